@@ -23,6 +23,7 @@ CREATE TABLE _timeseries_catalog.hypertable (
     id SERIAL PRIMARY KEY,
     schema_name TEXT NOT NULL,                 
     table_name TEXT NOT NULL,
+    last_value_column TEXT, -- series column of the last value cache, NULL = off
     created_at TIMESTAMPTZ NOT NULL DEFAULT NOW(),
     
     UNIQUE(schema_name, table_name)
@@ -36,13 +37,22 @@ CREATE TABLE _timeseries_catalog.dimension (
     hypertable_id INTEGER NOT NULL REFERENCES _timeseries_catalog.hypertable(id) ON DELETE CASCADE,
     column_name TEXT NOT NULL,
     column_type REGTYPE NOT NULL,
-    interval_length BIGINT NOT NULL,
+    interval_length BIGINT,     -- time dimension
+    num_partitions INTEGER,     -- hash (space) dimension
+    chunk_target_size BIGINT,   -- adaptive interval target in bytes, NULL = fixed interval
     
-    UNIQUE(hypertable_id)
+    UNIQUE(hypertable_id, column_name),
+    CHECK((interval_length IS NULL) <> (num_partitions IS NULL))
 );
 
+-- one time dimension and at most one space dimension per hypertable
+CREATE UNIQUE INDEX dimension_time_idx
+    ON _timeseries_catalog.dimension(hypertable_id) WHERE interval_length IS NOT NULL;
+CREATE UNIQUE INDEX dimension_space_idx
+    ON _timeseries_catalog.dimension(hypertable_id) WHERE num_partitions IS NOT NULL;
+
 COMMENT ON TABLE _timeseries_catalog.dimension IS 
-    'Stores time dimension information for each hypertable';
+    'Stores time and space dimension information for each hypertable';
 
 -- chunk
 CREATE TABLE _timeseries_catalog.chunk (
@@ -52,6 +62,7 @@ CREATE TABLE _timeseries_catalog.chunk (
     table_name TEXT NOT NULL, -- chunk name
     start_time BIGINT NOT NULL,                
     end_time BIGINT NOT NULL,
+    space_bucket INTEGER NOT NULL DEFAULT 0, -- hash dimension bucket, 0 without space dimension
     is_compressed BOOLEAN NOT NULL DEFAULT FALSE,
     created_at TIMESTAMPTZ NOT NULL DEFAULT NOW(),
     
@@ -76,12 +87,16 @@ SELECT
     h.table_name,
     d.column_name AS time_column,
     d.interval_length,
+    s.column_name AS space_column,
+    s.num_partitions,
     h.created_at,
     COUNT(c.id) AS num_chunks
 FROM _timeseries_catalog.hypertable h
-LEFT JOIN _timeseries_catalog.dimension d ON h.id = d.hypertable_id
+LEFT JOIN _timeseries_catalog.dimension d ON h.id = d.hypertable_id AND d.interval_length IS NOT NULL
+LEFT JOIN _timeseries_catalog.dimension s ON h.id = s.hypertable_id AND s.num_partitions IS NOT NULL
 LEFT JOIN _timeseries_catalog.chunk c ON h.id = c.hypertable_id
-GROUP BY h.id, h.schema_name, h.table_name, d.column_name, d.interval_length, h.created_at;
+GROUP BY h.id, h.schema_name, h.table_name, d.column_name, d.interval_length,
+         s.column_name, s.num_partitions, h.created_at;
 
 
 -- ==========================================
@@ -186,6 +201,23 @@ CREATE FUNCTION create_hypertable(
 AS 'MODULE_PATHNAME', 'create_hypertable'
 LANGUAGE C STRICT;
 
+-- hash partition chunks by column, before the first row is inserted
+CREATE FUNCTION add_dimension(
+    hypertable REGCLASS,
+    column_name TEXT,
+    number_partitions INTEGER
+) RETURNS VOID
+AS 'MODULE_PATHNAME', 'add_dimension'
+LANGUAGE C STRICT;
+
+-- size new chunks from recent chunk sizes: a size ('512MB'), 'estimate' (shared_buffers / 4) or 'off'
+CREATE FUNCTION set_adaptive_chunking(
+    hypertable REGCLASS,
+    chunk_target_size TEXT
+) RETURNS BIGINT
+AS 'MODULE_PATHNAME', 'set_adaptive_chunking'
+LANGUAGE C STRICT;
+
 -- drop hypertable
 CREATE FUNCTION drop_hypertable(
     table_name REGCLASS
@@ -193,6 +225,171 @@ CREATE FUNCTION drop_hypertable(
 AS 'MODULE_PATHNAME', 'drop_hypertable'
 LANGUAGE C STRICT;
 
+-- keep the newest row per series_column in shared memory, read with last_values()
+CREATE FUNCTION enable_last_value_cache(
+    hypertable REGCLASS,
+    series_column NAME
+) RETURNS VOID
+AS 'MODULE_PATHNAME', 'enable_last_value_cache'
+LANGUAGE C STRICT;
+
+CREATE FUNCTION disable_last_value_cache(
+    hypertable REGCLASS
+) RETURNS VOID
+AS 'MODULE_PATHNAME', 'disable_last_value_cache'
+LANGUAGE C STRICT;
+
+-- newest row of every series: SELECT * FROM last_values(NULL::sensor_data)
+CREATE FUNCTION last_values(
+    hypertable ANYELEMENT
+) RETURNS SETOF ANYELEMENT
+AS 'MODULE_PATHNAME', 'last_values'
+LANGUAGE C VOLATILE;
+
+-- ==========================================
+-- TIME BUCKET
+-- ==========================================
+
+-- round time down to the start of its bucket, buckets start at 2000-01-01 00:00 UTC (or origin)
+CREATE FUNCTION time_bucket(
+    bucket_width  INTERVAL,
+    ts            TIMESTAMPTZ
+) RETURNS TIMESTAMPTZ
+AS 'MODULE_PATHNAME', 'time_bucket'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE FUNCTION time_bucket(
+    bucket_width  INTERVAL,
+    ts            TIMESTAMPTZ,
+    origin        TIMESTAMPTZ
+) RETURNS TIMESTAMPTZ
+AS 'MODULE_PATHNAME', 'time_bucket_origin'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE FUNCTION time_bucket(
+    bucket_width  INTERVAL,
+    ts            TIMESTAMPTZ,
+    "offset"      INTERVAL
+) RETURNS TIMESTAMPTZ
+AS 'MODULE_PATHNAME', 'time_bucket_offset'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+-- timestamp has the same representation, same functions
+CREATE FUNCTION time_bucket(
+    bucket_width  INTERVAL,
+    ts            TIMESTAMP
+) RETURNS TIMESTAMP
+AS 'MODULE_PATHNAME', 'time_bucket'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE FUNCTION time_bucket(
+    bucket_width  INTERVAL,
+    ts            TIMESTAMP,
+    origin        TIMESTAMP
+) RETURNS TIMESTAMP
+AS 'MODULE_PATHNAME', 'time_bucket_origin'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE FUNCTION time_bucket(
+    bucket_width  INTERVAL,
+    ts            TIMESTAMP,
+    "offset"      INTERVAL
+) RETURNS TIMESTAMP
+AS 'MODULE_PATHNAME', 'time_bucket_offset'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+-- integer time, buckets start at 0 (or offset)
+CREATE FUNCTION time_bucket(
+    bucket_width  SMALLINT,
+    ts            SMALLINT,
+    "offset"      SMALLINT DEFAULT 0
+) RETURNS SMALLINT
+AS 'MODULE_PATHNAME', 'time_bucket_int16'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE FUNCTION time_bucket(
+    bucket_width  INTEGER,
+    ts            INTEGER,
+    "offset"      INTEGER DEFAULT 0
+) RETURNS INTEGER
+AS 'MODULE_PATHNAME', 'time_bucket_int32'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE FUNCTION time_bucket(
+    bucket_width  BIGINT,
+    ts            BIGINT,
+    "offset"      BIGINT DEFAULT 0
+) RETURNS BIGINT
+AS 'MODULE_PATHNAME', 'time_bucket_int64'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+-- time_bucket() that also returns rows for buckets without data when it is in GROUP BY,
+-- start / finish default to the time range in WHERE
+CREATE FUNCTION time_bucket_gapfill(
+    bucket_width  INTERVAL,
+    ts            TIMESTAMPTZ,
+    start         TIMESTAMPTZ DEFAULT NULL,
+    finish        TIMESTAMPTZ DEFAULT NULL
+) RETURNS TIMESTAMPTZ
+AS 'MODULE_PATHNAME', 'time_bucket_gapfill'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- in a gap filled query: value of the last bucket with data
+CREATE FUNCTION locf(
+    value         ANYELEMENT
+) RETURNS ANYELEMENT
+AS 'MODULE_PATHNAME', 'locf'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+-- in a gap filled query: linear between the buckets with data around the gap
+CREATE FUNCTION interpolate(
+    value         FLOAT8
+) RETURNS FLOAT8
+AS 'MODULE_PATHNAME', 'interpolate'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+-- ==========================================
+-- CHUNK SKIPPING
+-- ==========================================
+
+-- columns with min/max per chunk, the planner skips chunks on them like on time
+CREATE TABLE _timeseries_catalog.chunk_skipping_column (
+    id SERIAL PRIMARY KEY,
+    hypertable_id INTEGER NOT NULL REFERENCES _timeseries_catalog.hypertable(id) ON DELETE CASCADE,
+    column_name TEXT NOT NULL,
+
+    UNIQUE(hypertable_id, column_name)
+);
+
+-- range of a column in a chunk, binary (send) format of the column type
+CREATE TABLE _timeseries_catalog.chunk_column_stats (
+    chunk_id INTEGER NOT NULL REFERENCES _timeseries_catalog.chunk(id) ON DELETE CASCADE,
+    column_name TEXT NOT NULL,
+    range_min BYTEA,  -- NULL when the chunk has only NULLs in the column
+    range_max BYTEA,
+    valid BOOLEAN NOT NULL DEFAULT TRUE,  -- FALSE after UPDATE, chunk is not skipped
+
+    UNIQUE(chunk_id, column_name)
+);
+
+COMMENT ON TABLE _timeseries_catalog.chunk_column_stats IS
+    'Stores min/max of chunk skipping columns per chunk';
+
+-- track min/max of column per chunk (again: recompute all ranges)
+CREATE FUNCTION enable_chunk_skipping(
+    hypertable REGCLASS,
+    column_name NAME
+) RETURNS VOID
+AS 'MODULE_PATHNAME', 'enable_chunk_skipping'
+LANGUAGE C STRICT;
+
+CREATE FUNCTION disable_chunk_skipping(
+    hypertable REGCLASS,
+    column_name NAME
+) RETURNS VOID
+AS 'MODULE_PATHNAME', 'disable_chunk_skipping'
+LANGUAGE C STRICT;
+
 -- ==========================================
 -- TRIGGER FUNCTIONS
 -- ==========================================
@@ -201,6 +398,67 @@ RETURNS TRIGGER
 AS 'MODULE_PATHNAME', 'trigger_insert'
 LANGUAGE C;
 
+CREATE FUNCTION trigger_insert_flush()
+RETURNS TRIGGER
+AS 'MODULE_PATHNAME', 'trigger_insert_flush'
+LANGUAGE C;
+
+CREATE FUNCTION trigger_last_value_invalidate()
+RETURNS TRIGGER
+AS 'MODULE_PATHNAME', 'trigger_last_value_invalidate'
+LANGUAGE C;
+
+CREATE FUNCTION trigger_chunk_skipping_invalidate()
+RETURNS TRIGGER
+AS 'MODULE_PATHNAME', 'trigger_chunk_skipping_invalidate'
+LANGUAGE C;
+
+-- ==========================================
+-- COLUMNAR INGEST
+-- ==========================================
+
+-- one array per column (time column excluded, table column order), returns inserted rows
+-- not STRICT: a NULL array is an error instead of silently inserting nothing
+CREATE FUNCTION ingest_columns(
+    hypertable  REGCLASS,
+    times       TIMESTAMPTZ[],
+    VARIADIC columns "any"
+) RETURNS BIGINT
+AS 'MODULE_PATHNAME', 'ingest_columns'
+LANGUAGE C;
+
+-- ==========================================
+-- ASYNCHRONOUS INGEST
+-- ==========================================
+
+-- queue row for the ingest writer at commit, false when dropped (queue full)
+CREATE FUNCTION ingest_async(
+    hypertable  REGCLASS,
+    rec         RECORD
+) RETURNS BOOLEAN
+AS 'MODULE_PATHNAME', 'ingest_async'
+LANGUAGE C STRICT;
+
+-- write all queued rows of this database and of this transaction now (tests)
+CREATE FUNCTION ingest_async_flush()
+RETURNS VOID
+AS 'MODULE_PATHNAME', 'ingest_async_flush'
+LANGUAGE C STRICT;
+
+-- queue counters of this database
+CREATE FUNCTION ingest_async_stats(
+    OUT queue_depth         BIGINT,
+    OUT queue_bytes         BIGINT,
+    OUT enqueued            BIGINT,
+    OUT written             BIGINT,
+    OUT failed              BIGINT,
+    OUT dropped             BIGINT,
+    OUT backpressure_waits  BIGINT,
+    OUT writer_running      BOOLEAN
+) RETURNS RECORD
+AS 'MODULE_PATHNAME', 'ingest_async_stats'
+LANGUAGE C STRICT;
+
 -- ==========================================
 -- DATA RETENTION SYSTEM
 -- ==========================================
@@ -245,6 +503,41 @@ RETURNS VOID
 AS 'MODULE_PATHNAME', 'apply_retention_policies'
 LANGUAGE C STRICT; 
 
+-- ==========================================
+-- CHUNK PRE-CREATION
+-- ==========================================
+
+-- keep upcoming chunks created ahead of ingest
+CREATE TABLE _timeseries_catalog.precreate_policies (
+    hypertable_id INTEGER NOT NULL REFERENCES _timeseries_catalog.hypertable(id) ON DELETE CASCADE,
+    chunks_ahead INTEGER NOT NULL CHECK (chunks_ahead > 0),
+    created_at TIMESTAMPTZ NOT NULL DEFAULT NOW(),
+    updated_at TIMESTAMPTZ NOT NULL DEFAULT NOW(),
+
+    UNIQUE(hypertable_id)
+);
+
+-- set pre-creation policy (current chunk + upcoming chunks)
+CREATE FUNCTION set_chunk_precreate_policy(
+    hypertable    REGCLASS,
+    chunks_ahead  INTEGER
+) RETURNS VOID
+AS 'MODULE_PATHNAME', 'set_chunk_precreate_policy'
+LANGUAGE C STRICT;
+
+-- remove policy
+CREATE FUNCTION remove_chunk_precreate_policy(
+    hypertable  REGCLASS
+) RETURNS VOID
+AS 'MODULE_PATHNAME', 'remove_chunk_precreate_policy'
+LANGUAGE C STRICT;
+
+-- apply all policies now (manual), return number of chunks created
+CREATE FUNCTION apply_chunk_precreate_policies()
+RETURNS INTEGER
+AS 'MODULE_PATHNAME', 'apply_chunk_precreate_policies'
+LANGUAGE C STRICT;
+
 -- ==========================================
 -- CONTINUOUS AGGREGATES
 -- ==========================================
@@ -263,14 +556,6 @@ CREATE TABLE _timeseries_catalog.continuous_aggregate (
     updated_at        TIMESTAMPTZ
 );
 
--- round timestamp for place in the same bucket
-CREATE FUNCTION time_bucket(
-    bucket_width  INTERVAL,
-    ts            TIMESTAMPTZ
-) RETURNS TIMESTAMPTZ
-AS 'MODULE_PATHNAME', 'time_bucket'
-LANGUAGE C STRICT;
-
 -- create continuous aggregate
 CREATE FUNCTION create_continuous_aggregate(
     view_name         TEXT,
@@ -13,38 +13,91 @@
 #include <utils/timestamp.h>
 #include <utils/memutils.h>
 #include <utils/hsearch.h>
+#include <utils/inval.h>
+#include <utils/snapmgr.h>
+#include <storage/lock.h>
+#include <miscadmin.h>
 #include <executor/spi.h>
 
 #include "metadata.h"
 #include "chunk.h"
+#include "chunk_map.h"
+#include "chunk_adaptive.h"
+#include "hypertable_cache.h"
 
 /*
  * Chunk cache management
+ *
+ * Routing cache (hypertable_id, space_bucket, chunk_start) -> chunk, kept for the whole
+ * backend lifetime in CacheMemoryContext, so autocommit inserts hit the
+ * cache instead of querying the catalog.
+ *
+ * Entries are invalidated through relcache invalidation of the chunk table:
+ * DROP TABLE of a chunk (retention, drop_hypertable, compression) removes
+ * the entry in every backend, and an aborted chunk creation removes it
+ * locally. Misses are not cached, so chunk creation needs no invalidation.
+ * The cache is bounded by chunk_cache_max_entries, least recently used
+ * entries are evicted first.
+ * Misses go to the shared chunk map (chunk_map.c) before the catalog.
+ *
+ * The key slot is the time aligned to the hypertable's current interval.
+ * With adaptive chunking chunks have different widths, a slot can span two
+ * chunks, so a hit only counts when the time is inside the chunk's range.
  */
+int chunk_cache_max_entries = 1024;
+
 static HTAB *chunk_cache = NULL;
 static MemoryContext chunk_cache_context = NULL;
-static bool xact_callback_registered = false;
+static dlist_head chunk_cache_lru = DLIST_STATIC_INIT(chunk_cache_lru);
+static bool relcache_callback_registered = false;
 
-// reset pointer when transaction finished
 static void
-chunk_cache_xact_callback(XactEvent event, void *arg)
+chunk_cache_remove(ChunkCacheEntry *entry)
 {
-    switch(event){
-        case XACT_EVENT_COMMIT:
-        case XACT_EVENT_ABORT:
-            // reset pointer
-            chunk_cache = NULL;
-            chunk_cache_context = NULL;
-            elog(DEBUG1, "Chunk cache reset");
-            break;
-        default:
-            break;
+    dlist_delete(&entry->lru_node);
+    hash_search(chunk_cache, &entry->key, HASH_REMOVE, NULL);
+}
+
+// drop whole cache, it is rebuilt on demand
+static void
+chunk_cache_reset(void)
+{
+    if (chunk_cache_context != NULL){
+        MemoryContextDelete(chunk_cache_context);
+    }
+    chunk_cache = NULL;
+    chunk_cache_context = NULL;
+    dlist_init(&chunk_cache_lru);
+    elog(DEBUG1, "Chunk cache reset");
+}
+
+// chunk table changed or dropped
+static void
+chunk_cache_relcache_callback(Datum arg, Oid relid)
+{
+    HASH_SEQ_STATUS status;
+    ChunkCacheEntry *entry;
+
+    if (chunk_cache == NULL) return;
+
+    // InvalidOid = invalidate everything (eg. sinval queue overflow)
+    if (relid == InvalidOid){
+        chunk_cache_reset();
+        return;
+    }
+
+    hash_seq_init(&status, chunk_cache);
+    while ((entry = (ChunkCacheEntry *) hash_seq_search(&status)) != NULL){
+        if (entry->info.relid == relid){
+            elog(DEBUG1, "Chunk cache invalidate: chunk=%s", entry->info.table_name);
+            chunk_cache_remove(entry);
+        }
     }
 }
 
 // find chunk in cache
 static ChunkInfo*
-chunk_cache_search(int hypertable_id, int64 chunk_start)
+chunk_cache_search(int hypertable_id, int64 chunk_start, int space_bucket)
 {
     ChunkCacheKey key;
     ChunkCacheEntry *entry;
@@ -53,6 +106,7 @@ chunk_cache_search(int hypertable_id, int64 chunk_start)
     if (chunk_cache == NULL) return NULL;
 
     key.hypertable_id = hypertable_id;
+    key.space_bucket = space_bucket;
     key.chunk_start = chunk_start;
 
     entry = (ChunkCacheEntry *) hash_search(
@@ -64,6 +118,7 @@ chunk_cache_search(int hypertable_id, int64 chunk_start)
     
     if(found){
         // elog(NOTICE, "cache hit: hypertable=%d", hypertable_id);
+        dlist_move_head(&chunk_cache_lru, &entry->lru_node);
         return &entry->info;
     }
 
@@ -78,12 +133,23 @@ chunk_cache_insert(int hypertable_id, int64 chunk_start, ChunkInfo *info)
     ChunkCacheEntry *entry;
     bool found;
 
+    // entry without table can not be invalidated
+    if (info->relid == InvalidOid) return;
+
     if(chunk_cache == NULL){
         chunk_cache_init();
     }
 
     key.hypertable_id = hypertable_id;
+    key.space_bucket = info->space_bucket;
     key.chunk_start = chunk_start;
+
+    // evict least recently used
+    if (hash_get_num_entries(chunk_cache) >= chunk_cache_max_entries &&
+        !dlist_is_empty(&chunk_cache_lru)){
+        ChunkCacheEntry *lru = dlist_tail_element(ChunkCacheEntry, lru_node, &chunk_cache_lru);
+        chunk_cache_remove(lru);
+    }
     
     // search
     entry = (ChunkCacheEntry *) hash_search(
@@ -94,10 +160,16 @@ chunk_cache_insert(int hypertable_id, int64 chunk_start, ChunkInfo *info)
     );
 
     // copy to cache entry
+    if (found){
+        dlist_move_head(&chunk_cache_lru, &entry->lru_node);
+    }
+    else{
+        dlist_push_head(&chunk_cache_lru, &entry->lru_node);
+    }
     entry->key = key;
     memcpy(&entry->info, info, sizeof(ChunkInfo));
-    elog(DEBUG1, "Chunk cache INSERT: hypertable=%d, start=%ld, chunk=%s",
-        hypertable_id, chunk_start, info->table_name);
+    elog(DEBUG1, "Chunk cache INSERT: hypertable=%d, start=%ld, bucket=%d, chunk=%s",
+        hypertable_id, chunk_start, info->space_bucket, info->table_name);
 }
 
 void
@@ -107,18 +179,15 @@ chunk_cache_init(void)
     
     if (chunk_cache != NULL) return;
 
-    /*
-    * when transaction finish memory will get destroy,
-    * to avoid dangling pointer for next transaction, we need to reset pointer to NULL
-    */  
-    if(!xact_callback_registered){
-        RegisterXactCallback(chunk_cache_xact_callback, NULL); // reset pointer
-        xact_callback_registered = true;
+    // callback can not be unregistered, register once per backend
+    if(!relcache_callback_registered){
+        CacheRegisterRelcacheCallback(chunk_cache_relcache_callback, (Datum) 0);
+        relcache_callback_registered = true;
     }
 
-    // memory context for cache, it will reset when transaction finish
+    // memory context for cache, it lives as long as the backend
     chunk_cache_context = AllocSetContextCreate(
-        CurTransactionContext,  // chained with current transaction
+        CacheMemoryContext,
         "ChunkCache",
         ALLOCSET_DEFAULT_SIZES
     );
@@ -134,6 +203,7 @@ chunk_cache_init(void)
         &ctl,
         HASH_ELEM | HASH_BLOBS | HASH_CONTEXT
     );
+    dlist_init(&chunk_cache_lru);
 
     // elog(NOTICE, "Chunk cache initialized");
 }
@@ -147,10 +217,10 @@ chunk_get_next_number(int hypertable_id)
     StringInfoData query;
     int chunk_number = 1;
 
+    // sequence is not transactional, concurrent creators never get the same name
     initStringInfo(&query);
     appendStringInfo(&query,
-        "SELECT COALESCE(MAX(id), 0) + 1 FROM _timeseries_catalog.chunk "
-        "WHERE hypertable_id = %d", hypertable_id);
+        "SELECT nextval('_timeseries_catalog._hyper_%d_chunk_seq')", hypertable_id);
     
     int ret = SPI_execute(query.data, false, 0);
     if (ret != SPI_OK_SELECT || SPI_processed == 0){
@@ -158,11 +228,46 @@ chunk_get_next_number(int hypertable_id)
     }
     
     bool isnull;
-    chunk_number = DatumGetInt32(SPI_getbinval(SPI_tuptable->vals[0], SPI_tuptable->tupdesc, 1, &isnull));
+    chunk_number = (int) DatumGetInt64(SPI_getbinval(SPI_tuptable->vals[0], SPI_tuptable->tupdesc, 1, &isnull));
     
     return chunk_number;
 }
 
+/*
+ * Chunk creation lock
+ *
+ * [writer A: miss]      [writer B: miss]
+ *        ↓                     ↓
+ * [lock (ht, start)]    [lock (ht, start)] -- waits until A commits
+ *        ↓                     ↓
+ * [re-check: none]      [re-check: found] --> reuse A's chunk
+ *        ↓
+ * [CREATE TABLE, catalog insert]
+ *
+ * Advisory lock tag on (database, hypertable_id, chunk_start, space_bucket),
+ * held until transaction end, so only one backend runs the DDL for a chunk.
+ * Writers of other intervals, buckets or hypertables are not blocked (a hash
+ * collision of the tag only serializes two creators, it is never wrong).
+ * Adaptive hypertables lock the whole bucket: a new chunk's range is only
+ * known after the lock, two creators of different slots could overlap. The re-check runs on
+ * the latest snapshot, the statement snapshot does not see A's commit.
+ */
+#define CHUNK_CREATE_LOCK_CLASS 0x5453 // keeps tags apart from pg_advisory_lock(bigint / int, int)
+
+static void
+chunk_creation_lock(int hypertable_id, int64 chunk_start, int space_bucket)
+{
+    LOCKTAG tag;
+
+    SET_LOCKTAG_ADVISORY(tag,
+                         MyDatabaseId,
+                         (uint32) hypertable_id,
+                         (uint32) (chunk_start ^ (chunk_start >> 32)) ^ ((uint32) space_bucket * 0x9E3779B9),
+                         CHUNK_CREATE_LOCK_CLASS);
+
+    (void) LockAcquire(&tag, ExclusiveLock, false, false);
+}
+
 static Oid 
 chunk_create_table(const char *hypertable_schema,
                    const char *hypertable_name,
@@ -313,7 +418,7 @@ chunk_get_info(int chunk_id)
 
     initStringInfo(&query);
     appendStringInfo(&query, 
-        "SELECT schema_name, table_name, start_time, end_time "
+        "SELECT schema_name, table_name, start_time, end_time, space_bucket "
         "FROM _timeseries_catalog.chunk "
         "WHERE id = %d", chunk_id);
     
@@ -337,17 +442,23 @@ chunk_get_info(int chunk_id)
     datum = SPI_getbinval(SPI_tuptable->vals[0], SPI_tuptable->tupdesc, 4, &isnull);
     info->end_time = DatumGetInt64(datum);
 
+    datum = SPI_getbinval(SPI_tuptable->vals[0], SPI_tuptable->tupdesc, 5, &isnull);
+    info->space_bucket = DatumGetInt32(datum);
+
+    info->relid = get_relname_relid(info->table_name, get_namespace_oid(info->schema_name, true));
+
     return info;
 }
 
 ChunkInfo* 
-chunk_create(int hypertable_id, int64 time_point)
+chunk_create(int hypertable_id, int64 time_point, int space_bucket)
 {
     StringInfoData query;
     char *hypertable_schema;
     char *hypertable_name;
     char *time_column;
     int64 chunk_interval;
+    int64 target_size;
     int64 chunk_start;
     int64 chunk_end;
     int chunk_number;
@@ -358,9 +469,9 @@ chunk_create(int hypertable_id, int64 time_point)
     // fetch hypertable
     initStringInfo(&query);
     appendStringInfo(&query,
-        "SELECT h.schema_name, h.table_name, d.column_name, d.interval_length "
+        "SELECT h.schema_name, h.table_name, d.column_name, d.interval_length, d.chunk_target_size "
         "FROM _timeseries_catalog.hypertable h "
-        "JOIN _timeseries_catalog.dimension d ON h.id = d.hypertable_id "
+        "JOIN _timeseries_catalog.dimension d ON h.id = d.hypertable_id AND d.interval_length IS NOT NULL "
         "WHERE h.id = %d", hypertable_id);
     
     int ret = SPI_execute(query.data, true, 0);
@@ -383,10 +494,28 @@ chunk_create(int hypertable_id, int64 time_point)
     
     datum = SPI_getbinval(SPI_tuptable->vals[0], SPI_tuptable->tupdesc, 4, &isnull);
     chunk_interval = DatumGetInt64(datum);
+
+    datum = SPI_getbinval(SPI_tuptable->vals[0], SPI_tuptable->tupdesc, 5, &isnull);
+    target_size = isnull ? 0 : DatumGetInt64(datum);
+
+    // size the new chunk from the chunks before it
+    if (target_size > 0){
+        int64 adaptive_interval = chunk_adaptive_interval(hypertable_id, space_bucket, time_point,
+                                                          chunk_interval, target_size);
+        if (adaptive_interval != chunk_interval){
+            metadata_set_chunk_interval(hypertable_id, adaptive_interval);
+            // routing slot width of every backend
+            hypertable_cache_invalidate(get_relname_relid(hypertable_name, get_namespace_oid(hypertable_schema, false)));
+            chunk_interval = adaptive_interval;
+        }
+    }
     
     chunk_start = chunk_calculate_start(time_point, chunk_interval);
     chunk_end = chunk_calculate_end(chunk_start, chunk_interval);
 
+    // chunks of another width may already cover part of the range
+    metadata_clip_chunk_range(hypertable_id, space_bucket, time_point, &chunk_start, &chunk_end);
+
     // build chunk name
     chunk_number = chunk_get_next_number(hypertable_id);
     snprintf(chunk_name, NAMEDATALEN, "_hyper_%d_%d_chunk", hypertable_id, chunk_number);
@@ -405,58 +534,89 @@ chunk_create(int hypertable_id, int64 time_point)
                                     hypertable_schema,
                                     chunk_name,
                                     chunk_start,
-                                    chunk_end);
+                                    chunk_end,
+                                    space_bucket);
 
     CommandCounterIncrement();
 
     ChunkInfo *info = (ChunkInfo *) palloc(sizeof(ChunkInfo));
     info->chunk_id = chunk_id;
+    info->relid = chunk_oid;
     strcpy(info->schema_name, hypertable_schema);
     strcpy(info->table_name, chunk_name);
     info->start_time = chunk_start;
     info->end_time = chunk_end;
+    info->space_bucket = space_bucket;
 
-    chunk_cache_insert(hypertable_id, chunk_start, info);
-    
     elog(NOTICE, "✅ Chunk %d created successfully (OID: %u)", info->chunk_id, chunk_oid);
     return info;
 }
 
 ChunkInfo* 
-chunk_get_or_create(int hypertable_id, int64 timestamp)
+chunk_get_or_create(int hypertable_id, int64 chunk_interval, int64 timestamp, int space_bucket)
 {
-    int64 chunk_interval;
     int64 chunk_start;
     ChunkInfo *cached_info;
+    ChunkInfo *info;
+    ChunkInfo *result;
     int chunk_id;
 
     if (chunk_cache == NULL){
         chunk_cache_init();
     }
 
-    // calculate chunk start
-    chunk_interval = metadata_get_chunk_interval(hypertable_id);
-    if (chunk_interval == -1) {
-        ereport(ERROR, errmsg("invalid chunk interval for hypertable %d", hypertable_id));
-    }
+    // calculate chunk start (interval comes from the hypertable descriptor cache)
     chunk_start = chunk_calculate_start(timestamp, chunk_interval);
 
-    // search inside cache
-    cached_info = chunk_cache_search(hypertable_id, chunk_start);
-    if(cached_info != NULL){
-        ChunkInfo *result = (ChunkInfo *) palloc(sizeof(ChunkInfo));
-        memcpy(result, cached_info, sizeof(ChunkInfo)); // save in cache
+    // search inside cache, no catalog access on this path
+    result = (ChunkInfo *) palloc(sizeof(ChunkInfo));
+    cached_info = chunk_cache_search(hypertable_id, chunk_start, space_bucket);
+    if(cached_info != NULL && timestamp >= cached_info->start_time && timestamp < cached_info->end_time){
+        memcpy(result, cached_info, sizeof(ChunkInfo));
+        return result;
+    }
+
+    // chunk already known by another backend
+    if(chunk_map_lookup(hypertable_id, chunk_start, space_bucket, result) &&
+       timestamp >= result->start_time && timestamp < result->end_time){
+        chunk_cache_insert(hypertable_id, chunk_start, result);
         return result;
     }
 
-    // search inside database
-    chunk_id = metadata_find_chunk(hypertable_id, timestamp);
+    // search inside database, SPI memory is released by SPI_finish so copy the result out
+    SPI_connect();
+    chunk_id = metadata_find_chunk(hypertable_id, timestamp, space_bucket);
     if(chunk_id != -1){
-        ChunkInfo *info = chunk_get_info(chunk_id);
+        info = chunk_get_info(chunk_id);
         chunk_cache_insert(hypertable_id, chunk_start, info);
-        return info;
     }
+    else{
+        // serialize creators of this chunk, then look again for a chunk committed meanwhile
+        chunk_creation_lock(hypertable_id,
+                            metadata_get_chunk_target_size(hypertable_id) > 0 ? 0 : chunk_start,
+                            space_bucket);
+
+        // re-check and neighbour clipping in chunk_create() must see chunks committed meanwhile
+        PushActiveSnapshot(GetLatestSnapshot());
+        chunk_id = metadata_find_chunk(hypertable_id, timestamp, space_bucket);
+        if(chunk_id != -1){
+            info = chunk_get_info(chunk_id);
+            chunk_cache_insert(hypertable_id, chunk_start, info);
+        }
+        else{
+            // elog(NOTICE, "create chunk");
+            info = chunk_create(hypertable_id, timestamp, space_bucket);
+
+            // clipped or adaptive chunks start elsewhere, cache under the routing slot of timestamp
+            chunk_cache_insert(hypertable_id, chunk_start, info);
+        }
+        PopActiveSnapshot();
+    }
+    memcpy(result, info, sizeof(ChunkInfo));
+    SPI_finish();
+
+    // share with other backends once this transaction commits
+    chunk_map_publish(hypertable_id, chunk_start, result);
 
-    // elog(NOTICE, "create chunk");
-    return chunk_create(hypertable_id, timestamp);
+    return result;
 }
\ No newline at end of file
@@ -1,21 +1,25 @@
 #pragma once
 
 #include <postgres.h>
+#include <lib/ilist.h>
 #include <utils/hsearch.h>
 
 #define NAMEDATALEN 64
 
 typedef struct ChunkInfo {
     int chunk_id;
+    Oid relid; // chunk table, InvalidOid when table does not exist (eg. compressed)
     char schema_name[NAMEDATALEN];
     char table_name[NAMEDATALEN];
     int64 start_time;
     int64 end_time;
+    int space_bucket; // hash dimension bucket, 0 without space dimension
 } ChunkInfo;
 
 // cache key
 typedef struct ChunkCacheKey {
     int hypertable_id;
+    int space_bucket;
     int64 chunk_start;
 } ChunkCacheKey;
 
@@ -23,13 +27,17 @@ typedef struct ChunkCacheKey {
 typedef struct ChunkCacheEntry{
     ChunkCacheKey key;
     ChunkInfo info;
+    dlist_node lru_node; // head = most recently used
 } ChunkCacheEntry;
 
+// max number of chunks kept in the routing cache
+extern int chunk_cache_max_entries;
+
 
 extern int64 chunk_calculate_start(int64 time_point, int64 chunk_interval);
 extern int64 chunk_calculate_end(int64 chunk_start, int64 chunk_interval);
-extern ChunkInfo* chunk_create(int hypertable_id, int64 time_point);
-extern ChunkInfo* chunk_get_or_create(int hypertable_id, int64 timestamp);
+extern ChunkInfo* chunk_create(int hypertable_id, int64 time_point, int space_bucket);
+extern ChunkInfo* chunk_get_or_create(int hypertable_id, int64 chunk_interval, int64 timestamp, int space_bucket);
 extern ChunkInfo* chunk_get_info(int chunk_id);
 extern void chunk_drop_all_chunk(const char *schema_name, const char *table_name);
 
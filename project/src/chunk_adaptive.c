@@ -0,0 +1,150 @@
+#include <postgres.h>
+#include <fmgr.h>
+#include <executor/spi.h>
+#include <storage/bufmgr.h>
+#include <utils/builtins.h>
+#include <utils/lsyscache.h>
+#include <utils/timestamp.h>
+
+#include "metadata.h"
+#include "chunk_adaptive.h"
+
+/*
+    Adaptive chunk interval
+
+    SELECT set_adaptive_chunking('sensor_data', '512MB'); -- or 'estimate' / 'off'
+
+    [chunk_create() for time t]
+            ↓
+    [last chunks of the bucket that ended before t]
+            ↓ heap + index bytes / microseconds covered
+    [interval = target size / bytes per microsecond]
+            ↓ clamp, whole seconds
+    [dimension.interval_length = interval] --> this and following chunks
+
+    Every chunk keeps its own interval as [start_time, end_time) in the
+    catalog. Routing (metadata_find_chunk, cache hit check in chunk.c) and
+    constraint exclusion only use those ranges, so chunks of different widths
+    coexist, and chunk_create() clips a new chunk to its neighbours.
+
+    'estimate' targets a quarter of shared_buffers: the chunk being written
+    and its indexes stay cached next to a few chunks being read.
+*/
+#define ADAPTIVE_SAMPLE_CHUNKS 3
+#define ADAPTIVE_MAX_GROWTH 16 // per new chunk, one odd sample must not swing the interval too far
+#define ADAPTIVE_MIN_INTERVAL USECS_PER_MINUTE
+#define ADAPTIVE_MAX_INTERVAL (USECS_PER_DAY * 365)
+
+/*
+    Public function
+*/
+int64
+chunk_adaptive_interval(int hypertable_id,
+                        int space_bucket,
+                        int64 time_point,
+                        int64 current_interval,
+                        int64 target_size)
+{
+    StringInfoData query;
+    int ret;
+    double total_bytes = 0;
+    double total_us = 0;
+    int64 interval;
+
+    // compressed chunks have no table, their size says nothing about the raw data rate
+    initStringInfo(&query);
+    appendStringInfo(&query,
+        "SELECT c.end_time - c.start_time, pg_total_relation_size(r.oid), r.reltuples "
+        "FROM _timeseries_catalog.chunk c "
+        "JOIN pg_namespace n ON n.nspname = c.schema_name "
+        "JOIN pg_class r ON r.relnamespace = n.oid AND r.relname = c.table_name "
+        "WHERE c.hypertable_id = %d AND c.space_bucket = %d "
+        "AND c.end_time <= " INT64_FORMAT " AND NOT c.is_compressed "
+        "ORDER BY c.end_time DESC LIMIT %d",
+        hypertable_id, space_bucket, time_point, ADAPTIVE_SAMPLE_CHUNKS);
+
+    ret = SPI_execute(query.data, true, 0);
+    if (ret != SPI_OK_SELECT){
+        ereport(ERROR, errmsg("failed to read chunk sizes of hypertable %d", hypertable_id));
+    }
+
+    for (uint64 i = 0; i < SPI_processed; i++){
+        bool isnull;
+        int64 chunk_us = DatumGetInt64(SPI_getbinval(SPI_tuptable->vals[i], SPI_tuptable->tupdesc, 1, &isnull));
+        int64 chunk_bytes = DatumGetInt64(SPI_getbinval(SPI_tuptable->vals[i], SPI_tuptable->tupdesc, 2, &isnull));
+        float4 chunk_rows = DatumGetFloat4(SPI_getbinval(SPI_tuptable->vals[i], SPI_tuptable->tupdesc, 3, &isnull));
+
+        // analyzed and empty (-1 = never analyzed, size still counts)
+        if (chunk_rows == 0 || chunk_bytes <= 0) continue;
+
+        total_bytes += chunk_bytes;
+        total_us += chunk_us;
+    }
+
+    // first chunks, nothing to learn from yet
+    if (total_bytes <= 0){
+        return current_interval;
+    }
+
+    interval = (int64) (target_size * (total_us / total_bytes));
+
+    interval = Min(interval, current_interval * ADAPTIVE_MAX_GROWTH);
+    interval = Max(interval, current_interval / ADAPTIVE_MAX_GROWTH);
+    interval = Min(interval, ADAPTIVE_MAX_INTERVAL);
+    interval = Max(interval, ADAPTIVE_MIN_INTERVAL);
+    interval -= interval % USECS_PER_SEC;
+
+    elog(DEBUG1, "Adaptive chunking: hypertable %d, %.0f bytes over %.0f us, interval " INT64_FORMAT " -> " INT64_FORMAT,
+        hypertable_id, total_bytes, total_us, current_interval, interval);
+
+    return interval;
+}
+
+/*
+    Top level function
+*/
+PG_FUNCTION_INFO_V1(set_adaptive_chunking);
+Datum
+set_adaptive_chunking(PG_FUNCTION_ARGS)
+{
+    Oid table_oid = PG_GETARG_OID(0);
+    char *target_text = text_to_cstring(PG_GETARG_TEXT_PP(1));
+    char *schema_name = get_namespace_name(get_rel_namespace(table_oid));
+    char *table_name = get_rel_name(table_oid);
+    int64 target_size;
+    int hypertable_id;
+
+    if (pg_strcasecmp(target_text, "off") == 0){
+        target_size = 0;
+    }
+    else if (pg_strcasecmp(target_text, "estimate") == 0){
+        target_size = (int64) NBuffers * BLCKSZ / 4;
+    }
+    else{
+        target_size = DatumGetInt64(DirectFunctionCall1(pg_size_bytes, PG_GETARG_DATUM(1)));
+    }
+
+    if (target_size != 0 && target_size < ADAPTIVE_MIN_TARGET_SIZE){
+        ereport(ERROR,
+                (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                errmsg("chunk_target_size must be at least 1MB, 'estimate' or 'off'")));
+    }
+
+    SPI_connect();
+    hypertable_id = metadata_get_hypertable_id(schema_name, table_name);
+    if (hypertable_id == -1){
+        ereport(ERROR, errmsg("\"%s.%s\" is not a hypertable", schema_name, table_name));
+    }
+    metadata_set_chunk_target_size(hypertable_id, target_size);
+    SPI_finish();
+
+    if (target_size > 0){
+        elog(NOTICE, "Adaptive chunking enabled on \"%s.%s\", target chunk size %s", schema_name, table_name,
+            text_to_cstring(DatumGetTextPP(DirectFunctionCall1(pg_size_pretty, Int64GetDatum(target_size)))));
+    }
+    else{
+        elog(NOTICE, "Adaptive chunking disabled on \"%s.%s\"", schema_name, table_name);
+    }
+
+    PG_RETURN_INT64(target_size);
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <postgres.h>
+
+// smallest chunk_target_size accepted by set_adaptive_chunking
+#define ADAPTIVE_MIN_TARGET_SIZE (INT64CONST(1024) * 1024)
+
+
+// interval for a new chunk of (hypertable, bucket) at time_point, sized so it
+// reaches target_size bytes at the data rate of the chunks before it
+extern int64 chunk_adaptive_interval(int hypertable_id,
+                                     int space_bucket,
+                                     int64 time_point,
+                                     int64 current_interval,
+                                     int64 target_size);
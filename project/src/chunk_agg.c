@@ -0,0 +1,294 @@
+#include <postgres.h>
+#include <nodes/makefuncs.h>
+#include <nodes/nodeFuncs.h>
+#include <optimizer/appendinfo.h>
+#include <optimizer/cost.h>
+#include <optimizer/optimizer.h>
+#include <optimizer/pathnode.h>
+#include <optimizer/planner.h>
+#include <optimizer/prep.h>
+#include <optimizer/tlist.h>
+#include <parser/parsetree.h>
+#include <port/pg_bitutils.h>
+#include <utils/selfuncs.h>
+
+#include "chunk_exclusion.h"
+#include "chunk_agg.h"
+
+/*
+    Chunk-wise aggregation
+
+    SELECT time_bucket('1 hour', time), avg(temperature) FROM sensor_data GROUP BY 1
+
+    [Agg]                                   [Finalize HashAggregate]
+        ↓                                       ↓
+    [Append]                    ==>         [Gather] (only with parallel workers)
+        ↓                                       ↓
+    [c1] [c2] ... [cn]                      [Parallel Append]
+                                                ↓ one chunk per worker
+                                            [Partial HashAggregate] ... per chunk
+                                                ↓
+                                            [c1] ... [cn]
+
+    Every chunk is reduced to its groups (transition states) before the
+    Append, the rows going through Append and Gather are groups instead of
+    chunk rows. With Parallel Append every worker aggregates whole chunks, a
+    rollup over months of chunks uses max_parallel_workers_per_gather workers.
+    Both paths (with and without Gather) are offered next to the ones of the
+    planner, the cheapest one wins.
+
+    The aggregates must have combine (and for internal states serialize)
+    functions, as for any partial aggregation. Not used for grouping sets,
+    GROUP BY that can not be hashed, and time quals only known at execution
+    (now(), $1): ChunkAppend excludes chunks there and needs the plain Append.
+*/
+
+bool chunk_agg_enabled = true;
+
+static bool
+contains_param_walker(Node *node, void *context)
+{
+    if (node == NULL) return false;
+
+    if (IsA(node, Param)){
+        return true;
+    }
+    return expression_tree_walker(node, contains_param_walker, context);
+}
+
+// the Append of the aggregated rel, children are scans of chunks (and the hypertable)
+static AppendPath *
+chunk_agg_input_append(PlannerInfo *root, RelOptInfo *input_rel)
+{
+    Path *path = input_rel->cheapest_total_path;
+    AppendPath *append;
+    Oid hypertable_relid;
+    int64 start_time;
+    int64 end_time;
+    int n_chunks = 0;
+    ListCell *lc;
+
+    if (path == NULL) return NULL;
+
+    // scan/join target applied on top of the Append
+    if (IsA(path, ProjectionPath)){
+        path = ((ProjectionPath *) path)->subpath;
+    }
+    if (!IsA(path, AppendPath)) return NULL;
+
+    append = (AppendPath *) path;
+    if (append->path.parallel_aware || list_length(append->subpaths) < 2) return NULL;
+
+    foreach(lc, append->subpaths){
+        RelOptInfo *child_rel = ((Path *) lfirst(lc))->parent;
+        RangeTblEntry *rte;
+
+        if (child_rel->reloptkind != RELOPT_OTHER_MEMBER_REL || child_rel->rtekind != RTE_RELATION){
+            return NULL;
+        }
+
+        rte = planner_rt_fetch(child_rel->relid, root);
+        if (chunk_exclusion_chunk_range(rte->relid, &hypertable_relid, &start_time, &end_time)){
+            n_chunks++;
+        }
+    }
+
+    return n_chunks > 0 ? append : NULL;
+}
+
+// quals ChunkAppend excludes chunks with at execution
+static bool
+chunk_agg_runtime_quals(RelOptInfo *input_rel)
+{
+    ListCell *lc;
+
+    foreach(lc, input_rel->baserestrictinfo){
+        Node *clause = (Node *) ((RestrictInfo *) lfirst(lc))->clause;
+
+        if (contain_mutable_functions(clause) || contains_param_walker(clause, NULL)){
+            return true;
+        }
+    }
+    return false;
+}
+
+// grouping columns and partial aggregates (same as the planner builds for parallel aggregation)
+static PathTarget *
+chunk_agg_partial_target(PlannerInfo *root, PathTarget *grouping_target, Node *having_qual)
+{
+    PathTarget *partial_target = create_empty_pathtarget();
+    List *non_group_cols = NIL;
+    List *non_group_exprs;
+    ListCell *lc;
+
+    foreach(lc, grouping_target->exprs){
+        Expr *expr = (Expr *) lfirst(lc);
+        Index sgref = get_pathtarget_sortgroupref(grouping_target, foreach_current_index(lc));
+
+        if (sgref && get_sortgroupref_clause_noerr(sgref, root->processed_groupClause) != NULL){
+            add_column_to_pathtarget(partial_target, expr, sgref);
+        }
+        else{
+            non_group_cols = lappend(non_group_cols, expr);
+        }
+    }
+
+    if (having_qual != NULL){
+        non_group_cols = lappend(non_group_cols, having_qual);
+    }
+
+    non_group_exprs = pull_var_clause((Node *) non_group_cols,
+                                      PVC_INCLUDE_AGGREGATES |
+                                      PVC_RECURSE_WINDOWFUNCS |
+                                      PVC_INCLUDE_PLACEHOLDERS);
+    add_new_columns_to_pathtarget(partial_target, non_group_exprs);
+
+    // aggregates stop at the serialized transition state
+    foreach(lc, partial_target->exprs){
+        Aggref *aggref = (Aggref *) lfirst(lc);
+
+        if (IsA(aggref, Aggref)){
+            Aggref *partial = makeNode(Aggref);
+
+            memcpy(partial, aggref, sizeof(Aggref));
+            mark_partial_aggref(partial, AGGSPLIT_INITIAL_SERIAL);
+            lfirst(lc) = partial;
+        }
+    }
+
+    list_free(non_group_exprs);
+    list_free(non_group_cols);
+
+    return set_pathtarget_cost_width(root, partial_target);
+}
+
+// target of the parent rel translated to the columns of a child
+static PathTarget *
+chunk_agg_child_target(PlannerInfo *root, PathTarget *target, AppendRelInfo **appinfos, int nappinfos)
+{
+    PathTarget *child_target = copy_pathtarget(target);
+
+    child_target->exprs = (List *) adjust_appendrel_attrs(root, (Node *) child_target->exprs, nappinfos, appinfos);
+    return child_target;
+}
+
+/*
+    Public function
+*/
+void
+chunk_agg_add_paths(PlannerInfo *root, RelOptInfo *input_rel, RelOptInfo *grouped_rel, GroupPathExtraData *extra)
+{
+    Query *parse = root->parse;
+    AppendPath *append;
+    RelOptInfo *partial_rel;
+    AggStrategy strategy;
+    AggClauseCosts partial_costs;
+    AggClauseCosts final_costs;
+    List *group_exprs;
+    List *partial_paths = NIL;
+    double n_groups = 1;
+    double n_partial_groups = 0;
+    bool parallel_safe = true;
+    Path *path;
+    ListCell *lc;
+
+    if (!chunk_agg_enabled) return;
+
+    // transition states of the aggregates can be combined
+    if (!(extra->flags & GROUPING_CAN_PARTIAL_AGG) || parse->groupingSets != NIL) return;
+
+    if (root->processed_groupClause != NIL){
+        if (!(extra->flags & GROUPING_CAN_USE_HASH) || !enable_hashagg) return;
+        strategy = AGG_HASHED;
+    }
+    else{
+        strategy = AGG_PLAIN;
+    }
+
+    if (input_rel->reloptkind != RELOPT_BASEREL || !planner_rt_fetch(input_rel->relid, root)->inh){
+        return;
+    }
+    if (chunk_agg_runtime_quals(input_rel)) return;
+
+    append = chunk_agg_input_append(root, input_rel);
+    if (append == NULL) return;
+
+    MemSet(&partial_costs, 0, sizeof(AggClauseCosts));
+    MemSet(&final_costs, 0, sizeof(AggClauseCosts));
+    if (parse->hasAggs){
+        get_agg_clause_costs(root, AGGSPLIT_INITIAL_SERIAL, &partial_costs);
+        get_agg_clause_costs(root, AGGSPLIT_FINAL_DESERIAL, &final_costs);
+    }
+
+    // the planner has one when it considered parallel aggregation itself
+    partial_rel = fetch_upper_rel(root, UPPERREL_PARTIAL_GROUP_AGG, grouped_rel->relids);
+    if (partial_rel->reltarget->exprs == NIL){
+        partial_rel->reltarget = chunk_agg_partial_target(root, grouped_rel->reltarget, extra->havingQual);
+        partial_rel->consider_parallel = grouped_rel->consider_parallel;
+    }
+
+    group_exprs = get_sortgrouplist_exprs(root->processed_groupClause, parse->targetList);
+
+    // Partial Aggregate over every child
+    foreach(lc, append->subpaths){
+        Path *subpath = (Path *) lfirst(lc);
+        RelOptInfo *child_rel = subpath->parent;
+        AppendRelInfo **appinfos;
+        int nappinfos;
+        PathTarget *scan_target;
+        PathTarget *partial_target;
+        double child_groups = 1;
+
+        appinfos = find_appinfos_by_relids(root, child_rel->relids, &nappinfos);
+
+        // grouping expressions are computed in the child (time_bucket(...) of the chunk column)
+        scan_target = chunk_agg_child_target(root, input_rel->reltarget, appinfos, nappinfos);
+        subpath = (Path *) create_projection_path(root, child_rel, subpath, scan_target);
+
+        partial_target = chunk_agg_child_target(root, partial_rel->reltarget, appinfos, nappinfos);
+        if (group_exprs != NIL){
+            List *child_group_exprs = (List *) adjust_appendrel_attrs(root, (Node *) group_exprs, nappinfos, appinfos);
+
+            child_groups = estimate_num_groups(root, child_group_exprs, subpath->rows, NULL, NULL);
+        }
+        pfree(appinfos);
+
+        path = (Path *) create_agg_path(root, child_rel, subpath, partial_target,
+                                        strategy, AGGSPLIT_INITIAL_SERIAL,
+                                        root->processed_groupClause, NIL,
+                                        &partial_costs, child_groups);
+
+        partial_paths = lappend(partial_paths, path);
+        parallel_safe = parallel_safe && path->parallel_safe;
+        n_partial_groups += child_groups;
+    }
+
+    if (group_exprs != NIL){
+        n_groups = estimate_num_groups(root, group_exprs, append->path.rows, NULL, NULL);
+    }
+
+    // Finalize Aggregate -> Append
+    path = (Path *) create_append_path(root, partial_rel, list_copy(partial_paths), NIL, NIL, NULL,
+                                       0, false, -1);
+    add_path(grouped_rel, (Path *) create_agg_path(root, grouped_rel, path, grouped_rel->reltarget,
+                                                   strategy, AGGSPLIT_FINAL_DESERIAL,
+                                                   root->processed_groupClause, (List *) extra->havingQual,
+                                                   &final_costs, n_groups));
+
+    // Finalize Aggregate -> Gather -> Parallel Append, every worker takes whole chunks
+    if (parallel_safe && grouped_rel->consider_parallel && partial_rel->consider_parallel &&
+        enable_parallel_append && max_parallel_workers_per_gather > 0){
+        int parallel_workers = pg_leftmost_one_pos32(list_length(partial_paths)) + 1;
+
+        parallel_workers = Min(parallel_workers, max_parallel_workers_per_gather);
+
+        path = (Path *) create_append_path(root, partial_rel, list_copy(partial_paths), NIL, NIL, NULL,
+                                           parallel_workers, true, -1);
+        path = (Path *) create_gather_path(root, partial_rel, path, partial_rel->reltarget, NULL,
+                                           &n_partial_groups);
+        add_path(grouped_rel, (Path *) create_agg_path(root, grouped_rel, path, grouped_rel->reltarget,
+                                                       strategy, AGGSPLIT_FINAL_DESERIAL,
+                                                       root->processed_groupClause, (List *) extra->havingQual,
+                                                       &final_costs, n_groups));
+    }
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <postgres.h>
+#include <nodes/pathnodes.h>
+
+// aggregate every chunk below the Append (simple_timeseries.enable_chunkwise_aggregation)
+extern bool chunk_agg_enabled;
+
+// add Finalize Aggregate -> (Gather ->) Append -> Partial Aggregate per chunk paths to grouped_rel
+extern void chunk_agg_add_paths(PlannerInfo *root, RelOptInfo *input_rel, RelOptInfo *grouped_rel,
+                                GroupPathExtraData *extra);
@@ -0,0 +1,1004 @@
+#include <postgres.h>
+#include <access/stratnum.h>
+#include <catalog/pg_type.h>
+#include <commands/explain.h>
+#include <executor/executor.h>
+#include <nodes/execnodes.h>
+#include <nodes/extensible.h>
+#include <nodes/makefuncs.h>
+#include <nodes/nodeFuncs.h>
+#include <optimizer/clauses.h>
+#include <optimizer/optimizer.h>
+#include <parser/parsetree.h>
+#include <utils/lsyscache.h>
+#include <utils/typcache.h>
+
+#include "hypertable_cache.h"
+#include "chunk_exclusion.h"
+#include "chunk_append.h"
+
+/*
+    ChunkAppend
+
+    Executor node that replaces Append over chunk scans when the time quals
+    are only known at execution: now() - interval, $1 of a generic plan,
+    values from the outer side of a nested loop.
+
+    [Append]                                [Custom Scan (ChunkAppend)]
+        ↓                       ==>                 ↓ chunk range vs evaluated qual
+    [chunk 1] [chunk 2] ... [chunk n]       [chunk n-1] [chunk n]
+
+    - startup: quals with stable functions and extern parameters are
+      evaluated once, chunks that can not match are never initialized
+    - rescan: quals with executor parameters (nested loop inner side) are
+      evaluated again, chunks that can not match are skipped for that scan
+
+    Chunk ranges come from the catalog (chunk_exclusion.c). Children that are
+    not chunks (the hypertable itself) are always scanned. The chunk scans
+    keep their own quals, the node only skips whole chunks.
+
+    Ordered: a Sort or MergeAppend on the time column over chunks becomes a
+    ChunkAppend that reads the chunks one after another in time order, so
+    ORDER BY time DESC LIMIT n stops inside the latest chunks instead of
+    starting an index scan on (or sorting) every chunk.
+
+    [Limit]                                 [Limit]
+        ↓                                       ↓
+    [MergeAppend]               ==>         [MergeAppend]
+        ↓                                       ↓
+    [parent] [c1] [c2] [c3]                 [parent] [ChunkAppend ordered]
+                                                         ↓ latest first
+                                                     [c3] [c2] [c1]
+
+    The hypertable itself can hold rows inserted before create_hypertable,
+    it stays merged next to the chunks.
+
+    Append below ModifyTable (UPDATE/DELETE of a hypertable, the chunks are
+    result relations) is replaced the same way, excluded chunks are not scanned.
+
+    Parallel, async and SCROLL cursor plans keep the plain Append.
+*/
+
+typedef struct ChunkAppendClause {
+    int child;
+    int strategy; // of "time op value"
+    ExprState *value;
+} ChunkAppendClause;
+
+typedef struct ChunkAppendState {
+    CustomScanState css;
+    int n_children;
+    PlanState **children; // NULL when excluded at startup
+    bool *valid; // child can match current parameters
+    bool *needs_rescan;
+    int64 *start_times;
+    int64 *end_times;
+    List *runtime_clauses; // ChunkAppendClause, depend on executor parameters
+    bool runtime_done; // runtime exclusion done for current parameters
+    int current;
+    int startup_excluded;
+    int64 runtime_excluded; // summed over rescans, EXPLAIN ANALYZE
+} ChunkAppendState;
+
+static Node *chunk_append_state_create(CustomScan *cscan);
+static void chunk_append_begin(CustomScanState *node, EState *estate, int eflags);
+static TupleTableSlot *chunk_append_exec(CustomScanState *node);
+static void chunk_append_end(CustomScanState *node);
+static void chunk_append_rescan(CustomScanState *node);
+static void chunk_append_explain(CustomScanState *node, List *ancestors, ExplainState *es);
+
+static CustomScanMethods chunk_append_plan_methods = {
+    .CustomName = "ChunkAppend",
+    .CreateCustomScanState = chunk_append_state_create,
+};
+
+static CustomExecMethods chunk_append_exec_methods = {
+    .CustomName = "ChunkAppend",
+    .BeginCustomScan = chunk_append_begin,
+    .ExecCustomScan = chunk_append_exec,
+    .EndCustomScan = chunk_append_end,
+    .ReScanCustomScan = chunk_append_rescan,
+    .ExplainCustomScan = chunk_append_explain,
+};
+
+static bool
+contains_exec_param_walker(Node *node, void *context)
+{
+    if (node == NULL) return false;
+
+    if (IsA(node, Param)){
+        return ((Param *) node)->paramkind == PARAM_EXEC;
+    }
+    return expression_tree_walker(node, contains_exec_param_walker, context);
+}
+
+// true when no row of [start_time, end_time) can satisfy "time op value"
+static bool
+chunk_append_excluded(ExprContext *econtext, ExprState *value, int strategy, int64 start_time, int64 end_time)
+{
+    bool isnull;
+    Datum datum = ExecEvalExprSwitchContext(value, econtext, &isnull);
+    int64 time_value;
+
+    // strict comparison with NULL matches no row
+    if (isnull) return true;
+
+    time_value = DatumGetInt64(datum);
+    switch (strategy){
+        case BTLessStrategyNumber:
+            return start_time >= time_value;
+        case BTLessEqualStrategyNumber:
+            return start_time > time_value;
+        case BTEqualStrategyNumber:
+            return time_value < start_time || time_value >= end_time;
+        case BTGreaterEqualStrategyNumber:
+            return end_time <= time_value;
+        case BTGreaterStrategyNumber:
+            return end_time - 1 <= time_value;
+        default:
+            return false;
+    }
+}
+
+/*
+    Executor
+*/
+static Node *
+chunk_append_state_create(CustomScan *cscan)
+{
+    ChunkAppendState *state = (ChunkAppendState *) newNode(sizeof(ChunkAppendState), T_CustomScanState);
+
+    state->css.methods = &chunk_append_exec_methods;
+    return (Node *) state;
+}
+
+static void
+chunk_append_begin(CustomScanState *node, EState *estate, int eflags)
+{
+    ChunkAppendState *state = (ChunkAppendState *) node;
+    CustomScan *cscan = (CustomScan *) node->ss.ps.plan;
+    List *start_times = (List *) linitial(cscan->custom_private);
+    List *end_times = (List *) lsecond(cscan->custom_private);
+    List *clause_children = (List *) lthird(cscan->custom_private);
+    List *clause_strategies = (List *) lfourth(cscan->custom_private);
+    ExprContext *econtext = node->ss.ps.ps_ExprContext;
+    ListCell *lc_expr;
+    ListCell *lc_child;
+    ListCell *lc_strategy;
+    int i;
+
+    state->n_children = list_length(cscan->custom_plans);
+    state->children = (PlanState **) palloc0(state->n_children * sizeof(PlanState *));
+    state->valid = (bool *) palloc(state->n_children * sizeof(bool));
+    state->needs_rescan = (bool *) palloc0(state->n_children * sizeof(bool));
+    state->start_times = (int64 *) palloc(state->n_children * sizeof(int64));
+    state->end_times = (int64 *) palloc(state->n_children * sizeof(int64));
+
+    for (i = 0; i < state->n_children; i++){
+        state->start_times[i] = DatumGetInt64(((Const *) list_nth(start_times, i))->constvalue);
+        state->end_times[i] = DatumGetInt64(((Const *) list_nth(end_times, i))->constvalue);
+        state->valid[i] = true;
+    }
+
+    // stable functions and extern parameters do not change during the execution
+    ResetExprContext(econtext);
+    forthree(lc_expr, cscan->custom_exprs, lc_child, clause_children, lc_strategy, clause_strategies){
+        Expr *expr = (Expr *) lfirst(lc_expr);
+        int child = lfirst_int(lc_child);
+        int strategy = lfirst_int(lc_strategy);
+
+        if (contains_exec_param_walker((Node *) expr, NULL)){
+            ChunkAppendClause *clause = (ChunkAppendClause *) palloc(sizeof(ChunkAppendClause));
+
+            clause->child = child;
+            clause->strategy = strategy;
+            clause->value = ExecInitExpr(expr, &node->ss.ps);
+            state->runtime_clauses = lappend(state->runtime_clauses, clause);
+            continue;
+        }
+
+        if (state->valid[child] &&
+            chunk_append_excluded(econtext, ExecInitExpr(expr, &node->ss.ps), strategy,
+                                  state->start_times[child], state->end_times[child])){
+            state->valid[child] = false;
+        }
+    }
+
+    // excluded chunks are never initialized (no relation open, no index scan setup)
+    i = 0;
+    foreach(lc_expr, cscan->custom_plans){
+        if (state->valid[i]){
+            state->children[i] = ExecInitNode((Plan *) lfirst(lc_expr), estate, eflags);
+            node->custom_ps = lappend(node->custom_ps, state->children[i]);
+        }
+        else{
+            state->startup_excluded++;
+        }
+        i++;
+    }
+
+    state->current = 0;
+    state->runtime_done = false;
+}
+
+// exclusion for the current executor parameter values
+static void
+chunk_append_runtime_exclude(ChunkAppendState *state)
+{
+    ExprContext *econtext = state->css.ss.ps.ps_ExprContext;
+    ListCell *lc;
+
+    for (int i = 0; i < state->n_children; i++){
+        state->valid[i] = (state->children[i] != NULL);
+    }
+
+    if (state->runtime_clauses == NIL) return;
+
+    ResetExprContext(econtext);
+    foreach(lc, state->runtime_clauses){
+        ChunkAppendClause *clause = (ChunkAppendClause *) lfirst(lc);
+
+        if (state->valid[clause->child] &&
+            chunk_append_excluded(econtext, clause->value, clause->strategy,
+                                  state->start_times[clause->child], state->end_times[clause->child])){
+            state->valid[clause->child] = false;
+            state->runtime_excluded++;
+        }
+    }
+}
+
+static TupleTableSlot *
+chunk_append_exec(CustomScanState *node)
+{
+    ChunkAppendState *state = (ChunkAppendState *) node;
+
+    if (!state->runtime_done){
+        chunk_append_runtime_exclude(state);
+        state->runtime_done = true;
+    }
+
+    while (state->current < state->n_children){
+        PlanState *child = state->children[state->current];
+        TupleTableSlot *slot;
+
+        if (child == NULL || !state->valid[state->current]){
+            state->current++;
+            continue;
+        }
+
+        // children with changed parameters are rescanned by ExecProcNode
+        if (state->needs_rescan[state->current]){
+            state->needs_rescan[state->current] = false;
+            if (child->chgParam == NULL){
+                ExecReScan(child);
+            }
+        }
+
+        CHECK_FOR_INTERRUPTS();
+
+        slot = ExecProcNode(child);
+        if (!TupIsNull(slot)){
+            return slot;
+        }
+        state->current++;
+    }
+
+    return NULL;
+}
+
+static void
+chunk_append_end(CustomScanState *node)
+{
+    ChunkAppendState *state = (ChunkAppendState *) node;
+
+    for (int i = 0; i < state->n_children; i++){
+        if (state->children[i] != NULL){
+            ExecEndNode(state->children[i]);
+        }
+    }
+}
+
+static void
+chunk_append_rescan(CustomScanState *node)
+{
+    ChunkAppendState *state = (ChunkAppendState *) node;
+
+    // skipped chunks are only rescanned when they are visited again
+    for (int i = 0; i < state->n_children; i++){
+        if (state->children[i] == NULL) continue;
+
+        if (node->ss.ps.chgParam != NULL){
+            UpdateChangedParamSet(state->children[i], node->ss.ps.chgParam);
+        }
+        state->needs_rescan[i] = true;
+    }
+
+    state->current = 0;
+    state->runtime_done = false;
+}
+
+static void
+chunk_append_explain(CustomScanState *node, List *ancestors, ExplainState *es)
+{
+    ChunkAppendState *state = (ChunkAppendState *) node;
+    CustomScan *cscan = (CustomScan *) node->ss.ps.plan;
+
+    if (boolVal(list_nth(cscan->custom_private, 4))){
+        ExplainPropertyBool("Ordered", true, es);
+    }
+    ExplainPropertyInteger("Chunks excluded during startup", NULL, state->startup_excluded, es);
+    if (es->analyze && state->runtime_clauses != NIL){
+        ExplainPropertyInteger("Chunks excluded during runtime", NULL, state->runtime_excluded, es);
+    }
+}
+
+/*
+    Plan
+*/
+typedef struct ChunkAppendChild {
+    Plan *plan;
+    bool is_chunk; // false for the hypertable itself and other non chunk scans
+    Index scanrelid;
+    Oid hypertable_relid;
+    Oid time_type;
+    AttrNumber time_attnum; // in the chunk
+    int64 start_time;
+    int64 end_time;
+    List *clauses; // values of execution time "time op value" quals
+    List *strategies;
+} ChunkAppendChild;
+
+typedef struct ChunkAppendContext {
+    PlannedStmt *stmt;
+    int next_plan_node_id; // Sort and ChunkAppend nodes added to the plan
+} ChunkAppendContext;
+
+// relation scanned by an Append child, 0 when the child is not a plain scan
+static Index
+chunk_append_scanrelid(Plan *plan)
+{
+    switch (nodeTag(plan)){
+        case T_SeqScan:
+        case T_SampleScan:
+        case T_IndexScan:
+        case T_IndexOnlyScan:
+        case T_BitmapHeapScan:
+        case T_TidScan:
+        case T_TidRangeScan:
+            return ((Scan *) plan)->scanrelid;
+        default:
+            return 0;
+    }
+}
+
+// relation scan of a child, also below the Sort of a merged child, NULL when there is none
+static Plan *
+chunk_append_child_scan(Plan *plan)
+{
+    if (IsA(plan, Sort) && plan->lefttree != NULL) plan = plan->lefttree;
+    return chunk_append_scanrelid(plan) != 0 ? plan : NULL;
+}
+
+// quals of a chunk scan in terms of the chunk columns
+static List *
+chunk_append_scan_quals(Plan *plan)
+{
+    switch (nodeTag(plan)){
+        case T_IndexScan:
+            return list_concat_copy(((IndexScan *) plan)->indexqualorig, plan->qual);
+        case T_BitmapHeapScan:
+            return list_concat_copy(((BitmapHeapScan *) plan)->bitmapqualorig, plan->qual);
+        default:
+            return plan->qual;
+    }
+}
+
+// "time op value" where value is known at execution only, false otherwise
+static bool
+chunk_append_runtime_clause(Expr *clause, Index scanrelid, AttrNumber time_attnum, Oid time_type,
+                            Expr **value, int *strategy)
+{
+    OpExpr *op;
+    Node *left;
+    Node *right;
+    Node *other;
+    bool var_on_left;
+    TypeCacheEntry *typentry;
+
+    if (!IsA(clause, OpExpr)) return false;
+
+    op = (OpExpr *) clause;
+    if (list_length(op->args) != 2) return false;
+
+    left = linitial(op->args);
+    right = lsecond(op->args);
+    if (IsA(left, Var) && ((Var *) left)->varno == scanrelid && ((Var *) left)->varattno == time_attnum){
+        other = right;
+        var_on_left = true;
+    }
+    else if (IsA(right, Var) && ((Var *) right)->varno == scanrelid && ((Var *) right)->varattno == time_attnum){
+        other = left;
+        var_on_left = false;
+    }
+    else{
+        return false;
+    }
+
+    // constants were already used by the planner
+    if (IsA(other, Const) || exprType(other) != time_type) return false;
+    if (contain_var_clause(other) || contain_volatile_functions(other) || contain_subplans(other)) return false;
+
+    typentry = lookup_type_cache(time_type, TYPECACHE_BTREE_OPFAMILY);
+    *strategy = get_op_opfamily_strategy(op->opno, typentry->btree_opf);
+    if (*strategy == InvalidStrategy) return false;
+
+    if (!var_on_left){
+        *strategy = chunk_exclusion_commute_strategy(*strategy);
+    }
+
+    *value = (Expr *) other;
+    return true;
+}
+
+static Const *
+make_int8_const(int64 value)
+{
+    return makeConst(INT8OID, -1, InvalidOid, sizeof(int64), Int64GetDatum(value), false, FLOAT8PASSBYVAL);
+}
+
+// chunk range and execution time quals of one child
+static void
+chunk_append_child_init(PlannedStmt *stmt, Plan *plan, ChunkAppendChild *child)
+{
+    Plan *scan = chunk_append_child_scan(plan);
+    RangeTblEntry *rte;
+    HypertableInfo ht_info;
+    Oid hypertable_relid;
+    int64 start_time;
+    int64 end_time;
+    ListCell *lc;
+
+    memset(child, 0, sizeof(ChunkAppendChild));
+    child->plan = plan;
+    child->start_time = PG_INT64_MIN;
+    child->end_time = PG_INT64_MAX;
+
+    if (scan == NULL) return;
+
+    child->scanrelid = chunk_append_scanrelid(scan);
+    rte = rt_fetch(child->scanrelid, stmt->rtable);
+    if (rte->rtekind != RTE_RELATION) return;
+    if (!chunk_exclusion_chunk_range(rte->relid, &hypertable_relid, &start_time, &end_time)) return;
+    if (!hypertable_cache_lookup(hypertable_relid, &ht_info)) return;
+    if (ht_info.time_type != TIMESTAMPTZOID && ht_info.time_type != TIMESTAMPOID) return;
+
+    child->is_chunk = true;
+    child->hypertable_relid = hypertable_relid;
+    child->time_type = ht_info.time_type;
+    child->start_time = start_time;
+    child->end_time = end_time;
+
+    // chunks may have another attnum layout than the hypertable
+    child->time_attnum = get_attnum(rte->relid, get_attname(hypertable_relid, ht_info.time_attnum, false));
+
+    foreach(lc, chunk_append_scan_quals(scan)){
+        Expr *value;
+        int strategy;
+
+        if (!chunk_append_runtime_clause((Expr *) lfirst(lc), child->scanrelid, child->time_attnum,
+                                         child->time_type, &value, &strategy)){
+            continue;
+        }
+        child->clauses = lappend(child->clauses, copyObject(value));
+        child->strategies = lappend_int(child->strategies, strategy);
+    }
+}
+
+// ChunkAppend visiting children in array order, costs are the sum of the children
+static CustomScan *
+chunk_append_make(ChunkAppendChild *children, int n_children, bool ordered)
+{
+    CustomScan *cscan = makeNode(CustomScan);
+    Plan *first = children[0].plan;
+    List *tlist = NIL;
+    List *start_times = NIL;
+    List *end_times = NIL;
+    List *clauses = NIL;
+    List *clause_children = NIL;
+    List *clause_strategies = NIL;
+    ListCell *lc;
+
+    // a custom scan reads the tuple of its children as INDEX_VAR
+    foreach(lc, first->targetlist){
+        TargetEntry *tle = (TargetEntry *) lfirst(lc);
+        Var *var = makeVar(INDEX_VAR, tle->resno, exprType((Node *) tle->expr),
+                           exprTypmod((Node *) tle->expr), exprCollation((Node *) tle->expr), 0);
+
+        tlist = lappend(tlist, makeTargetEntry((Expr *) var, tle->resno, tle->resname, tle->resjunk));
+    }
+
+    cscan->scan.plan.startup_cost = first->startup_cost;
+    cscan->scan.plan.plan_width = first->plan_width;
+    cscan->scan.plan.parallel_safe = true;
+
+    for (int i = 0; i < n_children; i++){
+        ChunkAppendChild *child = &children[i];
+        ListCell *lc_strategy;
+
+        start_times = lappend(start_times, make_int8_const(child->start_time));
+        end_times = lappend(end_times, make_int8_const(child->end_time));
+        forboth(lc, child->clauses, lc_strategy, child->strategies){
+            clauses = lappend(clauses, lfirst(lc));
+            clause_children = lappend_int(clause_children, i);
+            clause_strategies = lappend_int(clause_strategies, lfirst_int(lc_strategy));
+        }
+
+        cscan->custom_plans = lappend(cscan->custom_plans, child->plan);
+        cscan->scan.plan.total_cost += child->plan->total_cost;
+        cscan->scan.plan.plan_rows += child->plan->plan_rows;
+        cscan->scan.plan.parallel_safe &= child->plan->parallel_safe;
+        // execution time quals come from the children, so do their parameters
+        cscan->scan.plan.extParam = bms_add_members(cscan->scan.plan.extParam, child->plan->extParam);
+        cscan->scan.plan.allParam = bms_add_members(cscan->scan.plan.allParam, child->plan->allParam);
+    }
+
+    cscan->scan.scanrelid = 0;
+    cscan->scan.plan.targetlist = tlist;
+    // scan tuple described by a relation scan, so EXPLAIN VERBOSE can name the columns
+    cscan->custom_scan_tlist = copyObject(chunk_append_child_scan(first)->targetlist);
+    cscan->custom_exprs = clauses;
+    cscan->custom_private = list_make5(start_times, end_times, clause_children, clause_strategies,
+                                       makeBoolean(ordered));
+    cscan->methods = &chunk_append_plan_methods;
+    return cscan;
+}
+
+static Plan *
+chunk_append_from_append(ChunkAppendContext *ctx, Append *append)
+{
+    ChunkAppendChild *children;
+    CustomScan *cscan;
+    bool has_clauses = false;
+    ListCell *lc;
+    int i = 0;
+
+    if (append->appendplans == NIL || append->part_prune_info != NULL ||
+        append->nasyncplans > 0 || append->plan.parallel_aware){
+        return (Plan *) append;
+    }
+    if (chunk_append_child_scan((Plan *) linitial(append->appendplans)) == NULL) return (Plan *) append;
+
+    children = (ChunkAppendChild *) palloc(list_length(append->appendplans) * sizeof(ChunkAppendChild));
+    foreach(lc, append->appendplans){
+        ChunkAppendChild *child = &children[i++];
+
+        if (((Plan *) lfirst(lc))->parallel_aware) return (Plan *) append;
+
+        // not a chunk (the hypertable itself): always scanned
+        chunk_append_child_init(ctx->stmt, (Plan *) lfirst(lc), child);
+        if (child->clauses != NIL) has_clauses = true;
+    }
+
+    // nothing to decide at execution, Append is as good
+    if (!has_clauses) return (Plan *) append;
+
+    cscan = chunk_append_make(children, i, false);
+    cscan->scan.plan.initPlan = append->plan.initPlan;
+    cscan->scan.plan.startup_cost = append->plan.startup_cost;
+    cscan->scan.plan.total_cost = append->plan.total_cost;
+    cscan->scan.plan.plan_rows = append->plan.plan_rows;
+    cscan->scan.plan.plan_width = append->plan.plan_width;
+    cscan->scan.plan.parallel_safe = append->plan.parallel_safe;
+    cscan->scan.plan.plan_node_id = append->plan.plan_node_id;
+    cscan->scan.plan.extParam = append->plan.extParam;
+    cscan->scan.plan.allParam = append->plan.allParam;
+
+    elog(DEBUG1, "ChunkAppend: %d chunk scan(s), %d execution time qual(s)",
+         list_length(cscan->custom_plans), list_length(cscan->custom_exprs));
+    return (Plan *) cscan;
+}
+
+// 1 when sortop sorts time_type ascending, -1 descending, 0 for any other operator
+static int
+chunk_append_sort_direction(Oid sortop, Oid time_type)
+{
+    TypeCacheEntry *typentry = lookup_type_cache(time_type, TYPECACHE_BTREE_OPFAMILY);
+
+    switch (get_op_opfamily_strategy(sortop, typentry->btree_opf)){
+        case BTLessStrategyNumber:
+            return 1;
+        case BTGreaterStrategyNumber:
+            return -1;
+        default:
+            return 0;
+    }
+}
+
+// true when output column colno of a chunk child is the chunk time column
+static bool
+chunk_append_sorts_on_time(ChunkAppendChild *child, AttrNumber colno)
+{
+    Plan *plan = child->plan;
+    TargetEntry *tle;
+    Var *var;
+
+    // a Sort outputs the columns of its input
+    if (IsA(plan, Sort)){
+        tle = get_tle_by_resno(plan->targetlist, colno);
+        if (tle == NULL || !IsA(tle->expr, Var) || ((Var *) tle->expr)->varno != OUTER_VAR) return false;
+        colno = ((Var *) tle->expr)->varattno;
+        plan = plan->lefttree;
+    }
+
+    tle = get_tle_by_resno(plan->targetlist, colno);
+    if (tle == NULL || !IsA(tle->expr, Var)) return false;
+
+    // index only scan output refers to the index columns
+    if (IsA(plan, IndexOnlyScan) && ((Var *) tle->expr)->varno == INDEX_VAR){
+        tle = get_tle_by_resno(((IndexOnlyScan *) plan)->indextlist, ((Var *) tle->expr)->varattno);
+        if (tle == NULL || !IsA(tle->expr, Var)) return false;
+    }
+
+    var = (Var *) tle->expr;
+    return var->varno == child->scanrelid && var->varattno == child->time_attnum;
+}
+
+static int
+chunk_append_child_cmp(const void *a, const void *b)
+{
+    const ChunkAppendChild *child_a = *(ChunkAppendChild *const *) a;
+    const ChunkAppendChild *child_b = *(ChunkAppendChild *const *) b;
+
+    if (child_a->start_time < child_b->start_time) return -1;
+    if (child_a->start_time > child_b->start_time) return 1;
+    return 0;
+}
+
+/*
+    Children of a merge sorted on the chunk time column: chunks with
+    non-overlapping ranges are read one after another by an ordered
+    ChunkAppend, so the merge only compares the first rows of a few inputs
+
+    [MergeAppend]                       [MergeAppend]
+        ↓                     ==>           ↓
+    [parent] [c1] [c2] [c3]             [parent] [ChunkAppend ordered: c3 c2 c1]
+
+    Chunks are split into chains where no two chunks overlap (one chain per
+    space partition). NIL when the children are not sorted on time or no
+    chain holds more than one chunk.
+*/
+static List *
+chunk_append_ordered(ChunkAppendContext *ctx, List *plans, AttrNumber sort_col, Oid sortop)
+{
+    int n_plans = list_length(plans);
+    ChunkAppendChild *children = (ChunkAppendChild *) palloc(n_plans * sizeof(ChunkAppendChild));
+    ChunkAppendChild **chunks = (ChunkAppendChild **) palloc(n_plans * sizeof(ChunkAppendChild *));
+    List **chains;
+    int n_chunks = 0;
+    int n_chains = 0;
+    Oid hypertable_relid = InvalidOid;
+    int direction = 0;
+    bool combined = false;
+    List *result = NIL;
+    ListCell *lc;
+    int i = 0;
+
+    foreach(lc, plans){
+        ChunkAppendChild *child = &children[i++];
+
+        if (((Plan *) lfirst(lc))->parallel_aware) return NIL;
+
+        chunk_append_child_init(ctx->stmt, (Plan *) lfirst(lc), child);
+        if (!child->is_chunk) continue;
+
+        if (!OidIsValid(hypertable_relid)){
+            hypertable_relid = child->hypertable_relid;
+            direction = chunk_append_sort_direction(sortop, child->time_type);
+        }
+        if (child->hypertable_relid != hypertable_relid || direction == 0 ||
+            !chunk_append_sorts_on_time(child, sort_col)){
+            return NIL;
+        }
+        chunks[n_chunks++] = child;
+    }
+    if (n_chunks < 2) return NIL;
+
+    qsort(chunks, n_chunks, sizeof(ChunkAppendChild *), chunk_append_child_cmp);
+    chains = (List **) palloc0(n_chunks * sizeof(List *));
+    for (i = 0; i < n_chunks; i++){
+        int chain;
+
+        for (chain = 0; chain < n_chains; chain++){
+            if (((ChunkAppendChild *) llast(chains[chain]))->end_time <= chunks[i]->start_time) break;
+        }
+        if (chain == n_chains) n_chains++;
+        chains[chain] = lappend(chains[chain], chunks[i]);
+    }
+
+    // the hypertable itself and other inputs stay merged as they are
+    for (i = 0; i < n_plans; i++){
+        if (!children[i].is_chunk) result = lappend(result, children[i].plan);
+    }
+
+    for (int chain = 0; chain < n_chains; chain++){
+        int length = list_length(chains[chain]);
+        ChunkAppendChild *ordered;
+        CustomScan *cscan;
+
+        if (length == 1){
+            result = lappend(result, ((ChunkAppendChild *) linitial(chains[chain]))->plan);
+            continue;
+        }
+
+        // descending order reads the latest chunk first
+        ordered = (ChunkAppendChild *) palloc(length * sizeof(ChunkAppendChild));
+        i = 0;
+        foreach(lc, chains[chain]){
+            ordered[direction > 0 ? i : length - 1 - i] = *(ChunkAppendChild *) lfirst(lc);
+            i++;
+        }
+
+        cscan = chunk_append_make(ordered, length, true);
+        cscan->scan.plan.plan_node_id = ctx->next_plan_node_id++;
+        result = lappend(result, cscan);
+        combined = true;
+    }
+
+    return combined ? result : NIL;
+}
+
+static Plan *
+chunk_append_from_merge_append(ChunkAppendContext *ctx, MergeAppend *merge)
+{
+    List *plans;
+
+    if (merge->mergeplans == NIL || merge->part_prune_info != NULL || merge->plan.parallel_aware) return (Plan *) merge;
+
+    plans = chunk_append_ordered(ctx, merge->mergeplans, merge->sortColIdx[0], merge->sortOperators[0]);
+    if (plans == NIL) return (Plan *) merge;
+
+    elog(DEBUG1, "ChunkAppend: %d merge input(s) instead of %d",
+         list_length(plans), list_length(merge->mergeplans));
+    merge->mergeplans = plans;
+    return (Plan *) merge;
+}
+
+// Sort with the keys of sort over one Append child
+static Plan *
+chunk_append_make_sort(ChunkAppendContext *ctx, Sort *sort, Plan *child, Cost sort_cost)
+{
+    Sort *child_sort = makeNode(Sort);
+    ListCell *lc;
+
+    foreach(lc, child->targetlist){
+        TargetEntry *tle = (TargetEntry *) lfirst(lc);
+        Var *var = makeVar(OUTER_VAR, tle->resno, exprType((Node *) tle->expr),
+                           exprTypmod((Node *) tle->expr), exprCollation((Node *) tle->expr), 0);
+
+        child_sort->plan.targetlist = lappend(child_sort->plan.targetlist,
+                                              makeTargetEntry((Expr *) var, tle->resno, tle->resname, tle->resjunk));
+    }
+
+    child_sort->plan.lefttree = child;
+    child_sort->plan.startup_cost = child->total_cost + sort_cost;
+    child_sort->plan.total_cost = child_sort->plan.startup_cost;
+    child_sort->plan.plan_rows = child->plan_rows;
+    child_sort->plan.plan_width = child->plan_width;
+    child_sort->plan.parallel_safe = child->parallel_safe;
+    child_sort->plan.extParam = bms_copy(child->extParam);
+    child_sort->plan.allParam = bms_copy(child->allParam);
+    child_sort->plan.plan_node_id = ctx->next_plan_node_id++;
+
+    child_sort->numCols = sort->numCols;
+    child_sort->sortColIdx = (AttrNumber *) palloc(sort->numCols * sizeof(AttrNumber));
+    child_sort->sortOperators = (Oid *) palloc(sort->numCols * sizeof(Oid));
+    child_sort->collations = (Oid *) palloc(sort->numCols * sizeof(Oid));
+    child_sort->nullsFirst = (bool *) palloc(sort->numCols * sizeof(bool));
+    memcpy(child_sort->sortColIdx, sort->sortColIdx, sort->numCols * sizeof(AttrNumber));
+    memcpy(child_sort->sortOperators, sort->sortOperators, sort->numCols * sizeof(Oid));
+    memcpy(child_sort->collations, sort->collations, sort->numCols * sizeof(Oid));
+    memcpy(child_sort->nullsFirst, sort->nullsFirst, sort->numCols * sizeof(bool));
+    return (Plan *) child_sort;
+}
+
+/*
+    Sort over an Append of chunks: each chunk is sorted on its own and the
+    chunks are read in time order, a LIMIT above stops after the first chunks
+
+    [Sort]                              [MergeAppend]
+        ↓                                   ↓
+    [Append]                  ==>       [Sort]  [ChunkAppend ordered]
+        ↓                                   ↓       ↓
+    [parent] [c1] [c2]                  [parent] [Sort] [Sort]
+                                                    ↓      ↓
+                                                  [c2]   [c1]
+
+    NULL when the Sort is not on the chunk time column.
+*/
+static Plan *
+chunk_append_from_sort(ChunkAppendContext *ctx, Sort *sort)
+{
+    Append *append = (Append *) sort->plan.lefttree;
+    int next_plan_node_id = ctx->next_plan_node_id;
+    Cost sort_cost = sort->plan.total_cost - append->plan.total_cost;
+    MergeAppend *merge;
+    List *sorted = NIL;
+    List *plans;
+    ListCell *lc;
+
+    if (append->appendplans == NIL || append->part_prune_info != NULL || append->nasyncplans > 0 ||
+        append->plan.parallel_aware || append->plan.initPlan != NIL){
+        return NULL;
+    }
+
+    // sort cost shared by row count
+    foreach(lc, append->appendplans){
+        Plan *child = (Plan *) lfirst(lc);
+        double share = append->plan.plan_rows > 0 ? child->plan_rows / append->plan.plan_rows : 0;
+
+        sorted = lappend(sorted, chunk_append_make_sort(ctx, sort, child, sort_cost * share));
+    }
+
+    plans = chunk_append_ordered(ctx, sorted, sort->sortColIdx[0], sort->sortOperators[0]);
+    if (plans == NIL){
+        ctx->next_plan_node_id = next_plan_node_id;
+        return NULL;
+    }
+
+    merge = makeNode(MergeAppend);
+    merge->plan.targetlist = sort->plan.targetlist;
+    merge->plan.initPlan = sort->plan.initPlan;
+    merge->plan.startup_cost = sort->plan.startup_cost;
+    merge->plan.total_cost = sort->plan.total_cost;
+    merge->plan.plan_rows = sort->plan.plan_rows;
+    merge->plan.plan_width = sort->plan.plan_width;
+    merge->plan.parallel_safe = sort->plan.parallel_safe;
+    merge->plan.plan_node_id = sort->plan.plan_node_id;
+    merge->plan.extParam = sort->plan.extParam;
+    merge->plan.allParam = sort->plan.allParam;
+    merge->apprelids = append->apprelids;
+    merge->mergeplans = plans;
+    merge->numCols = sort->numCols;
+    merge->sortColIdx = sort->sortColIdx;
+    merge->sortOperators = sort->sortOperators;
+    merge->collations = sort->collations;
+    merge->nullsFirst = sort->nullsFirst;
+
+    elog(DEBUG1, "ChunkAppend: Sort over %d Append input(s) replaced by %d merge input(s)",
+         list_length(append->appendplans), list_length(plans));
+    return (Plan *) merge;
+}
+
+static Plan *
+chunk_append_walk(ChunkAppendContext *ctx, Plan *plan)
+{
+    ListCell *lc;
+
+    if (plan == NULL) return NULL;
+
+    // the Append below a Sort is looked at before it can become an unordered ChunkAppend
+    if (IsA(plan, Sort) && plan->lefttree != NULL && IsA(plan->lefttree, Append)){
+        Plan *merge;
+
+        foreach(lc, ((Append *) plan->lefttree)->appendplans){
+            lfirst(lc) = chunk_append_walk(ctx, (Plan *) lfirst(lc));
+        }
+        merge = chunk_append_from_sort(ctx, (Sort *) plan);
+        if (merge != NULL) return merge;
+
+        plan->lefttree = chunk_append_from_append(ctx, (Append *) plan->lefttree);
+        return plan;
+    }
+
+    plan->lefttree = chunk_append_walk(ctx, plan->lefttree);
+    plan->righttree = chunk_append_walk(ctx, plan->righttree);
+
+    switch (nodeTag(plan)){
+        case T_Append:
+            foreach(lc, ((Append *) plan)->appendplans){
+                lfirst(lc) = chunk_append_walk(ctx, (Plan *) lfirst(lc));
+            }
+            return chunk_append_from_append(ctx, (Append *) plan);
+        case T_MergeAppend:
+            foreach(lc, ((MergeAppend *) plan)->mergeplans){
+                lfirst(lc) = chunk_append_walk(ctx, (Plan *) lfirst(lc));
+            }
+            return chunk_append_from_merge_append(ctx, (MergeAppend *) plan);
+        case T_SubqueryScan:
+            ((SubqueryScan *) plan)->subplan = chunk_append_walk(ctx, ((SubqueryScan *) plan)->subplan);
+            break;
+        case T_CustomScan:
+            foreach(lc, ((CustomScan *) plan)->custom_plans){
+                lfirst(lc) = chunk_append_walk(ctx, (Plan *) lfirst(lc));
+            }
+            break;
+        default:
+            break;
+    }
+
+    return plan;
+}
+
+/*
+    Public function
+*/
+// highest plan_node_id below plan, new nodes are numbered after it
+int
+chunk_append_max_plan_node_id(Plan *plan)
+{
+    List *children = NIL;
+    ListCell *lc;
+    int max_id;
+
+    if (plan == NULL) return -1;
+
+    max_id = Max(plan->plan_node_id, chunk_append_max_plan_node_id(plan->lefttree));
+    max_id = Max(max_id, chunk_append_max_plan_node_id(plan->righttree));
+
+    switch (nodeTag(plan)){
+        case T_Append:
+            children = ((Append *) plan)->appendplans;
+            break;
+        case T_MergeAppend:
+            children = ((MergeAppend *) plan)->mergeplans;
+            break;
+        case T_BitmapAnd:
+            children = ((BitmapAnd *) plan)->bitmapplans;
+            break;
+        case T_BitmapOr:
+            children = ((BitmapOr *) plan)->bitmapplans;
+            break;
+        case T_CustomScan:
+            children = ((CustomScan *) plan)->custom_plans;
+            break;
+        case T_SubqueryScan:
+            return Max(max_id, chunk_append_max_plan_node_id(((SubqueryScan *) plan)->subplan));
+        default:
+            break;
+    }
+
+    foreach(lc, children){
+        max_id = Max(max_id, chunk_append_max_plan_node_id((Plan *) lfirst(lc)));
+    }
+    return max_id;
+}
+
+void
+chunk_append_init(void)
+{
+    RegisterCustomScanMethods(&chunk_append_plan_methods);
+}
+
+void
+chunk_append_plan_wrap(PlannedStmt *stmt, int cursor_options)
+{
+    ChunkAppendContext ctx;
+    HypertableInfo ht_info;
+    bool has_hypertable = false;
+    ListCell *lc;
+
+    // ChunkAppend can not scan backward
+    if (cursor_options & CURSOR_OPT_SCROLL) return;
+
+    foreach(lc, stmt->rtable){
+        RangeTblEntry *rte = (RangeTblEntry *) lfirst(lc);
+
+        if (rte->rtekind == RTE_RELATION && hypertable_cache_lookup(rte->relid, &ht_info)){
+            has_hypertable = true;
+            break;
+        }
+    }
+    if (!has_hypertable) return;
+
+    ctx.stmt = stmt;
+    ctx.next_plan_node_id = chunk_append_max_plan_node_id(stmt->planTree);
+    foreach(lc, stmt->subplans){
+        ctx.next_plan_node_id = Max(ctx.next_plan_node_id, chunk_append_max_plan_node_id((Plan *) lfirst(lc)));
+    }
+    ctx.next_plan_node_id++;
+
+    stmt->planTree = chunk_append_walk(&ctx, stmt->planTree);
+    foreach(lc, stmt->subplans){
+        lfirst(lc) = chunk_append_walk(&ctx, (Plan *) lfirst(lc));
+    }
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <postgres.h>
+#include <nodes/plannodes.h>
+
+// register ChunkAppend custom scan methods
+extern void chunk_append_init(void);
+
+// replace Append nodes over chunks that have now() / parameter time quals with ChunkAppend,
+// read chunks in time order below Sort / MergeAppend on the time column
+extern void chunk_append_plan_wrap(PlannedStmt *stmt, int cursor_options);
+
+// highest plan_node_id below plan, nodes added to a finished plan are numbered after it
+extern int chunk_append_max_plan_node_id(Plan *plan);
@@ -0,0 +1,482 @@
+#include <postgres.h>
+#include <fmgr.h>
+#include <catalog/pg_type.h>
+#include <executor/spi.h>
+#include <lib/stringinfo.h>
+#include <storage/lmgr.h>
+#include <utils/builtins.h>
+#include <utils/datum.h>
+#include <utils/lsyscache.h>
+#include <utils/typcache.h>
+
+#include "metadata.h"
+#include "hypertable_cache.h"
+#include "trigger.h"
+#include "chunk_column_stats.h"
+
+/*
+    Chunk skipping on non-time columns
+
+    SELECT enable_chunk_skipping('sensor_data', 'device_id');
+    SELECT ... FROM sensor_data WHERE device_id = 42
+
+    [INSERT / COPY / ingest, chunk insert state (chunk_insert.c)]
+            ↓ per row: widen min/max of the tracked columns of the chunk
+    [chunk insert state closed (end of statement, pre-commit)]
+            ↓ merge: stored range only grows
+    [_timeseries_catalog.chunk_column_stats (chunk, column) -> min, max]
+            ↓ loaded with the chunk ranges (chunk_exclusion.c)
+    [planner hook: device_id = 42 does not overlap [min, max] -> chunk not planned]
+
+    enable_chunk_skipping() computes the range of every chunk with one
+    min()/max() scan each, under a ShareLock of the hypertable so no insert
+    that does not track the column is in flight. Ranges are stored in the
+    binary (send) format of the column type, independent of DateStyle and
+    friends. A chunk whose column has only NULLs gets a row with NULL
+    bounds and is skipped by any comparison on the column.
+
+    A range that grew invalidates the hypertable relcache entry, cached
+    plans that left the chunk out are planned again. DELETE only shrinks
+    the data, the stored range stays a superset. UPDATE of the hypertable
+    (statement trigger) marks all ranges of the hypertable invalid, those
+    chunks are always planned until enable_chunk_skipping() recomputes them.
+    Rows written into a chunk table directly are not tracked either.
+
+    Supported: types with a btree operator class and binary I/O, without a
+    collation (integers, floats, timestamps, numeric, uuid ...), at most
+    HYPERTABLE_MAX_SKIPPING_COLUMNS columns per hypertable.
+*/
+
+/*
+    Private function
+*/
+static bytea *
+column_value_encode(Oid type, Datum value)
+{
+    Oid typsend;
+    bool typisvarlena;
+
+    getTypeBinaryOutputInfo(type, &typsend, &typisvarlena);
+    return OidSendFunctionCall(typsend, value);
+}
+
+// row of _timeseries_catalog.chunk_column_stats
+typedef struct StoredRange {
+    bool valid; // invalid ranges stay invalid until they are computed again
+    bool has_values; // false: only NULLs so far
+    Datum min;
+    Datum max;
+} StoredRange;
+
+// stored range of (chunk_id, column), values holds chunk_id and column name, false when there is no row
+static bool
+column_range_read(int chunk_id, Datum *values, Oid type, bool for_update, StoredRange *stored)
+{
+    Oid argtypes[2] = {INT4OID, TEXTOID};
+    Datum value;
+    bool isnull;
+    int ret;
+
+    ret = SPI_execute_with_args(
+        for_update ?
+        "SELECT range_min, range_max, valid FROM _timeseries_catalog.chunk_column_stats "
+        "WHERE chunk_id = $1 AND column_name = $2 FOR UPDATE" :
+        "SELECT range_min, range_max, valid FROM _timeseries_catalog.chunk_column_stats "
+        "WHERE chunk_id = $1 AND column_name = $2",
+        2, argtypes, values, NULL, false, 0);
+    if (ret != SPI_OK_SELECT){
+        ereport(ERROR, errmsg("failed to read range of chunk %d", chunk_id));
+    }
+    if (SPI_processed == 0) return false;
+
+    memset(stored, 0, sizeof(StoredRange));
+    stored->valid = DatumGetBool(SPI_getbinval(SPI_tuptable->vals[0], SPI_tuptable->tupdesc, 3, &isnull));
+
+    value = SPI_getbinval(SPI_tuptable->vals[0], SPI_tuptable->tupdesc, 1, &isnull);
+    if (stored->valid && !isnull){
+        stored->has_values = true;
+        stored->min = chunk_column_stats_decode(type, DatumGetByteaPP(value));
+        value = SPI_getbinval(SPI_tuptable->vals[0], SPI_tuptable->tupdesc, 2, &isnull);
+        stored->max = chunk_column_stats_decode(type, DatumGetByteaPP(value));
+    }
+    return true;
+}
+
+// true when [min, max] is not inside a valid stored range
+static bool
+column_range_widens(const StoredRange *stored, FmgrInfo *cmp, bool has_values, Datum min, Datum max)
+{
+    if (!stored->valid || !has_values) return false;
+    if (!stored->has_values) return true;
+
+    return DatumGetInt32(FunctionCall2(cmp, min, stored->min)) < 0 ||
+           DatumGetInt32(FunctionCall2(cmp, max, stored->max)) > 0;
+}
+
+// keep the row of (chunk_id, column) covering [min, max], replace overwrites it, true when the row changed
+static bool
+column_range_store(int chunk_id, const char *column_name, Oid type, FmgrInfo *cmp,
+                   bool has_values, Datum min, Datum max, bool replace)
+{
+    Oid argtypes[4] = {INT4OID, TEXTOID, BYTEAOID, BYTEAOID};
+    Datum values[4];
+    char nulls[4] = {' ', ' ', ' ', ' '};
+    StoredRange stored;
+    int ret;
+
+    values[0] = Int32GetDatum(chunk_id);
+    values[1] = CStringGetTextDatum(column_name);
+    if (has_values){
+        values[2] = PointerGetDatum(column_value_encode(type, min));
+        values[3] = PointerGetDatum(column_value_encode(type, max));
+    }
+    else{
+        nulls[2] = 'n';
+        nulls[3] = 'n';
+    }
+
+    if (replace){
+        ret = SPI_execute_with_args(
+            "INSERT INTO _timeseries_catalog.chunk_column_stats (chunk_id, column_name, range_min, range_max) "
+            "VALUES ($1, $2, $3, $4) "
+            "ON CONFLICT (chunk_id, column_name) DO UPDATE "
+            "SET range_min = EXCLUDED.range_min, range_max = EXCLUDED.range_max, valid = true",
+            4, argtypes, values, nulls, false, 0);
+        if (ret != SPI_OK_INSERT){
+            ereport(ERROR, errmsg("failed to store range of column \"%s\" of chunk %d", column_name, chunk_id));
+        }
+        return true;
+    }
+
+    // most writes stay inside the stored range: plain read, no row lock
+    if (!column_range_read(chunk_id, values, type, false, &stored)){
+        // first rows of the chunk
+        ret = SPI_execute_with_args(
+            "INSERT INTO _timeseries_catalog.chunk_column_stats (chunk_id, column_name, range_min, range_max) "
+            "VALUES ($1, $2, $3, $4) ON CONFLICT (chunk_id, column_name) DO NOTHING",
+            4, argtypes, values, nulls, false, 0);
+        if (ret != SPI_OK_INSERT){
+            ereport(ERROR, errmsg("failed to store range of column \"%s\" of chunk %d", column_name, chunk_id));
+        }
+        if (SPI_processed > 0) return true;
+    }
+    else if (!column_range_widens(&stored, cmp, has_values, min, max)){
+        return false;
+    }
+    if (!has_values) return false;
+
+    // row lock only to widen: concurrent inserts into the chunk merge one after the other
+    if (!column_range_read(chunk_id, values, type, true, &stored)) return false; // chunk dropped meanwhile
+    if (!column_range_widens(&stored, cmp, has_values, min, max)) return false;
+
+    // keep the stored bound where it is wider
+    if (stored.has_values){
+        if (DatumGetInt32(FunctionCall2(cmp, min, stored.min)) >= 0){
+            values[2] = PointerGetDatum(column_value_encode(type, stored.min));
+        }
+        if (DatumGetInt32(FunctionCall2(cmp, max, stored.max)) <= 0){
+            values[3] = PointerGetDatum(column_value_encode(type, stored.max));
+        }
+    }
+
+    ret = SPI_execute_with_args(
+        "UPDATE _timeseries_catalog.chunk_column_stats SET range_min = $3, range_max = $4 "
+        "WHERE chunk_id = $1 AND column_name = $2",
+        4, argtypes, values, nulls, false, 0);
+    if (ret != SPI_OK_UPDATE){
+        ereport(ERROR, errmsg("failed to update range of column \"%s\" of chunk %d", column_name, chunk_id));
+    }
+    return true;
+}
+
+// min/max of the column in every chunk of the hypertable, SPI is connected
+static void
+column_ranges_compute(int hypertable_id, Oid type, const char *column_name)
+{
+    TypeCacheEntry *typentry = lookup_type_cache(type, TYPECACHE_CMP_PROC_FINFO);
+    int16 typlen;
+    bool typbyval;
+    StringInfoData query;
+    List *chunk_ids = NIL;
+    List *chunk_names = NIL;
+    ListCell *id_cell;
+    ListCell *name_cell;
+    int ret;
+
+    get_typlenbyval(type, &typlen, &typbyval);
+
+    initStringInfo(&query);
+    appendStringInfo(&query,
+        "SELECT id, format('%%I.%%I', schema_name, table_name) FROM _timeseries_catalog.chunk "
+        "WHERE hypertable_id = %d AND NOT is_compressed",
+        hypertable_id);
+
+    ret = SPI_execute(query.data, true, 0);
+    if (ret != SPI_OK_SELECT){
+        ereport(ERROR, errmsg("failed to read chunks of hypertable %d", hypertable_id));
+    }
+    for (uint64 i = 0; i < SPI_processed; i++){
+        bool isnull;
+
+        chunk_ids = lappend_int(chunk_ids, DatumGetInt32(SPI_getbinval(SPI_tuptable->vals[i], SPI_tuptable->tupdesc, 1, &isnull)));
+        chunk_names = lappend(chunk_names, SPI_getvalue(SPI_tuptable->vals[i], SPI_tuptable->tupdesc, 2));
+    }
+
+    forboth(id_cell, chunk_ids, name_cell, chunk_names){
+        Datum min = (Datum) 0;
+        Datum max = (Datum) 0;
+        bool isnull;
+
+        resetStringInfo(&query);
+        appendStringInfo(&query, "SELECT min(%s), max(%s) FROM ONLY %s",
+                         quote_identifier(column_name), quote_identifier(column_name),
+                         (char *) lfirst(name_cell));
+
+        ret = SPI_execute(query.data, true, 0);
+        if (ret != SPI_OK_SELECT || SPI_processed != 1){
+            ereport(ERROR, errmsg("failed to compute range of column \"%s\" of chunk %s",
+                                  column_name, (char *) lfirst(name_cell)));
+        }
+
+        // tuple table goes away with the next statement
+        min = SPI_getbinval(SPI_tuptable->vals[0], SPI_tuptable->tupdesc, 1, &isnull);
+        if (!isnull){
+            min = datumCopy(min, typbyval, typlen);
+            max = datumCopy(SPI_getbinval(SPI_tuptable->vals[0], SPI_tuptable->tupdesc, 2, &isnull), typbyval, typlen);
+        }
+
+        column_range_store(lfirst_int(id_cell), column_name, type, &typentry->cmp_proc_finfo,
+                           !isnull, min, max, true);
+    }
+
+    elog(DEBUG1, "Chunk column stats: computed \"%s\" of %d chunk(s) of hypertable %d",
+         column_name, list_length(chunk_ids), hypertable_id);
+}
+
+/*
+    Top level function
+*/
+PG_FUNCTION_INFO_V1(enable_chunk_skipping);
+Datum
+enable_chunk_skipping(PG_FUNCTION_ARGS)
+{
+    Oid table_oid = PG_GETARG_OID(0);
+    char *column_name = NameStr(*PG_GETARG_NAME(1));
+    char *schema_name = get_namespace_name(get_rel_namespace(table_oid));
+    char *table_name = get_rel_name(table_oid);
+    HypertableInfo ht_info;
+    AttrNumber attnum;
+    Oid type;
+    TypeCacheEntry *typentry;
+    Oid typsend;
+    Oid typreceive;
+    Oid typioparam;
+    bool typisvarlena;
+    List *column_names;
+    bool tracked = false;
+    ListCell *lc;
+
+    if (!hypertable_cache_lookup(table_oid, &ht_info)){
+        ereport(ERROR, errmsg("\"%s.%s\" is not a hypertable", schema_name, table_name));
+    }
+
+    attnum = get_attnum(table_oid, column_name);
+    if (attnum == InvalidAttrNumber){
+        ereport(ERROR,
+                (errcode(ERRCODE_UNDEFINED_COLUMN),
+                errmsg("column \"%s\" of \"%s.%s\" does not exist", column_name, schema_name, table_name)));
+    }
+    if (attnum == ht_info.time_attnum){
+        ereport(ERROR,
+                (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                errmsg("column \"%s\" is the time column, chunks are already skipped by time", column_name)));
+    }
+
+    type = get_atttype(table_oid, attnum);
+    typentry = lookup_type_cache(type, TYPECACHE_CMP_PROC);
+    if (!OidIsValid(typentry->cmp_proc) || type_is_collatable(type)){
+        ereport(ERROR,
+                (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+                errmsg("chunk skipping does not support column \"%s\" of type %s", column_name, format_type_be(type)),
+                errhint("The type needs a btree operator class and no collation.")));
+    }
+    // both error out for types without binary I/O
+    getTypeBinaryOutputInfo(type, &typsend, &typisvarlena);
+    getTypeBinaryInputInfo(type, &typreceive, &typioparam);
+
+    // in-flight inserts do not track the column yet, wait for them and keep new ones out
+    LockRelationOid(table_oid, ShareLock);
+
+    SPI_connect();
+
+    column_names = metadata_get_chunk_skipping_columns(ht_info.hypertable_id);
+    foreach(lc, column_names){
+        tracked |= strcmp((char *) lfirst(lc), column_name) == 0;
+    }
+    if (!tracked && list_length(column_names) >= HYPERTABLE_MAX_SKIPPING_COLUMNS){
+        ereport(ERROR,
+                (errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+                errmsg("\"%s.%s\" already has %d chunk skipping columns", schema_name, table_name,
+                       HYPERTABLE_MAX_SKIPPING_COLUMNS)));
+    }
+
+    metadata_add_chunk_skipping_column(ht_info.hypertable_id, column_name);
+    trigger_create_chunk_skipping_on_hypertable(schema_name, table_name);
+
+    // again on an enabled column: ranges that went invalid are computed again
+    column_ranges_compute(ht_info.hypertable_id, type, column_name);
+
+    SPI_finish();
+
+    // insert paths track the column, planner reads the ranges
+    hypertable_cache_invalidate(table_oid);
+
+    elog(NOTICE, "Chunk skipping enabled on \"%s.%s\", column \"%s\"", schema_name, table_name, column_name);
+
+    PG_RETURN_VOID();
+}
+
+PG_FUNCTION_INFO_V1(disable_chunk_skipping);
+Datum
+disable_chunk_skipping(PG_FUNCTION_ARGS)
+{
+    Oid table_oid = PG_GETARG_OID(0);
+    char *column_name = NameStr(*PG_GETARG_NAME(1));
+    char *schema_name = get_namespace_name(get_rel_namespace(table_oid));
+    char *table_name = get_rel_name(table_oid);
+    int hypertable_id;
+
+    SPI_connect();
+    hypertable_id = metadata_get_hypertable_id(schema_name, table_name);
+    if (hypertable_id == -1){
+        ereport(ERROR, errmsg("\"%s.%s\" is not a hypertable", schema_name, table_name));
+    }
+    metadata_remove_chunk_skipping_column(hypertable_id, column_name);
+    if (metadata_get_chunk_skipping_columns(hypertable_id) == NIL){
+        trigger_drop_chunk_skipping_on_hypertable(schema_name, table_name);
+    }
+    SPI_finish();
+
+    hypertable_cache_invalidate(table_oid);
+
+    elog(NOTICE, "Chunk skipping disabled on \"%s.%s\", column \"%s\"", schema_name, table_name, column_name);
+
+    PG_RETURN_VOID();
+}
+
+/*
+    Public function
+*/
+ChunkColumnRange *
+chunk_column_stats_ranges_create(const HypertableInfo *ht_info, MemoryContext context)
+{
+    ChunkColumnRange *ranges;
+
+    if (ht_info->n_skipping_columns == 0) return NULL;
+
+    ranges = (ChunkColumnRange *) MemoryContextAllocZero(context, ht_info->n_skipping_columns * sizeof(ChunkColumnRange));
+    for (int i = 0; i < ht_info->n_skipping_columns; i++){
+        ChunkColumnRange *range = &ranges[i];
+
+        range->attnum = ht_info->skipping_attnums[i];
+        range->type = get_atttype(ht_info->relid, range->attnum);
+        get_typlenbyval(range->type, &range->typlen, &range->typbyval);
+        range->cmp = &lookup_type_cache(range->type, TYPECACHE_CMP_PROC_FINFO)->cmp_proc_finfo;
+        range->has_values = false;
+    }
+    return ranges;
+}
+
+void
+chunk_column_stats_ranges_add(ChunkColumnRange *ranges, int n_ranges, TupleTableSlot *slot, MemoryContext context)
+{
+    for (int i = 0; i < n_ranges; i++){
+        ChunkColumnRange *range = &ranges[i];
+        bool isnull;
+        Datum value = slot_getattr(slot, range->attnum, &isnull);
+        bool new_min;
+        bool new_max;
+        MemoryContext old_context;
+
+        if (isnull) continue;
+
+        new_min = !range->has_values || DatumGetInt32(FunctionCall2(range->cmp, value, range->min)) < 0;
+        new_max = !range->has_values || DatumGetInt32(FunctionCall2(range->cmp, value, range->max)) > 0;
+        if (!new_min && !new_max) continue;
+
+        old_context = MemoryContextSwitchTo(context);
+        if (new_min){
+            if (range->has_values && !range->typbyval) pfree(DatumGetPointer(range->min));
+            range->min = datumCopy(value, range->typbyval, range->typlen);
+        }
+        if (new_max){
+            if (range->has_values && !range->typbyval) pfree(DatumGetPointer(range->max));
+            range->max = datumCopy(value, range->typbyval, range->typlen);
+        }
+        MemoryContextSwitchTo(old_context);
+        range->has_values = true;
+    }
+}
+
+void
+chunk_column_stats_ranges_write(Oid hypertable_relid, int chunk_id, ChunkColumnRange *ranges, int n_ranges)
+{
+    bool changed = false;
+
+    if (n_ranges == 0) return;
+
+    SPI_connect();
+    for (int i = 0; i < n_ranges; i++){
+        ChunkColumnRange *range = &ranges[i];
+        char *column_name = get_attname(hypertable_relid, range->attnum, true);
+
+        if (column_name == NULL) continue; // dropped meanwhile
+
+        changed |= column_range_store(chunk_id, column_name, range->type, range->cmp,
+                                      range->has_values, range->min, range->max, false);
+    }
+    SPI_finish();
+
+    // cached plans may have left the chunk out for values it has now
+    if (changed){
+        hypertable_cache_invalidate(hypertable_relid);
+    }
+}
+
+Datum
+chunk_column_stats_decode(Oid type, bytea *value)
+{
+    StringInfoData buf;
+    Oid typreceive;
+    Oid typioparam;
+
+    getTypeBinaryInputInfo(type, &typreceive, &typioparam);
+
+    // receive functions expect a terminated buffer
+    initStringInfo(&buf);
+    appendBinaryStringInfo(&buf, VARDATA_ANY(value), VARSIZE_ANY_EXHDR(value));
+    return OidReceiveFunctionCall(typreceive, &buf, typioparam, -1);
+}
+
+void
+chunk_column_stats_invalidate(Oid hypertable_relid, int hypertable_id)
+{
+    StringInfoData query;
+    int ret;
+
+    initStringInfo(&query);
+    appendStringInfo(&query,
+        "UPDATE _timeseries_catalog.chunk_column_stats SET valid = false "
+        "WHERE valid AND chunk_id IN (SELECT id FROM _timeseries_catalog.chunk WHERE hypertable_id = %d)",
+        hypertable_id);
+
+    SPI_connect();
+    ret = SPI_execute(query.data, false, 0);
+    if (ret != SPI_OK_UPDATE){
+        ereport(ERROR, errmsg("failed to invalidate chunk column ranges of hypertable %d", hypertable_id));
+    }
+    if (SPI_processed > 0){
+        hypertable_cache_invalidate(hypertable_relid);
+    }
+    SPI_finish();
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <postgres.h>
+#include <fmgr.h>
+#include <executor/tuptable.h>
+
+#include "hypertable_cache.h"
+
+// min/max of one chunk skipping column over the rows routed into a chunk
+typedef struct ChunkColumnRange {
+    AttrNumber attnum; // hypertable attnum
+    Oid type;
+    int16 typlen;
+    bool typbyval;
+    FmgrInfo *cmp; // btree comparison of the column type (type cache)
+    bool has_values; // a non-NULL value was seen
+    Datum min;
+    Datum max;
+} ChunkColumnRange;
+
+// empty ranges of the chunk skipping columns of ht_info, NULL without any
+extern ChunkColumnRange *chunk_column_stats_ranges_create(const HypertableInfo *ht_info, MemoryContext context);
+
+// widen ranges with a row in hypertable format, copies are kept in context
+extern void chunk_column_stats_ranges_add(ChunkColumnRange *ranges, int n_ranges, TupleTableSlot *slot,
+                                          MemoryContext context);
+
+// merge ranges into _timeseries_catalog.chunk_column_stats, plans are invalidated when a range grew
+extern void chunk_column_stats_ranges_write(Oid hypertable_relid, int chunk_id,
+                                            ChunkColumnRange *ranges, int n_ranges);
+
+// value of range_min / range_max (binary format of the column type)
+extern Datum chunk_column_stats_decode(Oid type, bytea *value);
+
+// ranges may be wrong after UPDATE: no chunk of the hypertable is skipped until enable_chunk_skipping() runs again
+extern void chunk_column_stats_invalidate(Oid hypertable_relid, int hypertable_id);
@@ -0,0 +1,525 @@
+#include <postgres.h>
+#include <access/genam.h>
+#include <access/htup_details.h>
+#include <access/stratnum.h>
+#include <access/table.h>
+#include <catalog/dependency.h>
+#include <catalog/indexing.h>
+#include <catalog/pg_class.h>
+#include <catalog/pg_depend.h>
+#include <catalog/pg_type.h>
+#include <commands/explain.h>
+#include <executor/executor.h>
+#include <executor/spi.h>
+#include <nodes/execnodes.h>
+#include <nodes/extensible.h>
+#include <nodes/makefuncs.h>
+#include <nodes/nodeFuncs.h>
+#include <parser/parsetree.h>
+#include <storage/lmgr.h>
+#include <utils/builtins.h>
+#include <utils/fmgroids.h>
+#include <utils/lsyscache.h>
+#include <utils/rel.h>
+#include <utils/syscache.h>
+#include <utils/typcache.h>
+
+#include "hypertable_cache.h"
+#include "chunk_exclusion.h"
+#include "chunk_delete.h"
+
+/*
+    Whole chunk DELETE
+
+    DELETE FROM sensor_data WHERE time < '2024-02-01'
+
+    [planner hook, DELETE on hypertable]
+            ↓ WHERE is only "time op constant": rows of [start, end) go
+    [chunks entirely inside [start, end) (catalog ranges)]
+            ↓ standard_planner, inheritance expansion
+    [ModifyTable] -> covered chunks taken out of the result relations and scans
+        ↓
+    [Custom Scan (ChunkDelete)] => first call: DROP TABLE chunk + catalog row
+        ↓
+    [parent] [partially covered chunks] => row by row as before
+
+    A dropped chunk writes no WAL per row and leaves nothing to vacuum. Rows
+    of dropped chunks are not part of the DELETE row count.
+
+    Left to row deletes: RETURNING, USING / sublinks / other quals, row level
+    security, chunks with row DELETE triggers (also foreign keys pointing at
+    the chunk) or objects depending on them (views). Quals only known at
+    execution (now()) are not looked at, the Append below ModifyTable is
+    then handled by ChunkAppend as before.
+*/
+
+bool chunk_delete_drops_chunks = false;
+
+typedef struct ChunkDeleteState {
+    CustomScanState css;
+    int n_children;
+    PlanState **children;
+    int current;
+    bool drop_done; // chunks dropped, or nothing to drop (EPQ recheck)
+    int chunks_dropped;
+} ChunkDeleteState;
+
+static Node *chunk_delete_state_create(CustomScan *cscan);
+static void chunk_delete_begin(CustomScanState *node, EState *estate, int eflags);
+static TupleTableSlot *chunk_delete_exec(CustomScanState *node);
+static void chunk_delete_end(CustomScanState *node);
+static void chunk_delete_rescan(CustomScanState *node);
+static void chunk_delete_explain(CustomScanState *node, List *ancestors, ExplainState *es);
+
+static CustomScanMethods chunk_delete_plan_methods = {
+    .CustomName = "ChunkDelete",
+    .CreateCustomScanState = chunk_delete_state_create,
+};
+
+static CustomExecMethods chunk_delete_exec_methods = {
+    .CustomName = "ChunkDelete",
+    .BeginCustomScan = chunk_delete_begin,
+    .ExecCustomScan = chunk_delete_exec,
+    .EndCustomScan = chunk_delete_end,
+    .ReScanCustomScan = chunk_delete_rescan,
+    .ExplainCustomScan = chunk_delete_explain,
+};
+
+/*
+    Executor
+*/
+static Node *
+chunk_delete_state_create(CustomScan *cscan)
+{
+    ChunkDeleteState *state = (ChunkDeleteState *) newNode(sizeof(ChunkDeleteState), T_CustomScanState);
+
+    state->css.methods = &chunk_delete_exec_methods;
+    return (Node *) state;
+}
+
+static void
+chunk_delete_begin(CustomScanState *node, EState *estate, int eflags)
+{
+    ChunkDeleteState *state = (ChunkDeleteState *) node;
+    CustomScan *cscan = (CustomScan *) node->ss.ps.plan;
+    ListCell *lc;
+    int i = 0;
+
+    state->n_children = list_length(cscan->custom_plans);
+    state->children = (PlanState **) palloc(state->n_children * sizeof(PlanState *));
+    foreach(lc, cscan->custom_plans){
+        state->children[i] = ExecInitNode((Plan *) lfirst(lc), estate, eflags);
+        node->custom_ps = lappend(node->custom_ps, state->children[i]);
+        i++;
+    }
+
+    state->current = 0;
+    state->chunks_dropped = 0;
+
+    // EPQ recheck runs the subplan again, the chunks are gone already
+    state->drop_done = (estate->es_epq_active != NULL);
+}
+
+// DROP TABLE of one chunk and its catalog row, false when it is gone already
+static bool
+chunk_delete_drop(Oid relid)
+{
+    StringInfoData query;
+    char *schema_name;
+    char *table_name;
+
+    LockRelationOid(relid, AccessExclusiveLock);
+    if (!SearchSysCacheExists1(RELOID, ObjectIdGetDatum(relid))){
+        UnlockRelationOid(relid, AccessExclusiveLock);
+        return false;
+    }
+
+    schema_name = get_namespace_name(get_rel_namespace(relid));
+    table_name = get_rel_name(relid);
+
+    initStringInfo(&query);
+    appendStringInfo(&query, "DROP TABLE %s.%s", quote_identifier(schema_name), quote_identifier(table_name));
+    if (SPI_execute(query.data, false, 0) != SPI_OK_UTILITY){
+        ereport(ERROR, errmsg("failed to drop chunk %s.%s", schema_name, table_name));
+    }
+
+    resetStringInfo(&query);
+    appendStringInfo(&query,
+        "DELETE FROM _timeseries_catalog.chunk WHERE schema_name = %s AND table_name = %s",
+        quote_literal_cstr(schema_name), quote_literal_cstr(table_name));
+    if (SPI_execute(query.data, false, 0) != SPI_OK_DELETE){
+        ereport(ERROR, errmsg("failed to remove chunk %s.%s from catalog", schema_name, table_name));
+    }
+
+    elog(DEBUG1, "ChunkDelete: dropped chunk %s.%s", schema_name, table_name);
+    return true;
+}
+
+static TupleTableSlot *
+chunk_delete_exec(CustomScanState *node)
+{
+    ChunkDeleteState *state = (ChunkDeleteState *) node;
+
+    if (!state->drop_done){
+        CustomScan *cscan = (CustomScan *) node->ss.ps.plan;
+        ListCell *lc;
+
+        SPI_connect();
+        foreach(lc, (List *) linitial(cscan->custom_private)){
+            if (chunk_delete_drop(lfirst_oid(lc))){
+                state->chunks_dropped++;
+            }
+        }
+        SPI_finish();
+        state->drop_done = true;
+    }
+
+    // remaining scans one after another, like Append
+    while (state->current < state->n_children){
+        TupleTableSlot *slot;
+
+        CHECK_FOR_INTERRUPTS();
+
+        slot = ExecProcNode(state->children[state->current]);
+        if (!TupIsNull(slot)){
+            return slot;
+        }
+        state->current++;
+    }
+
+    return NULL;
+}
+
+static void
+chunk_delete_end(CustomScanState *node)
+{
+    ChunkDeleteState *state = (ChunkDeleteState *) node;
+
+    for (int i = 0; i < state->n_children; i++){
+        ExecEndNode(state->children[i]);
+    }
+}
+
+static void
+chunk_delete_rescan(CustomScanState *node)
+{
+    ChunkDeleteState *state = (ChunkDeleteState *) node;
+
+    for (int i = 0; i < state->n_children; i++){
+        if (node->ss.ps.chgParam != NULL){
+            UpdateChangedParamSet(state->children[i], node->ss.ps.chgParam);
+        }
+        if (state->children[i]->chgParam == NULL){
+            ExecReScan(state->children[i]);
+        }
+    }
+    state->current = 0;
+}
+
+static void
+chunk_delete_explain(CustomScanState *node, List *ancestors, ExplainState *es)
+{
+    ChunkDeleteState *state = (ChunkDeleteState *) node;
+    CustomScan *cscan = (CustomScan *) node->ss.ps.plan;
+
+    if (es->analyze){
+        ExplainPropertyInteger("Chunks dropped", NULL, state->chunks_dropped, es);
+    }
+    else{
+        ExplainPropertyInteger("Chunks to drop", NULL, list_length((List *) linitial(cscan->custom_private)), es);
+    }
+}
+
+/*
+    Plan
+*/
+// [start_time, end_time) from "time op constant" quals, false when any other qual is present
+static bool
+chunk_delete_time_range(Node *clause, Index rti, const HypertableInfo *ht_info, ParamListInfo bound_params,
+                        int64 *start_time, int64 *end_time)
+{
+    TypeCacheEntry *typentry;
+    OpExpr *op;
+    Node *left;
+    Node *right;
+    Var *var;
+    Const *value;
+    bool var_on_left;
+    int strategy;
+    int64 time_value;
+
+    // no WHERE: every row
+    if (clause == NULL) return true;
+
+    if (IsA(clause, BoolExpr) && ((BoolExpr *) clause)->boolop == AND_EXPR){
+        ListCell *lc;
+
+        foreach(lc, ((BoolExpr *) clause)->args){
+            if (!chunk_delete_time_range((Node *) lfirst(lc), rti, ht_info, bound_params, start_time, end_time)){
+                return false;
+            }
+        }
+        return true;
+    }
+
+    if (!IsA(clause, OpExpr)) return false;
+
+    op = (OpExpr *) clause;
+    if (list_length(op->args) != 2) return false;
+
+    left = linitial(op->args);
+    right = lsecond(op->args);
+    if (IsA(left, Var) && (value = chunk_exclusion_clause_constant(right, bound_params)) != NULL){
+        var = (Var *) left;
+        var_on_left = true;
+    }
+    else if (IsA(right, Var) && (value = chunk_exclusion_clause_constant(left, bound_params)) != NULL){
+        var = (Var *) right;
+        var_on_left = false;
+    }
+    else{
+        return false;
+    }
+
+    if (var->varno != rti || var->varlevelsup != 0 || var->varattno != ht_info->time_attnum) return false;
+    if (value->constisnull || value->consttype != ht_info->time_type) return false;
+
+    typentry = lookup_type_cache(ht_info->time_type, TYPECACHE_BTREE_OPFAMILY);
+    strategy = get_op_opfamily_strategy(op->opno, typentry->btree_opf);
+    time_value = DatumGetInt64(value->constvalue);
+
+    // "constant op time" reads the other way round
+    if (!var_on_left){
+        strategy = chunk_exclusion_commute_strategy(strategy);
+    }
+
+    // exact bounds, a chunk is only dropped when every row of it matches
+    switch (strategy){
+        case BTLessStrategyNumber:
+            *end_time = Min(*end_time, time_value);
+            break;
+        case BTLessEqualStrategyNumber:
+            if (time_value < PG_INT64_MAX) *end_time = Min(*end_time, time_value + 1);
+            break;
+        case BTEqualStrategyNumber:
+            if (time_value == PG_INT64_MAX) return false;
+            *start_time = Max(*start_time, time_value);
+            *end_time = Min(*end_time, time_value + 1);
+            break;
+        case BTGreaterEqualStrategyNumber:
+            *start_time = Max(*start_time, time_value);
+            break;
+        case BTGreaterStrategyNumber:
+            if (time_value == PG_INT64_MAX) return false;
+            *start_time = Max(*start_time, time_value + 1);
+            break;
+        default:
+            return false;
+    }
+    return true;
+}
+
+// something other than the chunk's own indexes and constraints refers to it (views, ...)
+static bool
+chunk_delete_has_dependents(Oid relid)
+{
+    Relation depend = table_open(DependRelationId, AccessShareLock);
+    ScanKeyData keys[2];
+    SysScanDesc scan;
+    HeapTuple tuple;
+    bool found = false;
+
+    ScanKeyInit(&keys[0], Anum_pg_depend_refclassid, BTEqualStrategyNumber, F_OIDEQ,
+                ObjectIdGetDatum(RelationRelationId));
+    ScanKeyInit(&keys[1], Anum_pg_depend_refobjid, BTEqualStrategyNumber, F_OIDEQ,
+                ObjectIdGetDatum(relid));
+    scan = systable_beginscan(depend, DependReferenceIndexId, true, NULL, 2, keys);
+
+    while (HeapTupleIsValid(tuple = systable_getnext(scan))){
+        if (((Form_pg_depend) GETSTRUCT(tuple))->deptype == DEPENDENCY_NORMAL){
+            found = true;
+            break;
+        }
+    }
+
+    systable_endscan(scan);
+    table_close(depend, AccessShareLock);
+    return found;
+}
+
+// DROP TABLE removes the same rows a row by row DELETE would, and nothing else
+static bool
+chunk_delete_droppable(Oid relid)
+{
+    Relation rel;
+    bool droppable;
+
+    // lock like inheritance expansion of the DELETE does
+    rel = try_table_open(relid, RowExclusiveLock);
+    if (rel == NULL) return false;
+
+    droppable = !(rel->trigdesc != NULL &&
+                  (rel->trigdesc->trig_delete_before_row || rel->trigdesc->trig_delete_after_row ||
+                   rel->trigdesc->trig_delete_instead_row));
+    table_close(rel, NoLock);
+
+    return droppable && !chunk_delete_has_dependents(relid);
+}
+
+// relation of a scan below the DELETE Append, InvalidOid for anything else
+static Oid
+chunk_delete_scan_relid(PlannedStmt *stmt, Plan *plan)
+{
+    switch (nodeTag(plan)){
+        case T_SeqScan:
+        case T_SampleScan:
+        case T_IndexScan:
+        case T_IndexOnlyScan:
+        case T_BitmapHeapScan:
+        case T_TidScan:
+        case T_TidRangeScan:
+            return rt_fetch(((Scan *) plan)->scanrelid, stmt->rtable)->relid;
+        default:
+            return InvalidOid;
+    }
+}
+
+/*
+    Public function
+*/
+void
+chunk_delete_init(void)
+{
+    RegisterCustomScanMethods(&chunk_delete_plan_methods);
+}
+
+List *
+chunk_delete_covered_chunks(Query *parse, ParamListInfo bound_params)
+{
+    RangeTblEntry *rte;
+    HypertableInfo ht_info;
+    int64 start_time = PG_INT64_MIN;
+    int64 end_time = PG_INT64_MAX;
+    List *result = NIL;
+    ListCell *lc;
+
+    if (!chunk_delete_drops_chunks) return NIL;
+    if (parse->commandType != CMD_DELETE || parse->resultRelation == 0) return NIL;
+    if (parse->returningList != NIL || parse->hasSubLinks || parse->cteList != NIL) return NIL;
+
+    // no USING
+    if (list_length(parse->jointree->fromlist) != 1 || !IsA(linitial(parse->jointree->fromlist), RangeTblRef) ||
+        ((RangeTblRef *) linitial(parse->jointree->fromlist))->rtindex != parse->resultRelation){
+        return NIL;
+    }
+
+    rte = rt_fetch(parse->resultRelation, parse->rtable);
+    if (rte->rtekind != RTE_RELATION || !rte->inh || rte->securityQuals != NIL) return NIL;
+    if (!hypertable_cache_lookup(rte->relid, &ht_info)) return NIL;
+    if (ht_info.time_type != TIMESTAMPTZOID && ht_info.time_type != TIMESTAMPOID) return NIL;
+
+    if (!chunk_delete_time_range(parse->jointree->quals, parse->resultRelation, &ht_info, bound_params,
+                                 &start_time, &end_time)){
+        return NIL;
+    }
+    if (start_time >= end_time) return NIL;
+
+    foreach(lc, chunk_exclusion_covered_chunks(rte->relid, start_time, end_time)){
+        if (chunk_delete_droppable(lfirst_oid(lc))){
+            result = lappend_oid(result, lfirst_oid(lc));
+        }
+    }
+
+    elog(DEBUG1, "ChunkDelete: %d chunk(s) of %s covered by the DELETE", list_length(result), get_rel_name(rte->relid));
+    return result;
+}
+
+void
+chunk_delete_plan_wrap(PlannedStmt *stmt, List *chunk_relids)
+{
+    ModifyTable *mt;
+    Append *append;
+    CustomScan *cscan;
+    Plan *first;
+    List *result_relations = NIL;
+    List *fdw_priv_lists = NIL;
+    List *stmt_result_relations = NIL;
+    List *plans = NIL;
+    List *dropped = NIL;
+    List *tlist = NIL;
+    ListCell *lc;
+    ListCell *lc_priv;
+
+    if (!IsA(stmt->planTree, ModifyTable)) return;
+
+    mt = (ModifyTable *) stmt->planTree;
+    if (mt->operation != CMD_DELETE || mt->returningLists != NIL || mt->withCheckOptionLists != NIL ||
+        !bms_is_empty(mt->fdwDirectModifyPlans) || outerPlan(mt) == NULL || !IsA(outerPlan(mt), Append)){
+        return;
+    }
+
+    append = (Append *) outerPlan(mt);
+    if (append->part_prune_info != NULL || append->nasyncplans > 0 || append->plan.parallel_aware) return;
+
+    // every Append child must be a scan, so no scan of a dropped chunk is left behind
+    foreach(lc, append->appendplans){
+        Oid relid = chunk_delete_scan_relid(stmt, (Plan *) lfirst(lc));
+
+        if (relid == InvalidOid) return;
+        if (!list_member_oid(chunk_relids, relid)){
+            plans = lappend(plans, lfirst(lc));
+        }
+    }
+    if (plans == NIL) return;
+
+    forboth(lc, mt->resultRelations, lc_priv, mt->fdwPrivLists){
+        Oid relid = rt_fetch(lfirst_int(lc), stmt->rtable)->relid;
+
+        if (list_member_oid(chunk_relids, relid)){
+            dropped = lappend_oid(dropped, relid);
+            continue;
+        }
+        result_relations = lappend_int(result_relations, lfirst_int(lc));
+        fdw_priv_lists = lappend(fdw_priv_lists, lfirst(lc_priv));
+    }
+    if (dropped == NIL) return;
+
+    foreach(lc, stmt->resultRelations){
+        if (!list_member_oid(dropped, rt_fetch(lfirst_int(lc), stmt->rtable)->relid)){
+            stmt_result_relations = lappend_int(stmt_result_relations, lfirst_int(lc));
+        }
+    }
+
+    // a custom scan reads the tuple of its children as INDEX_VAR
+    first = (Plan *) linitial(plans);
+    foreach(lc, first->targetlist){
+        TargetEntry *tle = (TargetEntry *) lfirst(lc);
+        Var *var = makeVar(INDEX_VAR, tle->resno, exprType((Node *) tle->expr),
+                           exprTypmod((Node *) tle->expr), exprCollation((Node *) tle->expr), 0);
+
+        tlist = lappend(tlist, makeTargetEntry((Expr *) var, tle->resno, tle->resname, tle->resjunk));
+    }
+
+    cscan = makeNode(CustomScan);
+    cscan->scan.scanrelid = 0;
+    cscan->scan.plan.targetlist = tlist;
+    cscan->scan.plan.initPlan = append->plan.initPlan;
+    cscan->scan.plan.startup_cost = append->plan.startup_cost;
+    cscan->scan.plan.total_cost = append->plan.total_cost;
+    cscan->scan.plan.plan_rows = append->plan.plan_rows;
+    cscan->scan.plan.plan_width = append->plan.plan_width;
+    cscan->scan.plan.plan_node_id = append->plan.plan_node_id;
+    cscan->scan.plan.extParam = append->plan.extParam;
+    cscan->scan.plan.allParam = append->plan.allParam;
+    cscan->custom_plans = plans;
+    cscan->custom_scan_tlist = copyObject(first->targetlist);
+    cscan->custom_private = list_make1(dropped);
+    cscan->methods = &chunk_delete_plan_methods;
+
+    mt->resultRelations = result_relations;
+    mt->fdwPrivLists = fdw_priv_lists;
+    outerPlan(mt) = (Plan *) cscan;
+    stmt->resultRelations = stmt_result_relations;
+
+    elog(DEBUG1, "ChunkDelete: %d chunk(s) dropped instead of deleted row by row", list_length(dropped));
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <postgres.h>
+#include <nodes/params.h>
+#include <nodes/parsenodes.h>
+#include <nodes/plannodes.h>
+
+// DELETE drops chunks lying entirely inside its time range (simple_timeseries.delete_drops_chunks)
+extern bool chunk_delete_drops_chunks;
+
+// register ChunkDelete custom scan methods
+extern void chunk_delete_init(void);
+
+// chunks a DELETE on a hypertable removes completely, NIL when rows are deleted one by one
+extern List *chunk_delete_covered_chunks(Query *parse, ParamListInfo bound_params);
+
+// take chunk_relids out of the DELETE plan, they are dropped when it executes
+extern void chunk_delete_plan_wrap(PlannedStmt *stmt, List *chunk_relids);
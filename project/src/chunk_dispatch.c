@@ -0,0 +1,355 @@
+#include <postgres.h>
+#include <fmgr.h>
+#include <access/table.h>
+#include <catalog/pg_type.h>
+#include <executor/executor.h>
+#include <executor/tuptable.h>
+#include <nodes/execnodes.h>
+#include <nodes/extensible.h>
+#include <nodes/makefuncs.h>
+#include <nodes/nodeFuncs.h>
+#include <parser/parsetree.h>
+#include <utils/lsyscache.h>
+#include <utils/rel.h>
+#include <utils/timestamp.h>
+
+#include "chunk.h"
+#include "chunk_insert.h"
+#include "chunk_dispatch.h"
+#include "hypertable_cache.h"
+#include "dimension.h"
+#include "last_value.h"
+#include "trigger.h"
+
+/*
+    ChunkDispatch
+
+    Executor node that replaces ModifyTable for INSERT into a hypertable.
+
+    [ModifyTable (INSERT hypertable)]         [Custom Scan (ChunkDispatch)]
+            ↓                        ==>              ↓
+    [subplan (VALUES / SELECT)]               [subplan (VALUES / SELECT)]
+
+    Each tuple from the subplan is routed with chunk_get_or_create() and
+    written through the per-chunk insert states (chunk_insert.c), so rows
+    never go through the BEFORE INSERT trigger. The node counts processed
+    rows for the command tag and projects RETURNING from the routed tuple.
+
+    An INSERT in a WITH query is a ModifyTable subplan read by a CTE scan,
+    it is replaced the same way. Like ModifyTable, the node then registers
+    itself to be run to completion at executor finish, also when the outer
+    query does not read all of its rows.
+
+    Cases the node does not handle keep the plain ModifyTable plan and the
+    trigger based routing: row level security / WITH CHECK OPTION, and
+    hypertables that have user defined triggers. ON CONFLICT is rejected,
+    the arbiter indexes of the hypertable do not see rows of the chunks.
+*/
+
+typedef struct ChunkDispatchState {
+    CustomScanState css;
+    Relation rel; // hypertable
+    HypertableInfo ht_info; // hypertable id, time column, chunk interval
+    TupleTableSlot *ht_slot; // tuple in hypertable format
+    AttrNumber *attr_map; // hypertable attno - 1 -> subplan output attno
+    bool has_returning;
+    bool can_set_tag;
+    bool done; // subplan exhausted
+} ChunkDispatchState;
+
+static Node *chunk_dispatch_state_create(CustomScan *cscan);
+static void chunk_dispatch_begin(CustomScanState *node, EState *estate, int eflags);
+static TupleTableSlot *chunk_dispatch_exec(CustomScanState *node);
+static void chunk_dispatch_end(CustomScanState *node);
+static void chunk_dispatch_rescan(CustomScanState *node);
+
+static CustomScanMethods chunk_dispatch_plan_methods = {
+    .CustomName = "ChunkDispatch",
+    .CreateCustomScanState = chunk_dispatch_state_create,
+};
+
+static CustomExecMethods chunk_dispatch_exec_methods = {
+    .CustomName = "ChunkDispatch",
+    .BeginCustomScan = chunk_dispatch_begin,
+    .ExecCustomScan = chunk_dispatch_exec,
+    .EndCustomScan = chunk_dispatch_end,
+    .ReScanCustomScan = chunk_dispatch_rescan,
+};
+
+/*
+    Executor
+*/
+static Node *
+chunk_dispatch_state_create(CustomScan *cscan)
+{
+    ChunkDispatchState *state = (ChunkDispatchState *) newNode(sizeof(ChunkDispatchState), T_CustomScanState);
+
+    state->css.methods = &chunk_dispatch_exec_methods;
+    return (Node *) state;
+}
+
+static void
+chunk_dispatch_begin(CustomScanState *node, EState *estate, int eflags)
+{
+    ChunkDispatchState *state = (ChunkDispatchState *) node;
+    CustomScan *cscan = (CustomScan *) node->ss.ps.plan;
+    Plan *subplan = linitial(cscan->custom_plans);
+    Index rti = linitial_int(cscan->custom_private);
+    TupleDesc tupdesc;
+    AttrNumber attno = 0;
+    ListCell *lc;
+
+    state->has_returning = lsecond_int(cscan->custom_private);
+    state->can_set_tag = lthird_int(cscan->custom_private);
+
+    // relation is opened and locked through the range table, closed at executor end
+    state->rel = ExecGetRangeTableRelation(estate, rti);
+    tupdesc = RelationGetDescr(state->rel);
+
+    node->custom_ps = list_make1(ExecInitNode(subplan, estate, eflags));
+
+    // EXPLAIN without ANALYZE does not need routing info
+    if(eflags & EXEC_FLAG_EXPLAIN_ONLY) return;
+
+    if(!hypertable_cache_lookup(RelationGetRelid(state->rel), &state->ht_info)){
+        ereport(ERROR, errmsg("table \"%s\" is not a hypertable", RelationGetRelationName(state->rel)));
+    }
+
+    // INSERT subplan has one non-junk output column per hypertable attribute
+    state->attr_map = (AttrNumber *) palloc0(tupdesc->natts * sizeof(AttrNumber));
+    foreach(lc, subplan->targetlist){
+        TargetEntry *tle = (TargetEntry *) lfirst(lc);
+
+        if(tle->resjunk) continue;
+        if(attno >= tupdesc->natts){
+            ereport(ERROR, errmsg("INSERT plan has more columns than hypertable \"%s\"", RelationGetRelationName(state->rel)));
+        }
+        state->attr_map[attno++] = tle->resno;
+    }
+    if(attno != tupdesc->natts){
+        ereport(ERROR, errmsg("INSERT plan has fewer columns than hypertable \"%s\"", RelationGetRelationName(state->rel)));
+    }
+
+    state->ht_slot = ExecInitExtraTupleSlot(estate, tupdesc, &TTSOpsVirtual);
+    state->done = false;
+
+    // INSERT in a WITH query, ExecPostprocessPlan() inserts the rows nobody read
+    if(!state->can_set_tag){
+        estate->es_auxmodifytables = lcons(node, estate->es_auxmodifytables);
+    }
+}
+
+static TupleTableSlot *
+chunk_dispatch_exec(CustomScanState *node)
+{
+    ChunkDispatchState *state = (ChunkDispatchState *) node;
+    PlanState *child = linitial(node->custom_ps);
+    EState *estate = node->ss.ps.state;
+    TupleDesc tupdesc = RelationGetDescr(state->rel);
+
+    if(state->done) return NULL;
+
+    for(;;){
+        TupleTableSlot *child_slot;
+        TupleTableSlot *slot = state->ht_slot;
+        ChunkInfo *chunk_info;
+        ChunkInsertState *insert_state;
+        bool isnull;
+        Datum time_datum;
+
+        CHECK_FOR_INTERRUPTS();
+
+        child_slot = ExecProcNode(child);
+        if(TupIsNull(child_slot)){
+            state->done = true;
+            return NULL;
+        }
+
+        // subplan output -> hypertable tuple
+        ExecClearTuple(slot);
+        slot_getallattrs(child_slot);
+        for(int i=0; i<tupdesc->natts; i++){
+            slot->tts_values[i] = child_slot->tts_values[state->attr_map[i] - 1];
+            slot->tts_isnull[i] = child_slot->tts_isnull[state->attr_map[i] - 1];
+        }
+        ExecStoreVirtualTuple(slot);
+
+        time_datum = slot_getattr(slot, state->ht_info.time_attnum, &isnull);
+        if(isnull){
+            ereport(ERROR, errmsg("time column cannot be NULL"));
+        }
+
+        chunk_info = chunk_get_or_create(state->ht_info.hypertable_id,
+                                         state->ht_info.chunk_interval,
+                                         DatumGetTimestampTz(time_datum),
+                                         dimension_slot_space_bucket(&state->ht_info, slot));
+        insert_state = chunk_insert_state_get(chunk_info, tupdesc, &state->ht_info);
+        pfree(chunk_info);
+
+        // RETURNING rows must be in the table when they are handed out
+        if(state->has_returning){
+            chunk_insert_state_insert(insert_state, slot);
+        }
+        else{
+            chunk_insert_state_buffer(insert_state, slot);
+        }
+        last_value_cache_update(&state->ht_info, slot);
+
+        if(state->can_set_tag){
+            (estate->es_processed)++;
+        }
+
+        if(state->has_returning){
+            ProjectionInfo *proj = node->ss.ps.ps_ProjInfo;
+
+            if(proj == NULL){
+                // RETURNING matches the hypertable row
+                return ExecCopySlot(node->ss.ss_ScanTupleSlot, slot);
+            }
+
+            ResetExprContext(node->ss.ps.ps_ExprContext);
+            node->ss.ps.ps_ExprContext->ecxt_scantuple = slot;
+            return ExecProject(proj);
+        }
+    }
+}
+
+static void
+chunk_dispatch_end(CustomScanState *node)
+{
+    // write remaining buffers and release chunk relations
+    chunk_insert_state_close_all();
+    ExecEndNode(linitial(node->custom_ps));
+}
+
+static void
+chunk_dispatch_rescan(CustomScanState *node)
+{
+    ((ChunkDispatchState *) node)->done = false;
+    ExecReScan(linitial(node->custom_ps));
+}
+
+/*
+    Plan
+*/
+// ChunkDispatch for an INSERT into a hypertable, NULL when not applicable
+static Plan *
+chunk_dispatch_plan_create(PlannedStmt *stmt, ModifyTable *mt)
+{
+    CustomScan *cscan;
+    Index rti;
+    RangeTblEntry *rte;
+    Relation rel;
+    TupleDesc tupdesc;
+    List *scan_tlist = NIL;
+    HypertableInfo ht_info;
+    bool supported;
+
+    if(mt->operation != CMD_INSERT ||
+       list_length(mt->resultRelations) != 1 ||
+       outerPlan(mt) == NULL){
+        return NULL;
+    }
+
+    rti = linitial_int(mt->resultRelations);
+    rte = rt_fetch(rti, stmt->rtable);
+    if(!hypertable_cache_lookup(rte->relid, &ht_info)){
+        return NULL;
+    }
+
+    // conflicts would only be checked against the empty parent table
+    if(mt->onConflictAction != ONCONFLICT_NONE){
+        ereport(ERROR,
+                (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+                 errmsg("ON CONFLICT is not supported on hypertables")));
+    }
+
+    if(mt->withCheckOptionLists != NIL){
+        return NULL;
+    }
+
+    // relation is already locked by the parser/planner
+    rel = table_open(rte->relid, NoLock);
+    supported = !trigger_has_user_triggers(rel) && !rel->rd_rel->relrowsecurity;
+    tupdesc = RelationGetDescr(rel);
+
+    if(supported){
+        // scan tuple = hypertable row, so RETURNING Vars resolve by attno
+        for(int i=0; i<tupdesc->natts; i++){
+            Form_pg_attribute attr = TupleDescAttr(tupdesc, i);
+            Expr *expr;
+
+            if(attr->attisdropped){
+                expr = (Expr *) makeNullConst(INT4OID, -1, InvalidOid);
+            }
+            else{
+                expr = (Expr *) makeVar(rti, attr->attnum, attr->atttypid, attr->atttypmod, attr->attcollation, 0);
+            }
+            scan_tlist = lappend(scan_tlist, makeTargetEntry(expr, i + 1, pstrdup(NameStr(attr->attname)), false));
+        }
+    }
+    table_close(rel, NoLock);
+
+    if(!supported){
+        return NULL;
+    }
+
+    cscan = makeNode(CustomScan);
+    cscan->scan.scanrelid = 0;
+    cscan->scan.plan.targetlist = mt->plan.targetlist; // RETURNING list, NIL otherwise
+    cscan->scan.plan.initPlan = mt->plan.initPlan;
+    cscan->scan.plan.startup_cost = mt->plan.startup_cost;
+    cscan->scan.plan.total_cost = mt->plan.total_cost;
+    cscan->scan.plan.plan_rows = mt->plan.plan_rows;
+    cscan->scan.plan.plan_width = mt->plan.plan_width;
+    cscan->scan.plan.plan_node_id = mt->plan.plan_node_id;
+    cscan->scan.plan.extParam = mt->plan.extParam;
+    cscan->scan.plan.allParam = mt->plan.allParam;
+    cscan->custom_plans = list_make1(outerPlan(mt));
+    cscan->custom_scan_tlist = scan_tlist;
+    cscan->custom_private = list_make3_int(rti, mt->returningLists != NIL, mt->canSetTag);
+    cscan->methods = &chunk_dispatch_plan_methods;
+
+    elog(DEBUG1, "ChunkDispatch: INSERT into %s routed in executor", get_rel_name(rte->relid));
+    return (Plan *) cscan;
+}
+
+/*
+    Public function
+*/
+void
+chunk_dispatch_init(void)
+{
+    RegisterCustomScanMethods(&chunk_dispatch_plan_methods);
+}
+
+bool
+chunk_dispatch_plan_wrap(PlannedStmt *stmt)
+{
+    Plan *plan;
+    ListCell *lc;
+    bool wrapped = false;
+
+    if(stmt->commandType == CMD_INSERT && IsA(stmt->planTree, ModifyTable)){
+        plan = chunk_dispatch_plan_create(stmt, (ModifyTable *) stmt->planTree);
+        if(plan != NULL){
+            stmt->planTree = plan;
+            wrapped = true;
+        }
+    }
+
+    // INSERT in a WITH query is a subplan of its own
+    foreach(lc, stmt->subplans){
+        Plan *subplan = (Plan *) lfirst(lc);
+
+        if(subplan == NULL || !IsA(subplan, ModifyTable)) continue;
+
+        plan = chunk_dispatch_plan_create(stmt, (ModifyTable *) subplan);
+        if(plan != NULL){
+            lfirst(lc) = plan;
+            wrapped = true;
+        }
+    }
+
+    return wrapped;
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <postgres.h>
+#include <nodes/parsenodes.h>
+#include <nodes/plannodes.h>
+
+// register ChunkDispatch custom scan methods
+extern void chunk_dispatch_init(void);
+
+// replace ModifyTable of an INSERT into hypertable (also in WITH queries) with ChunkDispatch,
+// returns false when nothing was replaced
+extern bool chunk_dispatch_plan_wrap(PlannedStmt *stmt);
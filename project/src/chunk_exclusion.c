@@ -0,0 +1,991 @@
+#include <postgres.h>
+#include <access/genam.h>
+#include <access/htup_details.h>
+#include <access/stratnum.h>
+#include <access/table.h>
+#include <catalog/pg_inherits.h>
+#include <catalog/pg_type.h>
+#include <executor/spi.h>
+#include <nodes/makefuncs.h>
+#include <nodes/nodeFuncs.h>
+#include <parser/parse_relation.h>
+#include <parser/parsetree.h>
+#include <storage/lmgr.h>
+#include <utils/builtins.h>
+#include <utils/datum.h>
+#include <utils/fmgroids.h>
+#include <utils/hsearch.h>
+#include <utils/inval.h>
+#include <utils/lsyscache.h>
+#include <utils/memutils.h>
+#include <utils/rel.h>
+#include <utils/snapmgr.h>
+#include <utils/syscache.h>
+#include <utils/typcache.h>
+
+#include "hypertable_cache.h"
+#include "dimension.h"
+#include "chunk_exclusion.h"
+#include "chunk_column_stats.h"
+
+/*
+    Catalog driven chunk exclusion
+
+    SELECT ... FROM sensor_data WHERE time >= '2024-01-01' AND time < '2024-01-02' AND sensor_id = 3
+
+    [planner hook, hypertable RTE]
+            ↓ WHERE / inner join quals: time op constant, space column = constant,
+            ↓ chunk skipping column op constant
+    [time range [lo, hi], space bucket, column quals]
+            ↓ binary search, then min/max of the skipping columns per chunk
+    [sorted chunk ranges of the hypertable (backend cache)]
+            ↓ matching chunks only, locked here
+    [RTE -> (SELECT ... FROM ONLY sensor_data UNION ALL SELECT ... FROM chunk ...)]
+            ↓ standard_planner flattens the UNION ALL into an append rel
+
+    Without this the planner expands every chunk through inheritance, opens
+    it and runs constraint exclusion against its CHECK constraint, so planning
+    time grew with the number of chunks. Now only matching chunks are opened;
+    constraint exclusion still runs on them and does the fine filtering.
+    Parameters of a custom plan ($1 of a prepared statement) count as
+    constants; now() and generic plan parameters are left to ChunkAppend
+    (chunk_append.c), which also reads chunk ranges from this cache.
+
+    The parent itself stays a member (ONLY), it carries the permission check
+    of the hypertable like inheritance does, chunks are not checked.
+
+    Chunk ranges are loaded once per hypertable from _timeseries_catalog.chunk
+    (with chunk_column_stats for columns of enable_chunk_skipping()) and dropped by relcache invalidation of the hypertable (adding a child
+    always invalidates the parent) or of one of its chunks (DROP TABLE by
+    retention, compression). Plans keep the hypertable in their relation
+    list, so cached plans are replanned when a chunk is created as well.
+
+    Every query level is rewritten (planner.c), including hypertables read by
+    UPDATE ... FROM, DELETE ... USING and INSERT ... SELECT.
+
+    The RTE is left to inheritance when there is no usable qual, when it is
+    the result relation of UPDATE/DELETE/MERGE, locked (FOR UPDATE), has
+    security quals or TABLESAMPLE, or when the query uses a system column or
+    a whole-row reference of it.
+*/
+typedef struct ChunkRange {
+    Oid relid;
+    int64 start_time;
+    int64 end_time;
+    int space_bucket;
+} ChunkRange;
+
+// min/max of a chunk skipping column in one chunk
+typedef struct ColumnRange {
+    bool valid; // stored and valid, otherwise the chunk is never skipped on the column
+    bool has_values; // false: only NULLs
+    Datum min;
+    Datum max;
+} ColumnRange;
+
+typedef struct HypertableChunks {
+    Oid relid; // key, hypertable
+    int n_chunks;
+    int64 max_width; // widest chunk, bounds the backward scan of a lookup
+    ChunkRange *chunks; // sorted by start_time
+    int n_columns; // chunk skipping columns (HypertableInfo.skipping_attnums)
+    ColumnRange *column_ranges; // n_chunks x n_columns, in column_context
+    MemoryContext column_context; // NULL without chunk skipping columns
+} HypertableChunks;
+
+typedef struct ChunkOwner {
+    Oid relid; // key, chunk
+    Oid hypertable_relid;
+    int index; // into HypertableChunks.chunks
+} ChunkOwner;
+
+// "column op constant" of a chunk skipping column, as tests of the chunk min/max
+typedef struct ColumnQual {
+    int column; // index into HypertableInfo.skipping_attnums
+    FmgrInfo min_test; // "min op value" must hold, fn_oid InvalidOid = no test
+    FmgrInfo max_test; // "max op value" must hold
+    Datum value;
+} ColumnQual;
+
+typedef struct ChunkRestriction {
+    int64 lo; // rows can not be older
+    int64 hi; // rows can not be newer
+    int space_bucket; // -1 = any bucket
+    List *column_quals; // ColumnQual
+    bool restricted;
+} ChunkRestriction;
+
+typedef struct SystemColumnContext {
+    Index rti;
+    int sublevels_up;
+} SystemColumnContext;
+
+static MemoryContext chunk_exclusion_context = NULL;
+static HTAB *hypertable_chunks = NULL;
+static HTAB *chunk_owners = NULL; // chunk -> hypertable, for invalidation
+static bool relcache_callback_registered = false;
+
+/*
+    Private function
+*/
+static void
+hypertable_chunks_remove(Oid hypertable_relid)
+{
+    HypertableChunks *entry;
+
+    entry = (HypertableChunks *) hash_search(hypertable_chunks, &hypertable_relid, HASH_FIND, NULL);
+    if (entry == NULL) return;
+
+    for (int i = 0; i < entry->n_chunks; i++){
+        hash_search(chunk_owners, &entry->chunks[i].relid, HASH_REMOVE, NULL);
+    }
+    if (entry->chunks != NULL){
+        pfree(entry->chunks);
+    }
+    if (entry->column_context != NULL){
+        MemoryContextDelete(entry->column_context);
+    }
+    hash_search(hypertable_chunks, &hypertable_relid, HASH_REMOVE, NULL);
+}
+
+static void
+chunk_exclusion_relcache_callback(Datum arg, Oid relid)
+{
+    ChunkOwner *owner;
+
+    if (hypertable_chunks == NULL) return;
+
+    // InvalidOid = invalidate everything
+    if (relid == InvalidOid){
+        MemoryContextDelete(chunk_exclusion_context);
+        chunk_exclusion_context = NULL;
+        hypertable_chunks = NULL;
+        chunk_owners = NULL;
+        return;
+    }
+
+    if (hash_search(hypertable_chunks, &relid, HASH_FIND, NULL) != NULL){
+        hypertable_chunks_remove(relid);
+        return;
+    }
+
+    owner = (ChunkOwner *) hash_search(chunk_owners, &relid, HASH_FIND, NULL);
+    if (owner != NULL){
+        hypertable_chunks_remove(owner->hypertable_relid);
+    }
+}
+
+static void
+chunk_exclusion_cache_init(void)
+{
+    HASHCTL ctl;
+
+    if (hypertable_chunks != NULL) return;
+
+    if (!relcache_callback_registered){
+        CacheRegisterRelcacheCallback(chunk_exclusion_relcache_callback, (Datum) 0);
+        relcache_callback_registered = true;
+    }
+
+    chunk_exclusion_context = AllocSetContextCreate(CacheMemoryContext,
+                                                    "Chunk Exclusion Cache",
+                                                    ALLOCSET_DEFAULT_SIZES);
+
+    memset(&ctl, 0, sizeof(ctl));
+    ctl.keysize = sizeof(Oid);
+    ctl.entrysize = sizeof(HypertableChunks);
+    ctl.hcxt = chunk_exclusion_context;
+    hypertable_chunks = hash_create("Hypertable Chunk Ranges",
+                                    64,
+                                    &ctl,
+                                    HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+
+    memset(&ctl, 0, sizeof(ctl));
+    ctl.keysize = sizeof(Oid);
+    ctl.entrysize = sizeof(ChunkOwner);
+    ctl.hcxt = chunk_exclusion_context;
+    chunk_owners = hash_create("Chunk Owners",
+                               1024,
+                               &ctl,
+                               HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+}
+
+// chunk ranges of a hypertable, read from catalog on first use
+static HypertableChunks *
+hypertable_chunks_get(const HypertableInfo *ht_info)
+{
+    HypertableChunks *entry;
+    StringInfoData query;
+    ChunkRange *loaded;
+    ColumnRange *loaded_columns = NULL;
+    int n_columns = ht_info->n_skipping_columns;
+    Oid column_types[HYPERTABLE_MAX_SKIPPING_COLUMNS];
+    int16 column_typlens[HYPERTABLE_MAX_SKIPPING_COLUMNS];
+    bool column_typbyvals[HYPERTABLE_MAX_SKIPPING_COLUMNS];
+    MemoryContext caller_context = CurrentMemoryContext;
+    int n_loaded = 0;
+    int64 max_width = 0;
+    bool found;
+    int ret;
+
+    chunk_exclusion_cache_init();
+
+    entry = (HypertableChunks *) hash_search(hypertable_chunks, &ht_info->relid, HASH_FIND, NULL);
+    if (entry != NULL) return entry;
+
+    // compressed chunks have no table any more
+    initStringInfo(&query);
+    appendStringInfo(&query,
+        "SELECT to_regclass(format('%%I.%%I', c.schema_name, c.table_name))::oid, "
+        "c.start_time, c.end_time, c.space_bucket");
+
+    // stored and valid, min, max per chunk skipping column
+    for (int i = 0; i < n_columns; i++){
+        appendStringInfo(&query, ", s%d.chunk_id IS NOT NULL, s%d.range_min, s%d.range_max", i, i, i);
+    }
+    appendStringInfo(&query, " FROM _timeseries_catalog.chunk c");
+    for (int i = 0; i < n_columns; i++){
+        AttrNumber attnum = ht_info->skipping_attnums[i];
+
+        appendStringInfo(&query,
+            " LEFT JOIN _timeseries_catalog.chunk_column_stats s%d"
+            " ON s%d.chunk_id = c.id AND s%d.valid AND s%d.column_name = %s",
+            i, i, i, i, quote_literal_cstr(get_attname(ht_info->relid, attnum, false)));
+
+        column_types[i] = get_atttype(ht_info->relid, attnum);
+        get_typlenbyval(column_types[i], &column_typlens[i], &column_typbyvals[i]);
+    }
+    appendStringInfo(&query,
+        " WHERE c.hypertable_id = %d AND NOT c.is_compressed "
+        "ORDER BY c.start_time, c.space_bucket",
+        ht_info->hypertable_id);
+
+    // latest snapshot: every chunk whose invalidation was already received is visible
+    SPI_connect();
+    PushActiveSnapshot(GetLatestSnapshot());
+
+    ret = SPI_execute(query.data, true, 0);
+    if (ret != SPI_OK_SELECT){
+        PopActiveSnapshot();
+        SPI_finish();
+        ereport(ERROR, errmsg("failed to read chunks of hypertable %d", ht_info->hypertable_id));
+    }
+
+    // outlives SPI_finish, invalidation during SPI may have reset the cache context
+    loaded = (ChunkRange *) SPI_palloc(Max(SPI_processed, 1) * sizeof(ChunkRange));
+    if (n_columns > 0){
+        loaded_columns = (ColumnRange *) SPI_palloc(Max(SPI_processed, 1) * n_columns * sizeof(ColumnRange));
+    }
+    for (uint64 i = 0; i < SPI_processed; i++){
+        HeapTuple tuple = SPI_tuptable->vals[i];
+        TupleDesc tupdesc = SPI_tuptable->tupdesc;
+        ChunkRange *range = &loaded[n_loaded];
+        bool isnull;
+
+        range->relid = DatumGetObjectId(SPI_getbinval(tuple, tupdesc, 1, &isnull));
+        if (isnull) continue;
+        range->start_time = DatumGetInt64(SPI_getbinval(tuple, tupdesc, 2, &isnull));
+        range->end_time = DatumGetInt64(SPI_getbinval(tuple, tupdesc, 3, &isnull));
+        range->space_bucket = DatumGetInt32(SPI_getbinval(tuple, tupdesc, 4, &isnull));
+
+        for (int c = 0; c < n_columns; c++){
+            ColumnRange *column = &loaded_columns[n_loaded * n_columns + c];
+            Datum min = SPI_getbinval(tuple, tupdesc, 6 + c * 3, &isnull);
+            MemoryContext old_context;
+
+            column->valid = DatumGetBool(SPI_getbinval(tuple, tupdesc, 5 + c * 3, &isnull));
+            column->has_values = column->valid && !isnull;
+            if (!column->has_values) continue;
+
+            // decoded values outlive SPI_finish like loaded
+            old_context = MemoryContextSwitchTo(caller_context);
+            column->min = chunk_column_stats_decode(column_types[c], DatumGetByteaPP(min));
+            column->max = chunk_column_stats_decode(column_types[c],
+                                                    DatumGetByteaPP(SPI_getbinval(tuple, tupdesc, 7 + c * 3, &isnull)));
+            MemoryContextSwitchTo(old_context);
+        }
+
+        max_width = Max(max_width, range->end_time - range->start_time);
+        n_loaded++;
+    }
+
+    PopActiveSnapshot();
+    SPI_finish();
+
+    chunk_exclusion_cache_init();
+
+    entry = (HypertableChunks *) hash_search(hypertable_chunks, &ht_info->relid, HASH_ENTER, &found);
+    entry->n_chunks = n_loaded;
+    entry->max_width = max_width;
+    entry->chunks = (ChunkRange *) MemoryContextAlloc(chunk_exclusion_context,
+                                                      Max(n_loaded, 1) * sizeof(ChunkRange));
+    memcpy(entry->chunks, loaded, n_loaded * sizeof(ChunkRange));
+    pfree(loaded);
+
+    entry->n_columns = n_columns;
+    entry->column_ranges = NULL;
+    entry->column_context = NULL;
+    if (n_columns > 0){
+        entry->column_context = AllocSetContextCreate(chunk_exclusion_context,
+                                                      "Chunk Column Ranges",
+                                                      ALLOCSET_SMALL_SIZES);
+        entry->column_ranges = (ColumnRange *) MemoryContextAlloc(entry->column_context,
+                                                                  Max(n_loaded, 1) * n_columns * sizeof(ColumnRange));
+        for (int i = 0; i < n_loaded * n_columns; i++){
+            ColumnRange *column = &entry->column_ranges[i];
+            int c = i % n_columns;
+
+            *column = loaded_columns[i];
+            if (column->has_values && !column_typbyvals[c]){
+                MemoryContext old_context = MemoryContextSwitchTo(entry->column_context);
+
+                column->min = datumCopy(column->min, false, column_typlens[c]);
+                column->max = datumCopy(column->max, false, column_typlens[c]);
+                MemoryContextSwitchTo(old_context);
+            }
+        }
+        pfree(loaded_columns);
+    }
+
+    for (int i = 0; i < n_loaded; i++){
+        ChunkOwner *owner = (ChunkOwner *) hash_search(chunk_owners, &entry->chunks[i].relid, HASH_ENTER, &found);
+        owner->hypertable_relid = ht_info->relid;
+        owner->index = i;
+    }
+
+    elog(DEBUG1, "Chunk exclusion: loaded %d chunk range(s) of hypertable %d", n_loaded, ht_info->hypertable_id);
+    return entry;
+}
+
+// false when a qual on a chunk skipping column can not hold for any row of the chunk
+static bool
+column_ranges_match(const HypertableChunks *entry, int index, const ChunkRestriction *restriction)
+{
+    ListCell *lc;
+
+    foreach(lc, restriction->column_quals){
+        ColumnQual *qual = (ColumnQual *) lfirst(lc);
+        const ColumnRange *range;
+
+        if (qual->column >= entry->n_columns) continue;
+
+        range = &entry->column_ranges[index * entry->n_columns + qual->column];
+        if (!range->valid) continue;
+
+        // only NULLs, comparison operators are strict
+        if (!range->has_values) return false;
+
+        if (OidIsValid(qual->min_test.fn_oid) &&
+            !DatumGetBool(FunctionCall2(&qual->min_test, range->min, qual->value))){
+            return false;
+        }
+        if (OidIsValid(qual->max_test.fn_oid) &&
+            !DatumGetBool(FunctionCall2(&qual->max_test, range->max, qual->value))){
+            return false;
+        }
+    }
+    return true;
+}
+
+// chunks overlapping [lo, hi] in bucket (-1 = any), oldest first
+static List *
+hypertable_chunks_find(const HypertableChunks *entry, const ChunkRestriction *restriction)
+{
+    int low = 0;
+    int high = entry->n_chunks;
+    int first;
+    List *result = NIL;
+
+    // first chunk starting after hi
+    while (low < high){
+        int mid = low + (high - low) / 2;
+
+        if (entry->chunks[mid].start_time <= restriction->hi) low = mid + 1;
+        else high = mid;
+    }
+
+    // walk back only as far as a chunk can still reach lo
+    first = low;
+    while (first > 0 && entry->chunks[first - 1].start_time + entry->max_width > restriction->lo){
+        first--;
+    }
+
+    for (int i = first; i < low; i++){
+        const ChunkRange *range = &entry->chunks[i];
+
+        if (range->end_time <= restriction->lo) continue;
+        if (restriction->space_bucket != -1 && range->space_bucket != restriction->space_bucket) continue;
+        if (restriction->column_quals != NIL && !column_ranges_match(entry, i, restriction)) continue;
+
+        result = lappend_oid(result, range->relid);
+    }
+
+    return result;
+}
+
+// parent of an inheritance child, InvalidOid when relid has none
+static Oid
+inheritance_parent(Oid relid)
+{
+    Relation inherits = table_open(InheritsRelationId, AccessShareLock);
+    ScanKeyData key;
+    SysScanDesc scan;
+    HeapTuple tuple;
+    Oid parent = InvalidOid;
+
+    ScanKeyInit(&key, Anum_pg_inherits_inhrelid, BTEqualStrategyNumber, F_OIDEQ, ObjectIdGetDatum(relid));
+    scan = systable_beginscan(inherits, InheritsRelidSeqnoIndexId, true, NULL, 1, &key);
+
+    tuple = systable_getnext(scan);
+    if (HeapTupleIsValid(tuple)){
+        parent = ((Form_pg_inherits) GETSTRUCT(tuple))->inhparent;
+    }
+
+    systable_endscan(scan);
+    table_close(inherits, AccessShareLock);
+    return parent;
+}
+
+// operator of strategy between column and value type, false when the opfamily has none
+static bool
+column_qual_test_init(FmgrInfo *finfo, Oid opfamily, Oid column_type, Oid value_type, int strategy)
+{
+    Oid opno;
+
+    finfo->fn_oid = InvalidOid;
+    if (strategy == InvalidStrategy) return true;
+
+    opno = get_opfamily_member(opfamily, column_type, value_type, strategy);
+    if (!OidIsValid(opno)) return false;
+
+    fmgr_info(get_opcode(opno), finfo);
+    return true;
+}
+
+// "column op constant" of a chunk skipping column: what min/max of a chunk must satisfy
+static void
+restriction_add_column_qual(ChunkRestriction *restriction, int column, OpExpr *op, Var *var,
+                            Const *value, bool var_on_left)
+{
+    TypeCacheEntry *typentry = lookup_type_cache(var->vartype, TYPECACHE_BTREE_OPFAMILY);
+    int strategy;
+    int min_strategy = InvalidStrategy;
+    int max_strategy = InvalidStrategy;
+    ColumnQual *qual;
+
+    if (!OidIsValid(typentry->btree_opf)) return;
+
+    strategy = get_op_opfamily_strategy(op->opno, typentry->btree_opf);
+    if (!var_on_left){
+        strategy = chunk_exclusion_commute_strategy(strategy);
+    }
+
+    // column < x needs min < x, column > x needs max > x, column = x needs min <= x <= max
+    switch (strategy){
+        case BTLessStrategyNumber:
+        case BTLessEqualStrategyNumber:
+            min_strategy = strategy;
+            break;
+        case BTGreaterEqualStrategyNumber:
+        case BTGreaterStrategyNumber:
+            max_strategy = strategy;
+            break;
+        case BTEqualStrategyNumber:
+            min_strategy = BTLessEqualStrategyNumber;
+            max_strategy = BTGreaterEqualStrategyNumber;
+            break;
+        default:
+            return;
+    }
+
+    qual = (ColumnQual *) palloc0(sizeof(ColumnQual));
+    qual->column = column;
+    qual->value = value->constvalue;
+    if (!column_qual_test_init(&qual->min_test, typentry->btree_opf, var->vartype, value->consttype, min_strategy) ||
+        !column_qual_test_init(&qual->max_test, typentry->btree_opf, var->vartype, value->consttype, max_strategy)){
+        pfree(qual);
+        return;
+    }
+
+    restriction->column_quals = lappend(restriction->column_quals, qual);
+    restriction->restricted = true;
+}
+
+// narrow restriction with "column op constant" of rti, AND is followed
+static void
+restriction_add_clause(ChunkRestriction *restriction, Node *clause, Index rti,
+                       const HypertableInfo *ht_info, ParamListInfo bound_params)
+{
+    OpExpr *op;
+    Node *left;
+    Node *right;
+    Var *var;
+    Const *value;
+    bool var_on_left;
+
+    if (clause == NULL) return;
+
+    if (IsA(clause, BoolExpr) && ((BoolExpr *) clause)->boolop == AND_EXPR){
+        ListCell *lc;
+
+        foreach(lc, ((BoolExpr *) clause)->args){
+            restriction_add_clause(restriction, (Node *) lfirst(lc), rti, ht_info, bound_params);
+        }
+        return;
+    }
+
+    if (!IsA(clause, OpExpr)) return;
+
+    op = (OpExpr *) clause;
+    if (list_length(op->args) != 2) return;
+
+    left = linitial(op->args);
+    right = lsecond(op->args);
+    if (IsA(left, Var) && (value = chunk_exclusion_clause_constant(right, bound_params)) != NULL){
+        var = (Var *) left;
+        var_on_left = true;
+    }
+    else if (IsA(right, Var) && (value = chunk_exclusion_clause_constant(left, bound_params)) != NULL){
+        var = (Var *) right;
+        var_on_left = false;
+    }
+    else{
+        return;
+    }
+
+    if (var->varno != rti || var->varlevelsup != 0 || value->constisnull) return;
+
+    // time dimension, catalog ranges are microseconds like timestamp(tz)
+    if (var->varattno == ht_info->time_attnum && value->consttype == ht_info->time_type &&
+        (ht_info->time_type == TIMESTAMPTZOID || ht_info->time_type == TIMESTAMPOID)){
+        TypeCacheEntry *typentry = lookup_type_cache(ht_info->time_type, TYPECACHE_BTREE_OPFAMILY);
+        int strategy = get_op_opfamily_strategy(op->opno, typentry->btree_opf);
+        int64 time_value = DatumGetInt64(value->constvalue);
+
+        // "constant op time" reads the other way round
+        if (!var_on_left){
+            strategy = chunk_exclusion_commute_strategy(strategy);
+        }
+
+        switch (strategy){
+            case BTLessStrategyNumber:
+            case BTLessEqualStrategyNumber:
+                restriction->hi = Min(restriction->hi, time_value);
+                break;
+            case BTEqualStrategyNumber:
+                restriction->lo = Max(restriction->lo, time_value);
+                restriction->hi = Min(restriction->hi, time_value);
+                break;
+            case BTGreaterEqualStrategyNumber:
+            case BTGreaterStrategyNumber:
+                restriction->lo = Max(restriction->lo, time_value);
+                break;
+            default:
+                return;
+        }
+        restriction->restricted = true;
+        return;
+    }
+
+    // hash dimension, first equality wins (a second one can only remove more rows)
+    if (ht_info->num_partitions > 0 && var->varattno == ht_info->space_attnum &&
+        value->consttype == ht_info->space_type && restriction->space_bucket == -1){
+        TypeCacheEntry *typentry = lookup_type_cache(ht_info->space_type, TYPECACHE_EQ_OPR);
+
+        if (op->opno != typentry->eq_opr) return;
+        if (OidIsValid(op->inputcollid) && op->inputcollid != ht_info->space_collation) return;
+
+        restriction->space_bucket = dimension_space_bucket(ht_info, value->constvalue, false);
+        restriction->restricted = true;
+    }
+
+    // chunk skipping columns, min/max per chunk
+    for (int i = 0; i < ht_info->n_skipping_columns; i++){
+        if (var->varattno == ht_info->skipping_attnums[i]){
+            restriction_add_column_qual(restriction, i, op, var, value, var_on_left);
+            return;
+        }
+    }
+}
+
+// quals that remove rows of rti: WHERE and ON of inner joins
+static void
+restriction_from_jointree(ChunkRestriction *restriction, Node *jtnode, Index rti,
+                          const HypertableInfo *ht_info, ParamListInfo bound_params)
+{
+    ListCell *lc;
+
+    if (jtnode == NULL) return;
+
+    if (IsA(jtnode, FromExpr)){
+        FromExpr *from = (FromExpr *) jtnode;
+
+        restriction_add_clause(restriction, from->quals, rti, ht_info, bound_params);
+        foreach(lc, from->fromlist){
+            restriction_from_jointree(restriction, (Node *) lfirst(lc), rti, ht_info, bound_params);
+        }
+    }
+    else if (IsA(jtnode, JoinExpr)){
+        JoinExpr *join = (JoinExpr *) jtnode;
+
+        // ON of an outer join keeps the rows of the preserved side
+        if (join->jointype != JOIN_INNER) return;
+
+        restriction_add_clause(restriction, join->quals, rti, ht_info, bound_params);
+        restriction_from_jointree(restriction, join->larg, rti, ht_info, bound_params);
+        restriction_from_jointree(restriction, join->rarg, rti, ht_info, bound_params);
+    }
+}
+
+// system columns (tableoid, ctid ...) and whole-row references need the relation itself
+static bool
+system_column_walker(Node *node, void *context)
+{
+    SystemColumnContext *ctx = (SystemColumnContext *) context;
+
+    if (node == NULL) return false;
+
+    if (IsA(node, Var)){
+        Var *var = (Var *) node;
+
+        return var->varno == ctx->rti && var->varlevelsup == ctx->sublevels_up && var->varattno <= 0;
+    }
+    if (IsA(node, Query)){
+        bool result;
+
+        ctx->sublevels_up++;
+        result = query_tree_walker((Query *) node, system_column_walker, context, 0);
+        ctx->sublevels_up--;
+        return result;
+    }
+
+    return expression_tree_walker(node, system_column_walker, context);
+}
+
+// SELECT <hypertable columns> FROM ONLY relid, in hypertable column order
+static Query *
+make_member_query(Relation ht_rel, Oid relid, RTEPermissionInfo *perminfo)
+{
+    TupleDesc ht_desc = RelationGetDescr(ht_rel);
+    Relation rel = (relid == RelationGetRelid(ht_rel)) ? ht_rel : table_open(relid, NoLock);
+    TupleDesc desc = RelationGetDescr(rel);
+    Query *query = makeNode(Query);
+    RangeTblEntry *rte = makeNode(RangeTblEntry);
+    List *colnames = NIL;
+
+    for (int i = 0; i < desc->natts; i++){
+        Form_pg_attribute attr = TupleDescAttr(desc, i);
+
+        colnames = lappend(colnames, makeString(pstrdup(attr->attisdropped ? "" : NameStr(attr->attname))));
+    }
+
+    rte->rtekind = RTE_RELATION;
+    rte->relid = relid;
+    rte->relkind = rel->rd_rel->relkind;
+    rte->rellockmode = AccessShareLock;
+    rte->inh = false;
+    rte->inFromCl = true;
+    rte->eref = makeAlias(RelationGetRelationName(rel), colnames);
+    if (perminfo != NULL){
+        query->rteperminfos = list_make1(perminfo);
+        rte->perminfoindex = 1;
+    }
+
+    // chunks may have another attnum layout than the hypertable
+    for (int i = 0; i < ht_desc->natts; i++){
+        Form_pg_attribute attr = TupleDescAttr(ht_desc, i);
+        Expr *expr;
+
+        if (attr->attisdropped){
+            expr = (Expr *) makeNullConst(INT4OID, -1, InvalidOid);
+        }
+        else{
+            AttrNumber attnum = (rel == ht_rel) ? attr->attnum : get_attnum(relid, NameStr(attr->attname));
+
+            if (attnum == InvalidAttrNumber){
+                ereport(ERROR, errmsg("column \"%s\" not found in chunk \"%s\"",
+                                      NameStr(attr->attname), RelationGetRelationName(rel)));
+            }
+            expr = (Expr *) makeVar(1, attnum, attr->atttypid, attr->atttypmod, attr->attcollation, 0);
+        }
+
+        query->targetList = lappend(query->targetList,
+                                    makeTargetEntry(expr, i + 1, pstrdup(NameStr(attr->attname)), false));
+    }
+
+    query->commandType = CMD_SELECT;
+    query->querySource = QSRC_ORIGINAL;
+    query->canSetTag = true;
+    query->rtable = list_make1(rte);
+    query->jointree = makeFromExpr(list_make1(makeRangeTblRef(1)), NULL);
+
+    if (rel != ht_rel){
+        table_close(rel, NoLock);
+    }
+    return query;
+}
+
+// balanced UNION ALL tree over members from..to, keeps recursion in the planner shallow
+static Node *
+make_union_tree(int from, int to, List *col_types, List *col_typmods, List *col_collations)
+{
+    SetOperationStmt *op;
+    int mid;
+
+    if (from == to){
+        return (Node *) makeRangeTblRef(from);
+    }
+
+    mid = from + (to - from) / 2;
+
+    op = makeNode(SetOperationStmt);
+    op->op = SETOP_UNION;
+    op->all = true;
+    op->larg = make_union_tree(from, mid, col_types, col_typmods, col_collations);
+    op->rarg = make_union_tree(mid + 1, to, col_types, col_typmods, col_collations);
+    op->colTypes = list_copy(col_types);
+    op->colTypmods = list_copy(col_typmods);
+    op->colCollations = list_copy(col_collations);
+    op->groupClauses = NIL;
+    return (Node *) op;
+}
+
+// turn the hypertable RTE into UNION ALL of ONLY hypertable and chunks
+static void
+rewrite_rte(Query *parse, RangeTblEntry *rte, Relation ht_rel, List *chunk_relids)
+{
+    TupleDesc ht_desc = RelationGetDescr(ht_rel);
+    RTEPermissionInfo *perminfo = NULL;
+    Query *top = makeNode(Query);
+    List *members = NIL;
+    List *col_types = NIL;
+    List *col_typmods = NIL;
+    List *col_collations = NIL;
+    ListCell *lc;
+
+    if (rte->perminfoindex > 0){
+        perminfo = copyObject(getRTEPermissionInfo(parse->rteperminfos, rte));
+    }
+
+    members = lappend(members, make_member_query(ht_rel, RelationGetRelid(ht_rel), perminfo));
+    foreach(lc, chunk_relids){
+        members = lappend(members, make_member_query(ht_rel, lfirst_oid(lc), NULL));
+    }
+
+    for (int i = 0; i < ht_desc->natts; i++){
+        Form_pg_attribute attr = TupleDescAttr(ht_desc, i);
+        Oid type = attr->attisdropped ? INT4OID : attr->atttypid;
+        int32 typmod = attr->attisdropped ? -1 : attr->atttypmod;
+        Oid collation = attr->attisdropped ? InvalidOid : attr->attcollation;
+
+        col_types = lappend_oid(col_types, type);
+        col_typmods = lappend_int(col_typmods, typmod);
+        col_collations = lappend_oid(col_collations, collation);
+
+        top->targetList = lappend(top->targetList,
+                                  makeTargetEntry((Expr *) makeVar(1, i + 1, type, typmod, collation, 0),
+                                                  i + 1, pstrdup(NameStr(attr->attname)), false));
+    }
+
+    foreach(lc, members){
+        RangeTblEntry *member_rte = makeNode(RangeTblEntry);
+
+        member_rte->rtekind = RTE_SUBQUERY;
+        member_rte->subquery = (Query *) lfirst(lc);
+        member_rte->eref = makeAlias("*SELECT*", copyObject(rte->eref->colnames));
+        member_rte->inFromCl = false;
+        top->rtable = lappend(top->rtable, member_rte);
+    }
+
+    top->commandType = CMD_SELECT;
+    top->querySource = QSRC_ORIGINAL;
+    top->canSetTag = true;
+    top->jointree = makeFromExpr(NIL, NULL);
+    top->setOperations = make_union_tree(1, list_length(members), col_types, col_typmods, col_collations);
+
+    // permission of the hypertable moved to the ONLY member
+    rte->rtekind = RTE_SUBQUERY;
+    rte->subquery = top;
+    rte->security_barrier = false;
+    rte->relid = InvalidOid;
+    rte->relkind = 0;
+    rte->rellockmode = NoLock;
+    rte->perminfoindex = 0;
+    rte->inh = false;
+}
+
+/*
+    Public function
+*/
+int
+chunk_exclusion_commute_strategy(int strategy)
+{
+    switch (strategy){
+        case BTLessStrategyNumber:
+            return BTGreaterStrategyNumber;
+        case BTLessEqualStrategyNumber:
+            return BTGreaterEqualStrategyNumber;
+        case BTGreaterStrategyNumber:
+            return BTLessStrategyNumber;
+        case BTGreaterEqualStrategyNumber:
+            return BTLessEqualStrategyNumber;
+        default:
+            return strategy; // equality and InvalidStrategy read the same both ways
+    }
+}
+
+Const *
+chunk_exclusion_clause_constant(Node *node, ParamListInfo bound_params)
+{
+    Param *param;
+    ParamExternData prmdata;
+    ParamExternData *prm;
+
+    if (IsA(node, Const)) return (Const *) node;
+    if (!IsA(node, Param) || bound_params == NULL) return NULL;
+
+    param = (Param *) node;
+    if (param->paramkind != PARAM_EXTERN || param->paramid <= 0 || param->paramid > bound_params->numParams) return NULL;
+
+    if (bound_params->paramFetch != NULL){
+        prm = bound_params->paramFetch(bound_params, param->paramid, true, &prmdata);
+    }
+    else{
+        prm = &bound_params->params[param->paramid - 1];
+    }
+
+    // generic plans do not mark parameters constant
+    if (!OidIsValid(prm->ptype) || prm->ptype != param->paramtype || !(prm->pflags & PARAM_FLAG_CONST)) return NULL;
+
+    return makeConst(param->paramtype, param->paramtypmod, param->paramcollid,
+                     get_typlen(param->paramtype), prm->value, prm->isnull, get_typbyval(param->paramtype));
+}
+
+bool
+chunk_exclusion_expand(Query *parse, Index rti, ParamListInfo bound_params)
+{
+    RangeTblEntry *rte = rt_fetch(rti, parse->rtable);
+    HypertableInfo ht_info;
+    ChunkRestriction restriction;
+    SystemColumnContext context;
+    HypertableChunks *entry;
+    List *matching;
+    List *chunk_relids = NIL;
+    int n_chunks;
+    Relation ht_rel;
+    ListCell *lc;
+
+    if (rte->rtekind != RTE_RELATION || !rte->inh) return false;
+    if (rte->tablesample != NULL || rte->securityQuals != NIL) return false;
+    if (parse->resultRelation == rti) return false;
+    if (get_parse_rowmark(parse, rti) != NULL) return false;
+
+    if (!hypertable_cache_lookup(rte->relid, &ht_info)) return false;
+
+    restriction.lo = PG_INT64_MIN;
+    restriction.hi = PG_INT64_MAX;
+    restriction.space_bucket = -1;
+    restriction.column_quals = NIL;
+    restriction.restricted = false;
+    restriction_from_jointree(&restriction, (Node *) parse->jointree, rti, &ht_info, bound_params);
+    if (!restriction.restricted) return false;
+
+    context.rti = rti;
+    context.sublevels_up = 0;
+    if (query_tree_walker(parse, system_column_walker, &context, 0)) return false;
+
+    entry = hypertable_chunks_get(&ht_info);
+    matching = hypertable_chunks_find(entry, &restriction);
+    n_chunks = entry->n_chunks;
+
+    // nothing excluded, inheritance expansion does the same
+    if (list_length(matching) == n_chunks) return false;
+
+    // planner expects relations in the range table to be locked, a chunk may be gone by now
+    // (locking accepts invalidations, entry must not be used below)
+    foreach(lc, matching){
+        Oid chunk_relid = lfirst_oid(lc);
+
+        LockRelationOid(chunk_relid, AccessShareLock);
+        if (!SearchSysCacheExists1(RELOID, ObjectIdGetDatum(chunk_relid))){
+            UnlockRelationOid(chunk_relid, AccessShareLock);
+            continue;
+        }
+        chunk_relids = lappend_oid(chunk_relids, chunk_relid);
+    }
+
+    elog(DEBUG1, "Chunk exclusion: %s, %d of %d chunk(s) planned",
+         get_rel_name(rte->relid), list_length(chunk_relids), n_chunks);
+
+    // no chunk can match, only the parent is left
+    if (chunk_relids == NIL){
+        rte->inh = false;
+        return true;
+    }
+
+    ht_rel = table_open(rte->relid, NoLock);
+    rewrite_rte(parse, rte, ht_rel, chunk_relids);
+    table_close(ht_rel, NoLock);
+
+    return true;
+}
+
+bool
+chunk_exclusion_chunk_range(Oid relid, Oid *hypertable_relid, int64 *start_time, int64 *end_time)
+{
+    ChunkOwner *owner;
+    HypertableChunks *entry;
+    HypertableInfo ht_info;
+    Oid parent;
+
+    chunk_exclusion_cache_init();
+
+    owner = (ChunkOwner *) hash_search(chunk_owners, &relid, HASH_FIND, NULL);
+    if (owner == NULL){
+        parent = inheritance_parent(relid);
+        if (parent == InvalidOid || !hypertable_cache_lookup(parent, &ht_info)) return false;
+
+        hypertable_chunks_get(&ht_info);
+        owner = (ChunkOwner *) hash_search(chunk_owners, &relid, HASH_FIND, NULL);
+        if (owner == NULL) return false; // created after the ranges were read
+    }
+
+    entry = (HypertableChunks *) hash_search(hypertable_chunks, &owner->hypertable_relid, HASH_FIND, NULL);
+    if (entry == NULL) return false;
+
+    *hypertable_relid = owner->hypertable_relid;
+    *start_time = entry->chunks[owner->index].start_time;
+    *end_time = entry->chunks[owner->index].end_time;
+    return true;
+}
+
+List *
+chunk_exclusion_covered_chunks(Oid hypertable_relid, int64 start_time, int64 end_time)
+{
+    HypertableInfo ht_info;
+    HypertableChunks *entry;
+    List *result = NIL;
+    int low = 0;
+    int high;
+
+    if (!hypertable_cache_lookup(hypertable_relid, &ht_info)) return NIL;
+
+    entry = hypertable_chunks_get(&ht_info);
+
+    // first chunk starting at or after start_time
+    high = entry->n_chunks;
+    while (low < high){
+        int mid = low + (high - low) / 2;
+
+        if (entry->chunks[mid].start_time < start_time) low = mid + 1;
+        else high = mid;
+    }
+
+    for (int i = low; i < entry->n_chunks && entry->chunks[i].start_time < end_time; i++){
+        if (entry->chunks[i].end_time <= end_time){
+            result = lappend_oid(result, entry->chunks[i].relid);
+        }
+    }
+
+    return result;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <postgres.h>
+#include <nodes/params.h>
+#include <nodes/parsenodes.h>
+#include <nodes/primnodes.h>
+
+// replace hypertable RTE rti of a query level by the chunks its time / space quals
+// can match, false when the query is left as it is
+extern bool chunk_exclusion_expand(Query *parse, Index rti, ParamListInfo bound_params);
+
+// [start_time, end_time) of a chunk table, false when relid is not a chunk
+extern bool chunk_exclusion_chunk_range(Oid relid, Oid *hypertable_relid, int64 *start_time, int64 *end_time);
+
+// chunks lying entirely inside [start_time, end_time), oldest first
+extern List *chunk_exclusion_covered_chunks(Oid hypertable_relid, int64 start_time, int64 end_time);
+
+// btree strategy of "value op column" for "column op value"
+extern int chunk_exclusion_commute_strategy(int strategy);
+
+// Const, or value of a custom plan parameter ($1 marked constant), NULL otherwise
+extern Const *chunk_exclusion_clause_constant(Node *node, ParamListInfo bound_params);
@@ -0,0 +1,526 @@
+#include <postgres.h>
+#include <access/heapam.h>
+#include <access/table.h>
+#include <access/tableam.h>
+#include <access/tupconvert.h>
+#include <access/xact.h>
+#include <catalog/namespace.h>
+#include <executor/executor.h>
+#include <executor/nodeModifyTable.h>
+#include <nodes/makefuncs.h>
+#include <parser/parse_relation.h>
+#include <utils/acl.h>
+#include <utils/hsearch.h>
+#include <utils/lsyscache.h>
+#include <utils/memutils.h>
+#include <utils/rel.h>
+#include <utils/resowner.h>
+
+#include "chunk.h"
+#include "chunk_insert.h"
+#include "chunk_column_stats.h"
+
+/*
+    Chunk insert state
+
+    Instead of serializing every row to text and running an INSERT through SPI,
+    each chunk gets an open Relation, ResultRelInfo (with indexes) and slot.
+    One row then costs one table_tuple_insert() plus index maintenance.
+
+    States live in TopTransactionContext and relations are opened under
+    TopTransactionResourceOwner, so they stay valid across subtransactions.
+    They are closed by the statement-level trigger after each INSERT, and
+    before commit as a safety net. On abort the resource owner releases
+    everything, we only reset the pointers.
+
+    Rows can also be buffered per chunk and written with table_multi_insert(),
+    so a multi-row INSERT fills one page at a time instead of one tuple at a
+    time. Buffers are flushed when full and when the states are closed.
+
+    Subtransactions (SAVEPOINT, plpgsql EXCEPTION blocks):
+
+        buffered rows  -> tagged with the subtransaction that buffered them,
+                          passed to the parent on commit, dropped on abort
+        open states    -> closed and forgotten when the subtransaction that
+                          opened them aborts (the chunk may be gone with it)
+
+    A buffer only holds rows of one subtransaction. Rows of an enclosing
+    subtransaction are never written from a nested one, they would be rolled
+    back with it: a nested statement inserts directly into such a chunk, and
+    leaves the state open when it closes the others.
+
+    Stored generated columns are computed on the row in hypertable format
+    before anything else, so chunks, chunk column ranges and the last value
+    cache of the caller all see the generated values.
+
+    Each state also keeps min/max of the hypertable's chunk skipping columns
+    over its rows, they are merged into the catalog when the state is closed
+    (chunk_column_stats.c).
+*/
+int chunk_insert_batch_size = 1000;
+
+static HTAB *insert_states = NULL;
+static MemoryContext insert_state_context = NULL;
+static bool xact_callback_registered = false;
+
+static void
+chunk_insert_state_xact_callback(XactEvent event, void *arg)
+{
+    switch(event){
+        case XACT_EVENT_PRE_COMMIT:
+            chunk_insert_state_close_all();
+            break;
+        case XACT_EVENT_ABORT:
+            // memory and relations already released by abort
+            insert_states = NULL;
+            insert_state_context = NULL;
+            break;
+        default:
+            break;
+    }
+}
+
+static void chunk_insert_state_close(ChunkInsertState *state);
+
+static int
+chunk_insert_state_cmp(const void *a, const void *b)
+{
+    const ChunkInsertState *sa = *(const ChunkInsertState *const *) a;
+    const ChunkInsertState *sb = *(const ChunkInsertState *const *) b;
+
+    if(sa->chunk_id != sb->chunk_id)
+        return (sa->chunk_id < sb->chunk_id) ? -1 : 1;
+    return 0;
+}
+
+// drop the buffered rows without writing them
+static void
+chunk_insert_state_discard(ChunkInsertState *state)
+{
+    for(int i=0; i<state->n_buffered; i++){
+        ExecClearTuple(state->buffered_slots[i]);
+    }
+    state->n_buffered = 0;
+}
+
+static void
+chunk_insert_state_subxact_callback(SubXactEvent event, SubTransactionId sub_id, SubTransactionId parent_id, void *arg)
+{
+    HASH_SEQ_STATUS status;
+    ChunkInsertState *state;
+    ResourceOwner old_owner;
+
+    if(insert_states == NULL) return;
+
+    switch(event){
+        case SUBXACT_EVENT_COMMIT_SUB:
+            hash_seq_init(&status, insert_states);
+            while((state = (ChunkInsertState *) hash_seq_search(&status)) != NULL){
+                if(state->subxact_id == sub_id) state->subxact_id = parent_id;
+                if(state->buffer_subxact_id == sub_id) state->buffer_subxact_id = parent_id;
+            }
+            break;
+        case SUBXACT_EVENT_ABORT_SUB:
+            // references were taken by the top transaction owner
+            old_owner = CurrentResourceOwner;
+            CurrentResourceOwner = TopTransactionResourceOwner;
+
+            hash_seq_init(&status, insert_states);
+            while((state = (ChunkInsertState *) hash_seq_search(&status)) != NULL){
+                if(state->buffer_subxact_id == sub_id){
+                    chunk_insert_state_discard(state);
+                }
+                if(state->subxact_id == sub_id){
+                    chunk_insert_state_close(state);
+                    hash_search(insert_states, &state->chunk_id, HASH_REMOVE, NULL);
+                }
+            }
+
+            CurrentResourceOwner = old_owner;
+            break;
+        default:
+            break;
+    }
+}
+
+static void
+chunk_insert_state_init(void)
+{
+    HASHCTL ctl;
+
+    if (insert_states != NULL) return;
+
+    if(!xact_callback_registered){
+        RegisterXactCallback(chunk_insert_state_xact_callback, NULL);
+        RegisterSubXactCallback(chunk_insert_state_subxact_callback, NULL);
+        xact_callback_registered = true;
+    }
+
+    insert_state_context = AllocSetContextCreate(
+        TopTransactionContext,
+        "ChunkInsertState",
+        ALLOCSET_DEFAULT_SIZES
+    );
+
+    memset(&ctl, 0, sizeof(ctl));
+    ctl.keysize = sizeof(int);
+    ctl.entrysize = sizeof(ChunkInsertState);
+    ctl.hcxt = insert_state_context;
+
+    insert_states = hash_create(
+        "Chunk Insert States",
+        16,
+        &ctl,
+        HASH_ELEM | HASH_BLOBS | HASH_CONTEXT
+    );
+}
+
+static void
+chunk_insert_state_open(ChunkInsertState *state, const ChunkInfo *info, TupleDesc hypertable_desc,
+                        const HypertableInfo *ht_info)
+{
+    ResourceOwner old_owner = CurrentResourceOwner;
+    MemoryContext old_context = MemoryContextSwitchTo(insert_state_context);
+    Oid schema_oid;
+    RangeTblEntry *rte;
+    RTEPermissionInfo *perminfo;
+    List *perminfos = NIL;
+
+    state->relid = info->relid;
+    if(state->relid == InvalidOid){
+        schema_oid = get_namespace_oid(info->schema_name, false);
+        state->relid = get_relname_relid(info->table_name, schema_oid);
+    }
+    if(state->relid == InvalidOid){
+        ereport(ERROR, errmsg("chunk table \"%s.%s\" does not exist", info->schema_name, info->table_name));
+    }
+
+    // keep relation and index references for the whole transaction
+    CurrentResourceOwner = TopTransactionResourceOwner;
+    PG_TRY();
+    {
+        state->rel = table_open(state->relid, RowExclusiveLock);
+
+        // single range table entry, so executor error reporting can resolve the relation
+        rte = makeNode(RangeTblEntry);
+        rte->rtekind = RTE_RELATION;
+        rte->relid = state->relid;
+        rte->relkind = state->rel->rd_rel->relkind;
+        rte->rellockmode = RowExclusiveLock;
+        perminfo = addRTEPermissionInfo(&perminfos, rte);
+        perminfo->requiredPerms = ACL_INSERT;
+
+        state->estate = CreateExecutorState();
+        ExecInitRangeTable(state->estate, list_make1(rte), perminfos);
+
+        state->result_rel_info = makeNode(ResultRelInfo);
+        InitResultRelInfo(state->result_rel_info, state->rel, 1, NULL, 0);
+        ExecOpenIndices(state->result_rel_info, false);
+
+        state->slot = MakeSingleTupleTableSlot(RelationGetDescr(state->rel), table_slot_callbacks(state->rel));
+        state->map = convert_tuples_by_name(hypertable_desc, RelationGetDescr(state->rel));
+
+        // relation is locked by the caller
+        state->hypertable_rri = NULL;
+        if(hypertable_desc->constr != NULL && hypertable_desc->constr->has_generated_stored){
+            state->hypertable_rri = makeNode(ResultRelInfo);
+            InitResultRelInfo(state->hypertable_rri, table_open(ht_info->relid, NoLock), 0, NULL, 0);
+        }
+
+        // buffer slots are created on demand
+        state->buffered_slots = NULL;
+        state->n_buffered = 0;
+        state->max_buffered = 0;
+        state->bistate = NULL;
+
+        state->subxact_id = GetCurrentSubTransactionId();
+        state->buffer_subxact_id = state->subxact_id;
+
+        state->hypertable_relid = ht_info->relid;
+        state->column_ranges = chunk_column_stats_ranges_create(ht_info, insert_state_context);
+        state->n_column_ranges = ht_info->n_skipping_columns;
+    }
+    PG_FINALLY();
+    {
+        CurrentResourceOwner = old_owner;
+    }
+    PG_END_TRY();
+
+    MemoryContextSwitchTo(old_context);
+    elog(DEBUG1, "Chunk insert state opened: %s.%s", info->schema_name, info->table_name);
+}
+
+// convert tuple to chunk layout (dropped columns in hypertable are not copied by LIKE)
+static TupleTableSlot*
+chunk_insert_state_convert(ChunkInsertState *state, TupleTableSlot *slot, TupleTableSlot *dest)
+{
+    if(state->map != NULL){
+        dest = execute_attr_map_slot(state->map->attrMap, slot, dest);
+        ExecMaterializeSlot(dest); // do not point into source slot memory
+        return dest;
+    }
+    return ExecCopySlot(dest, slot);
+}
+
+static void
+chunk_insert_state_close(ChunkInsertState *state)
+{
+    ExecCloseIndices(state->result_rel_info);
+    if(state->hypertable_rri != NULL){
+        table_close(state->hypertable_rri->ri_RelationDesc, NoLock);
+    }
+    ExecDropSingleTupleTableSlot(state->slot);
+    if(state->buffered_slots != NULL){
+        for(int i=0; i<state->max_buffered && state->buffered_slots[i] != NULL; i++){
+            ExecDropSingleTupleTableSlot(state->buffered_slots[i]);
+        }
+    }
+    if(state->bistate != NULL){
+        FreeBulkInsertState(state->bistate);
+    }
+    table_close(state->rel, NoLock); // keep lock until transaction end
+    FreeExecutorState(state->estate);
+}
+
+/*
+    Public function
+*/
+ChunkInsertState*
+chunk_insert_state_get(const ChunkInfo *info, TupleDesc hypertable_desc, const HypertableInfo *ht_info)
+{
+    ChunkInsertState *state;
+    bool found;
+
+    if(insert_states == NULL){
+        chunk_insert_state_init();
+    }
+
+    state = (ChunkInsertState *) hash_search(
+        insert_states,
+        &info->chunk_id,
+        HASH_ENTER,
+        &found
+    );
+
+    if(!found){
+        PG_TRY();
+        {
+            chunk_insert_state_open(state, info, hypertable_desc, ht_info);
+        }
+        PG_CATCH();
+        {
+            // do not leave a half initialized entry behind
+            hash_search(insert_states, &info->chunk_id, HASH_REMOVE, NULL);
+            PG_RE_THROW();
+        }
+        PG_END_TRY();
+    }
+
+    return state;
+}
+
+// fill stored generated columns of a row in hypertable format
+static void
+chunk_insert_state_generate(ChunkInsertState *state, TupleTableSlot *slot)
+{
+    ExecComputeStoredGenerated(state->hypertable_rri, state->estate, slot, CMD_INSERT);
+    ResetPerTupleExprContext(state->estate);
+}
+
+void
+chunk_insert_state_insert(ChunkInsertState *state, TupleTableSlot *slot)
+{
+    EState *estate = state->estate;
+    ResultRelInfo *rri = state->result_rel_info;
+    TupleTableSlot *chunk_slot;
+    MemoryContext old_context;
+
+    if(state->hypertable_rri != NULL){
+        chunk_insert_state_generate(state, slot);
+    }
+
+    if(state->n_column_ranges > 0){
+        chunk_column_stats_ranges_add(state->column_ranges, state->n_column_ranges, slot, insert_state_context);
+    }
+
+    old_context = MemoryContextSwitchTo(GetPerTupleMemoryContext(estate));
+
+    chunk_slot = chunk_insert_state_convert(state, slot, state->slot);
+
+    if(state->rel->rd_att->constr != NULL){
+        ExecConstraints(rri, chunk_slot, estate);
+    }
+
+    table_tuple_insert(state->rel, chunk_slot, GetCurrentCommandId(true), 0, NULL);
+
+    if(rri->ri_NumIndices > 0){
+        List *recheck = ExecInsertIndexTuples(rri, chunk_slot, estate, false, false, NULL, NIL, false);
+        list_free(recheck);
+    }
+
+    MemoryContextSwitchTo(old_context);
+    ResetPerTupleExprContext(estate);
+}
+
+void
+chunk_insert_state_buffer(ChunkInsertState *state, TupleTableSlot *slot)
+{
+    TupleTableSlot *chunk_slot;
+    MemoryContext old_context;
+    SubTransactionId subxact_id = GetCurrentSubTransactionId();
+
+    // rows of an enclosing subtransaction are buffered, do not write them from this one
+    if(state->n_buffered > 0 && state->buffer_subxact_id != subxact_id){
+        chunk_insert_state_insert(state, slot);
+        return;
+    }
+
+    if(state->buffered_slots == NULL){
+        if(chunk_insert_batch_size <= 1){
+            chunk_insert_state_insert(state, slot);
+            return;
+        }
+        state->max_buffered = chunk_insert_batch_size;
+        state->buffered_slots = (TupleTableSlot **) MemoryContextAllocZero(insert_state_context,
+                                                    state->max_buffered * sizeof(TupleTableSlot *));
+    }
+
+    if(state->hypertable_rri != NULL){
+        chunk_insert_state_generate(state, slot);
+    }
+
+    if(state->n_column_ranges > 0){
+        chunk_column_stats_ranges_add(state->column_ranges, state->n_column_ranges, slot, insert_state_context);
+    }
+
+    // buffered tuples must outlive the statement memory, keep them in the state context
+    old_context = MemoryContextSwitchTo(insert_state_context);
+    if(state->buffered_slots[state->n_buffered] == NULL){
+        ResourceOwner old_owner = CurrentResourceOwner;
+
+        // the slot pins the tuple descriptor, released when the state is closed
+        CurrentResourceOwner = TopTransactionResourceOwner;
+        state->buffered_slots[state->n_buffered] = MakeSingleTupleTableSlot(RelationGetDescr(state->rel),
+                                                                           table_slot_callbacks(state->rel));
+        CurrentResourceOwner = old_owner;
+    }
+    chunk_slot = chunk_insert_state_convert(state, slot, state->buffered_slots[state->n_buffered]);
+    MemoryContextSwitchTo(old_context);
+
+    // check constraints now, so errors point at the offending row
+    if(state->rel->rd_att->constr != NULL){
+        ExecConstraints(state->result_rel_info, chunk_slot, state->estate);
+        ResetPerTupleExprContext(state->estate);
+    }
+
+    state->buffer_subxact_id = subxact_id;
+    state->n_buffered++;
+    if(state->n_buffered >= state->max_buffered){
+        chunk_insert_state_flush(state);
+    }
+}
+
+void
+chunk_insert_state_flush(ChunkInsertState *state)
+{
+    EState *estate = state->estate;
+    ResultRelInfo *rri = state->result_rel_info;
+    MemoryContext old_context;
+
+    if(state->n_buffered == 0) return;
+
+    if(state->bistate == NULL){
+        MemoryContext state_context = MemoryContextSwitchTo(insert_state_context);
+        state->bistate = GetBulkInsertState();
+        MemoryContextSwitchTo(state_context);
+    }
+
+    old_context = MemoryContextSwitchTo(GetPerTupleMemoryContext(estate));
+
+    table_multi_insert(state->rel,
+                       state->buffered_slots,
+                       state->n_buffered,
+                       GetCurrentCommandId(true),
+                       0,
+                       state->bistate);
+
+    for(int i=0; i<state->n_buffered; i++){
+        if(rri->ri_NumIndices > 0){
+            List *recheck = ExecInsertIndexTuples(rri, state->buffered_slots[i], estate, false, false, NULL, NIL, false);
+            list_free(recheck);
+            ResetPerTupleExprContext(estate);
+        }
+        ExecClearTuple(state->buffered_slots[i]);
+    }
+
+    MemoryContextSwitchTo(old_context);
+    ResetPerTupleExprContext(estate);
+
+    // no buffer pin outlives the flush, it belongs to the current (sub)transaction
+    ReleaseBulkInsertStatePin(state->bistate);
+
+    elog(DEBUG1, "Chunk insert state flushed %d row(s) into chunk %d", state->n_buffered, state->chunk_id);
+    state->n_buffered = 0;
+}
+
+void
+chunk_insert_state_close_all(void)
+{
+    HASH_SEQ_STATUS status;
+    ChunkInsertState *state;
+    ResourceOwner old_owner;
+    SubTransactionId subxact_id = GetCurrentSubTransactionId();
+    ChunkInsertState **closed;
+    int n_closed = 0;
+    int n_kept = 0;
+
+    if(insert_states == NULL) return;
+
+    // references were taken by the top transaction owner
+    old_owner = CurrentResourceOwner;
+    CurrentResourceOwner = TopTransactionResourceOwner;
+
+    // write buffered rows before anything is closed
+    hash_seq_init(&status, insert_states);
+    while((state = (ChunkInsertState *) hash_seq_search(&status)) != NULL){
+        if(state->n_buffered > 0 && state->buffer_subxact_id != subxact_id) continue;
+        chunk_insert_state_flush(state);
+    }
+
+    /*
+        Ranges of the chunk skipping columns commit together with the rows.
+        Written in chunk_id order, so writers widening the ranges of the same
+        chunks take the row locks in the same order.
+    */
+    closed = (ChunkInsertState **) palloc(hash_get_num_entries(insert_states) * sizeof(ChunkInsertState *));
+    hash_seq_init(&status, insert_states);
+    while((state = (ChunkInsertState *) hash_seq_search(&status)) != NULL){
+        if(state->n_buffered > 0) continue;
+        closed[n_closed++] = state;
+    }
+    qsort(closed, n_closed, sizeof(ChunkInsertState *), chunk_insert_state_cmp);
+    for(int i=0; i<n_closed; i++){
+        chunk_column_stats_ranges_write(closed[i]->hypertable_relid, closed[i]->chunk_id,
+                                        closed[i]->column_ranges, closed[i]->n_column_ranges);
+    }
+    pfree(closed);
+
+    // states still holding rows of an enclosing subtransaction are closed by its statement
+    hash_seq_init(&status, insert_states);
+    while((state = (ChunkInsertState *) hash_seq_search(&status)) != NULL){
+        if(state->n_buffered > 0){
+            n_kept++;
+            continue;
+        }
+        chunk_insert_state_close(state);
+        hash_search(insert_states, &state->chunk_id, HASH_REMOVE, NULL);
+    }
+
+    CurrentResourceOwner = old_owner;
+
+    if(n_kept > 0) return;
+
+    MemoryContextDelete(insert_state_context);
+    insert_states = NULL;
+    insert_state_context = NULL;
+}
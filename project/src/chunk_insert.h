@@ -0,0 +1,49 @@
+#pragma once
+
+#include <postgres.h>
+#include <access/heapam.h>
+#include <access/tupconvert.h>
+#include <executor/tuptable.h>
+#include <nodes/execnodes.h>
+#include <utils/rel.h>
+
+#include "chunk.h"
+#include "chunk_column_stats.h"
+#include "hypertable_cache.h"
+
+// per-chunk executor state used to insert tuples directly into a chunk table
+typedef struct ChunkInsertState {
+    int chunk_id; // key
+    Oid relid;
+    Relation rel;
+    ResultRelInfo *result_rel_info;
+    EState *estate;
+    TupleTableSlot *slot; // slot in chunk tuple format
+    TupleConversionMap *map; // hypertable -> chunk, NULL when layout is the same
+    ResultRelInfo *hypertable_rri; // computes stored generated columns, NULL without
+
+    // multi-insert buffer
+    TupleTableSlot **buffered_slots;
+    int n_buffered;
+    int max_buffered; // capacity of buffered_slots
+    BulkInsertState bistate;
+
+    SubTransactionId subxact_id; // subtransaction that opened the state
+    SubTransactionId buffer_subxact_id; // subtransaction of the buffered rows
+
+    // min/max of the chunk skipping columns over the routed rows, written when the state is closed
+    Oid hypertable_relid;
+    ChunkColumnRange *column_ranges;
+    int n_column_ranges;
+} ChunkInsertState;
+
+// max rows buffered per chunk before table_multi_insert (<= 1 disables buffering)
+extern int chunk_insert_batch_size;
+
+
+extern ChunkInsertState* chunk_insert_state_get(const ChunkInfo *info, TupleDesc hypertable_desc,
+                                               const HypertableInfo *ht_info);
+extern void chunk_insert_state_insert(ChunkInsertState *state, TupleTableSlot *slot);
+extern void chunk_insert_state_buffer(ChunkInsertState *state, TupleTableSlot *slot);
+extern void chunk_insert_state_flush(ChunkInsertState *state);
+extern void chunk_insert_state_close_all(void);
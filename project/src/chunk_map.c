@@ -0,0 +1,306 @@
+#include <postgres.h>
+#include <access/xact.h>
+#include <lib/dshash.h>
+#include <miscadmin.h>
+#include <nodes/pg_list.h>
+#include <storage/ipc.h>
+#include <storage/lwlock.h>
+#include <storage/shmem.h>
+#include <utils/dsa.h>
+#include <utils/memutils.h>
+#include <utils/syscache.h>
+
+#include "chunk.h"
+#include "chunk_map.h"
+
+/*
+    Shared chunk map
+
+    [chunk_get_or_create]
+            ↓
+    [backend chunk cache (chunk.c)] --hit--> route
+            ↓ miss
+    [shared chunk map (dshash)]     --hit--> route, copy to backend cache
+            ↓ miss
+    [SPI: _timeseries_catalog.chunk / chunk_create] --> publish at commit
+
+    (database, hypertable_id, chunk_start, space_bucket) -> chunk, stored in a dshash table
+    on a DSA area, so a new connection routes rows without querying the catalog.
+    Readers take the dshash partition lock in shared mode only.
+
+    Chunks are published at commit of the transaction that found or created
+    them, once the chunk table is visible to other backends, and only if the
+    chunk table is still there at pre-commit (savepoint rollback). Readers
+    check that the chunk table exists (syscache, no catalog query). A failed
+    check is a miss, the catalog decides: chunks dropped by retention,
+    compression or DROP TABLE are replaced when their slot is created again.
+
+    The map needs shared memory, it is only available when the library is
+    in shared_preload_libraries. Otherwise every lookup is a miss.
+*/
+#define CHUNK_MAP_NAME "simple_timeseries chunk map"
+
+typedef struct ChunkMapShared {
+    LWLock *lock; // protects handles while the area is created
+    int tranche_id;
+    dsa_handle area_handle;
+    dshash_table_handle table_handle;
+} ChunkMapShared;
+
+typedef struct ChunkMapPending {
+    int hypertable_id;
+    int64 chunk_start;
+    ChunkInfo info;
+} ChunkMapPending;
+
+static ChunkMapShared *chunk_map_shared = NULL;
+static dsa_area *chunk_map_area = NULL;
+static dshash_table *chunk_map_table = NULL;
+
+static List *pending_chunks = NIL; // in TopTransactionContext
+static bool xact_callback_registered = false;
+
+static shmem_request_hook_type prev_shmem_request_hook = NULL;
+static shmem_startup_hook_type prev_shmem_startup_hook = NULL;
+
+static dshash_parameters chunk_map_params = {
+    .key_size = sizeof(ChunkMapKey),
+    .entry_size = sizeof(ChunkMapEntry),
+    .compare_function = dshash_memcmp,
+    .hash_function = dshash_memhash,
+    .copy_function = dshash_memcpy,
+    .tranche_id = 0, // set at attach
+};
+
+/*
+    Private function
+*/
+static void
+chunk_map_shmem_request(void)
+{
+    if (prev_shmem_request_hook){
+        prev_shmem_request_hook();
+    }
+
+    RequestAddinShmemSpace(MAXALIGN(sizeof(ChunkMapShared)));
+    RequestNamedLWLockTranche(CHUNK_MAP_NAME, 1);
+}
+
+static void
+chunk_map_shmem_startup(void)
+{
+    bool found;
+
+    if (prev_shmem_startup_hook){
+        prev_shmem_startup_hook();
+    }
+
+    LWLockAcquire(AddinShmemInitLock, LW_EXCLUSIVE);
+    chunk_map_shared = ShmemInitStruct(CHUNK_MAP_NAME, sizeof(ChunkMapShared), &found);
+    if (!found){
+        chunk_map_shared->lock = &(GetNamedLWLockTranche(CHUNK_MAP_NAME))->lock;
+        chunk_map_shared->tranche_id = LWLockNewTrancheId();
+        chunk_map_shared->area_handle = DSA_HANDLE_INVALID;
+        chunk_map_shared->table_handle = DSHASH_HANDLE_INVALID;
+    }
+    LWLockRelease(AddinShmemInitLock);
+}
+
+// attach (or create on first use) the shared map, false when shared memory is not available
+static bool
+chunk_map_attach(void)
+{
+    MemoryContext old_context;
+
+    if (chunk_map_table != NULL) return true;
+    if (chunk_map_shared == NULL) return false;
+
+    LWLockRegisterTranche(chunk_map_shared->tranche_id, CHUNK_MAP_NAME);
+    chunk_map_params.tranche_id = chunk_map_shared->tranche_id;
+
+    // mapping lives as long as the backend
+    old_context = MemoryContextSwitchTo(TopMemoryContext);
+    LWLockAcquire(chunk_map_shared->lock, LW_EXCLUSIVE);
+
+    if (chunk_map_shared->area_handle == DSA_HANDLE_INVALID){
+        chunk_map_area = dsa_create(chunk_map_shared->tranche_id);
+        dsa_pin(chunk_map_area); // keep area when all backends detach
+        dsa_pin_mapping(chunk_map_area);
+        chunk_map_table = dshash_create(chunk_map_area, &chunk_map_params, NULL);
+
+        chunk_map_shared->area_handle = dsa_get_handle(chunk_map_area);
+        chunk_map_shared->table_handle = dshash_get_hash_table_handle(chunk_map_table);
+    }
+    else{
+        chunk_map_area = dsa_attach(chunk_map_shared->area_handle);
+        dsa_pin_mapping(chunk_map_area);
+        chunk_map_table = dshash_attach(chunk_map_area, &chunk_map_params, chunk_map_shared->table_handle, NULL);
+    }
+
+    LWLockRelease(chunk_map_shared->lock);
+    MemoryContextSwitchTo(old_context);
+
+    elog(DEBUG1, "Chunk map attached");
+    return true;
+}
+
+static void
+chunk_map_make_key(ChunkMapKey *key, int hypertable_id, int64 chunk_start, int space_bucket)
+{
+    memset(key, 0, sizeof(ChunkMapKey)); // key is hashed as raw bytes
+    key->database_id = MyDatabaseId;
+    key->hypertable_id = hypertable_id;
+    key->chunk_start = chunk_start;
+    key->space_bucket = space_bucket;
+}
+
+static void
+chunk_map_insert(int hypertable_id, int64 chunk_start, const ChunkInfo *info)
+{
+    ChunkMapKey key;
+    ChunkMapEntry *entry;
+    bool found;
+
+    chunk_map_make_key(&key, hypertable_id, chunk_start, info->space_bucket);
+
+    entry = (ChunkMapEntry *) dshash_find_or_insert(chunk_map_table, &key, &found);
+    memcpy(&entry->info, info, sizeof(ChunkInfo));
+    dshash_release_lock(chunk_map_table, entry);
+
+    elog(DEBUG1, "Chunk map INSERT: hypertable=%d, start=%ld, chunk=%s",
+        hypertable_id, chunk_start, info->table_name);
+}
+
+static void
+chunk_map_xact_callback(XactEvent event, void *arg)
+{
+    ListCell *lc;
+    List *visible = NIL;
+    MemoryContext old_context;
+
+    switch (event){
+        case XACT_EVENT_PRE_COMMIT:
+            // catalog is not accessible at commit, drop chunks created in a rolled back savepoint now
+            old_context = MemoryContextSwitchTo(TopTransactionContext);
+            foreach(lc, pending_chunks){
+                ChunkMapPending *pending = (ChunkMapPending *) lfirst(lc);
+
+                if (SearchSysCacheExists1(RELOID, ObjectIdGetDatum(pending->info.relid))){
+                    visible = lappend(visible, pending);
+                }
+            }
+            pending_chunks = visible;
+            MemoryContextSwitchTo(old_context);
+            break;
+        case XACT_EVENT_COMMIT:
+        case XACT_EVENT_PARALLEL_COMMIT:
+            // other backends see the chunk table now, an error here can not abort the commit anymore
+            PG_TRY();
+            {
+                foreach(lc, pending_chunks){
+                    ChunkMapPending *pending = (ChunkMapPending *) lfirst(lc);
+
+                    chunk_map_insert(pending->hypertable_id, pending->chunk_start, &pending->info);
+                }
+            }
+            PG_CATCH();
+            {
+                // dshash partition lock held when the DSA allocation failed
+                LWLockReleaseAll();
+                FlushErrorState();
+                elog(WARNING, "chunk map: could not publish chunks, they are found in the catalog instead");
+            }
+            PG_END_TRY();
+            pending_chunks = NIL;
+            break;
+        case XACT_EVENT_ABORT:
+        case XACT_EVENT_PARALLEL_ABORT:
+        case XACT_EVENT_PREPARE:
+            // list memory released with TopTransactionContext
+            pending_chunks = NIL;
+            break;
+        default:
+            break;
+    }
+}
+
+/*
+    Public function
+*/
+void
+chunk_map_shmem_init(void)
+{
+    if (!process_shared_preload_libraries_in_progress) return;
+
+    prev_shmem_request_hook = shmem_request_hook;
+    shmem_request_hook = chunk_map_shmem_request;
+    prev_shmem_startup_hook = shmem_startup_hook;
+    shmem_startup_hook = chunk_map_shmem_startup;
+}
+
+bool
+chunk_map_lookup(int hypertable_id, int64 chunk_start, int space_bucket, ChunkInfo *info)
+{
+    ChunkMapKey key;
+    ChunkMapEntry *entry;
+
+    if (!chunk_map_attach()) return false;
+
+    chunk_map_make_key(&key, hypertable_id, chunk_start, space_bucket);
+
+    entry = (ChunkMapEntry *) dshash_find(chunk_map_table, &key, false);
+    if (entry == NULL) return false;
+
+    memcpy(info, &entry->info, sizeof(ChunkInfo));
+    dshash_release_lock(chunk_map_table, entry);
+
+    // chunk table dropped since it was published, or not visible to this backend yet: ask the catalog
+    if (!SearchSysCacheExists1(RELOID, ObjectIdGetDatum(info->relid))){
+        return false;
+    }
+
+    return true;
+}
+
+void
+chunk_map_publish(int hypertable_id, int64 chunk_start, const ChunkInfo *info)
+{
+    MemoryContext old_context;
+    ChunkMapPending *pending;
+
+    // entry without table can not be validated
+    if (info->relid == InvalidOid) return;
+    if (!chunk_map_attach()) return;
+
+    if (!xact_callback_registered){
+        RegisterXactCallback(chunk_map_xact_callback, NULL);
+        xact_callback_registered = true;
+    }
+
+    old_context = MemoryContextSwitchTo(TopTransactionContext);
+    pending = (ChunkMapPending *) palloc(sizeof(ChunkMapPending));
+    pending->hypertable_id = hypertable_id;
+    pending->chunk_start = chunk_start;
+    memcpy(&pending->info, info, sizeof(ChunkInfo));
+    pending_chunks = lappend(pending_chunks, pending);
+    MemoryContextSwitchTo(old_context);
+}
+
+void
+chunk_map_remove_hypertable(int hypertable_id)
+{
+    dshash_seq_status status;
+    ChunkMapEntry *entry;
+
+    if (!chunk_map_attach()) return;
+
+    dshash_seq_init(&status, chunk_map_table, true);
+    while ((entry = (ChunkMapEntry *) dshash_seq_next(&status)) != NULL){
+        if (entry->key.database_id == MyDatabaseId && entry->key.hypertable_id == hypertable_id){
+            dshash_delete_current(&status);
+        }
+    }
+    dshash_seq_term(&status);
+
+    elog(DEBUG1, "Chunk map cleared: hypertable=%d", hypertable_id);
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <postgres.h>
+
+#include "chunk.h"
+
+// shared map key, hypertable ids are per database
+typedef struct ChunkMapKey {
+    Oid database_id;
+    int hypertable_id;
+    int64 chunk_start;
+    int space_bucket; // 0 without space dimension
+} ChunkMapKey;
+
+// data that stored in shared map
+typedef struct ChunkMapEntry {
+    ChunkMapKey key;
+    ChunkInfo info;
+} ChunkMapEntry;
+
+
+// install shmem hooks, only when loaded by shared_preload_libraries
+extern void chunk_map_shmem_init(void);
+
+// copy chunk into info, false when not in the shared map (or map not available)
+extern bool chunk_map_lookup(int hypertable_id, int64 chunk_start, int space_bucket, ChunkInfo *info);
+
+// publish chunk to other backends when the current transaction commits (keyed by info->space_bucket)
+extern void chunk_map_publish(int hypertable_id, int64 chunk_start, const ChunkInfo *info);
+
+// remove every chunk of a hypertable (drop_hypertable)
+extern void chunk_map_remove_hypertable(int hypertable_id);
@@ -0,0 +1,190 @@
+#include <postgres.h>
+#include <fmgr.h>
+#include <executor/spi.h>
+#include <miscadmin.h>
+#include <utils/lsyscache.h>
+#include <utils/timestamp.h>
+
+#include "metadata.h"
+#include "chunk.h"
+#include "chunk_precreate.h"
+
+/*
+    Chunk pre-creation
+
+    [launcher] --spawn--> [retention worker (per database)]
+                                    ↓ every 60 sec, after retention
+                          [_timeseries_catalog.precreate_policies]
+                                    ↓ for each hypertable
+                          [chunk_get_or_create(now + i * interval, bucket), i < chunks_ahead]
+
+    The first insert into a new interval used to run CREATE TABLE, ALTER TABLE
+    and the catalog insert on the client's critical path. With a policy the
+    worker creates the current and upcoming chunks ahead of time, so ingest
+    only finds existing chunks (backend cache, shared chunk map or catalog).
+    The pass runs in the retention worker, a worker of its own would take
+    one more of max_worker_processes per database. A failing pass is rolled
+    back on its own and does not stop retention.
+
+    Chunks are created through chunk_get_or_create(), the same creation lock
+    as the insert path is taken, so a racing insert reuses the chunk. With a
+    hash dimension every bucket of an interval is created.
+*/
+
+/*
+    Public function
+*/
+int
+chunk_precreate(int hypertable_id, int64 now, int chunks_ahead)
+{
+    int64 chunk_interval;
+    int num_partitions = 1;
+    int created = 0;
+
+    chunk_interval = metadata_get_chunk_interval(hypertable_id);
+    if (chunk_interval == -1){
+        ereport(ERROR, errmsg("invalid chunk interval for hypertable %d", hypertable_id));
+    }
+
+    // time only hypertable = one bucket
+    metadata_get_space_column(hypertable_id, &num_partitions);
+
+    for (int i = 0; i < chunks_ahead; i++){
+        int64 time_point = now + i * chunk_interval;
+
+        for (int bucket = 0; bucket < num_partitions; bucket++){
+            if (metadata_find_chunk(hypertable_id, time_point, bucket) != -1) continue;
+
+            pfree(chunk_get_or_create(hypertable_id, chunk_interval, time_point, bucket));
+            created++;
+        }
+    }
+
+    return created;
+}
+
+int
+chunk_precreate_apply_all_policies(void)
+{
+    int ret, total = 0;
+    uint64 i, n;
+    int64 now = GetCurrentTimestamp();
+
+    ret = SPI_execute(
+        "SELECT hypertable_id, chunks_ahead "
+        "FROM _timeseries_catalog.precreate_policies",
+        true, 0);
+    if (ret != SPI_OK_SELECT || SPI_processed == 0)
+        return 0;
+
+    // copy rows, chunk creation overwrites SPI_tuptable
+    typedef struct {
+        int hypertable_id;
+        int chunks_ahead;
+    } PolicyRow;
+
+    n = SPI_processed;
+    PolicyRow *rows = (PolicyRow *) palloc(n * sizeof(PolicyRow));
+
+    for (i = 0; i < n; i++){
+        bool isnull;
+        rows[i].hypertable_id = DatumGetInt32(SPI_getbinval(SPI_tuptable->vals[i], SPI_tuptable->tupdesc, 1, &isnull));
+        rows[i].chunks_ahead = DatumGetInt32(SPI_getbinval(SPI_tuptable->vals[i], SPI_tuptable->tupdesc, 2, &isnull));
+    }
+
+    for (i = 0; i < n; i++){
+        int created = chunk_precreate(rows[i].hypertable_id, now, rows[i].chunks_ahead);
+        total += created;
+        if (created > 0)
+            elog(DEBUG1, "chunk precreate: hypertable %d : created %d chunk(s)", rows[i].hypertable_id, created);
+    }
+
+    return total;
+}
+
+PG_FUNCTION_INFO_V1(set_chunk_precreate_policy);
+Datum
+set_chunk_precreate_policy(PG_FUNCTION_ARGS)
+{
+    Oid table_oid = PG_GETARG_OID(0);
+    int chunks_ahead = PG_GETARG_INT32(1);
+
+    char *schema_name = get_namespace_name(get_rel_namespace(table_oid));
+    char *table_name = get_rel_name(table_oid);
+    StringInfoData query;
+
+    if (chunks_ahead <= 0){
+        ereport(ERROR, (errmsg("chunks_ahead must be positive")));
+    }
+
+    SPI_connect();
+
+    int hypertable_id = metadata_get_hypertable_id(schema_name, table_name);
+    if (hypertable_id == -1){
+        SPI_finish();
+        ereport(ERROR, (errmsg("table \"%s.%s\" is not a hypertable", schema_name, table_name)));
+    }
+
+    initStringInfo(&query);
+    appendStringInfo(&query,
+        "INSERT INTO _timeseries_catalog.precreate_policies (hypertable_id, chunks_ahead) "
+        "VALUES (%d, %d) "
+        "ON CONFLICT (hypertable_id) DO UPDATE "
+        "    SET chunks_ahead = EXCLUDED.chunks_ahead, "
+        "        updated_at = NOW()",
+        hypertable_id, chunks_ahead);
+
+    int ret = SPI_execute(query.data, false, 0);
+    if (ret != SPI_OK_INSERT && ret != SPI_OK_UPDATE){
+        SPI_finish();
+        ereport(ERROR, (errmsg("chunk precreate: failed to set policy")));
+    }
+
+    elog(NOTICE, "set_chunk_precreate_policy: \"%s.%s\" keeps %d chunk(s) ahead",
+        schema_name, table_name, chunks_ahead);
+
+    SPI_finish();
+    PG_RETURN_VOID();
+}
+
+PG_FUNCTION_INFO_V1(remove_chunk_precreate_policy);
+Datum
+remove_chunk_precreate_policy(PG_FUNCTION_ARGS)
+{
+    Oid table_oid = PG_GETARG_OID(0);
+
+    char *schema_name = get_namespace_name(get_rel_namespace(table_oid));
+    char *table_name = get_rel_name(table_oid);
+    StringInfoData query;
+
+    SPI_connect();
+
+    int hypertable_id = metadata_get_hypertable_id(schema_name, table_name);
+    if (hypertable_id == -1){
+        SPI_finish();
+        ereport(ERROR, (errmsg("table \"%s.%s\" is not a hypertable", schema_name, table_name)));
+    }
+
+    initStringInfo(&query);
+    appendStringInfo(&query,
+        "DELETE FROM _timeseries_catalog.precreate_policies "
+        "WHERE hypertable_id = %d", hypertable_id);
+    SPI_execute(query.data, false, 0);
+
+    elog(NOTICE, "remove_chunk_precreate_policy: policy removed from \"%s.%s\"", schema_name, table_name);
+
+    SPI_finish();
+    PG_RETURN_VOID();
+}
+
+PG_FUNCTION_INFO_V1(apply_chunk_precreate_policies);
+Datum
+apply_chunk_precreate_policies(PG_FUNCTION_ARGS)
+{
+    SPI_connect();
+    int total = chunk_precreate_apply_all_policies();
+    SPI_finish();
+
+    elog(NOTICE, "apply_chunk_precreate_policies: %d chunk(s) created in total", total);
+    PG_RETURN_INT32(total);
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <postgres.h>
+
+
+// create chunks covering [now, now + chunks_ahead intervals), return number of chunks created
+extern int chunk_precreate(int hypertable_id, int64 now, int chunks_ahead);
+
+// run through all hypertable with pre-creation policy
+extern int chunk_precreate_apply_all_policies(void);
@@ -0,0 +1,237 @@
+#include <postgres.h>
+#include <fmgr.h>
+#include <access/sysattr.h>
+#include <access/table.h>
+#include <catalog/pg_authid.h>
+#include <commands/copy.h>
+#include <executor/executor.h>
+#include <executor/tuptable.h>
+#include <miscadmin.h>
+#include <nodes/parsenodes.h>
+#include <parser/parse_node.h>
+#include <parser/parse_relation.h>
+#include <tcop/cmdtag.h>
+#include <tcop/utility.h>
+#include <utils/acl.h>
+#include <utils/lsyscache.h>
+#include <utils/memutils.h>
+#include <utils/rel.h>
+#include <utils/timestamp.h>
+
+#include "chunk.h"
+#include "chunk_insert.h"
+#include "copy.h"
+#include "hypertable_cache.h"
+#include "dimension.h"
+#include "last_value.h"
+#include "trigger.h"
+
+/*
+    COPY FROM into hypertable
+
+    [COPY sensor_data FROM ...]
+            ↓
+    [ProcessUtility hook: is target a hypertable?] --no--> standard COPY
+            ↓ yes
+    [NextCopyFrom() parses each row once]
+            ↓
+    [chunk_get_or_create() by time column and space bucket]
+            ↓
+    [per-chunk multi insert buffer (chunk_insert.c)]
+
+    The row trigger is bypassed, the same way PostgreSQL routes COPY into
+    partitions without going through the parent table. Hypertables with row
+    level security or user triggers go through standard COPY, rows are then
+    routed by before_insert_trigger.
+*/
+
+static ProcessUtility_hook_type prev_process_utility_hook = NULL;
+
+/*
+    Private function
+*/
+
+static void
+copy_check_permissions(CopyStmt *stmt, Relation rel)
+{
+    if(stmt->filename != NULL || stmt->is_program){
+        if(stmt->is_program && !has_privs_of_role(GetUserId(), ROLE_PG_EXECUTE_SERVER_PROGRAM)){
+            ereport(ERROR,
+                    (errcode(ERRCODE_INSUFFICIENT_PRIVILEGE),
+                    errmsg("permission denied to COPY from an external program")));
+        }
+        if(!stmt->is_program && !has_privs_of_role(GetUserId(), ROLE_PG_READ_SERVER_FILES)){
+            ereport(ERROR,
+                    (errcode(ERRCODE_INSUFFICIENT_PRIVILEGE),
+                    errmsg("permission denied to COPY from a file")));
+        }
+    }
+
+    // INSERT on the table, or on each copied column
+    if(pg_class_aclcheck(RelationGetRelid(rel), GetUserId(), ACL_INSERT) != ACLCHECK_OK){
+        RangeTblEntry *rte = makeNode(RangeTblEntry);
+        RTEPermissionInfo *perminfo;
+        List *perminfos = NIL;
+        List *attnums = CopyGetAttnums(RelationGetDescr(rel), rel, stmt->attlist);
+        ListCell *lc;
+
+        rte->rtekind = RTE_RELATION;
+        rte->relid = RelationGetRelid(rel);
+        rte->relkind = rel->rd_rel->relkind;
+        rte->rellockmode = RowExclusiveLock;
+        perminfo = addRTEPermissionInfo(&perminfos, rte);
+        perminfo->requiredPerms = ACL_INSERT;
+        foreach(lc, attnums){
+            perminfo->insertedCols = bms_add_member(perminfo->insertedCols,
+                                                    lfirst_int(lc) - FirstLowInvalidHeapAttributeNumber);
+        }
+
+        ExecCheckPermissions(list_make1(rte), perminfos, true);
+    }
+}
+
+static uint64
+copy_from_hypertable(ParseState *pstate, CopyStmt *stmt, Relation rel, const HypertableInfo *ht_info)
+{
+    TupleDesc tupdesc = RelationGetDescr(rel);
+    CopyFromState cstate;
+    EState *estate;
+    ExprContext *econtext;
+    TupleTableSlot *slot;
+    uint64 processed = 0;
+
+    cstate = BeginCopyFrom(pstate, rel, NULL, stmt->filename, stmt->is_program,
+                           NULL, stmt->attlist, stmt->options);
+
+    estate = CreateExecutorState();
+    econtext = GetPerTupleExprContext(estate);
+    slot = MakeSingleTupleTableSlot(tupdesc, &TTSOpsVirtual);
+
+    for(;;){
+        MemoryContext old_context;
+        ChunkInfo *chunk_info;
+        ChunkInsertState *insert_state;
+        bool isnull;
+        Datum time_datum;
+
+        CHECK_FOR_INTERRUPTS();
+
+        ResetPerTupleExprContext(estate);
+        ExecClearTuple(slot);
+
+        // row values and chunk lookup results only live for one row
+        old_context = MemoryContextSwitchTo(GetPerTupleMemoryContext(estate));
+
+        if(!NextCopyFrom(cstate, econtext, slot->tts_values, slot->tts_isnull)){
+            MemoryContextSwitchTo(old_context);
+            break;
+        }
+        ExecStoreVirtualTuple(slot);
+
+        time_datum = slot_getattr(slot, ht_info->time_attnum, &isnull);
+        if(isnull){
+            ereport(ERROR, errmsg("time column cannot be NULL"));
+        }
+
+        chunk_info = chunk_get_or_create(ht_info->hypertable_id, ht_info->chunk_interval, DatumGetTimestampTz(time_datum),
+                                         dimension_slot_space_bucket(ht_info, slot));
+        insert_state = chunk_insert_state_get(chunk_info, tupdesc, ht_info);
+        chunk_insert_state_buffer(insert_state, slot);
+        last_value_cache_update(ht_info, slot);
+
+        MemoryContextSwitchTo(old_context);
+        processed++;
+    }
+
+    // write remaining buffers
+    chunk_insert_state_close_all();
+
+    ExecDropSingleTupleTableSlot(slot);
+    FreeExecutorState(estate);
+    EndCopyFrom(cstate);
+
+    return processed;
+}
+
+static void
+timeseries_process_utility(PlannedStmt *pstmt,
+                           const char *query_string,
+                           bool read_only_tree,
+                           ProcessUtilityContext context,
+                           ParamListInfo params,
+                           QueryEnvironment *query_env,
+                           DestReceiver *dest,
+                           QueryCompletion *qc)
+{
+    Node *parsetree = pstmt->utilityStmt;
+
+    if(IsA(parsetree, CopyStmt)){
+        CopyStmt *stmt = (CopyStmt *) parsetree;
+
+        // only plain COPY table FROM, WHERE clause goes through standard COPY
+        if(stmt->is_from && stmt->relation != NULL && stmt->query == NULL && stmt->whereClause == NULL){
+            Relation rel = table_openrv(stmt->relation, RowExclusiveLock);
+            HypertableInfo ht_info;
+
+            // row level security and user triggers need the executor
+            if(hypertable_cache_lookup(RelationGetRelid(rel), &ht_info) &&
+               !rel->rd_rel->relrowsecurity && !trigger_has_user_triggers(rel)){
+                ParseState *pstate;
+                uint64 processed;
+
+                copy_check_permissions(stmt, rel);
+
+                pstate = make_parsestate(NULL);
+                pstate->p_sourcetext = query_string;
+
+                processed = copy_from_hypertable(pstate, stmt, rel, &ht_info);
+
+                free_parsestate(pstate);
+                table_close(rel, NoLock);
+
+                if(qc != NULL){
+                    SetQueryCompletion(qc, CMDTAG_COPY, processed);
+                }
+                return;
+            }
+
+            table_close(rel, NoLock);
+        }
+    }
+
+    // call previous hook or standard utility
+    if(prev_process_utility_hook){
+        prev_process_utility_hook(pstmt, query_string, read_only_tree, context, params, query_env, dest, qc);
+    }
+    else{
+        standard_ProcessUtility(pstmt, query_string, read_only_tree, context, params, query_env, dest, qc);
+    }
+}
+
+/*
+    Public function
+*/
+
+void
+copy_hook_init(void)
+{
+    // prevent double installation
+    if(ProcessUtility_hook == timeseries_process_utility){
+        elog(WARNING, "Timeseries utility hook already installed");
+        return;
+    }
+
+    prev_process_utility_hook = ProcessUtility_hook;
+    ProcessUtility_hook = timeseries_process_utility;
+
+    elog(LOG, "Timeseries utility hook installed");
+}
+
+void
+copy_hook_cleanup(void)
+{
+    if(ProcessUtility_hook == timeseries_process_utility){
+        ProcessUtility_hook = prev_process_utility_hook;
+        elog(LOG, "Timeseries utility hook removed");
+    }
+}
@@ -0,0 +1,7 @@
+#pragma once
+
+#include <postgres.h>
+
+// ProcessUtility hook that routes COPY FROM into hypertable chunks
+void copy_hook_init(void);
+void copy_hook_cleanup(void);
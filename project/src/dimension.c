@@ -0,0 +1,138 @@
+#include <postgres.h>
+#include <fmgr.h>
+#include <access/table.h>
+#include <executor/spi.h>
+#include <utils/builtins.h>
+#include <utils/lsyscache.h>
+#include <utils/rel.h>
+#include <utils/typcache.h>
+
+#include "metadata.h"
+#include "dimension.h"
+#include "hypertable_cache.h"
+
+/*
+    Hash (space) dimension
+
+    SELECT add_dimension('sensor_data', 'sensor_id', 4);
+
+    [row] → time slice (chunk_calculate_start) + bucket (dimension_space_bucket)
+                    ↓
+    [one chunk per (time slice, bucket)]
+
+    The bucket is the column type's hash function (the one hash joins and
+    hash indexes use) modulo number_partitions, NULL goes to bucket 0.
+    Concurrent writers of one time slice then spread over number_partitions
+    chunk heaps and indexes instead of contending on one. The planner drops
+    chunks of other buckets for "space_column = constant" (planner.c).
+
+    A hypertable has at most one hash dimension, and it must be added before
+    the first chunk exists, existing chunks would hold rows of every bucket.
+*/
+
+/*
+    Public function
+*/
+int
+dimension_space_bucket(const HypertableInfo *info, Datum value, bool isnull)
+{
+    TypeCacheEntry *typentry;
+    uint32 hash;
+
+    if (info->num_partitions <= 0 || isnull) return 0;
+
+    typentry = lookup_type_cache(info->space_type, TYPECACHE_HASH_PROC_FINFO);
+    if (!OidIsValid(typentry->hash_proc_finfo.fn_oid)){
+        ereport(ERROR, errmsg("could not identify a hash function for type %s", format_type_be(info->space_type)));
+    }
+
+    hash = DatumGetUInt32(FunctionCall1Coll(&typentry->hash_proc_finfo, info->space_collation, value));
+    return (int) (hash % (uint32) info->num_partitions);
+}
+
+int
+dimension_slot_space_bucket(const HypertableInfo *info, TupleTableSlot *slot)
+{
+    Datum value;
+    bool isnull;
+
+    if (info->num_partitions <= 0) return 0;
+
+    value = slot_getattr(slot, info->space_attnum, &isnull);
+    return dimension_space_bucket(info, value, isnull);
+}
+
+/*
+    Top level function
+*/
+PG_FUNCTION_INFO_V1(add_dimension);
+Datum
+add_dimension(PG_FUNCTION_ARGS)
+{
+    Oid table_oid = PG_GETARG_OID(0);
+    char *column_name = text_to_cstring(PG_GETARG_TEXT_PP(1));
+    int32 num_partitions = PG_GETARG_INT32(2);
+    Relation rel;
+    char *schema_name;
+    char *table_name;
+    char *time_column;
+    AttrNumber attnum;
+    Oid column_type;
+    TypeCacheEntry *typentry;
+    int hypertable_id;
+    int existing_partitions;
+
+    if (num_partitions < 1 || num_partitions > DIMENSION_MAX_PARTITIONS){
+        ereport(ERROR,
+                (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                errmsg("number_partitions must be between 1 and %d", DIMENSION_MAX_PARTITIONS)));
+    }
+
+    // no insert may route rows while the dimension changes
+    rel = table_open(table_oid, AccessExclusiveLock);
+    schema_name = get_namespace_name(RelationGetNamespace(rel));
+    table_name = pstrdup(RelationGetRelationName(rel));
+
+    attnum = get_attnum(table_oid, column_name);
+    if (attnum == InvalidAttrNumber){
+        ereport(ERROR, errmsg("column \"%s\" does not exist", column_name));
+    }
+
+    column_type = get_atttype(table_oid, attnum);
+    typentry = lookup_type_cache(column_type, TYPECACHE_HASH_PROC);
+    if (!OidIsValid(typentry->hash_proc)){
+        ereport(ERROR,
+                (errcode(ERRCODE_UNDEFINED_FUNCTION),
+                errmsg("column \"%s\" has type %s, which has no hash function", column_name, format_type_be(column_type))));
+    }
+
+    SPI_connect();
+    hypertable_id = metadata_get_hypertable_id(schema_name, table_name);
+    if (hypertable_id == -1){
+        ereport(ERROR, errmsg("\"%s.%s\" is not a hypertable", schema_name, table_name));
+    }
+
+    time_column = metadata_get_time_column(hypertable_id);
+    if (time_column != NULL && strcmp(time_column, column_name) == 0){
+        ereport(ERROR, errmsg("column \"%s\" is already the time dimension", column_name));
+    }
+
+    if (metadata_get_space_column(hypertable_id, &existing_partitions) != NULL){
+        ereport(ERROR, errmsg("\"%s.%s\" already has a space dimension", schema_name, table_name));
+    }
+
+    if (metadata_count_chunks(hypertable_id) > 0){
+        ereport(ERROR,
+                (errmsg("cannot add a space dimension to \"%s.%s\", it already has chunks", schema_name, table_name),
+                errhint("Add the dimension before inserting data.")));
+    }
+
+    metadata_insert_space_dimension(hypertable_id, column_name, column_type, num_partitions);
+    elog(NOTICE, "Added space dimension on column \"%s\" with %d partition(s)", column_name, num_partitions);
+    SPI_finish();
+
+    table_close(rel, NoLock); // keep lock until commit
+    hypertable_cache_invalidate(table_oid); // insert path descriptor, all backends
+
+    PG_RETURN_VOID();
+}
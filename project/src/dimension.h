@@ -0,0 +1,16 @@
+#pragma once
+
+#include <postgres.h>
+#include <executor/tuptable.h>
+
+#include "hypertable_cache.h"
+
+// upper bound for add_dimension(number_partitions)
+#define DIMENSION_MAX_PARTITIONS 1024
+
+
+// hash bucket of a space column value, 0 when the hypertable has no hash dimension
+extern int dimension_space_bucket(const HypertableInfo *info, Datum value, bool isnull);
+
+// same, value read from a tuple in hypertable layout
+extern int dimension_slot_space_bucket(const HypertableInfo *info, TupleTableSlot *slot);
@@ -0,0 +1,730 @@
+#include <postgres.h>
+#include <fmgr.h>
+#include <access/stratnum.h>
+#include <catalog/pg_type.h>
+#include <executor/executor.h>
+#include <nodes/execnodes.h>
+#include <nodes/extensible.h>
+#include <nodes/makefuncs.h>
+#include <nodes/nodeFuncs.h>
+#include <optimizer/optimizer.h>
+#include <optimizer/pathnode.h>
+#include <optimizer/paths.h>
+#include <optimizer/tlist.h>
+#include <utils/lsyscache.h>
+#include <utils/timestamp.h>
+#include <utils/typcache.h>
+
+#include "chunk_exclusion.h"
+#include "time_bucket.h"
+#include "gapfill.h"
+
+/*
+    Gap fill
+
+    SELECT time_bucket_gapfill('1 hour', time) AS hour, sensor_id,
+           avg(temperature), locf(avg(temperature)), interpolate(avg(temperature))
+    FROM sensor_data
+    WHERE time >= '2024-01-01' AND time < '2024-01-02'
+    GROUP BY hour, sensor_id
+
+    [GapFill]                       one row per bucket of [start, finish) and group
+        ↓ sorted by sensor_id, hour
+    [Sort] (unless the aggregation already returns that order)
+        ↓
+    [Aggregate]                     rows of buckets that have data
+
+    Missing buckets are emitted between the aggregated rows while they
+    stream through, per group (GROUP BY columns other than the bucket):
+
+    - bucket column: start of the missing bucket
+    - other GROUP BY columns: the values of the group
+    - locf(x): x of the last row of the group with data (NULL before it)
+    - interpolate(x): linear between the rows with data around the gap
+      (NULL before the first and after the last one)
+    - everything else (count(*), avg(...)): NULL
+
+    start and finish are the 3rd/4th arguments of time_bucket_gapfill() or
+    come from "time >=/> X" and "time </<= Y" in WHERE. Both are evaluated
+    once when the query starts (now() works). No extra scan or join: one
+    pass over the aggregated rows.
+
+    Outside a GROUP BY, time_bucket_gapfill() is time_bucket() and locf() /
+    interpolate() return their argument.
+*/
+
+typedef struct GapFillState {
+    CustomScanState css;
+    PlanState *child;
+
+    AttrNumber bucket_attno;
+    bool finish_inclusive;
+    int n_group;
+    AttrNumber *group_attnos;
+    ExprState *group_match; // same group as group_slot
+    List *locf_attnos;
+    List *interpolate_attnos;
+    ExprState *width_state;
+    ExprState *start_state;
+    ExprState *finish_state;
+
+    bool initialized; // start/finish evaluated
+    int64 width;
+    int64 first_bucket;
+    int64 end; // exclusive
+    int64 next_bucket; // next bucket of the current group that has no row yet
+
+    TupleTableSlot *pending; // child row waiting behind missing buckets
+    TupleTableSlot *group_slot; // first row of the current group
+    TupleTableSlot *last_slot; // last row with data of the current group
+    bool group_active;
+    bool has_last;
+    bool any_row;
+    bool done;
+} GapFillState;
+
+static Node *gapfill_state_create(CustomScan *cscan);
+static void gapfill_begin(CustomScanState *node, EState *estate, int eflags);
+static TupleTableSlot *gapfill_exec(CustomScanState *node);
+static void gapfill_end(CustomScanState *node);
+static void gapfill_rescan(CustomScanState *node);
+static Plan *gapfill_plan_create(PlannerInfo *root, RelOptInfo *rel, CustomPath *best_path,
+                                 List *tlist, List *clauses, List *custom_plans);
+
+static CustomPathMethods gapfill_path_methods = {
+    .CustomName = "GapFill",
+    .PlanCustomPath = gapfill_plan_create,
+};
+
+static CustomScanMethods gapfill_plan_methods = {
+    .CustomName = "GapFill",
+    .CreateCustomScanState = gapfill_state_create,
+};
+
+static CustomExecMethods gapfill_exec_methods = {
+    .CustomName = "GapFill",
+    .BeginCustomScan = gapfill_begin,
+    .ExecCustomScan = gapfill_exec,
+    .EndCustomScan = gapfill_end,
+    .ReScanCustomScan = gapfill_rescan,
+};
+
+/*
+    Top level function
+*/
+PG_FUNCTION_INFO_V1(time_bucket_gapfill);
+Datum
+time_bucket_gapfill(PG_FUNCTION_ARGS)
+{
+    int64 width;
+    Timestamp ts;
+    int64 result;
+
+    if (PG_ARGISNULL(0) || PG_ARGISNULL(1)) PG_RETURN_NULL();
+
+    width = time_bucket_interval_width(PG_GETARG_INTERVAL_P(0));
+    ts = PG_GETARG_TIMESTAMP(1);
+    if (TIMESTAMP_NOT_FINITE(ts)) PG_RETURN_TIMESTAMP(ts);
+
+    if (!time_bucket_compute(width, 0, ts, &result) || !IS_VALID_TIMESTAMP(result)){
+        ereport(ERROR,
+                (errcode(ERRCODE_DATETIME_VALUE_OUT_OF_RANGE),
+                errmsg("timestamp out of range")));
+    }
+    PG_RETURN_TIMESTAMP(result);
+}
+
+// value as is, GapFill carries it into missing buckets
+PG_FUNCTION_INFO_V1(locf);
+Datum
+locf(PG_FUNCTION_ARGS)
+{
+    PG_RETURN_DATUM(PG_GETARG_DATUM(0));
+}
+
+// value as is, GapFill interpolates it in missing buckets
+PG_FUNCTION_INFO_V1(interpolate);
+Datum
+interpolate(PG_FUNCTION_ARGS)
+{
+    PG_RETURN_FLOAT8(PG_GETARG_FLOAT8(0));
+}
+
+/*
+    Executor
+*/
+static Node *
+gapfill_state_create(CustomScan *cscan)
+{
+    GapFillState *state = (GapFillState *) newNode(sizeof(GapFillState), T_CustomScanState);
+
+    state->css.methods = &gapfill_exec_methods;
+    return (Node *) state;
+}
+
+static void
+gapfill_begin(CustomScanState *node, EState *estate, int eflags)
+{
+    GapFillState *state = (GapFillState *) node;
+    CustomScan *cscan = (CustomScan *) node->ss.ps.plan;
+    TupleDesc scan_desc = node->ss.ss_ScanTupleSlot->tts_tupleDescriptor;
+    List *group_attnos = (List *) lthird(cscan->custom_private);
+    List *group_eqops = (List *) lfourth(cscan->custom_private);
+    List *group_collations = (List *) list_nth(cscan->custom_private, 4);
+    Oid *eqops;
+    Oid *collations;
+    ListCell *lc;
+
+    state->child = ExecInitNode((Plan *) linitial(cscan->custom_plans), estate, eflags);
+    node->custom_ps = list_make1(state->child);
+
+    state->bucket_attno = intVal(linitial(cscan->custom_private));
+    state->finish_inclusive = boolVal(lsecond(cscan->custom_private));
+    state->locf_attnos = (List *) list_nth(cscan->custom_private, 5);
+    state->interpolate_attnos = (List *) list_nth(cscan->custom_private, 6);
+
+    state->width_state = ExecInitExpr((Expr *) linitial(cscan->custom_exprs), &node->ss.ps);
+    state->start_state = ExecInitExpr((Expr *) lsecond(cscan->custom_exprs), &node->ss.ps);
+    state->finish_state = ExecInitExpr((Expr *) lthird(cscan->custom_exprs), &node->ss.ps);
+
+    state->n_group = list_length(group_attnos);
+    state->group_attnos = (AttrNumber *) palloc((state->n_group + 1) * sizeof(AttrNumber));
+    eqops = (Oid *) palloc((state->n_group + 1) * sizeof(Oid));
+    collations = (Oid *) palloc((state->n_group + 1) * sizeof(Oid));
+    foreach(lc, group_attnos){
+        int i = foreach_current_index(lc);
+
+        state->group_attnos[i] = (AttrNumber) lfirst_int(lc);
+        eqops[i] = list_nth_oid(group_eqops, i);
+        collations[i] = list_nth_oid(group_collations, i);
+    }
+    if (state->n_group > 0){
+        state->group_match = execTuplesMatchPrepare(scan_desc, state->n_group, state->group_attnos,
+                                                    eqops, collations, &node->ss.ps);
+    }
+
+    state->group_slot = ExecInitExtraTupleSlot(estate, scan_desc, &TTSOpsMinimalTuple);
+    state->last_slot = ExecInitExtraTupleSlot(estate, scan_desc, &TTSOpsMinimalTuple);
+}
+
+static int64
+gapfill_eval_time(ExprState *expr_state, ExprContext *econtext, const char *what)
+{
+    bool isnull;
+    Datum value = ExecEvalExprSwitchContext(expr_state, econtext, &isnull);
+    Timestamp ts;
+
+    if (isnull){
+        ereport(ERROR,
+                (errcode(ERRCODE_NULL_VALUE_NOT_ALLOWED),
+                errmsg("time_bucket_gapfill %s can not be NULL", what)));
+    }
+    ts = DatumGetTimestamp(value);
+    if (TIMESTAMP_NOT_FINITE(ts)){
+        ereport(ERROR,
+                (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                errmsg("time_bucket_gapfill %s must be finite", what)));
+    }
+    return ts;
+}
+
+// range of buckets, evaluated once per scan
+static void
+gapfill_initialize(GapFillState *state)
+{
+    ExprContext *econtext = state->css.ss.ps.ps_ExprContext;
+    bool isnull;
+    Datum width = ExecEvalExprSwitchContext(state->width_state, econtext, &isnull);
+    int64 start;
+
+    if (isnull){
+        ereport(ERROR,
+                (errcode(ERRCODE_NULL_VALUE_NOT_ALLOWED),
+                errmsg("time_bucket_gapfill width can not be NULL")));
+    }
+    state->width = time_bucket_interval_width(DatumGetIntervalP(width));
+
+    start = gapfill_eval_time(state->start_state, econtext, "start");
+    state->end = gapfill_eval_time(state->finish_state, econtext, "finish");
+    if (state->finish_inclusive){
+        state->end++;
+    }
+
+    if (!time_bucket_compute(state->width, 0, start, &state->first_bucket)){
+        ereport(ERROR,
+                (errcode(ERRCODE_DATETIME_VALUE_OUT_OF_RANGE),
+                errmsg("timestamp out of range")));
+    }
+    state->initialized = true;
+}
+
+static bool
+gapfill_same_group(GapFillState *state, TupleTableSlot *slot)
+{
+    ExprContext *econtext = state->css.ss.ps.ps_ExprContext;
+
+    if (state->n_group == 0) return true;
+
+    econtext->ecxt_innertuple = state->group_slot;
+    econtext->ecxt_outertuple = slot;
+    return ExecQualAndReset(state->group_match, econtext);
+}
+
+static void
+gapfill_start_group(GapFillState *state, TupleTableSlot *slot)
+{
+    if (slot != NULL){
+        ExecCopySlot(state->group_slot, slot);
+    }
+    else{
+        // no rows at all and no group columns: one group of only missing buckets
+        ExecStoreAllNullTuple(state->group_slot);
+    }
+    state->group_active = true;
+    state->has_last = false;
+    state->next_bucket = state->first_bucket;
+}
+
+// linear between the last row with data and the pending row of the same group
+static bool
+gapfill_interpolate(GapFillState *state, AttrNumber attno, int64 bucket, Datum *result)
+{
+    TupleTableSlot *next = state->pending;
+    Datum prev_value;
+    Datum next_value;
+    Datum prev_time;
+    Datum next_time;
+    bool isnull;
+    double fraction;
+
+    if (!state->has_last || next == NULL) return false;
+
+    prev_time = slot_getattr(state->last_slot, state->bucket_attno, &isnull);
+    if (isnull) return false;
+    prev_value = slot_getattr(state->last_slot, attno, &isnull);
+    if (isnull) return false;
+    next_time = slot_getattr(next, state->bucket_attno, &isnull);
+    if (isnull) return false;
+    next_value = slot_getattr(next, attno, &isnull);
+    if (isnull) return false;
+
+    if (DatumGetTimestamp(next_time) == DatumGetTimestamp(prev_time)) return false;
+
+    fraction = (double) (bucket - DatumGetTimestamp(prev_time)) /
+               (double) (DatumGetTimestamp(next_time) - DatumGetTimestamp(prev_time));
+    *result = Float8GetDatum(DatumGetFloat8(prev_value) +
+                             (DatumGetFloat8(next_value) - DatumGetFloat8(prev_value)) * fraction);
+    return true;
+}
+
+// row of the missing bucket next_bucket of the current group
+static TupleTableSlot *
+gapfill_missing_row(GapFillState *state)
+{
+    TupleTableSlot *slot = state->css.ss.ss_ScanTupleSlot;
+    int natts = slot->tts_tupleDescriptor->natts;
+    bool pending_in_group = state->pending != NULL && gapfill_same_group(state, state->pending);
+    ListCell *lc;
+
+    ExecClearTuple(slot);
+    memset(slot->tts_isnull, true, natts * sizeof(bool));
+
+    slot->tts_values[state->bucket_attno - 1] = TimestampGetDatum(state->next_bucket);
+    slot->tts_isnull[state->bucket_attno - 1] = false;
+
+    for (int i = 0; i < state->n_group; i++){
+        AttrNumber attno = state->group_attnos[i];
+
+        slot->tts_values[attno - 1] = slot_getattr(state->group_slot, attno, &slot->tts_isnull[attno - 1]);
+    }
+
+    if (state->has_last){
+        foreach(lc, state->locf_attnos){
+            AttrNumber attno = (AttrNumber) lfirst_int(lc);
+
+            slot->tts_values[attno - 1] = slot_getattr(state->last_slot, attno, &slot->tts_isnull[attno - 1]);
+        }
+    }
+
+    if (pending_in_group){
+        foreach(lc, state->interpolate_attnos){
+            AttrNumber attno = (AttrNumber) lfirst_int(lc);
+
+            slot->tts_isnull[attno - 1] = !gapfill_interpolate(state, attno, state->next_bucket,
+                                                              &slot->tts_values[attno - 1]);
+        }
+    }
+
+    ExecStoreVirtualTuple(slot);
+    state->next_bucket += state->width;
+    return slot;
+}
+
+static TupleTableSlot *
+gapfill_project(GapFillState *state, TupleTableSlot *slot)
+{
+    ProjectionInfo *proj = state->css.ss.ps.ps_ProjInfo;
+
+    if (proj == NULL) return slot;
+
+    state->css.ss.ps.ps_ExprContext->ecxt_scantuple = slot;
+    return ExecProject(proj);
+}
+
+static TupleTableSlot *
+gapfill_exec(CustomScanState *node)
+{
+    GapFillState *state = (GapFillState *) node;
+
+    if (!state->initialized){
+        gapfill_initialize(state);
+    }
+
+    for (;;){
+        TupleTableSlot *slot;
+        Datum bucket;
+        bool isnull;
+
+        CHECK_FOR_INTERRUPTS();
+
+        if (state->pending == NULL && !state->done){
+            slot = ExecProcNode(state->child);
+            if (TupIsNull(slot)){
+                state->done = true;
+            }
+            else{
+                state->pending = slot;
+                state->any_row = true;
+            }
+        }
+
+        if (state->pending == NULL){
+            // buckets after the last row of the group
+            if (!state->group_active && !state->any_row && state->n_group == 0){
+                gapfill_start_group(state, NULL);
+            }
+            if (state->group_active && state->next_bucket < state->end){
+                return gapfill_project(state, gapfill_missing_row(state));
+            }
+            return NULL;
+        }
+
+        if (state->group_active && !gapfill_same_group(state, state->pending)){
+            // finish the previous group first
+            if (state->next_bucket < state->end){
+                return gapfill_project(state, gapfill_missing_row(state));
+            }
+            state->group_active = false;
+        }
+        if (!state->group_active){
+            gapfill_start_group(state, state->pending);
+        }
+
+        bucket = slot_getattr(state->pending, state->bucket_attno, &isnull);
+        if (!isnull && DatumGetTimestamp(bucket) > state->next_bucket && state->next_bucket < state->end){
+            return gapfill_project(state, gapfill_missing_row(state));
+        }
+
+        // row with data, in place
+        if (!isnull && DatumGetTimestamp(bucket) >= state->next_bucket){
+            state->next_bucket = DatumGetTimestamp(bucket) + state->width;
+        }
+        ExecCopySlot(state->last_slot, state->pending);
+        state->has_last = !isnull;
+
+        slot = ExecCopySlot(node->ss.ss_ScanTupleSlot, state->pending);
+        state->pending = NULL;
+        return gapfill_project(state, slot);
+    }
+}
+
+static void
+gapfill_end(CustomScanState *node)
+{
+    GapFillState *state = (GapFillState *) node;
+
+    ExecEndNode(state->child);
+}
+
+static void
+gapfill_rescan(CustomScanState *node)
+{
+    GapFillState *state = (GapFillState *) node;
+
+    if (node->ss.ps.chgParam != NULL){
+        UpdateChangedParamSet(state->child, node->ss.ps.chgParam);
+    }
+
+    // start and finish may depend on changed parameters
+    state->initialized = false;
+    state->pending = NULL;
+    state->group_active = false;
+    state->has_last = false;
+    state->any_row = false;
+    state->done = false;
+    ExecClearTuple(state->group_slot);
+    ExecClearTuple(state->last_slot);
+    if (state->child->chgParam == NULL){
+        ExecReScan(state->child);
+    }
+}
+
+/*
+    Plan
+*/
+// call of one of the functions above, same check as time_bucket_kind()
+static bool
+gapfill_is_function(Node *node, const char *fn_name, PGFunction fn)
+{
+    FmgrInfo finfo;
+    char *name;
+
+    if (node == NULL || !IsA(node, FuncExpr)) return false;
+
+    name = get_func_name(((FuncExpr *) node)->funcid);
+    if (name == NULL || strcmp(name, fn_name) != 0) return false;
+
+    fmgr_info(((FuncExpr *) node)->funcid, &finfo);
+    return finfo.fn_addr == fn;
+}
+
+// "time op X" of the bucketed column in WHERE, X without columns of this query level
+static Expr *
+gapfill_bound_from_quals(PlannerInfo *root, Var *time_var, bool lower, bool *inclusive)
+{
+    RelOptInfo *rel;
+    TypeCacheEntry *typentry;
+    ListCell *lc;
+
+    if (time_var->varlevelsup != 0 || time_var->varno <= 0 || time_var->varno >= root->simple_rel_array_size) return NULL;
+
+    rel = root->simple_rel_array[time_var->varno];
+    if (rel == NULL) return NULL;
+
+    typentry = lookup_type_cache(time_var->vartype, TYPECACHE_BTREE_OPFAMILY);
+
+    foreach(lc, rel->baserestrictinfo){
+        Expr *clause = ((RestrictInfo *) lfirst(lc))->clause;
+        OpExpr *op;
+        Node *left;
+        Node *right;
+        Node *bound;
+        int strategy;
+
+        if (!IsA(clause, OpExpr) || list_length(((OpExpr *) clause)->args) != 2) continue;
+
+        op = (OpExpr *) clause;
+        left = linitial(op->args);
+        right = lsecond(op->args);
+        strategy = get_op_opfamily_strategy(op->opno, typentry->btree_opf);
+
+        if (equal(left, time_var)){
+            bound = right;
+        }
+        else if (equal(right, time_var)){
+            bound = left;
+            // "X op time" reads the other way round
+            strategy = chunk_exclusion_commute_strategy(strategy);
+        }
+        else{
+            continue;
+        }
+
+        if (exprType(bound) != time_var->vartype || contain_var_clause(bound) || contain_volatile_functions(bound)){
+            continue;
+        }
+
+        if (lower && (strategy == BTGreaterStrategyNumber || strategy == BTGreaterEqualStrategyNumber)){
+            *inclusive = false;
+            return (Expr *) copyObject(bound);
+        }
+        if (!lower && (strategy == BTLessStrategyNumber || strategy == BTLessEqualStrategyNumber)){
+            *inclusive = strategy == BTLessEqualStrategyNumber;
+            return (Expr *) copyObject(bound);
+        }
+    }
+    return NULL;
+}
+
+static bool
+gapfill_is_null_const(Node *node)
+{
+    return node != NULL && IsA(node, Const) && ((Const *) node)->constisnull;
+}
+
+static Plan *
+gapfill_plan_create(PlannerInfo *root, RelOptInfo *rel, CustomPath *best_path,
+                    List *tlist, List *clauses, List *custom_plans)
+{
+    CustomScan *cscan = makeNode(CustomScan);
+    Index bucket_ref = (Index) intVal(linitial(best_path->custom_private));
+    List *group_clauses = (List *) lsecond(best_path->custom_private);
+    List *group_attnos = NIL;
+    List *group_eqops = NIL;
+    List *group_collations = NIL;
+    List *locf_attnos = NIL;
+    List *interpolate_attnos = NIL;
+    AttrNumber bucket_attno = InvalidAttrNumber;
+    ListCell *lc;
+
+    foreach(lc, tlist){
+        TargetEntry *tle = (TargetEntry *) lfirst(lc);
+        ListCell *lc2;
+
+        if (tle->ressortgroupref == bucket_ref){
+            bucket_attno = tle->resno;
+            continue;
+        }
+        if (gapfill_is_function((Node *) tle->expr, "locf", locf)){
+            locf_attnos = lappend_int(locf_attnos, tle->resno);
+            continue;
+        }
+        if (gapfill_is_function((Node *) tle->expr, "interpolate", interpolate)){
+            interpolate_attnos = lappend_int(interpolate_attnos, tle->resno);
+            continue;
+        }
+        if (tle->ressortgroupref == 0) continue;
+
+        foreach(lc2, group_clauses){
+            SortGroupClause *sgc = (SortGroupClause *) lfirst(lc2);
+
+            if (sgc->tleSortGroupRef == tle->ressortgroupref){
+                group_attnos = lappend_int(group_attnos, tle->resno);
+                group_eqops = lappend_oid(group_eqops, sgc->eqop);
+                group_collations = lappend_oid(group_collations, exprCollation((Node *) tle->expr));
+                break;
+            }
+        }
+    }
+
+    if (bucket_attno == InvalidAttrNumber){
+        elog(ERROR, "GapFill: time_bucket_gapfill column not in target list");
+    }
+
+    // output is the row of the child, missing buckets are built in the same layout
+    cscan->scan.plan.targetlist = tlist;
+    cscan->scan.scanrelid = 0;
+    cscan->custom_scan_tlist = tlist;
+    cscan->custom_plans = custom_plans;
+    cscan->custom_exprs = list_make3(lthird(best_path->custom_private), // width
+                                     lfourth(best_path->custom_private), // start
+                                     list_nth(best_path->custom_private, 4)); // finish
+    cscan->custom_private = list_make5(makeInteger(bucket_attno),
+                                       list_nth(best_path->custom_private, 5), // finish inclusive
+                                       group_attnos, group_eqops, group_collations);
+    cscan->custom_private = lappend(cscan->custom_private, locf_attnos);
+    cscan->custom_private = lappend(cscan->custom_private, interpolate_attnos);
+    cscan->methods = &gapfill_plan_methods;
+    return (Plan *) cscan;
+}
+
+/*
+    Public function
+*/
+void
+gapfill_init(void)
+{
+    RegisterCustomScanMethods(&gapfill_plan_methods);
+}
+
+void
+gapfill_add_paths(PlannerInfo *root, RelOptInfo *grouped_rel)
+{
+    Query *parse = root->parse;
+    SortGroupClause *bucket_clause = NULL;
+    FuncExpr *gapfill = NULL;
+    List *group_clauses = NIL;
+    List *sort_clauses;
+    List *pathkeys;
+    List *old_paths;
+    Expr *start;
+    Expr *finish;
+    bool start_inclusive = true;
+    bool finish_inclusive = false;
+    ListCell *lc;
+
+    if (parse->groupingSets != NIL || root->processed_groupClause == NIL) return;
+
+    foreach(lc, root->processed_groupClause){
+        SortGroupClause *sgc = (SortGroupClause *) lfirst(lc);
+        Node *expr = (Node *) get_sortgroupclause_expr(sgc, root->processed_tlist);
+
+        if (gapfill == NULL && gapfill_is_function(expr, "time_bucket_gapfill", time_bucket_gapfill)){
+            gapfill = (FuncExpr *) expr;
+            bucket_clause = sgc;
+        }
+        else{
+            group_clauses = lappend(group_clauses, sgc);
+        }
+    }
+    if (gapfill == NULL) return;
+
+    // missing rows are found between neighbours, every group column has to sort
+    foreach(lc, root->processed_groupClause){
+        if (!OidIsValid(((SortGroupClause *) lfirst(lc))->sortop)){
+            ereport(ERROR,
+                    (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+                    errmsg("time_bucket_gapfill needs GROUP BY columns that can be sorted")));
+        }
+    }
+
+    start = (Expr *) lthird(gapfill->args);
+    finish = (Expr *) lfourth(gapfill->args);
+    if (gapfill_is_null_const((Node *) start) && IsA(lsecond(gapfill->args), Var)){
+        start = gapfill_bound_from_quals(root, (Var *) lsecond(gapfill->args), true, &start_inclusive);
+    }
+    if (gapfill_is_null_const((Node *) finish) && IsA(lsecond(gapfill->args), Var)){
+        finish = gapfill_bound_from_quals(root, (Var *) lsecond(gapfill->args), false, &finish_inclusive);
+    }
+    if (start == NULL || finish == NULL || gapfill_is_null_const((Node *) start) || gapfill_is_null_const((Node *) finish)){
+        ereport(ERROR,
+                (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                errmsg("time_bucket_gapfill needs start and finish"),
+                errhint("Pass them as arguments or restrict the time column in WHERE (time >= ... AND time < ...).")));
+    }
+    if (contain_var_clause((Node *) start) || contain_var_clause((Node *) finish) ||
+        contain_var_clause(linitial(gapfill->args))){
+        ereport(ERROR,
+                (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+                errmsg("time_bucket_gapfill width, start and finish can not reference columns")));
+    }
+
+    // groups one after the other, buckets in order inside a group
+    sort_clauses = lappend(list_copy(group_clauses), bucket_clause);
+    pathkeys = make_pathkeys_for_sortclauses(root, sort_clauses, root->processed_tlist);
+
+    old_paths = grouped_rel->pathlist;
+    grouped_rel->pathlist = NIL;
+    grouped_rel->partial_pathlist = NIL;
+
+    foreach(lc, old_paths){
+        Path *subpath = (Path *) lfirst(lc);
+        CustomPath *path = makeNode(CustomPath);
+
+        if (!pathkeys_contained_in(pathkeys, subpath->pathkeys)){
+            subpath = (Path *) create_sort_path(root, grouped_rel, subpath, pathkeys, -1.0);
+        }
+
+        path->path.pathtype = T_CustomScan;
+        path->path.parent = grouped_rel;
+        path->path.pathtarget = subpath->pathtarget;
+        path->path.param_info = NULL;
+        path->path.parallel_aware = false;
+        path->path.parallel_safe = false;
+        path->path.parallel_workers = 0;
+        path->path.rows = subpath->rows;
+        path->path.startup_cost = subpath->startup_cost;
+        path->path.total_cost = subpath->total_cost + cpu_tuple_cost * subpath->rows;
+        path->path.pathkeys = pathkeys;
+        path->custom_paths = list_make1(subpath);
+        path->custom_private = list_make5(makeInteger(bucket_clause->tleSortGroupRef),
+                                          group_clauses,
+                                          linitial(gapfill->args),
+                                          start,
+                                          finish);
+        path->custom_private = lappend(path->custom_private, makeBoolean(finish_inclusive));
+        path->methods = &gapfill_path_methods;
+
+        add_path(grouped_rel, (Path *) path);
+    }
+}
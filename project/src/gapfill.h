@@ -0,0 +1,10 @@
+#pragma once
+
+#include <postgres.h>
+#include <nodes/pathnodes.h>
+
+// register GapFill custom scan methods
+extern void gapfill_init(void);
+
+// GROUP BY time_bucket_gapfill(...): put GapFill over the grouping paths, rows for missing buckets
+extern void gapfill_add_paths(PlannerInfo *root, RelOptInfo *grouped_rel);
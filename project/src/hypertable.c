@@ -13,7 +13,9 @@
 #include "metadata.h"
 #include "trigger.h"
 #include "chunk.h"
-#include "planner.h"
+#include "hypertable_cache.h"
+#include "chunk_map.h"
+#include "last_value.h"
 
 #define MICROSECS_PER_DAY INT64CONST(86400000000)
 #define MICROSECS_PER_HOUR INT64CONST(3600000000)
@@ -159,6 +161,7 @@ create_hypertable(PG_FUNCTION_ARGS)
                               time_type,
                               interval_us);
     elog(NOTICE, "Added time dimension on column \"%s\"", time_column_name);
+    metadata_create_chunk_sequence(hypertable_id);
     
     trigger_create_on_hypertable(schema_name, table_name);
     
@@ -166,7 +169,7 @@ create_hypertable(PG_FUNCTION_ARGS)
     elog(NOTICE, "✅ Successfully converted \"%s.%s\" to hypertable", schema_name, table_name);
     SPI_finish();
 
-    planner_invalidate_cache(); // set invalid cache, after commit
+    hypertable_cache_invalidate(table_oid); // planner and insert path descriptor, all backends
     
     PG_RETURN_VOID();
 }
@@ -179,6 +182,7 @@ drop_hypertable(PG_FUNCTION_ARGS)
     Relation rel;
     char *schema_name;
     char *table_name;
+    int hypertable_id;
 
     table_oid = PG_GETARG_OID(0);
 
@@ -191,7 +195,11 @@ drop_hypertable(PG_FUNCTION_ARGS)
         ereport(ERROR, (errmsg("\"%s.%s\" is not a hypertable", schema_name, table_name)));
     }
     
+    hypertable_id = metadata_get_hypertable_id(schema_name, table_name);
+    chunk_map_remove_hypertable(hypertable_id); // shared routing entries
+    last_value_cache_invalidate(hypertable_id);
     metadata_drop_hypertable(schema_name, table_name); // drop hypertable
+    metadata_drop_chunk_sequence(hypertable_id); // chunk numbering
     trigger_drop_on_hypertable(schema_name, table_name); // drop trigger
 
     table_close(rel, AccessExclusiveLock);
@@ -200,7 +208,7 @@ drop_hypertable(PG_FUNCTION_ARGS)
     elog(NOTICE, "✅ Successfully dropped hypertable \"%s.%s\"", schema_name, table_name);
     SPI_finish();
     
-    planner_invalidate_cache(); // set invalid cache, after commit
+    hypertable_cache_invalidate(table_oid); // planner and insert path descriptor, all backends
 
     PG_RETURN_VOID();
 }
\ No newline at end of file
@@ -0,0 +1,220 @@
+#include <postgres.h>
+#include <catalog/namespace.h>
+#include <executor/spi.h>
+#include <utils/hsearch.h>
+#include <utils/inval.h>
+#include <utils/lsyscache.h>
+#include <utils/memutils.h>
+#include <utils/syscache.h>
+
+#include "metadata.h"
+#include "hypertable_cache.h"
+
+/*
+    Hypertable descriptor cache
+
+    relid -> (hypertable id, time column attnum/type, chunk interval,
+              hash dimension attnum/type/partitions, last value cache column,
+              chunk skipping columns)
+
+    Lookups on the insert path used to run three SPI queries per row. The
+    descriptor is now loaded once per backend and kept in CacheMemoryContext.
+    Relations that are not hypertables are cached as well (hypertable_id = -1),
+    so COPY/INSERT into regular tables does not query the catalog either.
+
+    Entries are dropped by relcache invalidation of the relation.
+    create_hypertable/drop_hypertable invalidate the relation explicitly,
+    so every backend reloads the descriptor after commit. A schema change
+    (CREATE/DROP EXTENSION creates/drops _timeseries_catalog) drops all.
+
+    The planner checks every relation of every query here, a cached
+    relation costs one hash probe.
+*/
+static HTAB *hypertable_cache = NULL;
+static bool relcache_callback_registered = false;
+static Oid catalog_namespace = InvalidOid; // _timeseries_catalog
+static bool catalog_namespace_valid = false;
+
+static void
+hypertable_cache_relcache_callback(Datum arg, Oid relid)
+{
+    HASH_SEQ_STATUS status;
+    HypertableInfo *entry;
+
+    if (hypertable_cache == NULL) return;
+
+    if (relid != InvalidOid){
+        hash_search(hypertable_cache, &relid, HASH_REMOVE, NULL);
+        return;
+    }
+
+    // InvalidOid = invalidate everything
+    hash_seq_init(&status, hypertable_cache);
+    while ((entry = (HypertableInfo *) hash_seq_search(&status)) != NULL){
+        hash_search(hypertable_cache, &entry->relid, HASH_REMOVE, NULL);
+    }
+}
+
+// extension created or dropped: cached "not a hypertable" entries may be wrong
+static void
+hypertable_cache_namespace_callback(Datum arg, int cacheid, uint32 hashvalue)
+{
+    catalog_namespace_valid = false;
+    hypertable_cache_relcache_callback(arg, InvalidOid);
+}
+
+static void
+hypertable_cache_init(void)
+{
+    HASHCTL ctl;
+
+    if (hypertable_cache != NULL) return;
+
+    if (!relcache_callback_registered){
+        CacheRegisterRelcacheCallback(hypertable_cache_relcache_callback, (Datum) 0);
+        CacheRegisterSyscacheCallback(NAMESPACEOID, hypertable_cache_namespace_callback, (Datum) 0);
+        relcache_callback_registered = true;
+    }
+
+    memset(&ctl, 0, sizeof(ctl));
+    ctl.keysize = sizeof(Oid);
+    ctl.entrysize = sizeof(HypertableInfo);
+    ctl.hcxt = CacheMemoryContext;
+
+    hypertable_cache = hash_create("Hypertable Info Cache",
+                                   64,
+                                   &ctl,
+                                   HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+}
+
+// descriptor of a relation that is not a hypertable
+static void
+hypertable_info_init(Oid relid, HypertableInfo *info)
+{
+    info->relid = relid;
+    info->hypertable_id = -1;
+    info->time_attnum = InvalidAttrNumber;
+    info->time_type = InvalidOid;
+    info->chunk_interval = -1;
+    info->space_attnum = InvalidAttrNumber;
+    info->space_type = InvalidOid;
+    info->space_collation = InvalidOid;
+    info->num_partitions = 0;
+    info->last_value_attnum = InvalidAttrNumber;
+    info->n_skipping_columns = 0;
+}
+
+// read descriptor from catalog
+static void
+hypertable_cache_load(Oid relid, HypertableInfo *info)
+{
+    char *schema_name = get_namespace_name(get_rel_namespace(relid));
+    char *table_name = get_rel_name(relid);
+    char *time_column_name;
+    char *space_column_name;
+    char *last_value_column_name;
+    List *skipping_column_names;
+    int32 space_typmod;
+    ListCell *lc;
+
+    hypertable_info_init(relid, info);
+    if (schema_name == NULL || table_name == NULL) return;
+
+    SPI_connect();
+
+    info->hypertable_id = metadata_get_hypertable_id(schema_name, table_name);
+    if (info->hypertable_id != -1){
+        time_column_name = metadata_get_time_column(info->hypertable_id);
+        if (time_column_name == NULL){
+            SPI_finish();
+            ereport(ERROR, errmsg("no dimension found for hypertable %d", info->hypertable_id));
+        }
+
+        info->time_attnum = get_attnum(relid, time_column_name);
+        if (info->time_attnum == InvalidAttrNumber){
+            SPI_finish();
+            ereport(ERROR, errmsg("time column \"%s\" not found", time_column_name));
+        }
+        info->time_type = get_atttype(relid, info->time_attnum);
+
+        info->chunk_interval = metadata_get_chunk_interval(info->hypertable_id);
+        if (info->chunk_interval == -1){
+            SPI_finish();
+            ereport(ERROR, errmsg("invalid chunk interval for hypertable %d", info->hypertable_id));
+        }
+
+        space_column_name = metadata_get_space_column(info->hypertable_id, &info->num_partitions);
+        if (space_column_name != NULL){
+            info->space_attnum = get_attnum(relid, space_column_name);
+            if (info->space_attnum == InvalidAttrNumber){
+                SPI_finish();
+                ereport(ERROR, errmsg("space column \"%s\" not found", space_column_name));
+            }
+            get_atttypetypmodcoll(relid, info->space_attnum, &info->space_type, &space_typmod, &info->space_collation);
+        }
+
+        // column dropped since the cache was enabled: cache stays off
+        last_value_column_name = metadata_get_last_value_column(info->hypertable_id);
+        if (last_value_column_name != NULL){
+            info->last_value_attnum = get_attnum(relid, last_value_column_name);
+        }
+
+        // dropped columns are skipped the same way
+        skipping_column_names = metadata_get_chunk_skipping_columns(info->hypertable_id);
+        foreach(lc, skipping_column_names){
+            AttrNumber attnum = get_attnum(relid, (char *) lfirst(lc));
+
+            if (attnum == InvalidAttrNumber || info->n_skipping_columns >= HYPERTABLE_MAX_SKIPPING_COLUMNS) continue;
+            info->skipping_attnums[info->n_skipping_columns++] = attnum;
+        }
+    }
+
+    SPI_finish();
+}
+
+/*
+    Public function
+*/
+bool
+hypertable_cache_lookup(Oid relid, HypertableInfo *info)
+{
+    HypertableInfo *entry;
+    bool found;
+
+    if (hypertable_cache == NULL){
+        hypertable_cache_init();
+    }
+
+    entry = (HypertableInfo *) hash_search(hypertable_cache, &relid, HASH_FIND, &found);
+    if (found){
+        *info = *entry;
+        return info->hypertable_id != -1;
+    }
+
+    if (!catalog_namespace_valid){
+        catalog_namespace = get_namespace_oid("_timeseries_catalog", true);
+        catalog_namespace_valid = true;
+    }
+
+    // extension is preloaded, but might not be created in this database, catalog
+    // tables are never hypertables (their lookup queries are planned here too)
+    if (catalog_namespace == InvalidOid || get_rel_namespace(relid) == catalog_namespace){
+        hypertable_info_init(relid, info);
+    }
+    else{
+        // load first, a failed load must not leave an entry behind
+        hypertable_cache_load(relid, info);
+    }
+
+    entry = (HypertableInfo *) hash_search(hypertable_cache, &relid, HASH_ENTER, &found);
+    *entry = *info;
+
+    elog(DEBUG1, "Hypertable cache INSERT: relid=%u, hypertable=%d", relid, info->hypertable_id);
+    return info->hypertable_id != -1;
+}
+
+void
+hypertable_cache_invalidate(Oid relid)
+{
+    CacheInvalidateRelcacheByRelid(relid);
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <postgres.h>
+#include <access/attnum.h>
+
+// columns with per chunk min/max per hypertable (chunk_column_stats.c)
+#define HYPERTABLE_MAX_SKIPPING_COLUMNS 8
+
+// hypertable descriptor used by the insert path
+typedef struct HypertableInfo {
+    Oid relid; // key
+    int hypertable_id; // -1 when relation is not a hypertable
+    AttrNumber time_attnum;
+    Oid time_type;
+    int64 chunk_interval;
+    AttrNumber space_attnum; // hash dimension, InvalidAttrNumber when none
+    Oid space_type;
+    Oid space_collation;
+    int num_partitions; // 0 when no hash dimension
+    AttrNumber last_value_attnum; // series column of the last value cache, InvalidAttrNumber when off
+    int n_skipping_columns; // columns with per chunk min/max
+    AttrNumber skipping_attnums[HYPERTABLE_MAX_SKIPPING_COLUMNS];
+} HypertableInfo;
+
+
+// copy descriptor of relid into info, return false when relid is not a hypertable
+extern bool hypertable_cache_lookup(Oid relid, HypertableInfo *info);
+
+// drop cached descriptor, also sent to other backends at commit
+extern void hypertable_cache_invalidate(Oid relid);
@@ -0,0 +1,213 @@
+#include <postgres.h>
+#include <fmgr.h>
+#include <access/table.h>
+#include <catalog/pg_type.h>
+#include <executor/tuptable.h>
+#include <miscadmin.h>
+#include <utils/acl.h>
+#include <utils/array.h>
+#include <utils/builtins.h>
+#include <utils/lsyscache.h>
+#include <utils/rel.h>
+#include <utils/timestamp.h>
+
+#include "chunk.h"
+#include "chunk_insert.h"
+#include "hypertable_cache.h"
+#include "dimension.h"
+#include "last_value.h"
+
+/*
+    Column-wise batch ingest
+
+    SELECT ingest_columns('sensor_data', times, sensor_ids, temperatures, ...);
+
+    [times[], col1[], col2[] ...]
+            ↓ deconstruct every array once
+    [sort row numbers by space bucket and time]
+            ↓ one chunk_get_or_create() per run of rows in one chunk range
+    [per-chunk multi insert buffer (chunk_insert.c)]
+
+    Column arrays map to the hypertable columns in column order, the time
+    column excluded (it comes from times). Element types must match the
+    column types exactly. Like COPY, rows do not go through the row trigger.
+*/
+
+typedef struct IngestColumnsRow {
+    int space_bucket;
+    int row; // index into the arrays
+    int64 time;
+} IngestColumnsRow;
+
+// chunk order (chunk widths may vary, so by time instead of a fixed interval), input order on ties
+static int
+ingest_columns_row_cmp(const void *a, const void *b)
+{
+    const IngestColumnsRow *ra = (const IngestColumnsRow *) a;
+    const IngestColumnsRow *rb = (const IngestColumnsRow *) b;
+
+    if(ra->space_bucket != rb->space_bucket)
+        return ra->space_bucket - rb->space_bucket;
+    if(ra->time != rb->time)
+        return (ra->time < rb->time) ? -1 : 1;
+    return ra->row - rb->row;
+}
+
+PG_FUNCTION_INFO_V1(ingest_columns);
+Datum
+ingest_columns(PG_FUNCTION_ARGS)
+{
+    Oid relid;
+    ArrayType *times;
+    int n_columns = PG_NARGS() - 2;
+    HypertableInfo ht_info;
+    Relation rel;
+    TupleDesc tupdesc;
+    Datum *time_values;
+    bool *time_nulls;
+    int n_rows;
+    int expected_columns = 0;
+    AttrNumber *column_attnums;
+    Datum **column_values;
+    bool **column_nulls;
+    IngestColumnsRow *rows;
+    int space_column = -1; // argument index of the hash dimension column
+    TupleTableSlot *slot;
+    ChunkInsertState *insert_state = NULL;
+    ChunkInfo current_chunk;
+
+    if(get_fn_expr_variadic(fcinfo->flinfo)){
+        ereport(ERROR, errmsg("ingest_columns: pass column arrays as separate arguments, not as VARIADIC array"));
+    }
+    if(PG_ARGISNULL(0) || PG_ARGISNULL(1)){
+        ereport(ERROR,
+                (errcode(ERRCODE_NULL_VALUE_NOT_ALLOWED),
+                errmsg("ingest_columns: hypertable and times must not be NULL")));
+    }
+    relid = PG_GETARG_OID(0);
+    times = PG_GETARG_ARRAYTYPE_P(1);
+
+    if(!hypertable_cache_lookup(relid, &ht_info)){
+        ereport(ERROR, errmsg("table \"%s\" is not a hypertable", get_rel_name(relid)));
+    }
+    if(ht_info.time_type != TIMESTAMPTZOID){
+        ereport(ERROR, errmsg("ingest_columns: time column of \"%s\" must be timestamptz", get_rel_name(relid)));
+    }
+    if(pg_class_aclcheck(relid, GetUserId(), ACL_INSERT) != ACLCHECK_OK){
+        aclcheck_error(ACLCHECK_NO_PRIV, OBJECT_TABLE, get_rel_name(relid));
+    }
+
+    rel = table_open(relid, RowExclusiveLock);
+    tupdesc = RelationGetDescr(rel);
+
+    // rows are written to the chunks directly, policies would be bypassed
+    if(rel->rd_rel->relrowsecurity){
+        ereport(ERROR, errmsg("ingest_columns: \"%s\" has row level security enabled", RelationGetRelationName(rel)));
+    }
+
+    // column arrays follow the hypertable columns, time column and dropped columns skipped
+    column_attnums = (AttrNumber *) palloc(tupdesc->natts * sizeof(AttrNumber));
+    for(int i = 0; i < tupdesc->natts; i++){
+        Form_pg_attribute attr = TupleDescAttr(tupdesc, i);
+
+        if(attr->attisdropped || attr->attnum == ht_info.time_attnum) continue;
+        if(attr->attnum == ht_info.space_attnum) space_column = expected_columns;
+        column_attnums[expected_columns++] = attr->attnum;
+    }
+    if(n_columns != expected_columns){
+        ereport(ERROR, errmsg("ingest_columns: \"%s\" needs %d column array(s) after times, got %d",
+                              RelationGetRelationName(rel), expected_columns, n_columns));
+    }
+
+    if(ARR_NDIM(times) > 1){
+        ereport(ERROR, errmsg("ingest_columns: times must be a one-dimensional array"));
+    }
+    deconstruct_array_builtin(times, TIMESTAMPTZOID, &time_values, &time_nulls, &n_rows);
+
+    column_values = (Datum **) palloc(n_columns * sizeof(Datum *));
+    column_nulls = (bool **) palloc(n_columns * sizeof(bool *));
+    for(int i = 0; i < n_columns; i++){
+        Form_pg_attribute attr = TupleDescAttr(tupdesc, column_attnums[i] - 1);
+        Oid elem_type = get_element_type(get_fn_expr_argtype(fcinfo->flinfo, i + 2));
+        ArrayType *array;
+        int16 typlen;
+        bool typbyval;
+        char typalign;
+        int n;
+
+        if(PG_ARGISNULL(i + 2)){
+            ereport(ERROR,
+                    (errcode(ERRCODE_NULL_VALUE_NOT_ALLOWED),
+                    errmsg("ingest_columns: array of column \"%s\" must not be NULL, use an array of NULLs",
+                           NameStr(attr->attname))));
+        }
+        if(elem_type != attr->atttypid){
+            ereport(ERROR,
+                    (errcode(ERRCODE_DATATYPE_MISMATCH),
+                    errmsg("ingest_columns: argument %d must be %s[] for column \"%s\"",
+                           i + 3, format_type_be(attr->atttypid), NameStr(attr->attname))));
+        }
+
+        array = PG_GETARG_ARRAYTYPE_P(i + 2);
+        if(ARR_NDIM(array) > 1){
+            ereport(ERROR, errmsg("ingest_columns: column \"%s\" must be a one-dimensional array", NameStr(attr->attname)));
+        }
+
+        get_typlenbyvalalign(elem_type, &typlen, &typbyval, &typalign);
+        deconstruct_array(array, elem_type, typlen, typbyval, typalign, &column_values[i], &column_nulls[i], &n);
+        if(n != n_rows){
+            ereport(ERROR, errmsg("ingest_columns: column \"%s\" has %d element(s), times has %d",
+                                  NameStr(attr->attname), n, n_rows));
+        }
+    }
+
+    // group rows by chunk once, then each chunk is resolved a single time
+    rows = (IngestColumnsRow *) palloc(Max(n_rows, 1) * sizeof(IngestColumnsRow));
+    for(int row = 0; row < n_rows; row++){
+        if(time_nulls[row]){
+            ereport(ERROR, errmsg("time column cannot be NULL"));
+        }
+        rows[row].time = DatumGetTimestampTz(time_values[row]);
+        rows[row].space_bucket = (space_column == -1) ? 0 :
+            dimension_space_bucket(&ht_info, column_values[space_column][row], column_nulls[space_column][row]);
+        rows[row].row = row;
+    }
+    qsort(rows, n_rows, sizeof(IngestColumnsRow), ingest_columns_row_cmp);
+
+    slot = MakeSingleTupleTableSlot(tupdesc, &TTSOpsVirtual);
+    for(int i = 0; i < n_rows; i++){
+        int row = rows[i].row;
+
+        if(i == 0 || rows[i].space_bucket != current_chunk.space_bucket ||
+           rows[i].time >= current_chunk.end_time){
+            ChunkInfo *chunk_info = chunk_get_or_create(ht_info.hypertable_id,
+                                                        ht_info.chunk_interval,
+                                                        rows[i].time,
+                                                        rows[i].space_bucket);
+            insert_state = chunk_insert_state_get(chunk_info, tupdesc, &ht_info);
+            current_chunk = *chunk_info;
+            pfree(chunk_info);
+        }
+
+        ExecClearTuple(slot);
+        memset(slot->tts_isnull, true, tupdesc->natts * sizeof(bool)); // dropped columns
+        slot->tts_values[ht_info.time_attnum - 1] = time_values[row];
+        slot->tts_isnull[ht_info.time_attnum - 1] = false;
+        for(int c = 0; c < n_columns; c++){
+            slot->tts_values[column_attnums[c] - 1] = column_values[c][row];
+            slot->tts_isnull[column_attnums[c] - 1] = column_nulls[c][row];
+        }
+        ExecStoreVirtualTuple(slot);
+
+        chunk_insert_state_buffer(insert_state, slot);
+        last_value_cache_update(&ht_info, slot);
+    }
+
+    // write remaining buffers
+    chunk_insert_state_close_all();
+
+    ExecDropSingleTupleTableSlot(slot);
+    table_close(rel, NoLock);
+
+    PG_RETURN_INT64((int64) n_rows);
+}
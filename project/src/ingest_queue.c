@@ -0,0 +1,907 @@
+#include <postgres.h>
+#include <fmgr.h>
+#include <funcapi.h>
+#include <access/htup_details.h>
+#include <access/relation.h>
+#include <access/xact.h>
+#include <catalog/pg_class.h>
+#include <executor/tuptable.h>
+#include <miscadmin.h>
+#include <pgstat.h>
+#include <postmaster/bgworker.h>
+#include <storage/ipc.h>
+#include <storage/latch.h>
+#include <storage/lwlock.h>
+#include <storage/shmem.h>
+#include <utils/acl.h>
+#include <utils/builtins.h>
+#include <utils/lsyscache.h>
+#include <utils/memutils.h>
+#include <utils/rel.h>
+#include <utils/snapmgr.h>
+#include <utils/syscache.h>
+#include <utils/timestamp.h>
+
+#include "chunk.h"
+#include "chunk_insert.h"
+#include "hypertable_cache.h"
+#include "dimension.h"
+#include "last_value.h"
+#include "ingest_queue.h"
+
+/*
+    Asynchronous ingest queue
+
+    [ingest_async(hypertable, row)]
+            ↓ copy row into backend buffer, return
+    [rows of the transaction (TopTransactionContext)]
+            ↓ commit (dropped on abort / savepoint rollback)
+    [shared memory ring buffer (one per database)]
+            ↓ latch
+    [ingest writer (per database)]
+            ↓ batch of rows per transaction
+    [chunk_get_or_create + per-chunk multi insert buffer (chunk_insert.c)]
+
+    Rows are stored as flattened row type datums of the hypertable. The
+    writer removes up to INGEST_BATCH_BYTES of rows at once and writes them
+    in one transaction, so the client only pays for a memcpy under an LWLock.
+    Rows larger than a batch are rejected, every row can be taken out.
+
+    Rows follow the transaction of the caller: they enter the queue when it
+    commits and are discarded when it (or the savepoint they were queued in)
+    rolls back. ingest_async_flush writes the rows of the current transaction
+    directly, in the current transaction.
+
+    Durability is asynchronous: rows still in the queue are lost on crash or
+    restart, and a batch that fails (eg. constraint violation) is counted as
+    failed and discarded. When the queue is full ingest_async waits up to
+    simple_timeseries.ingest_queue_timeout for the writer, then drops the row
+    and returns false. A commit that finds the queue full waits the same
+    time, then drops the rows that do not fit.
+*/
+#define INGEST_QUEUE_NAME "simple_timeseries ingest queue"
+#define INGEST_QUEUE_MAX_DATABASES 8
+#define INGEST_ALIGN(len) TYPEALIGN(16, (len)) // padding record always fits a header
+#define INGEST_QUEUE_BYTES ((uint64) ingest_queue_size * 1024)
+#define INGEST_BATCH_BYTES ((Size) Min(INGEST_QUEUE_BYTES, 8 * 1024 * 1024))
+
+int ingest_queue_size = 1024;
+int ingest_queue_timeout = 1000;
+
+typedef struct IngestRecordHeader {
+    uint32 len; // aligned record length, header included
+    Oid relid; // hypertable, InvalidOid = padding until end of ring
+    uint32 tuple_len;
+    uint32 padding;
+} IngestRecordHeader;
+
+typedef struct IngestQueue {
+    Oid database_id; // InvalidOid = slot not used
+    Latch *writer_latch; // NULL when the writer is not running
+    uint64 head; // read position in bytes, never wraps
+    uint64 tail; // write position in bytes, never wraps
+    int64 depth; // rows in queue
+
+    // counters
+    int64 enqueued;
+    int64 taken; // removed from queue by writer or flush
+    int64 written;
+    int64 failed; // taken but not written
+    int64 dropped; // queue still full after timeout
+    int64 backpressure_waits;
+} IngestQueue;
+
+typedef struct IngestQueueShared {
+    LWLock *lock; // protects all queues
+    IngestQueue queues[INGEST_QUEUE_MAX_DATABASES];
+    // followed by one ring buffer of INGEST_QUEUE_BYTES per queue
+} IngestQueueShared;
+
+// start of the rows of one subtransaction in pending_rows, or pending_start before a flush
+typedef struct IngestPendingMark {
+    SubTransactionId subxact_id;
+    Size offset;
+} IngestPendingMark;
+
+static IngestQueueShared *ingest_shared = NULL;
+
+// rows of the current transaction, records as in the queue (TopTransactionContext)
+static char *pending_rows = NULL;
+static Size pending_size = 0;
+static Size pending_used = 0;
+static Size pending_start = 0; // rows before were written by ingest_async_flush
+static List *pending_marks = NIL;
+static List *flush_marks = NIL;
+static bool xact_callback_registered = false;
+
+static shmem_request_hook_type prev_shmem_request_hook = NULL;
+static shmem_startup_hook_type prev_shmem_startup_hook = NULL;
+
+static volatile sig_atomic_t got_sigterm = false;
+
+static void
+ingest_writer_sigterm_handler(SIGNAL_ARGS)
+{
+    got_sigterm = true;
+    SetLatch(MyLatch);
+}
+
+/*
+    Private function
+*/
+static Size
+ingest_queue_shmem_size(void)
+{
+    return add_size(MAXALIGN(sizeof(IngestQueueShared)),
+                    mul_size(INGEST_QUEUE_MAX_DATABASES, INGEST_QUEUE_BYTES));
+}
+
+static void
+ingest_queue_shmem_request(void)
+{
+    if (prev_shmem_request_hook){
+        prev_shmem_request_hook();
+    }
+
+    RequestAddinShmemSpace(ingest_queue_shmem_size());
+    RequestNamedLWLockTranche(INGEST_QUEUE_NAME, 1);
+}
+
+static void
+ingest_queue_shmem_startup(void)
+{
+    bool found;
+
+    if (prev_shmem_startup_hook){
+        prev_shmem_startup_hook();
+    }
+
+    LWLockAcquire(AddinShmemInitLock, LW_EXCLUSIVE);
+    ingest_shared = ShmemInitStruct(INGEST_QUEUE_NAME, ingest_queue_shmem_size(), &found);
+    if (!found){
+        memset(ingest_shared, 0, sizeof(IngestQueueShared));
+        ingest_shared->lock = &(GetNamedLWLockTranche(INGEST_QUEUE_NAME))->lock;
+    }
+    LWLockRelease(AddinShmemInitLock);
+}
+
+static char*
+ingest_queue_data(IngestQueue *queue)
+{
+    int slot = queue - ingest_shared->queues;
+
+    return (char *) ingest_shared + MAXALIGN(sizeof(IngestQueueShared)) + slot * INGEST_QUEUE_BYTES;
+}
+
+// queue of a database, lock must be held exclusively when create is true
+static IngestQueue*
+ingest_queue_for_database(Oid database_id, bool create)
+{
+    IngestQueue *free_queue = NULL;
+
+    for (int i = 0; i < INGEST_QUEUE_MAX_DATABASES; i++){
+        IngestQueue *queue = &ingest_shared->queues[i];
+
+        if (queue->database_id == database_id) return queue;
+        if (free_queue == NULL && queue->database_id == InvalidOid) free_queue = queue;
+    }
+
+    if (!create || free_queue == NULL) return NULL;
+
+    memset(free_queue, 0, sizeof(IngestQueue));
+    free_queue->database_id = database_id;
+    return free_queue;
+}
+
+// records are contiguous, bytes skipped at the end of the ring before a record of record_len
+static uint64
+ingest_queue_padding(IngestQueue *queue, uint32 record_len)
+{
+    uint64 offset = queue->tail % INGEST_QUEUE_BYTES;
+
+    return (INGEST_QUEUE_BYTES - offset < record_len) ? INGEST_QUEUE_BYTES - offset : 0;
+}
+
+// (lock held)
+static bool
+ingest_queue_has_space(IngestQueue *queue, uint32 record_len)
+{
+    return queue->tail + ingest_queue_padding(queue, record_len) + record_len - queue->head <= INGEST_QUEUE_BYTES;
+}
+
+// append one row, false when the queue is full (lock held)
+static bool
+ingest_queue_push(IngestQueue *queue, Oid relid, HeapTupleHeader td, uint32 tuple_len)
+{
+    uint64 size = INGEST_QUEUE_BYTES;
+    uint32 record_len = INGEST_ALIGN(sizeof(IngestRecordHeader) + tuple_len);
+    uint64 offset = queue->tail % size;
+    uint64 pad = ingest_queue_padding(queue, record_len);
+    IngestRecordHeader *header;
+
+    if (!ingest_queue_has_space(queue, record_len)) return false;
+
+    if (pad > 0){
+        header = (IngestRecordHeader *) (ingest_queue_data(queue) + offset);
+        header->len = (uint32) pad;
+        header->relid = InvalidOid;
+        header->tuple_len = 0;
+        queue->tail += pad;
+        offset = 0;
+    }
+
+    header = (IngestRecordHeader *) (ingest_queue_data(queue) + offset);
+    header->len = record_len;
+    header->relid = relid;
+    header->tuple_len = tuple_len;
+    memcpy((char *) header + sizeof(IngestRecordHeader), td, tuple_len);
+
+    queue->tail += record_len;
+    queue->depth++;
+    queue->enqueued++;
+    return true;
+}
+
+// move rows from queue into buf, return bytes used (lock held)
+static Size
+ingest_queue_pop_batch(IngestQueue *queue, char *buf, Size buf_size, int *n_records)
+{
+    uint64 size = INGEST_QUEUE_BYTES;
+    Size used = 0;
+
+    *n_records = 0;
+    while (queue->head < queue->tail){
+        IngestRecordHeader *header = (IngestRecordHeader *) (ingest_queue_data(queue) + queue->head % size);
+
+        if (header->relid == InvalidOid){
+            queue->head += header->len;
+            continue;
+        }
+        if (used + header->len > buf_size) break;
+
+        memcpy(buf + used, header, header->len);
+        used += header->len;
+        queue->head += header->len;
+        queue->depth--;
+        queue->taken++;
+        (*n_records)++;
+    }
+
+    return used;
+}
+
+typedef struct IngestTarget {
+    Oid relid;
+    Relation rel; // NULL when hypertable is gone
+    HypertableInfo ht_info;
+    TupleTableSlot *slot;
+} IngestTarget;
+
+// route rows of a batch into chunks, return number of rows written (inside a transaction)
+static int64
+ingest_write_batch(char *buf, Size used)
+{
+    List *targets = NIL;
+    IngestTarget *target = NULL;
+    int64 written = 0;
+    Size offset = 0;
+    ListCell *lc;
+
+    while (offset < used){
+        IngestRecordHeader *header = (IngestRecordHeader *) (buf + offset);
+        HeapTupleData tuple;
+        ChunkInfo *chunk_info;
+        ChunkInsertState *insert_state;
+        Datum time_datum;
+        bool isnull;
+
+        offset += header->len;
+
+        if (target == NULL || target->relid != header->relid){
+            target = NULL;
+            foreach(lc, targets){
+                if (((IngestTarget *) lfirst(lc))->relid == header->relid){
+                    target = (IngestTarget *) lfirst(lc);
+                    break;
+                }
+            }
+        }
+
+        if (target == NULL){
+            target = (IngestTarget *) palloc0(sizeof(IngestTarget));
+            target->relid = header->relid;
+            target->rel = try_relation_open(header->relid, RowExclusiveLock);
+            if (target->rel != NULL && !hypertable_cache_lookup(header->relid, &target->ht_info)){
+                relation_close(target->rel, RowExclusiveLock);
+                target->rel = NULL;
+            }
+            if (target->rel != NULL){
+                target->slot = MakeSingleTupleTableSlot(RelationGetDescr(target->rel), &TTSOpsVirtual);
+            }
+            else{
+                elog(WARNING, "ingest writer: hypertable %u no longer exists, rows discarded", header->relid);
+            }
+            targets = lappend(targets, target);
+        }
+
+        if (target->rel == NULL) continue;
+
+        // row type datum -> hypertable row
+        tuple.t_len = header->tuple_len;
+        tuple.t_data = (HeapTupleHeader) ((char *) header + sizeof(IngestRecordHeader));
+        ItemPointerSetInvalid(&tuple.t_self);
+        tuple.t_tableOid = InvalidOid;
+
+        ExecClearTuple(target->slot);
+        heap_deform_tuple(&tuple, RelationGetDescr(target->rel), target->slot->tts_values, target->slot->tts_isnull);
+        ExecStoreVirtualTuple(target->slot);
+
+        time_datum = slot_getattr(target->slot, target->ht_info.time_attnum, &isnull);
+        if (isnull) continue;
+
+        chunk_info = chunk_get_or_create(target->ht_info.hypertable_id,
+                                         target->ht_info.chunk_interval,
+                                         DatumGetTimestampTz(time_datum),
+                                         dimension_slot_space_bucket(&target->ht_info, target->slot));
+        insert_state = chunk_insert_state_get(chunk_info, RelationGetDescr(target->rel), &target->ht_info);
+        chunk_insert_state_buffer(insert_state, target->slot);
+        last_value_cache_update(&target->ht_info, target->slot);
+        pfree(chunk_info);
+
+        written++;
+    }
+
+    // write remaining per-chunk buffers
+    chunk_insert_state_close_all();
+
+    foreach(lc, targets){
+        target = (IngestTarget *) lfirst(lc);
+        if (target->rel != NULL){
+            ExecDropSingleTupleTableSlot(target->slot);
+            relation_close(target->rel, NoLock);
+        }
+    }
+
+    return written;
+}
+
+static void
+ingest_queue_count_batch(IngestQueue *queue, int n_records, int64 written)
+{
+    LWLockAcquire(ingest_shared->lock, LW_EXCLUSIVE);
+    queue->written += written;
+    queue->failed += n_records - written;
+    LWLockRelease(ingest_shared->lock);
+}
+
+// write one batch in its own transaction, a failed batch is discarded
+static void
+ingest_writer_flush_batch(IngestQueue *queue, char *buf, Size used, int n_records)
+{
+    MemoryContext context = CurrentMemoryContext;
+    volatile int64 written = 0;
+
+    SetCurrentStatementStartTimestamp();
+    StartTransactionCommand();
+    PushActiveSnapshot(GetTransactionSnapshot());
+
+    PG_TRY();
+    {
+        written = ingest_write_batch(buf, used);
+
+        PopActiveSnapshot();
+        CommitTransactionCommand();
+    }
+    PG_CATCH();
+    {
+        MemoryContextSwitchTo(context);
+        EmitErrorReport();
+        FlushErrorState();
+        AbortCurrentTransaction();
+        written = 0;
+    }
+    PG_END_TRY();
+
+    MemoryContextSwitchTo(context);
+    ingest_queue_count_batch(queue, n_records, written);
+
+    if (written < n_records)
+        elog(LOG, "ingest writer: %ld of %d row(s) discarded", (long) (n_records - written), n_records);
+}
+
+// wait until record_len bytes are free, false (row dropped) after ingest_queue_timeout
+static bool
+ingest_queue_wait_for_space(IngestQueue *queue, uint32 record_len, bool interruptible)
+{
+    TimestampTz wait_start = 0;
+
+    for (;;){
+        Latch *writer_latch;
+        bool has_space;
+        bool dropped = false;
+
+        LWLockAcquire(ingest_shared->lock, LW_EXCLUSIVE);
+        has_space = ingest_queue_has_space(queue, record_len);
+        if (!has_space){
+            TimestampTz now = GetCurrentTimestamp();
+
+            if (wait_start == 0){
+                wait_start = now;
+                queue->backpressure_waits++;
+            }
+            else if (TimestampDifferenceExceeds(wait_start, now, ingest_queue_timeout)){
+                queue->dropped++;
+                dropped = true;
+            }
+        }
+        writer_latch = queue->writer_latch;
+        LWLockRelease(ingest_shared->lock);
+
+        if (has_space) return true;
+        if (writer_latch != NULL) SetLatch(writer_latch);
+        if (dropped) return false;
+
+        // queue full, give the writer time to make room
+        WaitLatch(MyLatch,
+                  WL_LATCH_SET | WL_TIMEOUT | WL_EXIT_ON_PM_DEATH,
+                  10L,
+                  PG_WAIT_EXTENSION);
+        ResetLatch(MyLatch);
+        if (interruptible) CHECK_FOR_INTERRUPTS();
+    }
+}
+
+static void
+ingest_pending_reset(void)
+{
+    // memory released with TopTransactionContext
+    pending_rows = NULL;
+    pending_size = 0;
+    pending_used = 0;
+    pending_start = 0;
+    pending_marks = NIL;
+    flush_marks = NIL;
+}
+
+static void
+ingest_pending_add(Oid relid, HeapTupleHeader td, uint32 tuple_len)
+{
+    uint32 record_len = INGEST_ALIGN(sizeof(IngestRecordHeader) + tuple_len);
+    SubTransactionId subxact_id = GetCurrentSubTransactionId();
+    IngestPendingMark *mark = (pending_marks != NIL) ? (IngestPendingMark *) llast(pending_marks) : NULL;
+    IngestRecordHeader *header;
+    MemoryContext old_context;
+
+    old_context = MemoryContextSwitchTo(TopTransactionContext);
+
+    if (pending_used + record_len > pending_size){
+        Size new_size = Max(pending_size * 2, 64 * 1024);
+
+        while (new_size < pending_used + record_len) new_size *= 2;
+        pending_rows = (pending_rows == NULL) ? MemoryContextAllocHuge(TopTransactionContext, new_size)
+                                              : repalloc_huge(pending_rows, new_size);
+        pending_size = new_size;
+    }
+
+    if (mark == NULL || mark->subxact_id != subxact_id){
+        mark = (IngestPendingMark *) palloc(sizeof(IngestPendingMark));
+        mark->subxact_id = subxact_id;
+        mark->offset = pending_used;
+        pending_marks = lappend(pending_marks, mark);
+    }
+
+    header = (IngestRecordHeader *) (pending_rows + pending_used);
+    header->len = record_len;
+    header->relid = relid;
+    header->tuple_len = tuple_len;
+    header->padding = 0;
+    memcpy((char *) header + sizeof(IngestRecordHeader), td, tuple_len);
+    pending_used += record_len;
+
+    MemoryContextSwitchTo(old_context);
+}
+
+// move the rows of the committed transaction into the queue, nothing here may fail
+static void
+ingest_pending_push(void)
+{
+    IngestQueue *queue;
+    Latch *writer_latch;
+    Size offset = pending_start;
+    bool dropping = false;
+
+    LWLockAcquire(ingest_shared->lock, LW_SHARED);
+    queue = ingest_queue_for_database(MyDatabaseId, false);
+    LWLockRelease(ingest_shared->lock);
+
+    // slot was taken by ingest_async, queues are never released
+    if (queue == NULL) return;
+
+    while (offset < pending_used){
+        IngestRecordHeader *header = (IngestRecordHeader *) (pending_rows + offset);
+        bool queued;
+
+        offset += header->len;
+
+        if (!dropping){
+            LWLockAcquire(ingest_shared->lock, LW_EXCLUSIVE);
+            queued = ingest_queue_push(queue, header->relid,
+                                       (HeapTupleHeader) ((char *) header + sizeof(IngestRecordHeader)),
+                                       header->tuple_len);
+            LWLockRelease(ingest_shared->lock);
+            if (queued) continue;
+
+            // writer does not keep up within the timeout, drop the rest of the transaction
+            dropping = !ingest_queue_wait_for_space(queue, header->len, false);
+            if (!dropping){
+                offset -= header->len;
+            }
+            continue;
+        }
+
+        LWLockAcquire(ingest_shared->lock, LW_EXCLUSIVE);
+        queue->dropped++;
+        LWLockRelease(ingest_shared->lock);
+    }
+
+    LWLockAcquire(ingest_shared->lock, LW_SHARED);
+    writer_latch = queue->writer_latch;
+    LWLockRelease(ingest_shared->lock);
+
+    if (writer_latch != NULL) SetLatch(writer_latch);
+}
+
+static void
+ingest_queue_xact_callback(XactEvent event, void *arg)
+{
+    switch (event){
+        case XACT_EVENT_PRE_PREPARE:
+            if (pending_used > pending_start){
+                ereport(ERROR,
+                        (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+                         errmsg("cannot PREPARE a transaction that has queued rows with ingest_async")));
+            }
+            break;
+        case XACT_EVENT_COMMIT:
+            if (pending_used > pending_start) ingest_pending_push();
+            ingest_pending_reset();
+            break;
+        case XACT_EVENT_ABORT:
+        case XACT_EVENT_PREPARE:
+            ingest_pending_reset();
+            break;
+        default:
+            break;
+    }
+}
+
+static void
+ingest_queue_subxact_callback(SubXactEvent event, SubTransactionId sub_id, SubTransactionId parent_id, void *arg)
+{
+    ListCell *lc;
+
+    switch (event){
+        case SUBXACT_EVENT_COMMIT_SUB:
+            foreach(lc, pending_marks){
+                IngestPendingMark *mark = (IngestPendingMark *) lfirst(lc);
+                if (mark->subxact_id == sub_id) mark->subxact_id = parent_id;
+            }
+            foreach(lc, flush_marks){
+                IngestPendingMark *mark = (IngestPendingMark *) lfirst(lc);
+                if (mark->subxact_id == sub_id) mark->subxact_id = parent_id;
+            }
+            break;
+        case SUBXACT_EVENT_ABORT_SUB:
+            // rows of the subtransaction (and its committed children) are at the end
+            while (pending_marks != NIL && ((IngestPendingMark *) llast(pending_marks))->subxact_id == sub_id){
+                pending_used = ((IngestPendingMark *) llast(pending_marks))->offset;
+                pending_marks = list_delete_last(pending_marks);
+            }
+            // rows written by a flush in the subtransaction are rolled back, queue them again
+            while (flush_marks != NIL && ((IngestPendingMark *) llast(flush_marks))->subxact_id == sub_id){
+                pending_start = ((IngestPendingMark *) llast(flush_marks))->offset;
+                flush_marks = list_delete_last(flush_marks);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+// the writer runs as the bootstrap superuser, check what the caller could insert itself
+static void
+ingest_queue_check_permissions(Oid relid)
+{
+    HeapTuple tuple;
+    bool row_security;
+
+    // the row fills every column: INSERT on the table, or on each column
+    if (pg_class_aclcheck(relid, GetUserId(), ACL_INSERT) != ACLCHECK_OK &&
+        pg_attribute_aclcheck_all(relid, GetUserId(), ACL_INSERT, ACLMASK_ALL) != ACLCHECK_OK){
+        aclcheck_error(ACLCHECK_NO_PRIV, OBJECT_TABLE, get_rel_name(relid));
+    }
+
+    tuple = SearchSysCache1(RELOID, ObjectIdGetDatum(relid));
+    if (!HeapTupleIsValid(tuple)){
+        elog(ERROR, "cache lookup failed for relation %u", relid);
+    }
+    row_security = ((Form_pg_class) GETSTRUCT(tuple))->relrowsecurity;
+    ReleaseSysCache(tuple);
+
+    // rows are written to the chunks directly, policies would be bypassed
+    if (row_security){
+        ereport(ERROR,
+                (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+                errmsg("ingest_async: \"%s\" has row level security enabled", get_rel_name(relid))));
+    }
+}
+
+static void
+ingest_queue_check_available(void)
+{
+    if (ingest_shared == NULL){
+        ereport(ERROR,
+                (errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+                errmsg("ingest queue is not available"),
+                errhint("Add simple_timeseries to shared_preload_libraries.")));
+    }
+}
+
+/*
+    Public function
+*/
+void
+ingest_queue_shmem_init(void)
+{
+    if (!process_shared_preload_libraries_in_progress) return;
+
+    prev_shmem_request_hook = shmem_request_hook;
+    shmem_request_hook = ingest_queue_shmem_request;
+    prev_shmem_startup_hook = shmem_startup_hook;
+    shmem_startup_hook = ingest_queue_shmem_startup;
+}
+
+void
+ingest_writer_main(Datum main_arg)
+{
+    Oid db_oid = DatumGetObjectId(main_arg);
+    IngestQueue *queue;
+    MemoryContext writer_context;
+    char *buf;
+
+    pqsignal(SIGTERM, ingest_writer_sigterm_handler);
+    BackgroundWorkerUnblockSignals();
+
+    BackgroundWorkerInitializeConnectionByOid(db_oid, InvalidOid, 0);
+    pgstat_report_appname("ingest writer");
+
+    if (ingest_shared == NULL){
+        elog(LOG, "ingest writer: shared memory not available, exiting");
+        proc_exit(0);
+    }
+
+    LWLockAcquire(ingest_shared->lock, LW_EXCLUSIVE);
+    queue = ingest_queue_for_database(MyDatabaseId, true);
+    if (queue != NULL) queue->writer_latch = MyLatch;
+    LWLockRelease(ingest_shared->lock);
+
+    if (queue == NULL){
+        elog(WARNING, "ingest writer: all %d ingest queues are in use, exiting", INGEST_QUEUE_MAX_DATABASES);
+        proc_exit(0);
+    }
+
+    // one batch, a bounded part of the queue
+    writer_context = AllocSetContextCreate(TopMemoryContext, "IngestWriter", ALLOCSET_DEFAULT_SIZES);
+    MemoryContextSwitchTo(writer_context);
+    buf = palloc(INGEST_BATCH_BYTES);
+
+    elog(LOG, "ingest writer started for db oid=%u", db_oid);
+
+    while (!got_sigterm){
+        Size used;
+        int n_records;
+
+        LWLockAcquire(ingest_shared->lock, LW_EXCLUSIVE);
+        used = ingest_queue_pop_batch(queue, buf, INGEST_BATCH_BYTES, &n_records);
+        LWLockRelease(ingest_shared->lock);
+
+        if (n_records > 0){
+            ingest_writer_flush_batch(queue, buf, used, n_records);
+            continue;
+        }
+
+        // woken up by ingest_async, or every second
+        WaitLatch(MyLatch,
+                  WL_LATCH_SET | WL_TIMEOUT | WL_EXIT_ON_PM_DEATH,
+                  1000L,
+                  PG_WAIT_EXTENSION);
+        ResetLatch(MyLatch);
+        CHECK_FOR_INTERRUPTS();
+    }
+
+    LWLockAcquire(ingest_shared->lock, LW_EXCLUSIVE);
+    queue->writer_latch = NULL;
+    LWLockRelease(ingest_shared->lock);
+
+    elog(LOG, "ingest writer shutting down");
+}
+
+PG_FUNCTION_INFO_V1(ingest_async);
+Datum
+ingest_async(PG_FUNCTION_ARGS)
+{
+    Oid relid = PG_GETARG_OID(0);
+    HeapTupleHeader td = PG_GETARG_HEAPTUPLEHEADER(1);
+    uint32 tuple_len = HeapTupleHeaderGetDatumLength(td);
+    HypertableInfo ht_info;
+    IngestQueue *queue;
+
+    ingest_queue_check_available();
+
+    if (!hypertable_cache_lookup(relid, &ht_info)){
+        ereport(ERROR, errmsg("table \"%s\" is not a hypertable", get_rel_name(relid)));
+    }
+    if (HeapTupleHeaderGetTypeId(td) != get_rel_type_id(relid)){
+        ereport(ERROR,
+                (errcode(ERRCODE_DATATYPE_MISMATCH),
+                errmsg("record must be of type %s", format_type_be(get_rel_type_id(relid))),
+                errhint("Cast the row to the hypertable type, eg. ROW(...)::%s.", get_rel_name(relid))));
+    }
+    ingest_queue_check_permissions(relid);
+    if (INGEST_ALIGN(sizeof(IngestRecordHeader) + tuple_len) > INGEST_BATCH_BYTES){
+        ereport(ERROR, errmsg("row of %u bytes does not fit into the ingest queue", tuple_len));
+    }
+
+    // take the slot now, a commit can not fail anymore
+    LWLockAcquire(ingest_shared->lock, LW_EXCLUSIVE);
+    queue = ingest_queue_for_database(MyDatabaseId, true);
+    LWLockRelease(ingest_shared->lock);
+    if (queue == NULL){
+        ereport(ERROR, errmsg("all %d ingest queues are in use by other databases", INGEST_QUEUE_MAX_DATABASES));
+    }
+
+    // backpressure while the writer is behind
+    if (!ingest_queue_wait_for_space(queue, INGEST_ALIGN(sizeof(IngestRecordHeader) + tuple_len), true)){
+        PG_RETURN_BOOL(false);
+    }
+
+    if (!xact_callback_registered){
+        RegisterXactCallback(ingest_queue_xact_callback, NULL);
+        RegisterSubXactCallback(ingest_queue_subxact_callback, NULL);
+        xact_callback_registered = true;
+    }
+
+    // queued when the transaction commits
+    ingest_pending_add(relid, td, tuple_len);
+
+    PG_RETURN_BOOL(true);
+}
+
+// write rows of this transaction and queued rows of this database in the current transaction, then wait for the writer
+PG_FUNCTION_INFO_V1(ingest_async_flush);
+Datum
+ingest_async_flush(PG_FUNCTION_ARGS)
+{
+    IngestQueue *queue;
+    char *buf;
+
+    ingest_queue_check_available();
+
+    LWLockAcquire(ingest_shared->lock, LW_SHARED);
+    queue = ingest_queue_for_database(MyDatabaseId, false);
+    LWLockRelease(ingest_shared->lock);
+
+    if (queue == NULL) PG_RETURN_VOID();
+
+    // rows of this transaction never enter the queue, count them as if they did
+    if (pending_used > pending_start){
+        MemoryContext old_context;
+        IngestPendingMark *mark;
+        Size offset = pending_start;
+        int n_records = 0;
+        int64 written;
+
+        while (offset < pending_used){
+            offset += ((IngestRecordHeader *) (pending_rows + offset))->len;
+            n_records++;
+        }
+        written = ingest_write_batch(pending_rows + pending_start, pending_used - pending_start);
+
+        LWLockAcquire(ingest_shared->lock, LW_EXCLUSIVE);
+        queue->enqueued += n_records;
+        queue->taken += n_records;
+        queue->written += written;
+        queue->failed += n_records - written;
+        LWLockRelease(ingest_shared->lock);
+
+        // a rollback of this subtransaction queues the rows again
+        old_context = MemoryContextSwitchTo(TopTransactionContext);
+        mark = (IngestPendingMark *) palloc(sizeof(IngestPendingMark));
+        mark->subxact_id = GetCurrentSubTransactionId();
+        mark->offset = pending_start;
+        flush_marks = lappend(flush_marks, mark);
+        MemoryContextSwitchTo(old_context);
+
+        pending_start = pending_used;
+    }
+
+    buf = palloc(INGEST_BATCH_BYTES);
+    for (;;){
+        Size used;
+        int n_records;
+
+        LWLockAcquire(ingest_shared->lock, LW_EXCLUSIVE);
+        used = ingest_queue_pop_batch(queue, buf, INGEST_BATCH_BYTES, &n_records);
+        LWLockRelease(ingest_shared->lock);
+
+        if (n_records == 0) break;
+
+        PG_TRY();
+        {
+            ingest_queue_count_batch(queue, n_records, ingest_write_batch(buf, used));
+        }
+        PG_CATCH();
+        {
+            // taken rows must be accounted, otherwise the next flush waits forever
+            ingest_queue_count_batch(queue, n_records, 0);
+            PG_RE_THROW();
+        }
+        PG_END_TRY();
+    }
+    pfree(buf);
+
+    // batches taken by the writer before this call
+    for (;;){
+        bool done;
+
+        LWLockAcquire(ingest_shared->lock, LW_SHARED);
+        done = (queue->written + queue->failed >= queue->taken);
+        LWLockRelease(ingest_shared->lock);
+
+        if (done) break;
+
+        WaitLatch(MyLatch,
+                  WL_LATCH_SET | WL_TIMEOUT | WL_EXIT_ON_PM_DEATH,
+                  10L,
+                  PG_WAIT_EXTENSION);
+        ResetLatch(MyLatch);
+        CHECK_FOR_INTERRUPTS();
+    }
+
+    PG_RETURN_VOID();
+}
+
+PG_FUNCTION_INFO_V1(ingest_async_stats);
+Datum
+ingest_async_stats(PG_FUNCTION_ARGS)
+{
+    TupleDesc tupdesc;
+    Datum values[8];
+    bool nulls[8] = {0};
+    IngestQueue stats;
+
+    if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE){
+        ereport(ERROR, errmsg("ingest_async_stats: return type must be a row type"));
+    }
+
+    memset(&stats, 0, sizeof(stats));
+    if (ingest_shared != NULL){
+        IngestQueue *queue;
+
+        LWLockAcquire(ingest_shared->lock, LW_SHARED);
+        queue = ingest_queue_for_database(MyDatabaseId, false);
+        if (queue != NULL) stats = *queue;
+        LWLockRelease(ingest_shared->lock);
+    }
+
+    values[0] = Int64GetDatum(stats.depth);
+    values[1] = Int64GetDatum((int64) (stats.tail - stats.head));
+    values[2] = Int64GetDatum(stats.enqueued);
+    values[3] = Int64GetDatum(stats.written);
+    values[4] = Int64GetDatum(stats.failed);
+    values[5] = Int64GetDatum(stats.dropped);
+    values[6] = Int64GetDatum(stats.backpressure_waits);
+    values[7] = BoolGetDatum(stats.writer_latch != NULL);
+
+    PG_RETURN_DATUM(HeapTupleGetDatum(heap_form_tuple(tupdesc, values, nulls)));
+}
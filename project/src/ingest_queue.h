@@ -0,0 +1,15 @@
+#pragma once
+
+#include <postgres.h>
+
+// bytes per database queue (GUC, kB)
+extern int ingest_queue_size;
+// ms ingest_async waits for free space before dropping the row (GUC)
+extern int ingest_queue_timeout;
+
+
+// install shmem hooks, only when loaded by shared_preload_libraries
+extern void ingest_queue_shmem_init(void);
+
+// background worker entry point
+extern void ingest_writer_main(Datum main_arg);
@@ -1,9 +1,22 @@
 #include <postgres.h>
 #include <fmgr.h>
 #include <postmaster/bgworker.h>
+#include <utils/guc.h>
 
 #include "planner.h"
 #include "launcher.h"
+#include "chunk.h"
+#include "chunk_insert.h"
+#include "copy.h"
+#include "chunk_dispatch.h"
+#include "chunk_append.h"
+#include "chunk_delete.h"
+#include "chunk_agg.h"
+#include "skip_scan.h"
+#include "gapfill.h"
+#include "chunk_map.h"
+#include "last_value.h"
+#include "ingest_queue.h"
 
 PG_MODULE_MAGIC;
 
@@ -29,11 +42,104 @@ void _PG_init(void){
     elog(LOG, "auto_job: launcher registered.");
 
 
+    // rows buffered per chunk before a multi insert
+    DefineCustomIntVariable("simple_timeseries.insert_batch_size",
+                            "Maximum number of rows buffered per chunk during INSERT.",
+                            "Rows routed to a chunk are written with one multi insert when the buffer is full "
+                            "or the statement ends. 1 inserts every row immediately.",
+                            &chunk_insert_batch_size,
+                            1000,
+                            1,
+                            65536,
+                            PGC_USERSET,
+                            0,
+                            NULL, NULL, NULL);
+
+    // chunk routing cache size
+    DefineCustomIntVariable("simple_timeseries.max_cached_chunks",
+                            "Maximum number of chunks kept in the per-backend routing cache.",
+                            "Least recently used chunks are evicted when the cache is full.",
+                            &chunk_cache_max_entries,
+                            1024,
+                            1,
+                            INT_MAX,
+                            PGC_USERSET,
+                            0,
+                            NULL, NULL, NULL);
+
+
+    // ingest_async queue, size is fixed at server start
+    DefineCustomIntVariable("simple_timeseries.ingest_queue_size",
+                            "Size of the ingest_async queue of each database.",
+                            NULL,
+                            &ingest_queue_size,
+                            1024,
+                            64,
+                            1024 * 1024,
+                            PGC_POSTMASTER,
+                            GUC_UNIT_KB,
+                            NULL, NULL, NULL);
+
+    DefineCustomIntVariable("simple_timeseries.ingest_queue_timeout",
+                            "Time ingest_async waits for free queue space before dropping the row.",
+                            "0 drops the row immediately when the queue is full.",
+                            &ingest_queue_timeout,
+                            1000,
+                            0,
+                            INT_MAX,
+                            PGC_USERSET,
+                            GUC_UNIT_MS,
+                            NULL, NULL, NULL);
+
+    // DELETE covering whole chunks drops them
+    DefineCustomBoolVariable("simple_timeseries.delete_drops_chunks",
+                             "Drop chunks a DELETE removes completely instead of deleting their rows.",
+                             "Rows of dropped chunks are not counted in the DELETE row count.",
+                             &chunk_delete_drops_chunks,
+                             false,
+                             PGC_USERSET,
+                             0,
+                             NULL, NULL, NULL);
+
+    // GROUP BY over chunks aggregates every chunk first
+    DefineCustomBoolVariable("simple_timeseries.enable_chunkwise_aggregation",
+                             "Consider partial aggregation of every chunk below the Append of a hypertable.",
+                             "Chunks are aggregated by parallel workers when max_parallel_workers_per_gather allows it.",
+                             &chunk_agg_enabled,
+                             true,
+                             PGC_USERSET,
+                             0,
+                             NULL, NULL, NULL);
+
+    // DISTINCT ON over chunk indexes jumps between values
+    DefineCustomBoolVariable("simple_timeseries.enable_skip_scan",
+                             "Read one row per distinct leading index value of a chunk below DISTINCT.",
+                             NULL,
+                             &skip_scan_enabled,
+                             true,
+                             PGC_USERSET,
+                             0,
+                             NULL, NULL, NULL);
+
+    // shared chunk map and ingest queue (need shared_preload_libraries)
+    chunk_map_shmem_init();
+    last_value_shmem_init();
+    ingest_queue_shmem_init();
+
     // planner hook
+    chunk_dispatch_init();
+    chunk_append_init();
+    chunk_delete_init();
+    skip_scan_init();
+    gapfill_init();
     planner_hook_init();
+
+    // utility hook (COPY FROM into hypertable)
+    copy_hook_init();
 }
 
 void _PG_fini(void){
     planner_hook_cleanup();
+    copy_hook_cleanup();
     elog(LOG, "timeseries extension unloaded.");
 }
\ No newline at end of file
@@ -0,0 +1,797 @@
+#include <postgres.h>
+#include <fmgr.h>
+#include <funcapi.h>
+#include <access/heaptoast.h>
+#include <access/htup_details.h>
+#include <access/table.h>
+#include <access/xact.h>
+#include <executor/spi.h>
+#include <executor/tuptable.h>
+#include <lib/dshash.h>
+#include <lib/stringinfo.h>
+#include <miscadmin.h>
+#include <storage/ipc.h>
+#include <storage/lwlock.h>
+#include <storage/shmem.h>
+#include <utils/acl.h>
+#include <utils/builtins.h>
+#include <utils/dsa.h>
+#include <utils/hsearch.h>
+#include <utils/lsyscache.h>
+#include <utils/memutils.h>
+#include <utils/rel.h>
+#include <utils/rls.h>
+#include <utils/timestamp.h>
+#include <utils/tuplestore.h>
+
+#include "metadata.h"
+#include "hypertable_cache.h"
+#include "trigger.h"
+#include "last_value.h"
+
+/*
+    Last value cache
+
+    SELECT enable_last_value_cache('sensor_data', 'sensor_id');
+    SELECT * FROM last_values(NULL::sensor_data);
+
+    [INSERT / COPY / ingest into hypertable]
+            ↓ per row, newest row per series of this transaction
+    [pending rows (backend)] --pre-commit--> [shared cache (dshash)]
+                                                     ↑ newest time wins
+    [last_values()] --populated--> read the shared entries of the hypertable
+            ↓ not populated (server start, after invalidation)
+    [SELECT DISTINCT ON (series) * ORDER BY series, time DESC] --> fill cache
+
+    (database, hypertable_id, series value) -> newest row, the row is stored
+    in a DSA area next to the chunk map, so every backend reads the current
+    value of each series without scanning chunks.
+
+    UPDATE, DELETE and TRUNCATE of the hypertable (statement trigger),
+    retention, drop_hypertable and rows that can not be cached (series
+    value longer than 64 bytes, rolled back savepoint) remove the series of
+    the hypertable when their transaction commits, the next last_values()
+    scans the hypertable again. Rows are published before the commit record
+    is written, a commit that still fails (serialization failure) removes
+    the series of the hypertables it published. A scan started before the removal does not
+    fill the cache (generation of the hypertable entry).
+
+    The cache holds the newest committed row of each series, it is not
+    bound to the snapshot of the reading query. Row level security and
+    REPEATABLE READ always scan. Without shared_preload_libraries every
+    last_values() scans.
+*/
+#define LAST_VALUE_NAME "simple_timeseries last value cache"
+#define LAST_VALUE_SERIES_SIZE 64 // longer series values are not cached
+#define LAST_VALUE_HYPERTABLE -1 // series_len of the hypertable entry
+
+typedef struct LastValueKey {
+    Oid database_id;
+    int hypertable_id;
+    int series_len; // bytes of series, LAST_VALUE_HYPERTABLE for the hypertable entry
+    bool series_isnull;
+    char series[LAST_VALUE_SERIES_SIZE];
+} LastValueKey;
+
+typedef struct LastValueEntry {
+    LastValueKey key;
+    TimestampTz time;
+    dsa_pointer tuple; // HeapTupleHeader of the row
+    uint32 tuple_len;
+
+    // hypertable entry
+    uint64 generation; // bumped by every removal
+    bool populated; // every series of the hypertable is cached
+} LastValueEntry;
+
+typedef struct LastValueShared {
+    LWLock *lock; // area creation, scan fill against removal
+    int tranche_id;
+    dsa_handle area_handle;
+    dshash_table_handle table_handle;
+} LastValueShared;
+
+typedef struct LastValuePending {
+    LastValueKey key;
+    TimestampTz time;
+    HeapTuple tuple;
+} LastValuePending;
+
+static LastValueShared *last_value_shared = NULL;
+static dsa_area *last_value_area = NULL;
+static dshash_table *last_value_table = NULL;
+
+// in TopTransactionContext
+static HTAB *pending_rows = NULL;
+static List *pending_removals = NIL;
+static bool pending_subxact_aborted = false;
+static List *published_hypertables = NIL; // published at pre-commit, removed again on abort
+static bool xact_callback_registered = false;
+
+static shmem_request_hook_type prev_shmem_request_hook = NULL;
+static shmem_startup_hook_type prev_shmem_startup_hook = NULL;
+
+static dshash_parameters last_value_params = {
+    .key_size = sizeof(LastValueKey),
+    .entry_size = sizeof(LastValueEntry),
+    .compare_function = dshash_memcmp,
+    .hash_function = dshash_memhash,
+    .copy_function = dshash_memcpy,
+    .tranche_id = 0, // set at attach
+};
+
+/*
+    Private function
+*/
+static void
+last_value_shmem_request(void)
+{
+    if (prev_shmem_request_hook){
+        prev_shmem_request_hook();
+    }
+
+    RequestAddinShmemSpace(MAXALIGN(sizeof(LastValueShared)));
+    RequestNamedLWLockTranche(LAST_VALUE_NAME, 1);
+}
+
+static void
+last_value_shmem_startup(void)
+{
+    bool found;
+
+    if (prev_shmem_startup_hook){
+        prev_shmem_startup_hook();
+    }
+
+    LWLockAcquire(AddinShmemInitLock, LW_EXCLUSIVE);
+    last_value_shared = ShmemInitStruct(LAST_VALUE_NAME, sizeof(LastValueShared), &found);
+    if (!found){
+        last_value_shared->lock = &(GetNamedLWLockTranche(LAST_VALUE_NAME))->lock;
+        last_value_shared->tranche_id = LWLockNewTrancheId();
+        last_value_shared->area_handle = DSA_HANDLE_INVALID;
+        last_value_shared->table_handle = DSHASH_HANDLE_INVALID;
+    }
+    LWLockRelease(AddinShmemInitLock);
+}
+
+// attach (or create on first use) the shared cache, false when shared memory is not available
+static bool
+last_value_attach(void)
+{
+    MemoryContext old_context;
+
+    if (last_value_table != NULL) return true;
+    if (last_value_shared == NULL) return false;
+
+    LWLockRegisterTranche(last_value_shared->tranche_id, LAST_VALUE_NAME);
+    last_value_params.tranche_id = last_value_shared->tranche_id;
+
+    // mapping lives as long as the backend
+    old_context = MemoryContextSwitchTo(TopMemoryContext);
+    LWLockAcquire(last_value_shared->lock, LW_EXCLUSIVE);
+
+    if (last_value_shared->area_handle == DSA_HANDLE_INVALID){
+        last_value_area = dsa_create(last_value_shared->tranche_id);
+        dsa_pin(last_value_area); // keep area when all backends detach
+        dsa_pin_mapping(last_value_area);
+        last_value_table = dshash_create(last_value_area, &last_value_params, NULL);
+
+        last_value_shared->area_handle = dsa_get_handle(last_value_area);
+        last_value_shared->table_handle = dshash_get_hash_table_handle(last_value_table);
+    }
+    else{
+        last_value_area = dsa_attach(last_value_shared->area_handle);
+        dsa_pin_mapping(last_value_area);
+        last_value_table = dshash_attach(last_value_area, &last_value_params, last_value_shared->table_handle, NULL);
+    }
+
+    LWLockRelease(last_value_shared->lock);
+    MemoryContextSwitchTo(old_context);
+
+    elog(DEBUG1, "Last value cache attached");
+    return true;
+}
+
+static void
+last_value_hypertable_key(LastValueKey *key, int hypertable_id)
+{
+    memset(key, 0, sizeof(LastValueKey)); // key is hashed as raw bytes
+    key->database_id = MyDatabaseId;
+    key->hypertable_id = hypertable_id;
+    key->series_len = LAST_VALUE_HYPERTABLE;
+}
+
+// key of a series value, false when the value is too long to be cached
+static bool
+last_value_series_key(LastValueKey *key, int hypertable_id, Datum value, bool isnull, Form_pg_attribute attr)
+{
+    memset(key, 0, sizeof(LastValueKey));
+    key->database_id = MyDatabaseId;
+    key->hypertable_id = hypertable_id;
+
+    if (isnull){
+        key->series_isnull = true;
+        return true;
+    }
+
+    if (attr->attbyval){
+        store_att_byval(key->series, value, attr->attlen);
+        key->series_len = attr->attlen;
+        return true;
+    }
+
+    if (attr->attlen == -1){
+        struct varlena *detoasted = pg_detoast_datum_packed((struct varlena *) DatumGetPointer(value));
+        int len = VARSIZE_ANY_EXHDR(detoasted);
+
+        if (len > LAST_VALUE_SERIES_SIZE) return false;
+        memcpy(key->series, VARDATA_ANY(detoasted), len);
+        key->series_len = len;
+        return true;
+    }
+
+    if (attr->attlen > 0 && attr->attlen <= LAST_VALUE_SERIES_SIZE){
+        memcpy(key->series, DatumGetPointer(value), attr->attlen);
+        key->series_len = attr->attlen;
+        return true;
+    }
+
+    return false;
+}
+
+// keep the row for its series unless the shared entry holds a newer one
+static void
+last_value_store(const LastValueKey *key, TimestampTz time, HeapTuple tuple)
+{
+    LastValueEntry *entry;
+    dsa_pointer copy;
+    bool found;
+
+    // allocated before the entry is locked, a failed allocation leaves no half written entry
+    copy = dsa_allocate(last_value_area, tuple->t_len);
+    memcpy(dsa_get_address(last_value_area, copy), tuple->t_data, tuple->t_len);
+
+    entry = (LastValueEntry *) dshash_find_or_insert(last_value_table, key, &found);
+    if (found && entry->time > time){
+        dshash_release_lock(last_value_table, entry);
+        dsa_free(last_value_area, copy);
+        return;
+    }
+
+    if (found){
+        dsa_free(last_value_area, entry->tuple);
+    }
+    entry->time = time;
+    entry->tuple = copy;
+    entry->tuple_len = tuple->t_len;
+    entry->generation = 0;
+    entry->populated = false;
+    dshash_release_lock(last_value_table, entry);
+}
+
+// drop the series of a hypertable, a scan started before does not fill the cache
+static void
+last_value_remove(int hypertable_id)
+{
+    dshash_seq_status status;
+    LastValueEntry *entry;
+
+    LWLockAcquire(last_value_shared->lock, LW_EXCLUSIVE);
+
+    dshash_seq_init(&status, last_value_table, true);
+    while ((entry = (LastValueEntry *) dshash_seq_next(&status)) != NULL){
+        if (entry->key.database_id != MyDatabaseId || entry->key.hypertable_id != hypertable_id) continue;
+
+        if (entry->key.series_len == LAST_VALUE_HYPERTABLE){
+            entry->generation++;
+            entry->populated = false;
+        }
+        else{
+            dsa_free(last_value_area, entry->tuple);
+            dshash_delete_current(&status);
+        }
+    }
+    dshash_seq_term(&status);
+
+    LWLockRelease(last_value_shared->lock);
+
+    elog(DEBUG1, "Last value cache cleared: hypertable=%d", hypertable_id);
+}
+
+// rows of this transaction go to the shared cache
+static void
+last_value_publish(void)
+{
+    HASH_SEQ_STATUS status;
+    LastValuePending *pending;
+    MemoryContext old_context;
+
+    if (pending_rows == NULL) return;
+
+    // rows of the rolled back savepoint are mixed in, scan again after commit
+    if (pending_subxact_aborted){
+        old_context = MemoryContextSwitchTo(TopTransactionContext);
+
+        hash_seq_init(&status, pending_rows);
+        while ((pending = (LastValuePending *) hash_seq_search(&status)) != NULL){
+            pending_removals = list_append_unique_int(pending_removals, pending->key.hypertable_id);
+        }
+        MemoryContextSwitchTo(old_context);
+        pending_rows = NULL;
+        return;
+    }
+
+    // the commit can still fail after this, remember what to take back
+    old_context = MemoryContextSwitchTo(TopTransactionContext);
+    hash_seq_init(&status, pending_rows);
+    while ((pending = (LastValuePending *) hash_seq_search(&status)) != NULL){
+        published_hypertables = list_append_unique_int(published_hypertables, pending->key.hypertable_id);
+    }
+    MemoryContextSwitchTo(old_context);
+
+    LWLockAcquire(last_value_shared->lock, LW_SHARED);
+    hash_seq_init(&status, pending_rows);
+    while ((pending = (LastValuePending *) hash_seq_search(&status)) != NULL){
+        last_value_store(&pending->key, pending->time, pending->tuple);
+    }
+    LWLockRelease(last_value_shared->lock);
+
+    pending_rows = NULL;
+}
+
+static void
+last_value_reset_pending(void)
+{
+    // memory released with TopTransactionContext
+    pending_rows = NULL;
+    pending_removals = NIL;
+    pending_subxact_aborted = false;
+    published_hypertables = NIL;
+}
+
+static void
+last_value_xact_callback(XactEvent event, void *arg)
+{
+    ListCell *lc;
+
+    switch (event){
+        case XACT_EVENT_PRE_COMMIT:
+            last_value_publish();
+            break;
+        case XACT_EVENT_COMMIT:
+            // after commit, a scan starting now sees the changes
+            foreach(lc, pending_removals){
+                last_value_remove(lfirst_int(lc));
+            }
+            last_value_reset_pending();
+            break;
+        case XACT_EVENT_PRE_PREPARE:
+            if (pending_rows != NULL || pending_removals != NIL){
+                ereport(ERROR,
+                        (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+                         errmsg("cannot PREPARE a transaction that has written to a hypertable with last value cache")));
+            }
+            break;
+        case XACT_EVENT_ABORT:
+            // published rows of a commit that failed
+            foreach(lc, published_hypertables){
+                last_value_remove(lfirst_int(lc));
+            }
+            last_value_reset_pending();
+            break;
+        default:
+            break;
+    }
+}
+
+static void
+last_value_subxact_callback(SubXactEvent event, SubTransactionId sub_id, SubTransactionId parent_id, void *arg)
+{
+    if (event == SUBXACT_EVENT_ABORT_SUB && (pending_rows != NULL)){
+        pending_subxact_aborted = true;
+    }
+}
+
+static void
+last_value_register_callbacks(void)
+{
+    if (!xact_callback_registered){
+        RegisterXactCallback(last_value_xact_callback, NULL);
+        RegisterSubXactCallback(last_value_subxact_callback, NULL);
+        xact_callback_registered = true;
+    }
+}
+
+// copy of the cached rows of a hypertable, caller holds the lock
+static List *
+last_value_read(int hypertable_id)
+{
+    dshash_seq_status status;
+    LastValueEntry *entry;
+    List *rows = NIL;
+
+    dshash_seq_init(&status, last_value_table, false);
+    while ((entry = (LastValueEntry *) dshash_seq_next(&status)) != NULL){
+        HeapTuple tuple;
+
+        if (entry->key.database_id != MyDatabaseId || entry->key.hypertable_id != hypertable_id) continue;
+        if (entry->key.series_len == LAST_VALUE_HYPERTABLE) continue;
+
+        tuple = (HeapTuple) palloc(HEAPTUPLESIZE + entry->tuple_len);
+        tuple->t_len = entry->tuple_len;
+        tuple->t_data = (HeapTupleHeader) ((char *) tuple + HEAPTUPLESIZE);
+        ItemPointerSetInvalid(&tuple->t_self);
+        tuple->t_tableOid = InvalidOid;
+        memcpy(tuple->t_data, dsa_get_address(last_value_area, entry->tuple), entry->tuple_len);
+
+        rows = lappend(rows, tuple);
+    }
+    dshash_seq_term(&status);
+
+    return rows;
+}
+
+// cached rows when every series is cached, otherwise the generation a scan has to fill
+static bool
+last_value_cached(int hypertable_id, uint64 *generation, List **rows)
+{
+    LastValueKey key;
+    LastValueEntry *entry;
+    bool found;
+    bool populated;
+
+    last_value_hypertable_key(&key, hypertable_id);
+
+    LWLockAcquire(last_value_shared->lock, LW_SHARED);
+
+    entry = (LastValueEntry *) dshash_find_or_insert(last_value_table, &key, &found);
+    if (!found){
+        entry->time = 0;
+        entry->tuple = InvalidDsaPointer;
+        entry->tuple_len = 0;
+        entry->generation = 0;
+        entry->populated = false;
+    }
+    populated = entry->populated;
+    *generation = entry->generation;
+    dshash_release_lock(last_value_table, entry);
+
+    if (populated){
+        *rows = last_value_read(hypertable_id);
+    }
+
+    LWLockRelease(last_value_shared->lock);
+    return populated;
+}
+
+// newest row of every series, read from the hypertable
+static List *
+last_value_scan(Relation rel, const HypertableInfo *ht_info)
+{
+    TupleDesc tupdesc = RelationGetDescr(rel);
+    MemoryContext caller_context = CurrentMemoryContext;
+    Datum *values = (Datum *) palloc(tupdesc->natts * sizeof(Datum));
+    bool *nulls = (bool *) palloc(tupdesc->natts * sizeof(bool));
+    const char *series_column = quote_identifier(NameStr(TupleDescAttr(tupdesc, ht_info->last_value_attnum - 1)->attname));
+    const char *time_column = quote_identifier(NameStr(TupleDescAttr(tupdesc, ht_info->time_attnum - 1)->attname));
+    StringInfoData query;
+    List *rows = NIL;
+    int ret;
+
+    initStringInfo(&query);
+    appendStringInfo(&query,
+        "SELECT DISTINCT ON (%s) * FROM %s.%s ORDER BY %s, %s DESC",
+        series_column,
+        quote_identifier(get_namespace_name(RelationGetNamespace(rel))),
+        quote_identifier(RelationGetRelationName(rel)),
+        series_column, time_column);
+
+    SPI_connect();
+
+    // a new snapshot, taken after the generation was read
+    ret = SPI_execute(query.data, false, 0);
+    if (ret != SPI_OK_SELECT){
+        SPI_finish();
+        ereport(ERROR, errmsg("failed to read last values of \"%s\"", RelationGetRelationName(rel)));
+    }
+
+    // SELECT * skips dropped columns, cached rows have the table layout
+    for (uint64 i = 0; i < SPI_processed; i++){
+        MemoryContext old_context;
+        int column = 0;
+
+        for (int attno = 0; attno < tupdesc->natts; attno++){
+            if (TupleDescAttr(tupdesc, attno)->attisdropped){
+                values[attno] = (Datum) 0;
+                nulls[attno] = true;
+                continue;
+            }
+            values[attno] = SPI_getbinval(SPI_tuptable->vals[i], SPI_tuptable->tupdesc, ++column, &nulls[attno]);
+        }
+
+        // rows outlive SPI
+        old_context = MemoryContextSwitchTo(caller_context);
+        rows = lappend(rows, heap_form_tuple(tupdesc, values, nulls));
+        MemoryContextSwitchTo(old_context);
+    }
+
+    SPI_finish();
+    return rows;
+}
+
+// cache the scanned rows, unless series were removed since the scan started
+static void
+last_value_fill(const HypertableInfo *ht_info, TupleDesc tupdesc, uint64 generation, List *rows)
+{
+    Form_pg_attribute series_attr = TupleDescAttr(tupdesc, ht_info->last_value_attnum - 1);
+    LastValueKey *keys = (LastValueKey *) palloc(Max(list_length(rows), 1) * sizeof(LastValueKey));
+    LastValueKey key;
+    LastValueEntry *entry;
+    ListCell *lc;
+
+    foreach(lc, rows){
+        HeapTuple tuple = (HeapTuple) lfirst(lc);
+        bool isnull;
+        Datum value = heap_getattr(tuple, ht_info->last_value_attnum, tupdesc, &isnull);
+
+        if (!last_value_series_key(&keys[foreach_current_index(lc)], ht_info->hypertable_id, value, isnull,
+                                   series_attr)){
+            return;
+        }
+    }
+
+    last_value_hypertable_key(&key, ht_info->hypertable_id);
+
+    LWLockAcquire(last_value_shared->lock, LW_EXCLUSIVE);
+
+    entry = (LastValueEntry *) dshash_find(last_value_table, &key, false);
+    if (entry == NULL || entry->generation != generation){
+        if (entry != NULL) dshash_release_lock(last_value_table, entry);
+        LWLockRelease(last_value_shared->lock);
+        return;
+    }
+    dshash_release_lock(last_value_table, entry);
+
+    foreach(lc, rows){
+        HeapTuple tuple = (HeapTuple) lfirst(lc);
+        bool isnull;
+        TimestampTz time = DatumGetTimestampTz(heap_getattr(tuple, ht_info->time_attnum, tupdesc, &isnull));
+
+        last_value_store(&keys[foreach_current_index(lc)], time, tuple);
+    }
+
+    entry = (LastValueEntry *) dshash_find(last_value_table, &key, true);
+    if (entry != NULL){
+        entry->populated = true;
+        dshash_release_lock(last_value_table, entry);
+    }
+
+    LWLockRelease(last_value_shared->lock);
+
+    elog(DEBUG1, "Last value cache filled: hypertable=%d, series=%d", ht_info->hypertable_id, list_length(rows));
+}
+
+/*
+    Public function
+*/
+void
+last_value_shmem_init(void)
+{
+    if (!process_shared_preload_libraries_in_progress) return;
+
+    prev_shmem_request_hook = shmem_request_hook;
+    shmem_request_hook = last_value_shmem_request;
+    prev_shmem_startup_hook = shmem_startup_hook;
+    shmem_startup_hook = last_value_shmem_startup;
+}
+
+void
+last_value_cache_update(const HypertableInfo *ht_info, TupleTableSlot *slot)
+{
+    LastValueKey key;
+    LastValuePending *pending;
+    MemoryContext old_context;
+    HeapTuple tuple;
+    TimestampTz time;
+    Datum value;
+    bool isnull;
+    bool found;
+
+    if (ht_info->last_value_attnum == InvalidAttrNumber) return;
+    if (!last_value_attach()) return;
+
+    last_value_register_callbacks();
+
+    time = DatumGetTimestampTz(slot_getattr(slot, ht_info->time_attnum, &isnull));
+    if (isnull) return;
+
+    value = slot_getattr(slot, ht_info->last_value_attnum, &isnull);
+    if (!last_value_series_key(&key, ht_info->hypertable_id, value, isnull,
+                               TupleDescAttr(slot->tts_tupleDescriptor, ht_info->last_value_attnum - 1))){
+        // the cache would miss this series, scan again after commit
+        last_value_cache_invalidate(ht_info->hypertable_id);
+        return;
+    }
+
+    if (pending_rows == NULL){
+        HASHCTL ctl;
+
+        memset(&ctl, 0, sizeof(ctl));
+        ctl.keysize = sizeof(LastValueKey);
+        ctl.entrysize = sizeof(LastValuePending);
+        ctl.hcxt = TopTransactionContext;
+        pending_rows = hash_create("Last value pending rows", 64, &ctl, HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+    }
+
+    pending = (LastValuePending *) hash_search(pending_rows, &key, HASH_ENTER, &found);
+    if (found && pending->time > time) return;
+
+    old_context = MemoryContextSwitchTo(TopTransactionContext);
+    tuple = ExecCopySlotHeapTuple(slot);
+    // values toasted in another table must not be referenced from shared memory
+    if (HeapTupleHasExternal(tuple)){
+        HeapTuple flat = toast_flatten_tuple(tuple, slot->tts_tupleDescriptor);
+
+        heap_freetuple(tuple);
+        tuple = flat;
+    }
+    if (found){
+        heap_freetuple(pending->tuple);
+    }
+    pending->time = time;
+    pending->tuple = tuple;
+    MemoryContextSwitchTo(old_context);
+}
+
+void
+last_value_cache_invalidate(int hypertable_id)
+{
+    MemoryContext old_context;
+
+    if (!last_value_attach()) return;
+
+    last_value_register_callbacks();
+
+    old_context = MemoryContextSwitchTo(TopTransactionContext);
+    pending_removals = list_append_unique_int(pending_removals, hypertable_id);
+    MemoryContextSwitchTo(old_context);
+}
+
+/*
+    Top level function
+*/
+PG_FUNCTION_INFO_V1(enable_last_value_cache);
+Datum
+enable_last_value_cache(PG_FUNCTION_ARGS)
+{
+    Oid table_oid = PG_GETARG_OID(0);
+    char *column_name = NameStr(*PG_GETARG_NAME(1));
+    char *schema_name = get_namespace_name(get_rel_namespace(table_oid));
+    char *table_name = get_rel_name(table_oid);
+    int hypertable_id;
+
+    if (get_attnum(table_oid, column_name) == InvalidAttrNumber){
+        ereport(ERROR,
+                (errcode(ERRCODE_UNDEFINED_COLUMN),
+                errmsg("column \"%s\" of \"%s.%s\" does not exist", column_name, schema_name, table_name)));
+    }
+
+    SPI_connect();
+    hypertable_id = metadata_get_hypertable_id(schema_name, table_name);
+    if (hypertable_id == -1){
+        ereport(ERROR, errmsg("\"%s.%s\" is not a hypertable", schema_name, table_name));
+    }
+    metadata_set_last_value_column(hypertable_id, column_name);
+    trigger_create_last_value_on_hypertable(schema_name, table_name);
+    SPI_finish();
+
+    // series column may have changed
+    last_value_cache_invalidate(hypertable_id);
+    hypertable_cache_invalidate(table_oid);
+
+    if (last_value_shared == NULL){
+        elog(NOTICE, "Last value cache needs shared_preload_libraries, last_values() scans \"%s.%s\"",
+            schema_name, table_name);
+    }
+    elog(NOTICE, "Last value cache enabled on \"%s.%s\", series column \"%s\"", schema_name, table_name, column_name);
+
+    PG_RETURN_VOID();
+}
+
+PG_FUNCTION_INFO_V1(disable_last_value_cache);
+Datum
+disable_last_value_cache(PG_FUNCTION_ARGS)
+{
+    Oid table_oid = PG_GETARG_OID(0);
+    char *schema_name = get_namespace_name(get_rel_namespace(table_oid));
+    char *table_name = get_rel_name(table_oid);
+    int hypertable_id;
+
+    SPI_connect();
+    hypertable_id = metadata_get_hypertable_id(schema_name, table_name);
+    if (hypertable_id == -1){
+        ereport(ERROR, errmsg("\"%s.%s\" is not a hypertable", schema_name, table_name));
+    }
+    metadata_set_last_value_column(hypertable_id, NULL);
+    trigger_drop_last_value_on_hypertable(schema_name, table_name);
+    SPI_finish();
+
+    last_value_cache_invalidate(hypertable_id);
+    hypertable_cache_invalidate(table_oid);
+
+    elog(NOTICE, "Last value cache disabled on \"%s.%s\"", schema_name, table_name);
+
+    PG_RETURN_VOID();
+}
+
+// SELECT * FROM last_values(NULL::sensor_data)
+PG_FUNCTION_INFO_V1(last_values);
+Datum
+last_values(PG_FUNCTION_ARGS)
+{
+    ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+    Oid type_oid = get_fn_expr_argtype(fcinfo->flinfo, 0);
+    Oid relid = OidIsValid(type_oid) ? get_typ_typrelid(type_oid) : InvalidOid;
+    HypertableInfo ht_info;
+    Relation rel;
+    TupleDesc tupdesc;
+    Datum *values;
+    bool *nulls;
+    List *rows = NIL;
+    uint64 generation = 0;
+    bool cached = false;
+    bool can_fill;
+    AclResult aclresult;
+    ListCell *lc;
+
+    if (!OidIsValid(relid) || !hypertable_cache_lookup(relid, &ht_info)){
+        ereport(ERROR,
+                (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                errmsg("last_values() expects a row of a hypertable"),
+                errhint("Call it as last_values(NULL::hypertable_name).")));
+    }
+    if (ht_info.last_value_attnum == InvalidAttrNumber){
+        ereport(ERROR,
+                (errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+                errmsg("last value cache is not enabled on \"%s\"", get_rel_name(relid)),
+                errhint("Use enable_last_value_cache().")));
+    }
+
+    // the cache is read without the table, check what the scan would check
+    aclresult = pg_class_aclcheck(relid, GetUserId(), ACL_SELECT);
+    if (aclresult != ACLCHECK_OK){
+        aclcheck_error(aclresult, OBJECT_TABLE, get_rel_name(relid));
+    }
+
+    InitMaterializedSRF(fcinfo, 0);
+
+    rel = table_open(relid, AccessShareLock);
+    tupdesc = RelationGetDescr(rel);
+
+    // a transaction snapshot may be older than the generation read
+    can_fill = check_enable_rls(relid, InvalidOid, false) != RLS_ENABLED &&
+               !IsolationUsesXactSnapshot() &&
+               last_value_attach();
+
+    if (can_fill){
+        cached = last_value_cached(ht_info.hypertable_id, &generation, &rows);
+    }
+    if (!cached){
+        rows = last_value_scan(rel, &ht_info);
+        if (can_fill){
+            last_value_fill(&ht_info, tupdesc, generation, rows);
+        }
+    }
+
+    // rows cached before ADD COLUMN get the missing attributes here
+    values = (Datum *) palloc(tupdesc->natts * sizeof(Datum));
+    nulls = (bool *) palloc(tupdesc->natts * sizeof(bool));
+    foreach(lc, rows){
+        heap_deform_tuple((HeapTuple) lfirst(lc), tupdesc, values, nulls);
+        tuplestore_putvalues(rsinfo->setResult, rsinfo->setDesc, values, nulls);
+    }
+
+    table_close(rel, AccessShareLock);
+
+    return (Datum) 0;
+}
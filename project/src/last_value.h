@@ -0,0 +1,15 @@
+#pragma once
+
+#include <postgres.h>
+#include <executor/tuptable.h>
+
+#include "hypertable_cache.h"
+
+// install shmem hooks, only when loaded by shared_preload_libraries
+extern void last_value_shmem_init(void);
+
+// remember slot as newest row of its series, published when the transaction commits (no-op when the cache is off)
+extern void last_value_cache_update(const HypertableInfo *ht_info, TupleTableSlot *slot);
+
+// drop the cached series of a hypertable when the current transaction commits
+extern void last_value_cache_invalidate(int hypertable_id);
@@ -50,46 +50,45 @@ is_specific_worker_running(Oid db_oid, const char *app_name)
 }
 
 
-// spawn cagg and retention workers for a specific database
+// start a worker of the database unless it is running, BGW_NEVER_RESTART: the next launcher pass retries
 static void
-spawn_worker(Oid db_oid)
+launcher_start_worker(Oid db_oid, const char *bgw_name, const char *function_name)
 {
     BackgroundWorker worker;
     BackgroundWorkerHandle *handle;
 
-    // spawn continuous aggregate worker if not running
-    if (!is_specific_worker_running(db_oid, "continuous aggregate worker"))
-    {
-        MemSet(&worker, 0, sizeof(worker));
-        strlcpy(worker.bgw_name, "continuous aggregate worker", BGW_MAXLEN);
-        strlcpy(worker.bgw_library_name, "simple_timeseries", BGW_MAXLEN);
-        strlcpy(worker.bgw_function_name, "cagg_worker_main", BGW_MAXLEN);
-        
-        worker.bgw_flags = BGWORKER_SHMEM_ACCESS | BGWORKER_BACKEND_DATABASE_CONNECTION;
-        worker.bgw_start_time = BgWorkerStart_RecoveryFinished;
-        worker.bgw_restart_time = BGW_NEVER_RESTART;
-        worker.bgw_main_arg = ObjectIdGetDatum(db_oid);
-        
-        RegisterDynamicBackgroundWorker(&worker, &handle);
-        elog(LOG, "launcher: spawned continuous aggregate worker for db oid=%u", db_oid);
-    }
+    if (is_specific_worker_running(db_oid, bgw_name))
+        return;
 
-    // spawn retention worker if not running
-    if (!is_specific_worker_running(db_oid, "retention worker"))
-    {
-        MemSet(&worker, 0, sizeof(worker));
-        strlcpy(worker.bgw_name, "retention worker", BGW_MAXLEN);
-        strlcpy(worker.bgw_library_name, "simple_timeseries", BGW_MAXLEN);
-        strlcpy(worker.bgw_function_name, "retention_worker_main", BGW_MAXLEN);
-        
-        worker.bgw_flags = BGWORKER_SHMEM_ACCESS | BGWORKER_BACKEND_DATABASE_CONNECTION;
-        worker.bgw_start_time = BgWorkerStart_RecoveryFinished;
-        worker.bgw_restart_time = BGW_NEVER_RESTART;
-        worker.bgw_main_arg = ObjectIdGetDatum(db_oid);
-        
-        RegisterDynamicBackgroundWorker(&worker, &handle);
-        elog(LOG, "launcher: spawned retention worker for db oid=%u", db_oid);
+    MemSet(&worker, 0, sizeof(worker));
+    strlcpy(worker.bgw_name, bgw_name, BGW_MAXLEN);
+    strlcpy(worker.bgw_library_name, "simple_timeseries", BGW_MAXLEN);
+    strlcpy(worker.bgw_function_name, function_name, BGW_MAXLEN);
+
+    worker.bgw_flags = BGWORKER_SHMEM_ACCESS | BGWORKER_BACKEND_DATABASE_CONNECTION;
+    worker.bgw_start_time = BgWorkerStart_RecoveryFinished;
+    worker.bgw_restart_time = BGW_NEVER_RESTART;
+    worker.bgw_main_arg = ObjectIdGetDatum(db_oid);
+
+    // every background worker slot is in use
+    if (!RegisterDynamicBackgroundWorker(&worker, &handle)){
+        ereport(WARNING,
+                (errcode(ERRCODE_CONFIGURATION_LIMIT_EXCEEDED),
+                errmsg("launcher: could not start %s for db oid=%u", bgw_name, db_oid),
+                errhint("Increase max_worker_processes, each database with the extension needs 3 workers.")));
+        return;
     }
+    elog(LOG, "launcher: spawned %s for db oid=%u", bgw_name, db_oid);
+}
+
+
+// spawn cagg, retention and ingest writer workers for a specific database
+static void
+spawn_worker(Oid db_oid)
+{
+    launcher_start_worker(db_oid, "continuous aggregate worker", "cagg_worker_main");
+    launcher_start_worker(db_oid, "retention worker", "retention_worker_main");
+    launcher_start_worker(db_oid, "ingest writer", "ingest_writer_main");
 }
 
 
@@ -141,7 +140,7 @@ launcher_cleanup(void)
         appendStringInfo(&query,
             "SELECT pg_terminate_backend(pid) "
             "FROM pg_stat_activity "
-            "WHERE application_name IN ('continuous aggregate worker', 'retention worker') "
+            "WHERE application_name IN ('continuous aggregate worker', 'retention worker', 'ingest writer') "
             "   AND datid = %u", db_oid);
         SPI_execute(query.data, false, 0);
 
@@ -103,6 +103,28 @@ metadata_insert_dimension(int hypertable_id,
     }
 }
 
+void
+metadata_insert_space_dimension(int hypertable_id,
+                                const char *column_name,
+                                Oid column_type,
+                                int num_partitions)
+{
+    StringInfoData query;
+    char *type_name = format_type_be(column_type);
+
+    initStringInfo(&query);
+    appendStringInfo(&query,
+                    "INSERT INTO _timeseries_catalog.dimension "
+                    "(hypertable_id, column_name, column_type, num_partitions) "
+                    "VALUES (%d, %s, '%s', %d)",
+                    hypertable_id, quote_literal_cstr(column_name), type_name, num_partitions);
+
+    SPI_execute(query.data, false, 0);
+    if (SPI_processed <= 0){
+        ereport(ERROR, errmsg("failed to insert dimension metadata"));
+    }
+}
+
 int64
 metadata_get_chunk_interval(int hypertable_id)
 {
@@ -112,7 +134,7 @@ metadata_get_chunk_interval(int hypertable_id)
     initStringInfo(&query);
     appendStringInfo(&query,
         "SELECT interval_length FROM _timeseries_catalog.dimension "
-        "WHERE hypertable_id=%d",
+        "WHERE hypertable_id=%d AND interval_length IS NOT NULL",
         hypertable_id);
     
     SPI_execute(query.data, true, 0);
@@ -124,12 +146,232 @@ metadata_get_chunk_interval(int hypertable_id)
     return interval;
 }
 
+void
+metadata_set_chunk_interval(int hypertable_id, int64 interval_microseconds)
+{
+    StringInfoData query;
+
+    initStringInfo(&query);
+    appendStringInfo(&query,
+        "UPDATE _timeseries_catalog.dimension SET interval_length=" INT64_FORMAT " "
+        "WHERE hypertable_id=%d AND interval_length IS NOT NULL",
+        interval_microseconds, hypertable_id);
+
+    int ret = SPI_execute(query.data, false, 0);
+    if(ret != SPI_OK_UPDATE){
+        ereport(ERROR, errmsg("failed to update chunk interval of hypertable %d", hypertable_id));
+    }
+}
+
+// adaptive chunking target in bytes, 0 when the interval is fixed
+int64
+metadata_get_chunk_target_size(int hypertable_id)
+{
+    StringInfoData query;
+    int64 target_size = 0;
+
+    initStringInfo(&query);
+    appendStringInfo(&query,
+        "SELECT chunk_target_size FROM _timeseries_catalog.dimension "
+        "WHERE hypertable_id=%d AND interval_length IS NOT NULL AND chunk_target_size IS NOT NULL",
+        hypertable_id);
+
+    SPI_execute(query.data, true, 0);
+    if (SPI_processed > 0){
+        bool isnull;
+        target_size = DatumGetInt64(SPI_getbinval(SPI_tuptable->vals[0], SPI_tuptable->tupdesc, 1, &isnull));
+    }
+
+    return target_size;
+}
+
+void
+metadata_set_chunk_target_size(int hypertable_id, int64 target_size)
+{
+    StringInfoData query;
+
+    initStringInfo(&query);
+    if (target_size > 0){
+        appendStringInfo(&query,
+            "UPDATE _timeseries_catalog.dimension SET chunk_target_size=" INT64_FORMAT " "
+            "WHERE hypertable_id=%d AND interval_length IS NOT NULL",
+            target_size, hypertable_id);
+    }
+    else{
+        appendStringInfo(&query,
+            "UPDATE _timeseries_catalog.dimension SET chunk_target_size=NULL "
+            "WHERE hypertable_id=%d AND interval_length IS NOT NULL",
+            hypertable_id);
+    }
+
+    int ret = SPI_execute(query.data, false, 0);
+    if(ret != SPI_OK_UPDATE){
+        ereport(ERROR, errmsg("failed to update chunk target size of hypertable %d", hypertable_id));
+    }
+}
+
+char*
+metadata_get_time_column(int hypertable_id)
+{
+    StringInfoData query;
+    char *column_name = NULL;
+
+    initStringInfo(&query);
+    appendStringInfo(&query,
+        "SELECT column_name FROM _timeseries_catalog.dimension "
+        "WHERE hypertable_id=%d AND interval_length IS NOT NULL",
+        hypertable_id);
+    
+    SPI_execute(query.data, true, 0);
+    if (SPI_processed > 0){
+        bool isnull;
+        Datum datum = SPI_getbinval(SPI_tuptable->vals[0], SPI_tuptable->tupdesc, 1, &isnull);
+        column_name = TextDatumGetCString(datum);
+    }
+    
+    return column_name;
+}
+
+// hash dimension column, NULL when the hypertable is partitioned by time only
+char*
+metadata_get_space_column(int hypertable_id, int *num_partitions)
+{
+    StringInfoData query;
+    char *column_name = NULL;
+
+    initStringInfo(&query);
+    appendStringInfo(&query,
+        "SELECT column_name, num_partitions FROM _timeseries_catalog.dimension "
+        "WHERE hypertable_id=%d AND num_partitions IS NOT NULL",
+        hypertable_id);
+
+    SPI_execute(query.data, true, 0);
+    if (SPI_processed > 0){
+        bool isnull;
+        Datum datum = SPI_getbinval(SPI_tuptable->vals[0], SPI_tuptable->tupdesc, 1, &isnull);
+        column_name = TextDatumGetCString(datum);
+        *num_partitions = DatumGetInt32(SPI_getbinval(SPI_tuptable->vals[0], SPI_tuptable->tupdesc, 2, &isnull));
+    }
+
+    return column_name;
+}
+
+char*
+metadata_get_last_value_column(int hypertable_id)
+{
+    StringInfoData query;
+    char *column_name = NULL;
+
+    initStringInfo(&query);
+    appendStringInfo(&query,
+        "SELECT last_value_column FROM _timeseries_catalog.hypertable "
+        "WHERE id=%d AND last_value_column IS NOT NULL",
+        hypertable_id);
+
+    SPI_execute(query.data, true, 0);
+    if (SPI_processed > 0){
+        bool isnull;
+        Datum datum = SPI_getbinval(SPI_tuptable->vals[0], SPI_tuptable->tupdesc, 1, &isnull);
+        column_name = TextDatumGetCString(datum);
+    }
+
+    return column_name;
+}
+
+// NULL turns the last value cache off
+void
+metadata_set_last_value_column(int hypertable_id, const char *column_name)
+{
+    StringInfoData query;
+
+    initStringInfo(&query);
+    appendStringInfo(&query,
+        "UPDATE _timeseries_catalog.hypertable SET last_value_column=%s WHERE id=%d",
+        column_name != NULL ? quote_literal_cstr(column_name) : "NULL", hypertable_id);
+
+    int ret = SPI_execute(query.data, false, 0);
+    if(ret != SPI_OK_UPDATE){
+        ereport(ERROR, errmsg("failed to update last value column of hypertable %d", hypertable_id));
+    }
+}
+
+// columns with per chunk min/max, in the order they were enabled
+List*
+metadata_get_chunk_skipping_columns(int hypertable_id)
+{
+    StringInfoData query;
+    List *column_names = NIL;
+
+    initStringInfo(&query);
+    appendStringInfo(&query,
+        "SELECT column_name FROM _timeseries_catalog.chunk_skipping_column "
+        "WHERE hypertable_id=%d ORDER BY id",
+        hypertable_id);
+
+    SPI_execute(query.data, true, 0);
+    for (uint64 i = 0; i < SPI_processed; i++){
+        bool isnull;
+        Datum datum = SPI_getbinval(SPI_tuptable->vals[i], SPI_tuptable->tupdesc, 1, &isnull);
+        column_names = lappend(column_names, TextDatumGetCString(datum));
+    }
+
+    return column_names;
+}
+
+void
+metadata_add_chunk_skipping_column(int hypertable_id, const char *column_name)
+{
+    StringInfoData query;
+
+    initStringInfo(&query);
+    appendStringInfo(&query,
+        "INSERT INTO _timeseries_catalog.chunk_skipping_column (hypertable_id, column_name) "
+        "VALUES (%d, %s) ON CONFLICT DO NOTHING",
+        hypertable_id, quote_literal_cstr(column_name));
+
+    int ret = SPI_execute(query.data, false, 0);
+    if(ret != SPI_OK_INSERT){
+        ereport(ERROR, errmsg("failed to add chunk skipping column of hypertable %d", hypertable_id));
+    }
+}
+
+// ranges of the column go with it
+void
+metadata_remove_chunk_skipping_column(int hypertable_id, const char *column_name)
+{
+    StringInfoData query;
+
+    initStringInfo(&query);
+    appendStringInfo(&query,
+        "DELETE FROM _timeseries_catalog.chunk_column_stats "
+        "WHERE column_name=%s AND chunk_id IN "
+        "(SELECT id FROM _timeseries_catalog.chunk WHERE hypertable_id=%d)",
+        quote_literal_cstr(column_name), hypertable_id);
+
+    int ret = SPI_execute(query.data, false, 0);
+    if(ret != SPI_OK_DELETE){
+        ereport(ERROR, errmsg("failed to remove chunk column ranges of hypertable %d", hypertable_id));
+    }
+
+    resetStringInfo(&query);
+    appendStringInfo(&query,
+        "DELETE FROM _timeseries_catalog.chunk_skipping_column "
+        "WHERE hypertable_id=%d AND column_name=%s",
+        hypertable_id, quote_literal_cstr(column_name));
+
+    ret = SPI_execute(query.data, false, 0);
+    if(ret != SPI_OK_DELETE){
+        ereport(ERROR, errmsg("failed to remove chunk skipping column of hypertable %d", hypertable_id));
+    }
+}
+
 int 
 metadata_insert_chunk(int hypertable_id,
                           const char *schema_name,
                           const char *table_name,
                           int64 start_time,
-                          int64 end_time)
+                          int64 end_time,
+                          int space_bucket)
 {
     StringInfoData query;
     int chunk_id;
@@ -138,9 +380,9 @@ metadata_insert_chunk(int hypertable_id,
     initStringInfo(&query);
     appendStringInfo(&query,
         "INSERT INTO _timeseries_catalog.chunk "
-        "(hypertable_id, schema_name, table_name, start_time, end_time) "
-        "VALUES (%d, '%s', '%s', " INT64_FORMAT ", " INT64_FORMAT ") RETURNING id",
-        hypertable_id, schema_name, table_name, start_time, end_time);
+        "(hypertable_id, schema_name, table_name, start_time, end_time, space_bucket) "
+        "VALUES (%d, '%s', '%s', " INT64_FORMAT ", " INT64_FORMAT ", %d) RETURNING id",
+        hypertable_id, schema_name, table_name, start_time, end_time, space_bucket);
     
     SPI_execute(query.data, false, 0);
     if (SPI_processed <= 0){
@@ -152,7 +394,7 @@ metadata_insert_chunk(int hypertable_id,
 }
 
 int 
-metadata_find_chunk(int hypertable_id, int64 time_microseconds)
+metadata_find_chunk(int hypertable_id, int64 time_microseconds, int space_bucket)
 {
     StringInfoData query;
     int chunk_id = -1;
@@ -160,8 +402,9 @@ metadata_find_chunk(int hypertable_id, int64 time_microseconds)
     initStringInfo(&query);
     appendStringInfo(&query,
         "SELECT id FROM _timeseries_catalog.chunk "
-        "WHERE hypertable_id=%d AND start_time<=" INT64_FORMAT " AND end_time>" INT64_FORMAT,
-        hypertable_id, time_microseconds, time_microseconds);
+        "WHERE hypertable_id=%d AND start_time<=" INT64_FORMAT " AND end_time>" INT64_FORMAT
+        " AND space_bucket=%d",
+        hypertable_id, time_microseconds, time_microseconds, space_bucket);
     
     SPI_execute(query.data, true, 0);
     if (SPI_processed > 0){
@@ -171,3 +414,81 @@ metadata_find_chunk(int hypertable_id, int64 time_microseconds)
 
     return chunk_id;
 }
+
+// shrink [*start, *end) so it does not overlap chunks around time_microseconds (variable chunk widths)
+void
+metadata_clip_chunk_range(int hypertable_id, int space_bucket, int64 time_microseconds, int64 *start, int64 *end)
+{
+    StringInfoData query;
+
+    initStringInfo(&query);
+    appendStringInfo(&query,
+        "SELECT MAX(end_time) FILTER (WHERE end_time<=" INT64_FORMAT " AND end_time>" INT64_FORMAT "), "
+        "MIN(start_time) FILTER (WHERE start_time>" INT64_FORMAT " AND start_time<" INT64_FORMAT ") "
+        "FROM _timeseries_catalog.chunk "
+        "WHERE hypertable_id=%d AND space_bucket=%d",
+        time_microseconds, *start, time_microseconds, *end, hypertable_id, space_bucket);
+
+    SPI_execute(query.data, true, 0);
+    if (SPI_processed > 0){
+        bool isnull;
+        Datum datum;
+
+        datum = SPI_getbinval(SPI_tuptable->vals[0], SPI_tuptable->tupdesc, 1, &isnull);
+        if (!isnull) *start = DatumGetInt64(datum);
+
+        datum = SPI_getbinval(SPI_tuptable->vals[0], SPI_tuptable->tupdesc, 2, &isnull);
+        if (!isnull) *end = DatumGetInt64(datum);
+    }
+}
+
+int64
+metadata_count_chunks(int hypertable_id)
+{
+    StringInfoData query;
+    int64 count = 0;
+
+    initStringInfo(&query);
+    appendStringInfo(&query,
+        "SELECT COUNT(*) FROM _timeseries_catalog.chunk WHERE hypertable_id=%d",
+        hypertable_id);
+
+    SPI_execute(query.data, true, 0);
+    if (SPI_processed > 0){
+        bool isnull;
+        count = DatumGetInt64(SPI_getbinval(SPI_tuptable->vals[0], SPI_tuptable->tupdesc, 1, &isnull));
+    }
+
+    return count;
+}
+
+// chunk names are numbered per hypertable by a sequence, nextval never blocks concurrent writers
+void
+metadata_create_chunk_sequence(int hypertable_id)
+{
+    StringInfoData query;
+
+    initStringInfo(&query);
+    appendStringInfo(&query,
+        "CREATE SEQUENCE _timeseries_catalog._hyper_%d_chunk_seq", hypertable_id);
+
+    int ret = SPI_execute(query.data, false, 0);
+    if(ret != SPI_OK_UTILITY){
+        ereport(ERROR, errmsg("failed to create chunk sequence for hypertable %d", hypertable_id));
+    }
+}
+
+void
+metadata_drop_chunk_sequence(int hypertable_id)
+{
+    StringInfoData query;
+
+    initStringInfo(&query);
+    appendStringInfo(&query,
+        "DROP SEQUENCE IF EXISTS _timeseries_catalog._hyper_%d_chunk_seq", hypertable_id);
+
+    int ret = SPI_execute(query.data, false, 0);
+    if(ret != SPI_OK_UTILITY){
+        ereport(ERROR, errmsg("failed to drop chunk sequence for hypertable %d", hypertable_id));
+    }
+}
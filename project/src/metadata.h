@@ -2,6 +2,7 @@
 
 #include <postgres.h>
 #include <catalog/pg_type.h>
+#include <nodes/pg_list.h>
 
 
 extern bool metadata_is_hypertable(const char *schema_name, const char *table_name);
@@ -14,11 +15,33 @@ extern void metadata_insert_dimension(int hypertable_id,
                                     Oid column_type,
                                     int64 interval_microseconds);
 
+extern void metadata_insert_space_dimension(int hypertable_id,
+                                            const char *column_name,
+                                            Oid column_type,
+                                            int num_partitions);
+
 extern int64 metadata_get_chunk_interval(int hypertable_id);
+extern void metadata_set_chunk_interval(int hypertable_id, int64 interval_microseconds);
+extern int64 metadata_get_chunk_target_size(int hypertable_id);
+extern void metadata_set_chunk_target_size(int hypertable_id, int64 target_size);
+extern char* metadata_get_time_column(int hypertable_id);
+extern char* metadata_get_space_column(int hypertable_id, int *num_partitions);
+extern char* metadata_get_last_value_column(int hypertable_id);
+extern void metadata_set_last_value_column(int hypertable_id, const char *column_name);
+extern List* metadata_get_chunk_skipping_columns(int hypertable_id);
+extern void metadata_add_chunk_skipping_column(int hypertable_id, const char *column_name);
+extern void metadata_remove_chunk_skipping_column(int hypertable_id, const char *column_name);
 extern int metadata_insert_chunk(int hypertable_id,
                                 const char *schema_name,
                                 const char *table_name,
                                 int64 start_time,
-                                int64 end_time);
+                                int64 end_time,
+                                int space_bucket);
+
+extern int metadata_find_chunk(int hypertable_id, int64 time_microseconds, int space_bucket);
+extern void metadata_clip_chunk_range(int hypertable_id, int space_bucket, int64 time_microseconds,
+                                      int64 *start, int64 *end);
+extern int64 metadata_count_chunks(int hypertable_id);
 
-extern int metadata_find_chunk(int hypertable_id, int64 time_microseconds);
\ No newline at end of file
+extern void metadata_create_chunk_sequence(int hypertable_id);
+extern void metadata_drop_chunk_sequence(int hypertable_id);
\ No newline at end of file
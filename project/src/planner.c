@@ -1,231 +1,95 @@
 #include <postgres.h>
 #include <optimizer/planner.h>
-#include <optimizer/pathnode.h>
+#include <optimizer/paths.h>
 #include <nodes/pg_list.h>
 #include <catalog/namespace.h>
 #include <utils/lsyscache.h>
 #include <utils/timestamp.h>
 #include <utils/builtins.h>
-#include <utils/memutils.h>
-#include <utils/hsearch.h>
-#include <utils/inval.h>
-#include <executor/spi.h>
 #include <nodes/makefuncs.h>
+#include <nodes/nodeFuncs.h>
 #include <parser/parsetree.h>
-#include <access/xact.h>
 
-#include "metadata.h"
-
-#define NAMEDATALEN 64
+#include "hypertable_cache.h"
+#include "chunk_dispatch.h"
+#include "chunk_exclusion.h"
+#include "chunk_append.h"
+#include "chunk_delete.h"
+#include "chunk_agg.h"
+#include "skip_scan.h"
+#include "time_bucket.h"
+#include "gapfill.h"
 
 /*
-    Cache system for planner Workflow
+    Hypertable check for planner Workflow
 
-    [Transaction Start]
-            ↓
-    [User perform DDL CREATE/DROP hypertable]
-            ↓
-    [Transaction COMMIT/ABORT]
-            ↓
-    [Invoke invalidate_cache_callback] => invalidate the cache after COMMIT, since it might not the same as catalog that commited
-            ↓
-    [cache_valid = false]
-            ↓
-    [User run SELECT query]
+    [User run query]
             ↓
-    [Call is_hypertable_relation() from planner]
+    [Call is_hypertable_relation() for each RTE]
             ↓
-    [Check is cache invalid]
-            ↓ true
-    [rebuild_hypertable_cache()] => directly read from catalog (table_open)
-            ↓
-    [cache_valid = true]
-            ↓
-    [Find in cache]
+    [hypertable_cache_lookup()] => one hash probe when the relation was seen before
+            ↓ miss
+    [Load descriptor from catalog, cache it (also "not a hypertable")]
             ↓
     [Return result]
+
+    Entries are dropped by relcache invalidation of the relation only:
+    create_hypertable/drop_hypertable invalidate the table in every backend at
+    commit, DROP/ALTER TABLE do it by themselves. Transactions that do not
+    touch hypertable definitions (INSERT, COPY, ...) keep the cache.
 */
 
 static planner_hook_type prev_planner_hook = NULL;
-
-typedef struct HypertableCacheKey
-{
-    Oid relid;
-} HypertableCacheKey;
-
-typedef struct HypertableCacheEntry
-{
-    Oid relid; // key
-    bool is_hypertable; // value
-    char schema_name[NAMEDATALEN];
-    char table_name[NAMEDATALEN];
-} HypertableCacheEntry;
-
-static HTAB *hypertable_cache = NULL;
-static bool cache_valid = false;
-
-static void init_hypertable_cache(void);
-static void rebuild_hypertable_cache(void);
-static void invalidate_cache_callback(XactEvent event, void *arg);
-
-// initialize the cache hash table
-static void 
-init_hypertable_cache(void)
-{
-    HASHCTL ctl;
-
-    if(hypertable_cache != NULL){
-        return;
-    }
-
-    memset(&ctl, 0, sizeof(ctl));
-    ctl.keysize = sizeof(HypertableCacheKey);
-    ctl.entrysize = sizeof(HypertableCacheEntry);
-    ctl.hcxt = TopMemoryContext; // cache must in TopMemoryContext
-
-    hypertable_cache = hash_create("Hypertable Cache",
-                                   256,
-                                   &ctl,
-                                   HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
-    
-    elog(LOG, "Hypertable cache initialized");
-}
-
-//  rebuild cache from catalog
-static void 
-rebuild_hypertable_cache(void)
-{
-    int ret;
-    HASH_SEQ_STATUS status;
-    HypertableCacheEntry *entry;
-
-    if(hypertable_cache == NULL){
-        init_hypertable_cache();
-    }
-
-    hash_seq_init(&status, hypertable_cache);
-    while ((entry = (HypertableCacheEntry *) hash_seq_search(&status)) != NULL)
-    {
-        hash_search(hypertable_cache, &entry->relid, HASH_REMOVE, NULL);
-    }
-
-    // check _timeseries_catalog schema exists
-    Oid catalog_schema_oid = get_namespace_oid("_timeseries_catalog", true);
-    if(catalog_schema_oid == InvalidOid){
-        elog(LOG, "Schema _timeseries_catalog does not exist, cache empty");
-        cache_valid = true;
-        return;
-    }
-    
-    // load all hypertable from catalog
-    SPI_connect();
-
-    ret = SPI_execute("SELECT schema_name, table_name FROM _timeseries_catalog.hypertable", 
-                    true, 0);
-    
-    if (ret == SPI_OK_SELECT && SPI_processed > 0){
-        for (uint64 i = 0; i < SPI_processed; i++){
-            char *schema_name;
-            char *table_name;
-            Oid schema_oid;
-            Oid table_oid;
-            bool isnull;
-            Datum datum;
-            HypertableCacheEntry *cache_entry;
-            HypertableCacheKey key;
-            bool found;
-
-            // schema_name 
-            datum = SPI_getbinval(SPI_tuptable->vals[i], SPI_tuptable->tupdesc, 1, &isnull);
-            if (isnull) continue;
-            schema_name = TextDatumGetCString(datum);
-
-            // table_name
-            datum = SPI_getbinval(SPI_tuptable->vals[i], SPI_tuptable->tupdesc, 2, &isnull);
-            if (isnull) continue;
-            table_name = TextDatumGetCString(datum);
-
-            // oid 
-            schema_oid = get_namespace_oid(schema_name, true);
-            if (schema_oid == InvalidOid) continue;
-
-            table_oid = get_relname_relid(table_name, schema_oid);
-            if (table_oid == InvalidOid) continue;
-            
-            // add to cache
-            key.relid = table_oid;
-            cache_entry = (HypertableCacheEntry *) hash_search(hypertable_cache,
-                                                                &key,
-                                                                HASH_ENTER,
-                                                                &found);
-            
-            cache_entry->relid = table_oid;
-            cache_entry->is_hypertable = true;
-            strncpy(cache_entry->schema_name, schema_name, NAMEDATALEN);
-            strncpy(cache_entry->table_name, table_name, NAMEDATALEN);
-
-            elog(LOG, "Added to cache: %s.%s (OID: %u)", schema_name, table_name, table_oid);
-        }
-    }
-
-    SPI_finish();
-    cache_valid = true;
-
-    elog(LOG, "Hypertable cache rebuilt with %lu entries",  hash_get_num_entries(hypertable_cache));
-}
-
-// Transaction callback to invalidate cache
-static void 
-invalidate_cache_callback(XactEvent event, void *arg)
-{
-    switch (event)
-    {
-        case XACT_EVENT_COMMIT: // commit
-        case XACT_EVENT_ABORT: // when roolback/abort
-            cache_valid = false;
-            // elog(NOTICE, "Hypertable cache invalidated");
-            break;
-        default:
-            break;
-    }
-}
+static create_upper_paths_hook_type prev_create_upper_paths_hook = NULL;
+static set_rel_pathlist_hook_type prev_set_rel_pathlist_hook = NULL;
 
 static bool 
 is_hypertable_relation(RangeTblEntry *rte)
 {
-    HypertableCacheKey key;
-    HypertableCacheEntry *entry;
-    bool found;
+    HypertableInfo ht_info;
 
     if (rte->rtekind != RTE_RELATION){
         return false;
     }
 
-    char *schema_name = get_namespace_name(get_rel_namespace(rte->relid));
-    if (schema_name && strcmp(schema_name, "_timeseries_catalog") == 0){
+    return hypertable_cache_lookup(rte->relid, &ht_info);
+}
+
+/*
+    Every query level is looked at: FROM subqueries, CTEs, sublinks in
+    WHERE/SELECT, the source of INSERT ... SELECT, UPDATE ... FROM,
+    DELETE ... USING. The result relation of UPDATE/DELETE stays with
+    inheritance (CHECK constraint exclusion, ChunkAppend at execution).
+*/
+static bool
+expand_hypertables_walker(Node *node, void *context)
+{
+    if (node == NULL){
         return false;
     }
 
-    if (hypertable_cache == NULL){
-        init_hypertable_cache();
-    }
+    if (IsA(node, Query)){
+        Query *query = (Query *) node;
+        Index rti = 0;
+        ListCell *lc;
 
-    if (!cache_valid){
-        rebuild_hypertable_cache();
-    }
+        // time_bucket(w, time) op constant also restricts time (time_bucket.c), before chunks are picked
+        time_bucket_transform_quals(query, (ParamListInfo) context);
 
-    key.relid = rte->relid;
-    entry = (HypertableCacheEntry *) hash_search(hypertable_cache,
-                                                &key,
-                                                HASH_FIND,
-                                                &found);
+        foreach(lc, query->rtable){
+            RangeTblEntry *rte = (RangeTblEntry *) lfirst(lc);
 
-    if (found && entry->is_hypertable){
-        // elog(LOG, "Cache hit: %s.%s is a hypertable", entry->schema_name, entry->table_name);
-        return true;
+            rti++;
+            if (rte->rtekind == RTE_RELATION && rte->inh && is_hypertable_relation(rte)){
+                chunk_exclusion_expand(query, rti, (ParamListInfo) context);
+            }
+        }
+
+        // rewritten RTEs are subqueries over chunks now, nothing to expand in them
+        return query_tree_walker(query, expand_hypertables_walker, context, 0);
     }
 
-    return false;
+    return expression_tree_walker(node, expand_hypertables_walker, context);
 }
 
 static PlannedStmt *
@@ -236,15 +100,16 @@ timeseries_planner_hook(Query *parse,
 {
     PlannedStmt *result;
     RangeTblEntry *rte;
+    List *dropped_chunks = NIL;
 
-    if((parse->commandType == CMD_SELECT) && (list_length(parse->rtable) > 0)){
-        rte = (RangeTblEntry *) linitial(parse->rtable);
-        if (is_hypertable_relation(rte)){
-            char *schema_name = get_namespace_name(get_rel_namespace(rte->relid));
-            char *table_name = get_rel_name(rte->relid);
-            
-            elog(LOG, "Planner: Optimizing query on hypertable %s.%s", schema_name, table_name);
-        }
+    // DELETE removing whole chunks drops them instead (chunk_delete.c)
+    if(parse->commandType == CMD_DELETE){
+        dropped_chunks = chunk_delete_covered_chunks(parse, boundParams);
+    }
+
+    // plan only the chunks the quals can match (chunk_exclusion.c)
+    if(parse->commandType != CMD_UTILITY){
+        expand_hypertables_walker((Node *) parse, boundParams);
     }
 
     // call previous hook or standard planner
@@ -254,10 +119,66 @@ timeseries_planner_hook(Query *parse,
     else{
         result = standard_planner(parse, query_string, cursorOptions, boundParams);
     }
+
+    if(dropped_chunks != NIL){
+        chunk_delete_plan_wrap(result, dropped_chunks);
+    }
+
+    // chunks excluded at execution by now() / parameter quals, also below UPDATE/DELETE
+    chunk_append_plan_wrap(result, cursorOptions);
+
+    // DISTINCT ON (col) over chunk index scans on (col, ...) reads one row per value
+    skip_scan_plan_wrap(result);
+
+    // route INSERT into hypertable inside the executor instead of the row trigger
+    if((parse->commandType == CMD_INSERT) && (parse->resultRelation > 0)){
+        rte = rt_fetch(parse->resultRelation, parse->rtable);
+        if (is_hypertable_relation(rte) || parse->hasModifyingCTE){
+            chunk_dispatch_plan_wrap(result);
+        }
+    }
+    else if(parse->hasModifyingCTE){
+        chunk_dispatch_plan_wrap(result);
+    }
     
     return result;
 }
 
+static void
+timeseries_create_upper_paths_hook(PlannerInfo *root,
+                                   UpperRelationKind stage,
+                                   RelOptInfo *input_rel,
+                                   RelOptInfo *output_rel,
+                                   void *extra)
+{
+    if(prev_create_upper_paths_hook){
+        prev_create_upper_paths_hook(root, stage, input_rel, output_rel, extra);
+    }
+
+    // GROUP BY / aggregates over chunks: partial aggregation per chunk (chunk_agg.c)
+    if(stage == UPPERREL_GROUP_AGG && extra != NULL){
+        chunk_agg_add_paths(root, input_rel, output_rel, (GroupPathExtraData *) extra);
+    }
+
+    // GROUP BY time_bucket_gapfill(...): rows for missing buckets on top of the grouping (gapfill.c)
+    if(stage == UPPERREL_GROUP_AGG){
+        gapfill_add_paths(root, output_rel);
+    }
+}
+
+static void
+timeseries_set_rel_pathlist_hook(PlannerInfo *root,
+                                 RelOptInfo *rel,
+                                 Index rti,
+                                 RangeTblEntry *rte)
+{
+    if(prev_set_rel_pathlist_hook){
+        prev_set_rel_pathlist_hook(root, rel, rti, rte);
+    }
+
+    // ORDER BY / GROUP BY time_bucket(w, time): chunks read in time order (time_bucket.c)
+    time_bucket_add_ordered_paths(root, rel, rti, rte);
+}
 
 void
 planner_hook_init(void)
@@ -268,14 +189,13 @@ planner_hook_init(void)
         return;
     }
 
-    init_hypertable_cache();
-
-    // register transaction callback 
-    RegisterXactCallback(invalidate_cache_callback, NULL);
-
     // install planner hook
     prev_planner_hook = planner_hook;
     planner_hook = timeseries_planner_hook;
+    prev_create_upper_paths_hook = create_upper_paths_hook;
+    create_upper_paths_hook = timeseries_create_upper_paths_hook;
+    prev_set_rel_pathlist_hook = set_rel_pathlist_hook;
+    set_rel_pathlist_hook = timeseries_set_rel_pathlist_hook;
     
     elog(LOG, "Timeseries planner hook installed");
 }
@@ -283,25 +203,11 @@ planner_hook_init(void)
 void
 planner_hook_cleanup(void)
 {
-    // unregister transaction callback
-    UnregisterXactCallback(invalidate_cache_callback, NULL);
-
     // remove planner hook
     if (planner_hook == timeseries_planner_hook){
         planner_hook = prev_planner_hook;
+        create_upper_paths_hook = prev_create_upper_paths_hook;
+        set_rel_pathlist_hook = prev_set_rel_pathlist_hook;
         elog(LOG, "Timeseries planner hook removed");
     }
-
-    // clean up cache
-    if (hypertable_cache != NULL){
-        hash_destroy(hypertable_cache);
-        hypertable_cache = NULL;
-        cache_valid = false;
-        elog(LOG, "Hypertable cache destroyed");
-    }
-}
-
-void
-planner_invalidate_cache(void){
-    cache_valid = false;
 }
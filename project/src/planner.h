@@ -3,5 +3,4 @@
 #include <postgres.h>
 
 void planner_hook_init(void);
-void planner_hook_cleanup(void);
-void planner_invalidate_cache(void);
\ No newline at end of file
+void planner_hook_cleanup(void);
\ No newline at end of file
@@ -0,0 +1,508 @@
+#include <postgres.h>
+#include <access/genam.h>
+#include <access/skey.h>
+#include <access/stratnum.h>
+#include <catalog/pg_am.h>
+#include <catalog/pg_index.h>
+#include <catalog/pg_type.h>
+#include <commands/explain.h>
+#include <executor/executor.h>
+#include <nodes/execnodes.h>
+#include <nodes/extensible.h>
+#include <nodes/makefuncs.h>
+#include <nodes/nodeFuncs.h>
+#include <parser/parsetree.h>
+#include <utils/datum.h>
+#include <utils/lsyscache.h>
+#include <utils/rel.h>
+
+#include "chunk_exclusion.h"
+#include "chunk_append.h"
+#include "skip_scan.h"
+
+/*
+    SkipScan
+
+    SELECT DISTINCT ON (sensor_id) * FROM sensor_data ORDER BY sensor_id, time DESC
+
+    [Unique]                                [Unique]
+        ↓                                       ↓
+    [MergeAppend]               ==>         [MergeAppend]
+        ↓                                       ↓
+    [Index Scan (sensor_id, time DESC)]     [Custom Scan (SkipScan)] per chunk
+        per chunk, every row                    ↓ first row, then sensor_id > previous
+                                            [Index Scan (sensor_id, time DESC)]
+
+    Only the first row of every distinct leading key value is read from a
+    chunk: after returning it, the index scan starts again at the next
+    value ("sensor_id > 7" as first index key). Each chunk costs one index
+    descent per series instead of one index tuple per row, MergeAppend and
+    Unique combine the chunks as before. The NULL group is read with
+    "sensor_id IS NULL" before or after the values, as the index orders it.
+
+    Used below Unique on a single column (DISTINCT ON (col), SELECT DISTINCT
+    col) for btree index scans of chunks whose leading index column is that
+    column. Other quals of the scan are kept, the first row passing them is
+    the one of its value.
+*/
+
+bool skip_scan_enabled = true;
+
+typedef enum SkipScanStage {
+    SKIP_SCAN_VALUES, // one row per non null value
+    SKIP_SCAN_NULLS,  // one row with NULL
+} SkipScanStage;
+
+typedef struct SkipScanState {
+    CustomScanState css;
+    PlanState *child;
+    ScanKey skip_key; // first index key of the child, set again before every descent
+    StrategyNumber strategy; // "col > previous" or "col < previous" in scan order
+    AttrNumber attnum; // leading index column in the scan tuple of the child
+    SkipScanStage stages[2]; // index order of values and NULL
+    int stage; // 2 when done
+    bool needs_rescan;
+    bool has_previous;
+    Datum previous;
+    bool previous_byval;
+    int16 previous_len;
+} SkipScanState;
+
+typedef struct SkipScanContext {
+    PlannedStmt *stmt;
+    int next_plan_node_id;
+} SkipScanContext;
+
+static Node *skip_scan_state_create(CustomScan *cscan);
+static void skip_scan_begin(CustomScanState *node, EState *estate, int eflags);
+static TupleTableSlot *skip_scan_exec(CustomScanState *node);
+static void skip_scan_end(CustomScanState *node);
+static void skip_scan_rescan(CustomScanState *node);
+static void skip_scan_explain(CustomScanState *node, List *ancestors, ExplainState *es);
+
+static CustomScanMethods skip_scan_plan_methods = {
+    .CustomName = "SkipScan",
+    .CreateCustomScanState = skip_scan_state_create,
+};
+
+static CustomExecMethods skip_scan_exec_methods = {
+    .CustomName = "SkipScan",
+    .BeginCustomScan = skip_scan_begin,
+    .ExecCustomScan = skip_scan_exec,
+    .EndCustomScan = skip_scan_end,
+    .ReScanCustomScan = skip_scan_rescan,
+    .ExplainCustomScan = skip_scan_explain,
+};
+
+/*
+    Executor
+*/
+static Node *
+skip_scan_state_create(CustomScan *cscan)
+{
+    SkipScanState *state = (SkipScanState *) newNode(sizeof(SkipScanState), T_CustomScanState);
+
+    state->css.methods = &skip_scan_exec_methods;
+    return (Node *) state;
+}
+
+static void
+skip_scan_begin(CustomScanState *node, EState *estate, int eflags)
+{
+    SkipScanState *state = (SkipScanState *) node;
+    CustomScan *cscan = (CustomScan *) node->ss.ps.plan;
+    bool nulls_first = boolVal(lsecond(cscan->custom_private));
+    ScanKey keys;
+    int n_keys;
+    Form_pg_attribute attr;
+
+    state->child = ExecInitNode((Plan *) linitial(cscan->custom_plans), estate, eflags);
+    node->custom_ps = list_make1(state->child);
+
+    state->attnum = intVal(linitial(cscan->custom_private));
+    state->stages[0] = nulls_first ? SKIP_SCAN_NULLS : SKIP_SCAN_VALUES;
+    state->stages[1] = nulls_first ? SKIP_SCAN_VALUES : SKIP_SCAN_NULLS;
+    state->stage = 0;
+    state->needs_rescan = true;
+
+    // index scans do not build their keys for EXPLAIN
+    if (eflags & EXEC_FLAG_EXPLAIN_ONLY) return;
+
+    if (IsA(state->child, IndexScanState)){
+        keys = ((IndexScanState *) state->child)->iss_ScanKeys;
+        n_keys = ((IndexScanState *) state->child)->iss_NumScanKeys;
+    }
+    else if (IsA(state->child, IndexOnlyScanState)){
+        keys = ((IndexOnlyScanState *) state->child)->ioss_ScanKeys;
+        n_keys = ((IndexOnlyScanState *) state->child)->ioss_NumScanKeys;
+    }
+    else{
+        elog(ERROR, "SkipScan: unexpected child node %d", (int) nodeTag(state->child));
+    }
+    if (n_keys < 1){
+        elog(ERROR, "SkipScan: index scan without skip key");
+    }
+
+    state->skip_key = &keys[0];
+    state->strategy = state->skip_key->sk_strategy;
+
+    attr = TupleDescAttr(((ScanState *) state->child)->ss_ScanTupleSlot->tts_tupleDescriptor, state->attnum - 1);
+    state->previous_byval = attr->attbyval;
+    state->previous_len = attr->attlen;
+}
+
+// first index key for the next descent of the current stage
+static void
+skip_scan_set_key(SkipScanState *state)
+{
+    ScanKey key = state->skip_key;
+
+    if (state->stages[state->stage] == SKIP_SCAN_NULLS){
+        key->sk_flags = SK_ISNULL | SK_SEARCHNULL;
+        key->sk_strategy = InvalidStrategy;
+        key->sk_argument = (Datum) 0;
+    }
+    else if (state->has_previous){
+        key->sk_flags = 0;
+        key->sk_strategy = state->strategy;
+        key->sk_argument = state->previous;
+    }
+    else{
+        key->sk_flags = SK_ISNULL | SK_SEARCHNOTNULL;
+        key->sk_strategy = InvalidStrategy;
+        key->sk_argument = (Datum) 0;
+    }
+}
+
+static void
+skip_scan_forget_previous(SkipScanState *state)
+{
+    if (state->has_previous && !state->previous_byval){
+        pfree(DatumGetPointer(state->previous));
+    }
+    state->has_previous = false;
+}
+
+static TupleTableSlot *
+skip_scan_exec(CustomScanState *node)
+{
+    SkipScanState *state = (SkipScanState *) node;
+
+    while (state->stage < 2){
+        TupleTableSlot *slot;
+
+        if (state->needs_rescan){
+            skip_scan_set_key(state);
+            ExecReScan(state->child);
+            state->needs_rescan = false;
+        }
+
+        slot = ExecProcNode(state->child);
+        if (TupIsNull(slot)){
+            // no more values (or no NULL) in this chunk
+            skip_scan_forget_previous(state);
+            state->stage++;
+            state->needs_rescan = true;
+            continue;
+        }
+
+        if (state->stages[state->stage] == SKIP_SCAN_VALUES){
+            TupleTableSlot *scan_slot = ((ScanState *) state->child)->ss_ScanTupleSlot;
+            bool isnull;
+            Datum value = slot_getattr(scan_slot, state->attnum, &isnull);
+
+            Assert(!isnull);
+            value = datumCopy(value, state->previous_byval, state->previous_len);
+            skip_scan_forget_previous(state);
+            state->previous = value;
+            state->has_previous = true;
+        }
+        else{
+            state->stage++;
+        }
+
+        // the slot stays valid until the next call, the index is searched again then
+        state->needs_rescan = true;
+        return slot;
+    }
+
+    return NULL;
+}
+
+static void
+skip_scan_end(CustomScanState *node)
+{
+    SkipScanState *state = (SkipScanState *) node;
+
+    ExecEndNode(state->child);
+}
+
+static void
+skip_scan_rescan(CustomScanState *node)
+{
+    SkipScanState *state = (SkipScanState *) node;
+
+    if (node->ss.ps.chgParam != NULL){
+        UpdateChangedParamSet(state->child, node->ss.ps.chgParam);
+    }
+
+    skip_scan_forget_previous(state);
+    state->stage = 0;
+    state->needs_rescan = true;
+}
+
+static void
+skip_scan_explain(CustomScanState *node, List *ancestors, ExplainState *es)
+{
+    CustomScan *cscan = (CustomScan *) node->ss.ps.plan;
+
+    ExplainPropertyText("Skip Column", strVal(lthird(cscan->custom_private)), es);
+}
+
+/*
+    Plan
+*/
+// index column Vars of an index only scan tlist replaced by the indexed expressions
+static Node *
+skip_scan_index_var_mutator(Node *node, void *context)
+{
+    if (node == NULL) return NULL;
+
+    if (IsA(node, Var) && ((Var *) node)->varno == INDEX_VAR){
+        TargetEntry *tle = get_tle_by_resno((List *) context, ((Var *) node)->varattno);
+
+        return (Node *) copyObject(tle->expr);
+    }
+    return expression_tree_mutator(node, skip_scan_index_var_mutator, context);
+}
+
+// SkipScan over an index scan of a chunk returning distinct values of output column colno, NULL when not possible
+static Plan *
+skip_scan_make(SkipScanContext *ctx, Plan *plan, AttrNumber colno)
+{
+    Scan *scan = (Scan *) plan;
+    CustomScan *cscan;
+    RangeTblEntry *rte;
+    TargetEntry *tle;
+    Relation index_rel;
+    Oid indexid;
+    Oid hypertable_relid;
+    int64 start_time;
+    int64 end_time;
+    AttrNumber heap_attnum;
+    AttrNumber scan_attnum;
+    Oid opfamily;
+    Oid opcintype;
+    Oid collation;
+    int16 indoption;
+    bool backward;
+    bool is_btree;
+    Oid opno;
+    OpExpr *skip_qual;
+    List *tlist = NIL;
+    ListCell *lc;
+
+    switch (nodeTag(plan)){
+        case T_IndexScan:
+            if (((IndexScan *) plan)->indexorderby != NIL) return NULL;
+            indexid = ((IndexScan *) plan)->indexid;
+            backward = ScanDirectionIsBackward(((IndexScan *) plan)->indexorderdir);
+            break;
+        case T_IndexOnlyScan:
+            if (((IndexOnlyScan *) plan)->indexorderby != NIL) return NULL;
+            indexid = ((IndexOnlyScan *) plan)->indexid;
+            backward = ScanDirectionIsBackward(((IndexOnlyScan *) plan)->indexorderdir);
+            break;
+        default:
+            return NULL;
+    }
+
+    rte = rt_fetch(scan->scanrelid, ctx->stmt->rtable);
+    if (rte->rtekind != RTE_RELATION) return NULL;
+    if (!chunk_exclusion_chunk_range(rte->relid, &hypertable_relid, &start_time, &end_time)) return NULL;
+
+    // locked by the planner
+    index_rel = index_open(indexid, NoLock);
+    is_btree = index_rel->rd_rel->relam == BTREE_AM_OID;
+    heap_attnum = index_rel->rd_index->indkey.values[0];
+    opfamily = index_rel->rd_opfamily[0];
+    opcintype = index_rel->rd_opcintype[0];
+    collation = index_rel->rd_indcollation[0];
+    indoption = index_rel->rd_indoption[0];
+    index_close(index_rel, NoLock);
+
+    // expression as leading index column is not supported
+    if (!is_btree || heap_attnum == InvalidAttrNumber) return NULL;
+
+    // the distinct column must be the leading index column
+    tle = get_tle_by_resno(plan->targetlist, colno);
+    if (tle == NULL || !IsA(tle->expr, Var)) return NULL;
+    if (IsA(plan, IndexScan)){
+        if (((Var *) tle->expr)->varno != scan->scanrelid || ((Var *) tle->expr)->varattno != heap_attnum){
+            return NULL;
+        }
+        scan_attnum = heap_attnum;
+    }
+    else{
+        if (((Var *) tle->expr)->varno != INDEX_VAR || ((Var *) tle->expr)->varattno != 1){
+            return NULL;
+        }
+        scan_attnum = 1;
+    }
+
+    // values come in descending order from a DESC column, or an ASC column read backward
+    opno = get_opfamily_member(opfamily, opcintype, opcintype,
+                               ((indoption & INDOPTION_DESC) != 0) != backward ?
+                               BTLessStrategyNumber : BTGreaterStrategyNumber);
+    if (!OidIsValid(opno)) return NULL;
+
+    // placeholder first index key "col > NULL", replaced before every index descent
+    skip_qual = (OpExpr *) make_opclause(opno, BOOLOID, false,
+                                         (Expr *) makeVar(INDEX_VAR, 1, opcintype, -1, collation, 0),
+                                         (Expr *) makeNullConst(opcintype, -1, collation),
+                                         InvalidOid, collation);
+    set_opfuncid(skip_qual);
+
+    if (IsA(plan, IndexScan)){
+        ((IndexScan *) plan)->indexqual = lcons(skip_qual, ((IndexScan *) plan)->indexqual);
+    }
+    else{
+        ((IndexOnlyScan *) plan)->indexqual = lcons(skip_qual, ((IndexOnlyScan *) plan)->indexqual);
+    }
+
+    // a custom scan reads the tuple of its child as INDEX_VAR
+    foreach(lc, plan->targetlist){
+        TargetEntry *child_tle = (TargetEntry *) lfirst(lc);
+        Var *var = makeVar(INDEX_VAR, child_tle->resno, exprType((Node *) child_tle->expr),
+                           exprTypmod((Node *) child_tle->expr), exprCollation((Node *) child_tle->expr), 0);
+
+        tlist = lappend(tlist, makeTargetEntry((Expr *) var, child_tle->resno, child_tle->resname,
+                                               child_tle->resjunk));
+    }
+
+    cscan = makeNode(CustomScan);
+    cscan->scan.plan.startup_cost = plan->startup_cost;
+    cscan->scan.plan.total_cost = plan->total_cost;
+    cscan->scan.plan.plan_rows = plan->plan_rows;
+    cscan->scan.plan.plan_width = plan->plan_width;
+    cscan->scan.plan.parallel_safe = plan->parallel_safe;
+    cscan->scan.plan.plan_node_id = ctx->next_plan_node_id++;
+    cscan->scan.plan.extParam = bms_copy(plan->extParam);
+    cscan->scan.plan.allParam = bms_copy(plan->allParam);
+    cscan->scan.plan.targetlist = tlist;
+    cscan->scan.scanrelid = 0;
+    cscan->custom_plans = list_make1(plan);
+    // scan tuple described with the columns of the chunk, so EXPLAIN VERBOSE can name them
+    if (IsA(plan, IndexOnlyScan)){
+        cscan->custom_scan_tlist = (List *) skip_scan_index_var_mutator((Node *) plan->targetlist,
+                                                                        ((IndexOnlyScan *) plan)->indextlist);
+    }
+    else{
+        cscan->custom_scan_tlist = copyObject(plan->targetlist);
+    }
+    cscan->custom_private = list_make3(makeInteger(scan_attnum),
+                                       makeBoolean(((indoption & INDOPTION_NULLS_FIRST) != 0) != backward),
+                                       makeString(get_attname(rte->relid, heap_attnum, false)));
+    cscan->methods = &skip_scan_plan_methods;
+    return (Plan *) cscan;
+}
+
+// index scans below Unique on one column read one row per value
+static void
+skip_scan_from_unique(SkipScanContext *ctx, Unique *unique)
+{
+    Plan *input = unique->plan.lefttree;
+    Plan *skip_scan;
+    int n_skip_scans = 0;
+    ListCell *lc;
+
+    if (unique->numCols != 1 || input == NULL) return;
+
+    if (IsA(input, MergeAppend)){
+        foreach(lc, ((MergeAppend *) input)->mergeplans){
+            skip_scan = skip_scan_make(ctx, (Plan *) lfirst(lc), unique->uniqColIdx[0]);
+            if (skip_scan != NULL){
+                lfirst(lc) = skip_scan;
+                n_skip_scans++;
+            }
+        }
+    }
+    else{
+        skip_scan = skip_scan_make(ctx, input, unique->uniqColIdx[0]);
+        if (skip_scan != NULL){
+            unique->plan.lefttree = skip_scan;
+            n_skip_scans++;
+        }
+    }
+
+    if (n_skip_scans > 0){
+        elog(DEBUG1, "SkipScan: %d chunk index scan(s) below Unique", n_skip_scans);
+    }
+}
+
+static void
+skip_scan_walk(SkipScanContext *ctx, Plan *plan)
+{
+    ListCell *lc;
+
+    if (plan == NULL) return;
+
+    skip_scan_walk(ctx, plan->lefttree);
+    skip_scan_walk(ctx, plan->righttree);
+
+    switch (nodeTag(plan)){
+        case T_Unique:
+            skip_scan_from_unique(ctx, (Unique *) plan);
+            break;
+        case T_Append:
+            foreach(lc, ((Append *) plan)->appendplans){
+                skip_scan_walk(ctx, (Plan *) lfirst(lc));
+            }
+            break;
+        case T_MergeAppend:
+            foreach(lc, ((MergeAppend *) plan)->mergeplans){
+                skip_scan_walk(ctx, (Plan *) lfirst(lc));
+            }
+            break;
+        case T_SubqueryScan:
+            skip_scan_walk(ctx, ((SubqueryScan *) plan)->subplan);
+            break;
+        case T_CustomScan:
+            foreach(lc, ((CustomScan *) plan)->custom_plans){
+                skip_scan_walk(ctx, (Plan *) lfirst(lc));
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+/*
+    Public function
+*/
+void
+skip_scan_init(void)
+{
+    RegisterCustomScanMethods(&skip_scan_plan_methods);
+}
+
+void
+skip_scan_plan_wrap(PlannedStmt *stmt)
+{
+    SkipScanContext ctx;
+    ListCell *lc;
+
+    if (!skip_scan_enabled) return;
+
+    ctx.stmt = stmt;
+    ctx.next_plan_node_id = chunk_append_max_plan_node_id(stmt->planTree);
+    foreach(lc, stmt->subplans){
+        ctx.next_plan_node_id = Max(ctx.next_plan_node_id, chunk_append_max_plan_node_id((Plan *) lfirst(lc)));
+    }
+    ctx.next_plan_node_id++;
+
+    skip_scan_walk(&ctx, stmt->planTree);
+    foreach(lc, stmt->subplans){
+        skip_scan_walk(&ctx, (Plan *) lfirst(lc));
+    }
+}
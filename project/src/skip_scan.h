@@ -0,0 +1,13 @@
+#pragma once
+
+#include <postgres.h>
+#include <nodes/plannodes.h>
+
+// DISTINCT below Unique skips between index values (simple_timeseries.enable_skip_scan)
+extern bool skip_scan_enabled;
+
+// register SkipScan custom scan methods
+extern void skip_scan_init(void);
+
+// put SkipScan over chunk index scans below Unique on their leading index column
+extern void skip_scan_plan_wrap(PlannedStmt *stmt);
@@ -0,0 +1,657 @@
+#include <postgres.h>
+#include <fmgr.h>
+#include <access/stratnum.h>
+#include <catalog/pg_am.h>
+#include <catalog/pg_type.h>
+#include <common/int.h>
+#include <datatype/timestamp.h>
+#include <nodes/makefuncs.h>
+#include <nodes/nodeFuncs.h>
+#include <optimizer/pathnode.h>
+#include <optimizer/paths.h>
+#include <parser/parsetree.h>
+#include <utils/lsyscache.h>
+#include <utils/timestamp.h>
+#include <utils/typcache.h>
+
+#include "hypertable_cache.h"
+#include "chunk_exclusion.h"
+#include "time_bucket.h"
+
+/*
+    time_bucket family
+
+    time_bucket(width, time [, origin | offset])    timestamptz, timestamp
+    time_bucket(width, value [, offset])            smallint, integer, bigint
+
+    bucket = floor((time - origin) / width) * width + origin
+
+    The origin defaults to 2000-01-01 00:00 UTC (0 for integers), the offset
+    moves it. Times before the origin round down as well. Intervals with
+    months have no fixed width and are rejected.
+
+    The functions are IMMUTABLE and PARALLEL SAFE: usable in expression
+    indexes, folded when every argument is constant, run in parallel workers.
+
+    The planner does not look into a function compared with a constant, so
+    the planner hook (planner.c) adds the range of the bucketed column:
+
+    WHERE time_bucket('1 day', time) >= '2024-01-05'
+            ↓ adds
+    AND time >= '2024-01-05'    => chunk exclusion, index range on time
+
+    Ordering by a bucket is ordering by the bucketed column, an index on time
+    reads the chunks in bucket order:
+
+    GROUP BY time_bucket('1 hour', time) ORDER BY 1
+            ↓
+    [GroupAggregate] -> [Merge Append] -> [Index Scan on chunk (time)] ...
+    (instead of Sort -> HashAggregate -> Append -> Seq Scan)
+*/
+
+typedef enum TimeBucketKind {
+    TIME_BUCKET_NONE,
+    TIME_BUCKET_TIMESTAMP, // (interval, timestamp)
+    TIME_BUCKET_ORIGIN, // (interval, timestamp, origin timestamp)
+    TIME_BUCKET_OFFSET, // (interval, timestamp, offset interval)
+    TIME_BUCKET_INTEGER // (int, int [, offset int])
+} TimeBucketKind;
+
+// constant arguments of a time_bucket call, values as int64
+typedef struct TimeBucketCall {
+    Node *value; // bucketed expression
+    Oid type;
+    int64 width;
+    int64 offset;
+} TimeBucketCall;
+
+/*
+    Private function
+*/
+static Datum
+time_bucket_timestamp(int64 width, int64 origin, Timestamp ts)
+{
+    int64 result;
+
+    if (TIMESTAMP_NOT_FINITE(ts)){
+        PG_RETURN_TIMESTAMP(ts);
+    }
+
+    if (!time_bucket_compute(width, origin, ts, &result) || !IS_VALID_TIMESTAMP(result)){
+        ereport(ERROR,
+                (errcode(ERRCODE_DATETIME_VALUE_OUT_OF_RANGE),
+                errmsg("timestamp out of range")));
+    }
+    PG_RETURN_TIMESTAMP(result);
+}
+
+static int64
+time_bucket_integer(int64 width, int64 value, int64 offset, int64 min, int64 max)
+{
+    int64 result;
+
+    if (width <= 0){
+        ereport(ERROR,
+                (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                errmsg("time_bucket width must be positive")));
+    }
+
+    if (!time_bucket_compute(width, offset, value, &result) || result < min || result > max){
+        ereport(ERROR,
+                (errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
+                errmsg("time_bucket result out of range")));
+    }
+    return result;
+}
+
+/*
+    Top level function
+*/
+PG_FUNCTION_INFO_V1(time_bucket);
+Datum
+time_bucket(PG_FUNCTION_ARGS)
+{
+    return time_bucket_timestamp(time_bucket_interval_width(PG_GETARG_INTERVAL_P(0)), 0, PG_GETARG_TIMESTAMP(1));
+}
+
+PG_FUNCTION_INFO_V1(time_bucket_origin);
+Datum
+time_bucket_origin(PG_FUNCTION_ARGS)
+{
+    Timestamp origin = PG_GETARG_TIMESTAMP(2);
+
+    if (TIMESTAMP_NOT_FINITE(origin)){
+        ereport(ERROR,
+                (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                errmsg("time_bucket origin must be finite")));
+    }
+    return time_bucket_timestamp(time_bucket_interval_width(PG_GETARG_INTERVAL_P(0)), origin, PG_GETARG_TIMESTAMP(1));
+}
+
+PG_FUNCTION_INFO_V1(time_bucket_offset);
+Datum
+time_bucket_offset(PG_FUNCTION_ARGS)
+{
+    Interval *offset = PG_GETARG_INTERVAL_P(2);
+
+    if (offset->month != 0){
+        ereport(ERROR,
+                (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+                errmsg("time_bucket offset can not have months")));
+    }
+    return time_bucket_timestamp(time_bucket_interval_width(PG_GETARG_INTERVAL_P(0)),
+                                 offset->day * USECS_PER_DAY + offset->time, PG_GETARG_TIMESTAMP(1));
+}
+
+PG_FUNCTION_INFO_V1(time_bucket_int16);
+Datum
+time_bucket_int16(PG_FUNCTION_ARGS)
+{
+    int16 offset = PG_NARGS() > 2 ? PG_GETARG_INT16(2) : 0;
+
+    PG_RETURN_INT16((int16) time_bucket_integer(PG_GETARG_INT16(0), PG_GETARG_INT16(1), offset, PG_INT16_MIN, PG_INT16_MAX));
+}
+
+PG_FUNCTION_INFO_V1(time_bucket_int32);
+Datum
+time_bucket_int32(PG_FUNCTION_ARGS)
+{
+    int32 offset = PG_NARGS() > 2 ? PG_GETARG_INT32(2) : 0;
+
+    PG_RETURN_INT32((int32) time_bucket_integer(PG_GETARG_INT32(0), PG_GETARG_INT32(1), offset, PG_INT32_MIN, PG_INT32_MAX));
+}
+
+PG_FUNCTION_INFO_V1(time_bucket_int64);
+Datum
+time_bucket_int64(PG_FUNCTION_ARGS)
+{
+    int64 offset = PG_NARGS() > 2 ? PG_GETARG_INT64(2) : 0;
+
+    PG_RETURN_INT64(time_bucket_integer(PG_GETARG_INT64(0), PG_GETARG_INT64(1), offset, PG_INT64_MIN, PG_INT64_MAX));
+}
+
+/*
+    Plan
+*/
+static TimeBucketKind
+time_bucket_kind(Oid funcid)
+{
+    char *name = get_func_name(funcid);
+    FmgrInfo finfo;
+
+    if (name == NULL || strcmp(name, "time_bucket") != 0) return TIME_BUCKET_NONE;
+
+    // another time_bucket (other extension, SQL function) is not ours
+    fmgr_info(funcid, &finfo);
+    if (finfo.fn_addr == time_bucket) return TIME_BUCKET_TIMESTAMP;
+    if (finfo.fn_addr == time_bucket_origin) return TIME_BUCKET_ORIGIN;
+    if (finfo.fn_addr == time_bucket_offset) return TIME_BUCKET_OFFSET;
+    if (finfo.fn_addr == time_bucket_int16 || finfo.fn_addr == time_bucket_int32 ||
+        finfo.fn_addr == time_bucket_int64){
+        return TIME_BUCKET_INTEGER;
+    }
+    return TIME_BUCKET_NONE;
+}
+
+static bool
+time_bucket_datum_int64(Datum value, Oid type, int64 *result)
+{
+    switch (type){
+        case INT2OID:
+            *result = DatumGetInt16(value);
+            return true;
+        case INT4OID:
+            *result = DatumGetInt32(value);
+            return true;
+        case INT8OID:
+            *result = DatumGetInt64(value);
+            return true;
+        case TIMESTAMPOID:
+        case TIMESTAMPTZOID:
+            *result = DatumGetTimestamp(value);
+            return !TIMESTAMP_NOT_FINITE(*result);
+        default:
+            return false;
+    }
+}
+
+// constant of type, false when value does not fit
+static Const *
+time_bucket_make_const(int64 value, Oid type)
+{
+    switch (type){
+        case INT2OID:
+            if (value < PG_INT16_MIN || value > PG_INT16_MAX) return NULL;
+            return makeConst(INT2OID, -1, InvalidOid, sizeof(int16), Int16GetDatum((int16) value), false, true);
+        case INT4OID:
+            if (value < PG_INT32_MIN || value > PG_INT32_MAX) return NULL;
+            return makeConst(INT4OID, -1, InvalidOid, sizeof(int32), Int32GetDatum((int32) value), false, true);
+        case INT8OID:
+            return makeConst(INT8OID, -1, InvalidOid, sizeof(int64), Int64GetDatum(value), false, FLOAT8PASSBYVAL);
+        case TIMESTAMPOID:
+        case TIMESTAMPTZOID:
+            if (!IS_VALID_TIMESTAMP(value)) return NULL;
+            return makeConst(type, -1, InvalidOid, sizeof(int64), TimestampGetDatum(value), false, FLOAT8PASSBYVAL);
+        default:
+            return NULL;
+    }
+}
+
+// time_bucket(constant width, expr [, constant origin/offset]), false for anything else
+static bool
+time_bucket_call(Node *node, TimeBucketCall *call, ParamListInfo bound_params)
+{
+    FuncExpr *func;
+    TimeBucketKind kind;
+    Const *width;
+    Const *extra = NULL;
+
+    if (node == NULL || !IsA(node, FuncExpr)) return false;
+
+    func = (FuncExpr *) node;
+    if (list_length(func->args) < 2) return false;
+
+    kind = time_bucket_kind(func->funcid);
+    if (kind == TIME_BUCKET_NONE) return false;
+
+    width = chunk_exclusion_clause_constant(linitial(func->args), bound_params);
+    if (width == NULL || width->constisnull) return false;
+    if (list_length(func->args) > 2){
+        extra = chunk_exclusion_clause_constant(lthird(func->args), bound_params);
+        if (extra == NULL || extra->constisnull) return false;
+    }
+
+    call->value = lsecond(func->args);
+    call->type = func->funcresulttype;
+    call->offset = 0;
+
+    if (kind == TIME_BUCKET_INTEGER){
+        if (!time_bucket_datum_int64(width->constvalue, width->consttype, &call->width)) return false;
+        if (extra != NULL && !time_bucket_datum_int64(extra->constvalue, extra->consttype, &call->offset)) return false;
+    }
+    else{
+        Interval *interval = DatumGetIntervalP(width->constvalue);
+
+        if (interval->month != 0) return false;
+        call->width = interval->day * USECS_PER_DAY + interval->time;
+
+        if (kind == TIME_BUCKET_ORIGIN){
+            if (!time_bucket_datum_int64(extra->constvalue, extra->consttype, &call->offset)) return false;
+        }
+        else if (kind == TIME_BUCKET_OFFSET){
+            Interval *offset = DatumGetIntervalP(extra->constvalue);
+
+            if (offset->month != 0) return false;
+            call->offset = offset->day * USECS_PER_DAY + offset->time;
+        }
+    }
+
+    return call->width > 0;
+}
+
+// "column op bound" with the btree operator of strategy
+static Node *
+time_bucket_make_qual(Node *value, Oid type, int strategy, int64 bound)
+{
+    TypeCacheEntry *typentry = lookup_type_cache(type, TYPECACHE_BTREE_OPFAMILY);
+    Const *constant = time_bucket_make_const(bound, type);
+    Oid opno;
+    OpExpr *op;
+
+    if (constant == NULL) return NULL;
+
+    opno = get_opfamily_member(typentry->btree_opf, type, type, strategy);
+    if (!OidIsValid(opno)) return NULL;
+
+    op = (OpExpr *) make_opclause(opno, BOOLOID, false, (Expr *) copyObject(value), (Expr *) constant,
+                                  InvalidOid, InvalidOid);
+    op->opfuncid = get_opcode(opno);
+    return (Node *) op;
+}
+
+// range of the bucketed column implied by "time_bucket(...) op constant", appended to quals
+static List *
+time_bucket_derive_quals(Node *clause, List *derived, ParamListInfo bound_params)
+{
+    TimeBucketCall call;
+    TypeCacheEntry *typentry;
+    OpExpr *op;
+    Node *left;
+    Node *right;
+    Const *value;
+    int64 x;
+    int64 lo;
+    int64 hi;
+    int strategy;
+    Node *qual;
+
+    if (clause == NULL) return derived;
+
+    if (IsA(clause, BoolExpr) && ((BoolExpr *) clause)->boolop == AND_EXPR){
+        ListCell *lc;
+
+        foreach(lc, ((BoolExpr *) clause)->args){
+            derived = time_bucket_derive_quals((Node *) lfirst(lc), derived, bound_params);
+        }
+        return derived;
+    }
+
+    if (!IsA(clause, OpExpr)) return derived;
+
+    op = (OpExpr *) clause;
+    if (list_length(op->args) != 2) return derived;
+
+    left = linitial(op->args);
+    right = lsecond(op->args);
+    if (time_bucket_call(left, &call, bound_params) && (value = chunk_exclusion_clause_constant(right, bound_params)) != NULL){
+        typentry = lookup_type_cache(call.type, TYPECACHE_BTREE_OPFAMILY);
+        strategy = get_op_opfamily_strategy(op->opno, typentry->btree_opf);
+    }
+    else if (time_bucket_call(right, &call, bound_params) && (value = chunk_exclusion_clause_constant(left, bound_params)) != NULL){
+        typentry = lookup_type_cache(call.type, TYPECACHE_BTREE_OPFAMILY);
+        strategy = get_op_opfamily_strategy(op->opno, typentry->btree_opf);
+
+        // "constant op bucket" reads the other way round
+        strategy = chunk_exclusion_commute_strategy(strategy);
+    }
+    else{
+        return derived;
+    }
+
+    // the range is only useful on a column
+    if (!IsA(call.value, Var) || ((Var *) call.value)->varlevelsup != 0) return derived;
+    if (value->constisnull || value->consttype != call.type || exprType(call.value) != call.type) return derived;
+    if (!time_bucket_datum_int64(value->constvalue, value->consttype, &x)) return derived;
+
+    // bucket(t) >= x  <=>  t >= bucket(x - 1) + width, the first bucket starting at or after x
+    switch (strategy){
+        case BTGreaterEqualStrategyNumber:
+            if (pg_sub_s64_overflow(x, 1, &lo) || !time_bucket_compute(call.width, call.offset, lo, &lo) ||
+                pg_add_s64_overflow(lo, call.width, &lo)){
+                return derived;
+            }
+            qual = time_bucket_make_qual(call.value, call.type, BTGreaterEqualStrategyNumber, lo);
+            break;
+        case BTGreaterStrategyNumber:
+            if (!time_bucket_compute(call.width, call.offset, x, &lo) || pg_add_s64_overflow(lo, call.width, &lo)){
+                return derived;
+            }
+            qual = time_bucket_make_qual(call.value, call.type, BTGreaterEqualStrategyNumber, lo);
+            break;
+        case BTLessEqualStrategyNumber:
+            if (!time_bucket_compute(call.width, call.offset, x, &hi) || pg_add_s64_overflow(hi, call.width, &hi)){
+                return derived;
+            }
+            qual = time_bucket_make_qual(call.value, call.type, BTLessStrategyNumber, hi);
+            break;
+        case BTLessStrategyNumber:
+            if (pg_sub_s64_overflow(x, 1, &hi) || !time_bucket_compute(call.width, call.offset, hi, &hi) ||
+                pg_add_s64_overflow(hi, call.width, &hi)){
+                return derived;
+            }
+            qual = time_bucket_make_qual(call.value, call.type, BTLessStrategyNumber, hi);
+            break;
+        case BTEqualStrategyNumber:
+            if (!time_bucket_compute(call.width, call.offset, x, &lo) || pg_add_s64_overflow(lo, call.width, &hi)){
+                return derived;
+            }
+            qual = time_bucket_make_qual(call.value, call.type, BTGreaterEqualStrategyNumber, lo);
+            if (qual != NULL){
+                derived = lappend(derived, qual);
+            }
+            qual = time_bucket_make_qual(call.value, call.type, BTLessStrategyNumber, hi);
+            break;
+        default:
+            return derived;
+    }
+
+    if (qual != NULL){
+        derived = lappend(derived, qual);
+    }
+    return derived;
+}
+
+static Node *
+time_bucket_add_to_quals(Node *quals, ParamListInfo bound_params)
+{
+    List *derived = time_bucket_derive_quals(quals, NIL, bound_params);
+
+    if (derived == NIL) return quals;
+
+    // original quals stay, they are exact for constants inside a bucket
+    if (quals == NULL){
+        return list_length(derived) == 1 ? (Node *) linitial(derived) : (Node *) makeBoolExpr(AND_EXPR, derived, -1);
+    }
+    if (IsA(quals, BoolExpr) && ((BoolExpr *) quals)->boolop == AND_EXPR){
+        ((BoolExpr *) quals)->args = list_concat(((BoolExpr *) quals)->args, derived);
+        return quals;
+    }
+    return (Node *) makeBoolExpr(AND_EXPR, lcons(quals, derived), -1);
+}
+
+// WHERE and ON of inner joins
+static void
+time_bucket_transform_jointree(Node *jtnode, ParamListInfo bound_params)
+{
+    ListCell *lc;
+
+    if (jtnode == NULL) return;
+
+    if (IsA(jtnode, FromExpr)){
+        FromExpr *from = (FromExpr *) jtnode;
+
+        from->quals = time_bucket_add_to_quals(from->quals, bound_params);
+        foreach(lc, from->fromlist){
+            time_bucket_transform_jointree((Node *) lfirst(lc), bound_params);
+        }
+    }
+    else if (IsA(jtnode, JoinExpr)){
+        JoinExpr *join = (JoinExpr *) jtnode;
+
+        if (join->jointype == JOIN_INNER){
+            join->quals = time_bucket_add_to_quals(join->quals, bound_params);
+        }
+        time_bucket_transform_jointree(join->larg, bound_params);
+        time_bucket_transform_jointree(join->rarg, bound_params);
+    }
+}
+
+// pathkey sorts by time_bucket(width, time column of rti)
+static bool
+time_bucket_pathkey_matches(PathKey *pathkey, Index rti, AttrNumber time_attnum)
+{
+    ListCell *lc;
+
+    foreach(lc, pathkey->pk_eclass->ec_members){
+        EquivalenceMember *member = (EquivalenceMember *) lfirst(lc);
+        Node *expr = (Node *) member->em_expr;
+        TimeBucketCall call;
+        Var *var;
+
+        if (member->em_is_child) continue;
+
+        while (IsA(expr, RelabelType)){
+            expr = (Node *) ((RelabelType *) expr)->arg;
+        }
+        if (!time_bucket_call(expr, &call, NULL) || !IsA(call.value, Var)) continue;
+
+        var = (Var *) call.value;
+        if (var->varno == rti && var->varattno == time_attnum && var->varlevelsup == 0){
+            return true;
+        }
+    }
+    return false;
+}
+
+// index scans in bucket order on the time index of a chunk, false when it has none
+static bool
+time_bucket_add_index_paths(PlannerInfo *root, RelOptInfo *child_rel, AttrNumber attno, PathKey *pathkey)
+{
+    bool added = false;
+    ListCell *lc;
+
+    foreach(lc, child_rel->indexlist){
+        IndexOptInfo *index = (IndexOptInfo *) lfirst(lc);
+        ScanDirection direction;
+        List *indexclauses = NIL;
+        bool nulls_first;
+        ListCell *lc2;
+
+        if (index->relam != BTREE_AM_OID || index->sortopfamily == NULL) continue;
+        if (index->indexkeys[0] != attno || index->sortopfamily[0] != pathkey->pk_opfamily) continue;
+        if (index->indpred != NIL && !index->predOK) continue;
+
+        // btree reads both ways, nulls move with the direction
+        if ((pathkey->pk_strategy == BTLessStrategyNumber) != index->reverse_sort[0]){
+            direction = ForwardScanDirection;
+            nulls_first = index->nulls_first[0];
+        }
+        else{
+            direction = BackwardScanDirection;
+            nulls_first = !index->nulls_first[0];
+        }
+        if (nulls_first != pathkey->pk_nulls_first) continue;
+
+        // keep the index quals of the unordered scan (time range)
+        foreach(lc2, child_rel->pathlist){
+            Path *path = (Path *) lfirst(lc2);
+
+            if (IsA(path, IndexPath) && ((IndexPath *) path)->indexinfo == index && path->param_info == NULL){
+                indexclauses = ((IndexPath *) path)->indexclauses;
+                break;
+            }
+        }
+
+        add_path(child_rel, (Path *) create_index_path(root, index, indexclauses, NIL, NIL,
+                                                       list_make1(pathkey), direction, false,
+                                                       NULL, 1.0, false));
+        added = true;
+    }
+    return added;
+}
+
+// hypertable behind an appendrel (inheritance or the UNION ALL of chunk exclusion)
+static bool
+time_bucket_appendrel_hypertable(PlannerInfo *root, Index rti, RangeTblEntry *rte, HypertableInfo *ht_info)
+{
+    ListCell *lc;
+
+    if (rte->rtekind == RTE_RELATION){
+        return hypertable_cache_lookup(rte->relid, ht_info);
+    }
+
+    foreach(lc, root->append_rel_list){
+        AppendRelInfo *appinfo = (AppendRelInfo *) lfirst(lc);
+        RangeTblEntry *child_rte;
+        Oid hypertable_relid;
+        int64 start_time;
+        int64 end_time;
+
+        if (appinfo->parent_relid != rti) continue;
+
+        child_rte = planner_rt_fetch(appinfo->child_relid, root);
+        if (child_rte->rtekind != RTE_RELATION) return false;
+
+        if (chunk_exclusion_chunk_range(child_rte->relid, &hypertable_relid, &start_time, &end_time)){
+            return hypertable_cache_lookup(hypertable_relid, ht_info);
+        }
+        if (hypertable_cache_lookup(child_rte->relid, ht_info)){
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+    Public function
+*/
+bool
+time_bucket_compute(int64 width, int64 offset, int64 value, int64 *result)
+{
+    int64 shifted;
+    int64 bucket;
+
+    // only the position of the origin inside a bucket matters
+    offset = offset % width;
+
+    if (pg_sub_s64_overflow(value, offset, &shifted)) return false;
+
+    bucket = (shifted / width) * width;
+    if (shifted % width < 0){
+        // division rounds toward zero, times before the origin go one bucket down
+        if (pg_sub_s64_overflow(bucket, width, &bucket)) return false;
+    }
+
+    return !pg_add_s64_overflow(bucket, offset, result);
+}
+
+int64
+time_bucket_interval_width(Interval *interval)
+{
+    int64 width;
+
+    if (interval->month != 0){
+        ereport(ERROR,
+                (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+                errmsg("time_bucket width can not have months"),
+                errhint("Use days, for example '30 days' instead of '1 month'.")));
+    }
+
+    width = interval->day * USECS_PER_DAY + interval->time;
+    if (width <= 0){
+        ereport(ERROR,
+                (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                errmsg("time_bucket width must be positive")));
+    }
+    return width;
+}
+
+void
+time_bucket_transform_quals(Query *parse, ParamListInfo bound_params)
+{
+    time_bucket_transform_jointree((Node *) parse->jointree, bound_params);
+}
+
+void
+time_bucket_add_ordered_paths(PlannerInfo *root, RelOptInfo *rel, Index rti, RangeTblEntry *rte)
+{
+    HypertableInfo ht_info;
+    PathKey *pathkey;
+    List *live_children = NIL;
+    bool added = false;
+    ListCell *lc;
+
+    if (rel->reloptkind != RELOPT_BASEREL || !rte->inh || IS_DUMMY_REL(rel)) return;
+    if (list_length(root->query_pathkeys) != 1) return;
+
+    if (!time_bucket_appendrel_hypertable(root, rti, rte, &ht_info)) return;
+
+    pathkey = (PathKey *) linitial(root->query_pathkeys);
+    if (!time_bucket_pathkey_matches(pathkey, rti, ht_info.time_attnum)) return;
+
+    foreach(lc, root->append_rel_list){
+        AppendRelInfo *appinfo = (AppendRelInfo *) lfirst(lc);
+        RelOptInfo *child_rel;
+        Var *child_var;
+
+        if (appinfo->parent_relid != rti) continue;
+
+        child_rel = root->simple_rel_array[appinfo->child_relid];
+        if (child_rel == NULL || IS_DUMMY_REL(child_rel)) continue;
+        live_children = lappend(live_children, child_rel);
+
+        // time column of the chunk, attnos differ after dropped columns
+        child_var = (Var *) list_nth(appinfo->translated_vars, ht_info.time_attnum - 1);
+        if (child_var == NULL || !IsA(child_var, Var) || child_var->varno != child_rel->relid) continue;
+
+        if (time_bucket_add_index_paths(root, child_rel, child_var->varattno, pathkey)){
+            set_cheapest(child_rel);
+            added = true;
+        }
+    }
+
+    // Merge Append over the new child paths, children without an index get a Sort
+    if (added){
+        add_paths_to_append_rel(root, rel, live_children);
+    }
+}
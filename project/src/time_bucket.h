@@ -0,0 +1,19 @@
+#pragma once
+
+#include <postgres.h>
+#include <nodes/params.h>
+#include <nodes/parsenodes.h>
+#include <nodes/pathnodes.h>
+#include <datatype/timestamp.h>
+
+// floor bucket of value, false on overflow
+extern bool time_bucket_compute(int64 width, int64 offset, int64 value, int64 *result);
+
+// width of an interval in microseconds, errors for months and non-positive widths
+extern int64 time_bucket_interval_width(Interval *interval);
+
+// add "column op constant" ranges implied by time_bucket(...) comparisons to the quals of one query level
+extern void time_bucket_transform_quals(Query *parse, ParamListInfo bound_params);
+
+// ORDER BY / GROUP BY time_bucket(width, time) of a hypertable: chunk index scans on time in bucket order
+extern void time_bucket_add_ordered_paths(PlannerInfo *root, RelOptInfo *rel, Index rti, RangeTblEntry *rte);
@@ -13,6 +13,11 @@
 
 #include "metadata.h"
 #include "chunk.h"
+#include "chunk_insert.h"
+#include "hypertable_cache.h"
+#include "dimension.h"
+#include "last_value.h"
+#include "chunk_column_stats.h"
 
 /* 
 * Private Functions 
@@ -33,70 +38,6 @@ get_time_value_from_tuple(HeapTuple tuple, TupleDesc tupdesc, AttrNumber time_at
     return timestamp;
 }
 
-static char* 
-get_chunk_table_name(const char *schema_name, const char *table_name)
-{   
-    StringInfoData name;
-    initStringInfo(&name);
-    appendStringInfo(&name, "%s.%s", quote_identifier(schema_name), quote_identifier(table_name));
-    
-    return name.data;
-}
-
-static char*
-build_insert_query(const char *chunk_table, TupleDesc tupdesc, HeapTuple tuple)
-{
-    StringInfoData query;
-    int num_atts = tupdesc->natts;
-    
-    initStringInfo(&query);
-    appendStringInfo(&query, "INSERT INTO %s VALUES (", chunk_table);
-
-    for(int i=0; i<num_atts; i++){
-        Form_pg_attribute attr = TupleDescAttr(tupdesc, i);
-        bool isnull;
-        Datum value;
-
-        if (attr->attisdropped) continue;
-
-        value = heap_getattr(tuple, attr->attnum, tupdesc, &isnull);
-
-        if(i>0){
-            appendStringInfoString(&query, ", ");
-        }
-        if(isnull){
-            appendStringInfoString(&query, "NULL");
-        } else {
-            Oid typoutput;
-            bool typIsVarlena;
-            char *value_str;
-
-            getTypeOutputInfo(attr->atttypid, &typoutput, &typIsVarlena);
-            value_str = OidOutputFunctionCall(typoutput, value);
-            
-            switch(attr->atttypid){
-                case TEXTOID:
-                case VARCHAROID:
-                case BPCHAROID:
-                case TIMESTAMPOID:
-                case TIMESTAMPTZOID:
-                case DATEOID:
-                case TIMEOID:
-                case TIMETZOID:
-                    appendStringInfo(&query, "%s", quote_literal_cstr(value_str));
-                    break;
-                default:
-                    appendStringInfo(&query, "%s", value_str);
-                    break;
-            }
-        }
-    }
-    appendStringInfoString(&query, ")");
-    elog(NOTICE, "%s", query.data);
-
-    return query.data;
-}
-
 /* 
 * Top-level Functions 
 */
@@ -106,15 +47,11 @@ trigger_insert(PG_FUNCTION_ARGS)
 {
     TriggerData *trigdata = (TriggerData *) fcinfo->context;
     Relation rel;
-    char *schema_name = NULL;
-    char *table_name = NULL;
-    int hypertable_id;
-    AttrNumber time_attnum;
+    TupleDesc tupdesc;
+    HypertableInfo ht_info;
     int64 time_value;
     ChunkInfo *chunk_info;
-    char *chunk_full_name;
-    char *insert_query;
-    int ret;
+    ChunkInsertState *insert_state;
 
     // check trigger
     if(!CALLED_AS_TRIGGER(fcinfo)){
@@ -133,73 +70,93 @@ trigger_insert(PG_FUNCTION_ARGS)
         ereport(ERROR, errmsg("trigger_insert: must be a FOR EACH ROW trigger"));
     }
 
-    // fetch hypertable
+    // fetch hypertable descriptor (cached per relation, no catalog query on warm path)
     rel = trigdata->tg_relation;
-    schema_name = get_namespace_name(RelationGetNamespace(rel));
-    table_name = RelationGetRelationName(rel);
+    tupdesc = RelationGetDescr(rel);
+    if(!hypertable_cache_lookup(RelationGetRelid(rel), &ht_info)){
+        ereport(ERROR, errmsg("table \"%s.%s\" is not a hypertable",
+                              get_namespace_name(RelationGetNamespace(rel)), RelationGetRelationName(rel)));
+    }
+
+    // fetch timestamp
+    time_value = get_time_value_from_tuple(trigdata->tg_trigtuple, tupdesc, ht_info.time_attnum);
+    chunk_info = chunk_get_or_create(ht_info.hypertable_id, ht_info.chunk_interval, time_value,
+                                     dimension_slot_space_bucket(&ht_info, trigdata->tg_trigslot));
+
+    // insert tuple directly into chunk table
+    insert_state = chunk_insert_state_get(chunk_info, tupdesc, &ht_info);
+
+    // buffered per chunk, flushed when full or by trigger_insert_flush at statement end
+    chunk_insert_state_buffer(insert_state, trigdata->tg_trigslot);
+    last_value_cache_update(&ht_info, trigdata->tg_trigslot);
     
-    SPI_connect();
-    hypertable_id = metadata_get_hypertable_id(schema_name, table_name);
-    if(hypertable_id == -1){
-        ereport(ERROR, errmsg("table \"%s.%s\" is not a hypertable", schema_name, table_name));
+    return PointerGetDatum(NULL);  // since it already inserted at chunk, no need to insert again
+}
+
+// flush buffered rows and close chunk insert states once the INSERT statement is done
+PG_FUNCTION_INFO_V1(trigger_insert_flush);
+Datum
+trigger_insert_flush(PG_FUNCTION_ARGS)
+{
+    TriggerData *trigdata = (TriggerData *) fcinfo->context;
+
+    if(!CALLED_AS_TRIGGER(fcinfo)){
+        ereport(ERROR, errmsg("trigger_insert_flush: not called by trigger manager"));
     }
 
-    // find time column
-    StringInfoData query;
-    bool isnull;
-    Datum datum;
-    char *time_column_name;
+    if(!TRIGGER_FIRED_FOR_STATEMENT(trigdata->tg_event)){
+        ereport(ERROR, errmsg("trigger_insert_flush: must be a FOR EACH STATEMENT trigger"));
+    }
 
-    initStringInfo(&query);
-    appendStringInfo(&query,
-        "SELECT column_name FROM _timeseries_catalog.dimension "
-        "WHERE hypertable_id = %d", hypertable_id);
-        
-    ret = SPI_execute(query.data, true, 0);
-    if (ret != SPI_OK_SELECT || SPI_processed == 0){
-        SPI_finish();
-        ereport(ERROR, errmsg("no dimension found for hypertable %d", hypertable_id));
-    }
-
-    datum = SPI_getbinval(SPI_tuptable->vals[0], SPI_tuptable->tupdesc, 1, &isnull);
-    time_column_name = pstrdup(TextDatumGetCString(datum));
-
-    // find attribute number of time column
-    TupleDesc tupdesc = RelationGetDescr(rel);
-    time_attnum = InvalidAttrNumber;
-    for(int i=0; i<tupdesc->natts; i++){
-        Form_pg_attribute attr = TupleDescAttr(tupdesc, i);
-        if (attr->attisdropped){
-            continue;
-        }
-        
-        if (strcmp(NameStr(attr->attname), time_column_name) == 0){
-            time_attnum = attr->attnum;
-            break;
-        }
+    chunk_insert_state_close_all();
+
+    return PointerGetDatum(NULL);
+}
+
+// rows of the last value cache may be gone or changed, readers scan again after commit
+PG_FUNCTION_INFO_V1(trigger_last_value_invalidate);
+Datum
+trigger_last_value_invalidate(PG_FUNCTION_ARGS)
+{
+    TriggerData *trigdata = (TriggerData *) fcinfo->context;
+    HypertableInfo ht_info;
+
+    if(!CALLED_AS_TRIGGER(fcinfo)){
+        ereport(ERROR, errmsg("trigger_last_value_invalidate: not called by trigger manager"));
     }
-    if (time_attnum == InvalidAttrNumber){
-        ereport(ERROR, errmsg("time column \"%s\" not found", time_column_name));
+
+    if(!TRIGGER_FIRED_FOR_STATEMENT(trigdata->tg_event)){
+        ereport(ERROR, errmsg("trigger_last_value_invalidate: must be a FOR EACH STATEMENT trigger"));
     }
-    
-    // fetch timestamp
-    time_value = get_time_value_from_tuple(trigdata->tg_trigtuple, tupdesc, time_attnum);
-    chunk_info = chunk_get_or_create(hypertable_id, time_value);
-    
-    // fetch chunk
-    chunk_full_name = get_chunk_table_name(chunk_info->schema_name, chunk_info->table_name);
-    
-    // insert to chunk table
-    insert_query = build_insert_query(chunk_full_name, tupdesc, trigdata->tg_trigtuple);
-    
-    ret = SPI_execute(insert_query, false, 0);
-    if (ret != SPI_OK_INSERT){
-        SPI_finish();
-        ereport(ERROR, errmsg("failed to insert into chunk \"%s\"", chunk_full_name));
+
+    if(hypertable_cache_lookup(RelationGetRelid(trigdata->tg_relation), &ht_info)){
+        last_value_cache_invalidate(ht_info.hypertable_id);
     }
-    SPI_finish();
-    
-    return PointerGetDatum(NULL);  // since it already inserted at chunk, no need to insert again
+
+    return PointerGetDatum(NULL);
+}
+
+// updated rows may be outside the stored chunk column ranges, chunks are not skipped any more
+PG_FUNCTION_INFO_V1(trigger_chunk_skipping_invalidate);
+Datum
+trigger_chunk_skipping_invalidate(PG_FUNCTION_ARGS)
+{
+    TriggerData *trigdata = (TriggerData *) fcinfo->context;
+    HypertableInfo ht_info;
+
+    if(!CALLED_AS_TRIGGER(fcinfo)){
+        ereport(ERROR, errmsg("trigger_chunk_skipping_invalidate: not called by trigger manager"));
+    }
+
+    if(!TRIGGER_FIRED_FOR_STATEMENT(trigdata->tg_event)){
+        ereport(ERROR, errmsg("trigger_chunk_skipping_invalidate: must be a FOR EACH STATEMENT trigger"));
+    }
+
+    if(hypertable_cache_lookup(RelationGetRelid(trigdata->tg_relation), &ht_info)){
+        chunk_column_stats_invalidate(ht_info.relid, ht_info.hypertable_id);
+    }
+
+    return PointerGetDatum(NULL);
 }
 
 /* 
@@ -226,6 +183,20 @@ trigger_create_on_hypertable(const char *schema_name, const char *table_name)
     if(ret != SPI_OK_UTILITY){
         ereport(ERROR, errmsg("Failed to create insert trigger on \"%s.%s\"", schema_name, table_name));
     }
+
+    // statement trigger closes per-chunk insert states after each INSERT
+    resetStringInfo(&query);
+    appendStringInfo(&query,
+                    "CREATE TRIGGER after_insert_trigger "
+                    "AFTER INSERT ON %s.%s "
+                    "FOR EACH STATEMENT "
+                    "EXECUTE FUNCTION trigger_insert_flush()",
+                    schema_name, table_name);
+
+    ret = SPI_execute(query.data, false, 0);
+    if(ret != SPI_OK_UTILITY){
+        ereport(ERROR, errmsg("Failed to create insert flush trigger on \"%s.%s\"", schema_name, table_name));
+    }
     elog(NOTICE, "Created INSERT trigger on \"%s.%s\"", schema_name, table_name);
 }
 
@@ -247,6 +218,104 @@ trigger_drop_on_hypertable(const char *schema_name, const char *table_name)
         ereport(WARNING, errmsg("failed to drop insert trigger on \"%s.%s\"", schema_name, table_name));
         return;
     }
+
+    resetStringInfo(&query);
+    appendStringInfo(&query,
+                    "DROP TRIGGER IF EXISTS after_insert_trigger ON %s.%s",
+                    quote_identifier(schema_name), quote_identifier(table_name));
+    SPI_execute(query.data, false, 0);
+
+    trigger_drop_last_value_on_hypertable(schema_name, table_name);
+    trigger_drop_chunk_skipping_on_hypertable(schema_name, table_name);
+
     elog(NOTICE, "Dropped INSERT trigger from \"%s.%s\"", schema_name, table_name);
 }
 
+bool
+trigger_has_user_triggers(Relation rel)
+{
+    TriggerDesc *trigdesc = rel->trigdesc;
+
+    if(trigdesc == NULL) return false;
+
+    // internal triggers installed by trigger_create_on_hypertable
+    for(int i=0; i<trigdesc->numtriggers; i++){
+        const char *name = trigdesc->triggers[i].tgname;
+        if(strcmp(name, "before_insert_trigger") != 0 && strcmp(name, "after_insert_trigger") != 0 &&
+           strcmp(name, "last_value_cache_trigger") != 0 && strcmp(name, "chunk_skipping_trigger") != 0){
+            return true;
+        }
+    }
+    return false;
+}
+
+void
+trigger_create_last_value_on_hypertable(const char *schema_name, const char *table_name)
+{
+    StringInfoData query;
+    int ret;
+
+    // enable_last_value_cache() may run again with another series column
+    trigger_drop_last_value_on_hypertable(schema_name, table_name);
+
+    initStringInfo(&query);
+    appendStringInfo(&query,
+                    "CREATE TRIGGER last_value_cache_trigger "
+                    "AFTER UPDATE OR DELETE OR TRUNCATE ON %s.%s "
+                    "FOR EACH STATEMENT "
+                    "EXECUTE FUNCTION trigger_last_value_invalidate()",
+                    quote_identifier(schema_name), quote_identifier(table_name));
+
+    ret = SPI_execute(query.data, false, 0);
+    if(ret != SPI_OK_UTILITY){
+        ereport(ERROR, errmsg("Failed to create last value cache trigger on \"%s.%s\"", schema_name, table_name));
+    }
+}
+
+void
+trigger_drop_last_value_on_hypertable(const char *schema_name, const char *table_name)
+{
+    StringInfoData query;
+
+    initStringInfo(&query);
+    appendStringInfo(&query,
+                    "DROP TRIGGER IF EXISTS last_value_cache_trigger ON %s.%s",
+                    quote_identifier(schema_name), quote_identifier(table_name));
+    SPI_execute(query.data, false, 0);
+}
+
+
+void
+trigger_create_chunk_skipping_on_hypertable(const char *schema_name, const char *table_name)
+{
+    StringInfoData query;
+    int ret;
+
+    // one trigger for all chunk skipping columns
+    trigger_drop_chunk_skipping_on_hypertable(schema_name, table_name);
+
+    initStringInfo(&query);
+    appendStringInfo(&query,
+                    "CREATE TRIGGER chunk_skipping_trigger "
+                    "AFTER UPDATE ON %s.%s "
+                    "FOR EACH STATEMENT "
+                    "EXECUTE FUNCTION trigger_chunk_skipping_invalidate()",
+                    quote_identifier(schema_name), quote_identifier(table_name));
+
+    ret = SPI_execute(query.data, false, 0);
+    if(ret != SPI_OK_UTILITY){
+        ereport(ERROR, errmsg("Failed to create chunk skipping trigger on \"%s.%s\"", schema_name, table_name));
+    }
+}
+
+void
+trigger_drop_chunk_skipping_on_hypertable(const char *schema_name, const char *table_name)
+{
+    StringInfoData query;
+
+    initStringInfo(&query);
+    appendStringInfo(&query,
+                    "DROP TRIGGER IF EXISTS chunk_skipping_trigger ON %s.%s",
+                    quote_identifier(schema_name), quote_identifier(table_name));
+    SPI_execute(query.data, false, 0);
+}
@@ -1,6 +1,18 @@
 #pragma once
 
 #include <postgres.h>
+#include <utils/rel.h>
 
 extern void trigger_create_on_hypertable(const char *schema_name, const char *table_name);
 extern void trigger_drop_on_hypertable(const char *schema_name, const char *table_name);
+
+// triggers other than the ones installed by this extension, rows must then go through the executor
+extern bool trigger_has_user_triggers(Relation rel);
+
+// statement trigger clearing the last value cache on UPDATE, DELETE and TRUNCATE
+extern void trigger_create_last_value_on_hypertable(const char *schema_name, const char *table_name);
+extern void trigger_drop_last_value_on_hypertable(const char *schema_name, const char *table_name);
+
+// statement trigger invalidating the chunk column ranges on UPDATE
+extern void trigger_create_chunk_skipping_on_hypertable(const char *schema_name, const char *table_name);
+extern void trigger_drop_chunk_skipping_on_hypertable(const char *schema_name, const char *table_name);
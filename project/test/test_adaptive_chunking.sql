@@ -0,0 +1,69 @@
+DROP TABLE IF EXISTS sensor_data CASCADE;
+CREATE TABLE sensor_data (
+    time TIMESTAMPTZ NOT NULL,
+    sensor_id INTEGER,
+    temperature DOUBLE PRECISION,
+    payload TEXT
+);
+
+SELECT create_hypertable('sensor_data', 'time', INTERVAL '1 hour');
+
+-- return 1048576
+SELECT set_adaptive_chunking('sensor_data', '1MB');
+
+\echo 'High rate hour, then the rate continues...'
+
+-- about 3MB in the first hour
+INSERT INTO sensor_data
+SELECT '2024-01-01 00:00:00+00'::timestamptz + (i * INTERVAL '100 milliseconds'), i % 10, 20.0, repeat('x', 60)
+FROM generate_series(0, 35999) AS i;
+
+INSERT INTO sensor_data
+SELECT '2024-01-01 01:00:00+00'::timestamptz + (i * INTERVAL '100 milliseconds'), i % 10, 20.0, repeat('x', 60)
+FROM generate_series(0, 35999) AS i;
+
+-- chunks after the first one are shorter than 1 hour
+SELECT table_name,
+       (end_time - start_time) / 1000000 AS interval_seconds
+FROM _timeseries_catalog.chunk
+ORDER BY start_time;
+
+-- interval of the next chunk
+SELECT interval_length / 1000000 AS interval_seconds, chunk_target_size
+FROM _timeseries_catalog.dimension d
+JOIN _timeseries_catalog.hypertable h ON h.id = d.hypertable_id
+WHERE h.table_name = 'sensor_data';
+
+-- chunk ranges never overlap, return 0
+SELECT COUNT(*)
+FROM _timeseries_catalog.chunk a
+JOIN _timeseries_catalog.chunk b
+  ON a.hypertable_id = b.hypertable_id AND a.space_bucket = b.space_bucket AND a.id < b.id
+ AND a.start_time < b.end_time AND b.start_time < a.end_time;
+
+-- every row routed, return 72000
+SELECT COUNT(*) FROM sensor_data;
+
+-- parent table must return 0
+SELECT COUNT(*) FROM ONLY sensor_data;
+
+-- ==========================================
+-- Test Pruning on variable width chunks
+-- ==========================================
+EXPLAIN (COSTS OFF)
+SELECT * FROM sensor_data
+WHERE time >= '2024-01-01 01:30:00+00' AND time < '2024-01-01 01:40:00+00';
+-- output must scan only the chunk(s) covering 01:30 - 01:40
+
+\echo 'Settings...'
+
+-- return a quarter of shared_buffers
+SELECT set_adaptive_chunking('sensor_data', 'estimate');
+
+-- return 0
+SELECT set_adaptive_chunking('sensor_data', 'off');
+
+-- too small, must fail
+SELECT set_adaptive_chunking('sensor_data', '10kB');
+
+SELECT drop_hypertable('sensor_data');
@@ -0,0 +1,86 @@
+DROP TABLE IF EXISTS sensor_data CASCADE;
+CREATE TABLE sensor_data (
+    time TIMESTAMPTZ NOT NULL,
+    sensor_id INTEGER,
+    temperature DOUBLE PRECISION,
+    humidity DOUBLE PRECISION
+);
+
+SELECT create_hypertable('sensor_data', 'time', INTERVAL '1 day');
+
+\echo '30 days of rows every minute, 30 chunks...'
+
+INSERT INTO sensor_data
+SELECT '2024-01-01 00:00:00+00'::timestamptz + (i * INTERVAL '1 minute'), i % 10, i % 40, 50.0
+FROM generate_series(0, 30 * 1440 - 1) AS i;
+
+ANALYZE sensor_data;
+
+-- ==========================================
+-- Test partial aggregation per chunk
+-- ==========================================
+SET max_parallel_workers_per_gather = 0;
+
+EXPLAIN (COSTS OFF)
+SELECT time_bucket('1 day', time), count(*), avg(temperature)
+FROM sensor_data GROUP BY 1;
+-- output must show Finalize HashAggregate -> Append -> Partial HashAggregate per chunk
+
+-- 30 days of 1440 rows, return 30, 1440, 1440, 19.5
+SELECT count(*), min(n), max(n), max(avg_temperature)
+FROM (
+    SELECT time_bucket('1 day', time), count(*) AS n, avg(temperature) AS avg_temperature
+    FROM sensor_data GROUP BY 1
+) AS daily;
+
+-- ==========================================
+-- Test parallel workers
+-- ==========================================
+SET max_parallel_workers_per_gather = 4;
+SET parallel_setup_cost = 0;
+SET parallel_tuple_cost = 0;
+SET min_parallel_table_scan_size = 0;
+
+EXPLAIN (COSTS OFF)
+SELECT sensor_id, max(temperature), sum(humidity)
+FROM sensor_data GROUP BY sensor_id;
+-- output must show Finalize HashAggregate -> Gather -> Parallel Append -> Partial HashAggregate per chunk
+
+-- same groups as aggregating above the Append, return 0
+SELECT count(*) FROM (
+    (SELECT sensor_id, max(temperature), sum(humidity) FROM sensor_data GROUP BY sensor_id)
+    EXCEPT
+    (SELECT sensor_id, max(temperature), sum(humidity) FROM (SELECT * FROM sensor_data OFFSET 0) AS s GROUP BY sensor_id)
+) AS diff;
+
+-- HAVING is applied after combining the chunks, return 10
+SELECT count(*) FROM (
+    SELECT sensor_id FROM sensor_data GROUP BY sensor_id HAVING count(*) = 4320
+) AS busy;
+
+-- aggregate without GROUP BY, return 43200
+SELECT count(*) FROM sensor_data;
+
+\echo 'Time quals only known at execution keep ChunkAppend...'
+
+EXPLAIN (COSTS OFF)
+SELECT time_bucket('1 hour', time), avg(temperature)
+FROM sensor_data WHERE time > now() - INTERVAL '1 day' GROUP BY 1;
+-- output must show no Partial HashAggregate per chunk
+
+\echo 'Turned off...'
+
+SET simple_timeseries.enable_chunkwise_aggregation = off;
+
+EXPLAIN (COSTS OFF)
+SELECT time_bucket('1 day', time), count(*)
+FROM sensor_data GROUP BY 1;
+-- output must show the aggregate above the Append (or Parallel Append) of chunk scans
+
+RESET simple_timeseries.enable_chunkwise_aggregation;
+RESET max_parallel_workers_per_gather;
+RESET parallel_setup_cost;
+RESET parallel_tuple_cost;
+RESET min_parallel_table_scan_size;
+
+DROP TABLE sensor_data CASCADE;
@@ -0,0 +1,94 @@
+DROP TABLE IF EXISTS sensor_data CASCADE;
+CREATE TABLE sensor_data (
+    time TIMESTAMPTZ NOT NULL,
+    sensor_id INTEGER,
+    temperature DOUBLE PRECISION,
+    humidity DOUBLE PRECISION
+);
+
+SELECT create_hypertable('sensor_data', 'time', INTERVAL '1 hour');
+
+\echo 'Last 24 hours every 10 minutes, one chunk per hour...'
+
+INSERT INTO sensor_data
+SELECT date_trunc('hour', now()) - (i * INTERVAL '10 minutes'), i % 4, 20.0, 50.0
+FROM generate_series(0, 143) AS i;
+
+-- ==========================================
+-- Test startup exclusion (now())
+-- ==========================================
+EXPLAIN (ANALYZE, COSTS OFF, TIMING OFF, SUMMARY OFF)
+SELECT * FROM sensor_data
+WHERE time > now() - INTERVAL '2 hours';
+-- output must show Custom Scan (ChunkAppend) with most chunks excluded during startup
+
+-- same rows as with constants, return true
+SELECT (SELECT COUNT(*) FROM sensor_data WHERE time > now() - INTERVAL '2 hours') =
+       (SELECT COUNT(*) FROM sensor_data WHERE time > (SELECT now() - INTERVAL '2 hours'));
+
+\echo 'Generic plan of a prepared statement...'
+
+SET plan_cache_mode = force_generic_plan;
+
+PREPARE since(timestamptz) AS
+SELECT COUNT(*) FROM sensor_data WHERE time >= $1;
+
+EXPLAIN (ANALYZE, COSTS OFF, TIMING OFF, SUMMARY OFF)
+EXECUTE since(date_trunc('hour', now()) - INTERVAL '1 hour');
+-- output must exclude all but 2 chunks during startup
+
+-- return 7
+EXECUTE since(date_trunc('hour', now()) - INTERVAL '1 hour');
+
+DEALLOCATE since;
+RESET plan_cache_mode;
+
+\echo 'Custom plan of a prepared statement excludes at plan time...'
+
+SET plan_cache_mode = force_custom_plan;
+
+PREPARE since(timestamptz) AS
+SELECT COUNT(*) FROM sensor_data WHERE time >= $1;
+
+EXPLAIN (COSTS OFF)
+EXECUTE since(date_trunc('hour', now()) - INTERVAL '1 hour');
+-- output must plan sensor_data and 2 chunks, no ChunkAppend
+
+DEALLOCATE since;
+RESET plan_cache_mode;
+
+-- ==========================================
+-- Test runtime exclusion (nested loop)
+-- ==========================================
+DROP TABLE IF EXISTS windows;
+CREATE TABLE windows (window_start TIMESTAMPTZ);
+INSERT INTO windows VALUES
+    (date_trunc('hour', now()) - INTERVAL '3 hours'),
+    (date_trunc('hour', now()) - INTERVAL '10 hours');
+
+SET enable_hashjoin = off;
+SET enable_mergejoin = off;
+
+EXPLAIN (ANALYZE, COSTS OFF, TIMING OFF, SUMMARY OFF)
+SELECT w.window_start, d.n
+FROM windows w,
+LATERAL (
+    SELECT COUNT(*) AS n FROM sensor_data
+    WHERE time >= w.window_start AND time < w.window_start + INTERVAL '1 hour'
+) d;
+-- output must show chunks excluded during runtime
+
+-- every window holds 6 rows
+SELECT w.window_start = date_trunc('hour', now()) - INTERVAL '3 hours' AS latest, d.n
+FROM windows w,
+LATERAL (
+    SELECT COUNT(*) AS n FROM sensor_data
+    WHERE time >= w.window_start AND time < w.window_start + INTERVAL '1 hour'
+) d
+ORDER BY 1;
+
+RESET enable_hashjoin;
+RESET enable_mergejoin;
+
+DROP TABLE windows;
+DROP TABLE sensor_data CASCADE;
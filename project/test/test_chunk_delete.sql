@@ -0,0 +1,105 @@
+DROP TABLE IF EXISTS sensor_data CASCADE;
+CREATE TABLE sensor_data (
+    time TIMESTAMPTZ NOT NULL,
+    sensor_id INTEGER,
+    temperature DOUBLE PRECISION,
+    humidity DOUBLE PRECISION
+);
+
+SELECT create_hypertable('sensor_data', 'time', INTERVAL '1 day');
+
+\echo '10 days of hourly rows, 10 chunks...'
+
+INSERT INTO sensor_data
+SELECT '2024-01-01 00:00:00+00'::timestamptz + (i * INTERVAL '1 hour'), i % 10, 20.0, 50.0
+FROM generate_series(0, 10 * 24 - 1) AS i;
+
+-- ==========================================
+-- Test whole chunks are dropped
+-- ==========================================
+EXPLAIN (COSTS OFF)
+DELETE FROM sensor_data WHERE time < '2024-01-03 12:00:00+00';
+-- output must show a plain Delete, dropping chunks is opt-in
+
+SET simple_timeseries.delete_drops_chunks = on;
+
+EXPLAIN (COSTS OFF)
+DELETE FROM sensor_data WHERE time < '2024-01-03 12:00:00+00';
+-- output must show Custom Scan (ChunkDelete) with Chunks to drop: 2, and only the 2024-01-03 chunk deleted row by row
+
+DELETE FROM sensor_data WHERE time < '2024-01-03 12:00:00+00';
+
+-- return 8
+SELECT COUNT(*) FROM _timeseries_catalog.chunk;
+
+-- half of 2024-01-03 is left, return 12, 2024-01-03 12:00:00+00
+SELECT COUNT(*), min(time) FROM sensor_data WHERE time < '2024-01-04';
+
+-- chunks are created again for new rows, return 1
+INSERT INTO sensor_data VALUES ('2024-01-01 10:00:00+00', 1, 20.0, 50.0);
+SELECT COUNT(*) FROM sensor_data WHERE time < '2024-01-02';
+
+\echo 'Range in the middle, BETWEEN...'
+
+EXPLAIN (ANALYZE, COSTS OFF, TIMING OFF, SUMMARY OFF)
+DELETE FROM sensor_data WHERE time BETWEEN '2024-01-05 00:00:00+00' AND '2024-01-06 23:59:59.999999+00';
+-- output must show Chunks dropped: 2
+
+-- return 0
+SELECT COUNT(*) FROM sensor_data WHERE time >= '2024-01-05 00:00:00+00' AND time < '2024-01-07 00:00:00+00';
+
+\echo 'Row deletes only...'
+
+-- other qual, rows are deleted one by one, return 22
+DELETE FROM sensor_data WHERE time >= '2024-01-07' AND time < '2024-01-08' AND sensor_id < 1;
+SELECT COUNT(*) FROM sensor_data WHERE time >= '2024-01-07' AND time < '2024-01-08';
+
+-- RETURNING needs the rows
+EXPLAIN (COSTS OFF)
+DELETE FROM sensor_data WHERE time >= '2024-01-08' AND time < '2024-01-09' RETURNING time;
+-- output must show a plain Delete
+
+-- return 24
+WITH deleted AS (
+    DELETE FROM sensor_data WHERE time >= '2024-01-08' AND time < '2024-01-09' RETURNING *
+)
+SELECT COUNT(*) FROM deleted;
+
+-- a view on the 2024-01-10 chunk keeps it
+SELECT format('CREATE VIEW chunk_view AS SELECT * FROM %I.%I', schema_name, table_name)
+FROM _timeseries_catalog.chunk
+ORDER BY start_time DESC LIMIT 1 \gexec
+
+EXPLAIN (COSTS OFF)
+DELETE FROM sensor_data WHERE time >= '2024-01-09';
+-- output must show Chunks to drop: 1, the 2024-01-10 chunk deleted row by row
+
+-- return 24
+SELECT COUNT(*) FROM chunk_view;
+DELETE FROM sensor_data WHERE time >= '2024-01-09';
+-- return 0
+SELECT COUNT(*) FROM chunk_view;
+DROP VIEW chunk_view;
+
+SET simple_timeseries.delete_drops_chunks = off;
+
+EXPLAIN (COSTS OFF)
+DELETE FROM sensor_data WHERE time < '2024-01-05';
+-- output must show a plain Delete
+
+SET simple_timeseries.delete_drops_chunks = on;
+
+\echo 'Rollback restores dropped chunks...'
+
+BEGIN;
+DELETE FROM sensor_data;
+-- return 0
+SELECT COUNT(*) FROM sensor_data;
+ROLLBACK;
+
+-- return 59
+SELECT COUNT(*) FROM sensor_data;
+
+RESET simple_timeseries.delete_drops_chunks;
+
+DROP TABLE sensor_data CASCADE;
@@ -0,0 +1,73 @@
+DROP TABLE IF EXISTS sensor_data CASCADE;
+CREATE TABLE sensor_data (
+    time TIMESTAMPTZ NOT NULL,
+    sensor_id INTEGER,
+    temperature DOUBLE PRECISION,
+    humidity DOUBLE PRECISION
+);
+
+SELECT create_hypertable('sensor_data', 'time', INTERVAL '1 day');
+
+\echo 'INSERT plan must use ChunkDispatch instead of ModifyTable...'
+EXPLAIN (COSTS OFF)
+INSERT INTO sensor_data VALUES ('2024-01-01 00:00:00+00', 1, 25.5, 60.0);
+
+\echo 'Command tag must report inserted rows (INSERT 0 3)...'
+INSERT INTO sensor_data VALUES
+    ('2024-01-01 06:00:00+00', 1, 26.0, 61.0),
+    ('2024-01-01 12:00:00+00', 2, 27.5, 62.0),
+    ('2024-01-02 18:00:00+00', 1, 25.0, 59.0);
+
+\echo 'RETURNING must return inserted rows...'
+INSERT INTO sensor_data VALUES ('2024-01-03 08:00:00+00', 3, 24.0, 58.0)
+RETURNING *;
+
+INSERT INTO sensor_data (time, sensor_id) VALUES ('2024-01-03 09:00:00+00', 4)
+RETURNING sensor_id, time_bucket('1 day', time) AS bucket;
+
+WITH inserted AS (
+    INSERT INTO sensor_data
+    SELECT '2024-01-04 00:00:00+00'::timestamptz + (i * INTERVAL '1 hour'), i, 20.0, 50.0
+    FROM generate_series(0, 47) AS i
+    RETURNING time
+)
+SELECT COUNT(*) FROM inserted; -- return 48
+
+-- rows of an INSERT in WITH are written even when the outer query does not read them
+WITH inserted AS (
+    INSERT INTO sensor_data VALUES ('2024-01-06 00:00:00+00', 5, 20.0, 50.0)
+    RETURNING time
+)
+SELECT 1;
+
+-- parent table must return 0
+SELECT COUNT(*) FROM ONLY sensor_data;
+
+-- return 54
+SELECT COUNT(*) FROM sensor_data;
+
+
+\echo 'ON CONFLICT must fail...'
+INSERT INTO sensor_data VALUES ('2024-01-01 00:00:00+00', 1, 25.5, 60.0)
+ON CONFLICT DO NOTHING;
+
+-- return 54
+SELECT COUNT(*) FROM sensor_data;
+
+
+\echo 'Hypertable with user trigger falls back to trigger routing...'
+CREATE FUNCTION sensor_data_audit() RETURNS TRIGGER AS $$
+BEGIN
+    RAISE NOTICE 'audit: %', NEW.time;
+    RETURN NEW;
+END;
+$$ LANGUAGE plpgsql;
+
+CREATE TRIGGER a_audit BEFORE INSERT ON sensor_data FOR EACH ROW EXECUTE FUNCTION sensor_data_audit();
+
+EXPLAIN (COSTS OFF)
+INSERT INTO sensor_data VALUES ('2024-01-05 00:00:00+00', 1, 25.5, 60.0);
+INSERT INTO sensor_data VALUES ('2024-01-05 00:00:00+00', 1, 25.5, 60.0);
+
+DROP TRIGGER a_audit ON sensor_data;
+DROP FUNCTION sensor_data_audit();
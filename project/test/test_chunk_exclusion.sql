@@ -0,0 +1,98 @@
+DROP TABLE IF EXISTS sensor_data CASCADE;
+CREATE TABLE sensor_data (
+    time TIMESTAMPTZ NOT NULL,
+    sensor_id INTEGER,
+    temperature DOUBLE PRECISION,
+    humidity DOUBLE PRECISION
+);
+
+SELECT create_hypertable('sensor_data', 'time', INTERVAL '1 day');
+
+\echo 'One year of hourly rows, 366 chunks...'
+
+INSERT INTO sensor_data
+SELECT '2024-01-01 00:00:00+00'::timestamptz + (i * INTERVAL '1 hour'), i % 10, 20.0, 50.0
+FROM generate_series(0, 366 * 24 - 1) AS i;
+
+-- return 366
+SELECT COUNT(*) FROM _timeseries_catalog.chunk;
+
+-- ==========================================
+-- Test catalog driven exclusion
+-- ==========================================
+EXPLAIN (COSTS OFF)
+SELECT * FROM sensor_data
+WHERE time >= '2024-06-01' AND time < '2024-06-03';
+-- output must scan sensor_data (parent) and 2 chunks only
+
+EXPLAIN (COSTS OFF)
+SELECT * FROM sensor_data
+WHERE time = '2024-03-15 12:00:00+00';
+-- output must scan a single chunk
+
+EXPLAIN (COSTS OFF)
+SELECT * FROM sensor_data
+WHERE '2024-12-30' <= time;
+-- constant on the left, output must scan the last 2 chunks
+
+EXPLAIN (COSTS OFF)
+SELECT * FROM sensor_data
+WHERE time BETWEEN '2024-02-01' AND '2024-02-02';
+-- BETWEEN is two quals, output must scan 2 chunks
+
+-- return 48
+SELECT COUNT(*) FROM sensor_data
+WHERE time >= '2024-06-01' AND time < '2024-06-03';
+
+-- outside of every chunk, only the parent is scanned, return 0
+SELECT COUNT(*) FROM sensor_data WHERE time >= '2030-01-01';
+
+\echo 'Inner join quals restrict, outer join ON does not...'
+
+DROP TABLE IF EXISTS sensors;
+CREATE TABLE sensors (id INTEGER, name TEXT);
+INSERT INTO sensors SELECT i, 'sensor ' || i FROM generate_series(0, 9) AS i;
+
+EXPLAIN (COSTS OFF)
+SELECT s.name, d.temperature
+FROM sensors s JOIN sensor_data d ON d.sensor_id = s.id AND d.time >= '2024-12-31';
+-- output must scan 1 chunk
+
+-- return 24
+SELECT COUNT(*)
+FROM sensors s JOIN sensor_data d ON d.sensor_id = s.id AND d.time >= '2024-12-31';
+
+-- preserved side keeps every row, return 8784
+SELECT COUNT(*)
+FROM sensor_data d LEFT JOIN sensors s ON d.sensor_id = s.id AND d.time >= '2024-12-31';
+
+\echo 'Falls back to inheritance...'
+
+-- tableoid needs the relation itself, return 1
+SELECT COUNT(DISTINCT tableoid) FROM sensor_data
+WHERE time >= '2024-06-01' AND time < '2024-06-02';
+
+-- no usable qual (output must scan all chunks)
+SELECT COUNT(*) FROM sensor_data WHERE temperature > 0;
+
+\echo 'Cached plans see new and dropped chunks...'
+
+PREPARE recent AS SELECT COUNT(*) FROM sensor_data WHERE time >= '2024-12-31';
+-- return 24
+EXECUTE recent;
+
+INSERT INTO sensor_data VALUES ('2025-01-01 10:00:00+00', 1, 25.0, 50.0);
+-- new chunk, return 25
+EXECUTE recent;
+
+-- drop the 2024-12-31 chunk table
+SELECT format('DROP TABLE %I.%I', schema_name, table_name)
+FROM _timeseries_catalog.chunk
+ORDER BY start_time DESC OFFSET 1 LIMIT 1 \gexec
+-- dropped chunk, return 1
+EXECUTE recent;
+
+DEALLOCATE recent;
+
+DROP TABLE sensors;
+DROP TABLE sensor_data CASCADE;
@@ -0,0 +1,41 @@
+DROP TABLE IF EXISTS sensor_data CASCADE;
+
+CREATE TABLE sensor_data (
+    time      TIMESTAMPTZ NOT NULL,
+    sensor_id INTEGER,
+    value     DOUBLE PRECISION
+);
+
+SELECT create_hypertable('sensor_data', 'time', INTERVAL '1 hour');
+
+-- =============================================
+-- Pre-create current and upcoming chunks
+-- =============================================
+
+SELECT set_chunk_precreate_policy('sensor_data', 3);
+
+-- return 3 (current hour + 2 upcoming)
+SELECT apply_chunk_precreate_policies();
+
+-- return 0, chunks already exist
+SELECT apply_chunk_precreate_policies();
+
+SELECT count(*) AS precreated_chunks FROM _timeseries_catalog.chunk c
+JOIN _timeseries_catalog.hypertable h ON h.id = c.hypertable_id
+WHERE h.table_name = 'sensor_data'; -- return 3
+
+-- insert into the current hour does not create a chunk (no NOTICE)
+INSERT INTO sensor_data VALUES (NOW(), 1, 10.0);
+
+SELECT count(*) AS chunks_after_insert FROM _timeseries_catalog.chunk c
+JOIN _timeseries_catalog.hypertable h ON h.id = c.hypertable_id
+WHERE h.table_name = 'sensor_data'; -- return 3
+
+-- =============================================
+-- Remove policy
+-- =============================================
+
+SELECT remove_chunk_precreate_policy('sensor_data');
+
+-- return 0
+SELECT count(*) FROM _timeseries_catalog.precreate_policies;
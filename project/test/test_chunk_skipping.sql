@@ -0,0 +1,114 @@
+DROP TABLE IF EXISTS sensor_data CASCADE;
+CREATE TABLE sensor_data (
+    time TIMESTAMPTZ NOT NULL,
+    seq BIGINT,
+    device_id INTEGER,
+    temperature DOUBLE PRECISION,
+    location TEXT
+);
+
+SELECT create_hypertable('sensor_data', 'time', INTERVAL '1 day');
+
+\echo '10 days of rows every minute, seq grows with time, 10 chunks...'
+
+-- chunk of day d has seq d*1440 .. d*1440+1439, device_id d*10 .. d*10+9
+INSERT INTO sensor_data
+SELECT '2024-01-01 00:00:00+00'::timestamptz + (i * INTERVAL '1 minute'), i, (i / 1440) * 10 + i % 10, 20.0, 'lab'
+FROM generate_series(0, 10 * 1440 - 1) AS i;
+
+-- ==========================================
+-- Test enable
+-- ==========================================
+SELECT enable_chunk_skipping('sensor_data', 'seq');
+SELECT enable_chunk_skipping('sensor_data', 'device_id');
+
+-- ranges of existing chunks are computed, return 20
+SELECT count(*) FROM _timeseries_catalog.chunk_column_stats WHERE valid;
+
+-- error: collation
+SELECT enable_chunk_skipping('sensor_data', 'location');
+
+-- error: time column
+SELECT enable_chunk_skipping('sensor_data', 'time');
+
+-- ==========================================
+-- Test exclusion on non-time columns
+-- ==========================================
+EXPLAIN (COSTS OFF)
+SELECT * FROM sensor_data WHERE seq = 5000;
+-- output must scan sensor_data (parent) and the chunk of 2024-01-04 only
+
+-- return 1
+SELECT count(*) FROM sensor_data WHERE seq = 5000;
+
+EXPLAIN (COSTS OFF)
+SELECT * FROM sensor_data WHERE seq >= 12960;
+-- output must scan the chunk of 2024-01-10 only (and the parent)
+
+-- constant on the left, cross-type (integer constant, bigint column), return 1440
+SELECT count(*) FROM sensor_data WHERE 12960 <= seq;
+
+-- device 42 is only in the chunk of 2024-01-05, return 144
+SELECT count(*) FROM sensor_data WHERE device_id = 42;
+
+-- together with time, return 0 (device 42 is not on 2024-01-06)
+SELECT count(*) FROM sensor_data WHERE device_id = 42 AND time >= '2024-01-06 00:00:00+00';
+
+-- ==========================================
+-- Test insert widens ranges
+-- ==========================================
+PREPARE seq_count(BIGINT) AS SELECT count(*) FROM sensor_data WHERE seq = $1;
+
+-- return 0
+EXECUTE seq_count(999999);
+
+INSERT INTO sensor_data VALUES ('2024-01-02 12:00:00+00', 999999, 1, 20.0, 'lab');
+
+-- chunk of 2024-01-02 grew, cached plan is replanned, return 1
+EXECUTE seq_count(999999);
+SELECT count(*) FROM sensor_data WHERE seq = 999999;
+
+-- COPY goes through the same path, return 1
+COPY sensor_data FROM STDIN;
+2024-01-03 12:00:00+00	777777	1	20.0	lab
+\.
+SELECT count(*) FROM sensor_data WHERE seq = 777777;
+
+-- new chunk gets a range on its first insert, return 1, 1
+INSERT INTO sensor_data VALUES ('2024-01-20 12:00:00+00', 500000, 1, 20.0, 'lab');
+SELECT count(*) FROM _timeseries_catalog.chunk_column_stats
+WHERE column_name = 'seq' AND chunk_id = (SELECT max(id) FROM _timeseries_catalog.chunk);
+SELECT count(*) FROM sensor_data WHERE seq = 500000;
+
+-- NULL only chunk is skipped, return 0
+INSERT INTO sensor_data VALUES ('2024-01-25 12:00:00+00', NULL, NULL, 20.0, 'lab');
+SELECT count(*) FROM sensor_data WHERE seq > 0 AND time >= '2024-01-25 00:00:00+00';
+
+-- ==========================================
+-- Test UPDATE invalidates
+-- ==========================================
+UPDATE sensor_data SET seq = 888888 WHERE seq = 5000;
+
+-- return 0
+SELECT count(*) FROM _timeseries_catalog.chunk_column_stats WHERE valid;
+
+-- nothing is skipped, still correct, return 1
+SELECT count(*) FROM sensor_data WHERE seq = 888888;
+
+-- recompute, return 1 (and ranges valid again)
+SELECT enable_chunk_skipping('sensor_data', 'seq');
+SELECT count(*) FROM sensor_data WHERE seq = 888888;
+
+-- ==========================================
+-- Test disable
+-- ==========================================
+SELECT disable_chunk_skipping('sensor_data', 'seq');
+SELECT disable_chunk_skipping('sensor_data', 'device_id');
+
+-- return 0, 0
+SELECT count(*) FROM _timeseries_catalog.chunk_column_stats;
+SELECT count(*) FROM _timeseries_catalog.chunk_skipping_column;
+
+-- Cleanup
+DEALLOCATE seq_count;
+DROP TABLE sensor_data CASCADE;
@@ -0,0 +1,98 @@
+DROP TABLE IF EXISTS sensor_data CASCADE;
+CREATE TABLE sensor_data (
+    time TIMESTAMPTZ NOT NULL,
+    sensor_id INTEGER,
+    temperature DOUBLE PRECISION,
+    humidity DOUBLE PRECISION
+);
+
+SELECT create_hypertable('sensor_data', 'time', INTERVAL '1 day');
+
+\echo 'COPY rows spanning 3 days...'
+
+COPY sensor_data FROM STDIN WITH (FORMAT csv);
+2024-01-01 00:00:00+00,1,25.5,60.0
+2024-01-01 12:00:00+00,2,27.5,62.0
+2024-01-02 10:00:00+00,3,28.0,63.0
+2024-01-03 08:00:00+00,1,24.0,58.0
+\.
+
+-- parent table must return 0
+SELECT COUNT(*) FROM ONLY sensor_data;
+
+-- return 4 (child included)
+SELECT COUNT(*) FROM sensor_data;
+
+-- 3 chunks created
+SELECT table_name FROM _timeseries_catalog.chunk ORDER BY start_time;
+
+
+\echo 'COPY with column list (missing columns use default)...'
+
+COPY sensor_data (time, sensor_id) FROM STDIN WITH (FORMAT csv);
+2024-01-03 09:00:00+00,4
+\.
+
+SELECT * FROM sensor_data WHERE sensor_id = 4;
+
+
+\echo 'COPY into hypertable with a user trigger fires the trigger...'
+
+CREATE TABLE copy_trigger_log (sensor_id INTEGER);
+CREATE FUNCTION copy_trigger_log_row() RETURNS trigger AS $$
+BEGIN
+    INSERT INTO copy_trigger_log VALUES (NEW.sensor_id);
+    RETURN NEW;
+END $$ LANGUAGE plpgsql;
+CREATE TRIGGER a_copy_trigger BEFORE INSERT ON sensor_data FOR EACH ROW EXECUTE FUNCTION copy_trigger_log_row();
+
+COPY sensor_data (time, sensor_id) FROM STDIN WITH (FORMAT csv);
+2024-01-03 10:00:00+00,5
+\.
+
+-- return 5
+SELECT * FROM copy_trigger_log;
+-- return 1
+SELECT COUNT(*) FROM sensor_data WHERE sensor_id = 5;
+
+DROP TRIGGER a_copy_trigger ON sensor_data;
+DROP FUNCTION copy_trigger_log_row();
+DROP TABLE copy_trigger_log;
+
+
+\echo 'COPY with column privileges only...'
+
+CREATE ROLE copy_column_user;
+GRANT INSERT (time, sensor_id) ON sensor_data TO copy_column_user;
+SET ROLE copy_column_user;
+COPY sensor_data (time, sensor_id) FROM STDIN WITH (FORMAT csv);
+2024-01-03 11:00:00+00,6
+\.
+-- permission denied
+COPY sensor_data (time, sensor_id, temperature) FROM STDIN WITH (FORMAT csv);
+2024-01-03 12:00:00+00,6,20.0
+\.
+RESET ROLE;
+-- return 1
+SELECT COUNT(*) FROM sensor_data WHERE sensor_id = 6;
+REVOKE ALL ON sensor_data FROM copy_column_user;
+DROP ROLE copy_column_user;
+
+
+\echo 'Bulk COPY from generated file...'
+
+COPY (
+    SELECT '2024-02-01 00:00:00+00'::timestamptz + (i * INTERVAL '1 minute'), i % 10, 20.0, 50.0
+    FROM generate_series(0, 99999) AS i
+) TO '/tmp/sensor_data.csv' WITH (FORMAT csv);
+
+COPY sensor_data FROM '/tmp/sensor_data.csv' WITH (FORMAT csv);
+
+-- return 100000
+SELECT COUNT(*) FROM sensor_data WHERE time >= '2024-02-01';
+
+
+\echo 'NULL time must fail...'
+COPY sensor_data FROM STDIN WITH (FORMAT csv);
+,1,25.5,60.0
+\.
@@ -0,0 +1,92 @@
+-- ==========================================
+-- Hypertable with gaps
+-- ==========================================
+DROP TABLE IF EXISTS sensor_data CASCADE;
+CREATE TABLE sensor_data (
+    time TIMESTAMPTZ NOT NULL,
+    sensor_id INTEGER,
+    temperature DOUBLE PRECISION
+);
+
+SELECT create_hypertable('sensor_data', 'time', INTERVAL '1 day');
+
+-- sensor 1: 00:00 = 10, 03:00 = 40 ; sensor 2: 01:00 = 5
+INSERT INTO sensor_data VALUES
+    ('2024-01-01 00:10:00+00', 1, 10),
+    ('2024-01-01 00:20:00+00', 1, 10),
+    ('2024-01-01 03:30:00+00', 1, 40),
+    ('2024-01-01 01:15:00+00', 2, 5);
+ANALYZE sensor_data;
+
+-- ==========================================
+-- Test missing buckets
+-- ==========================================
+-- range from WHERE, one group
+-- return 6 rows 00:00 .. 05:00: count 2, NULL, NULL, 1, NULL, NULL for sensor 1
+SELECT time_bucket_gapfill('1 hour', time) AS hour, count(*)
+FROM sensor_data
+WHERE sensor_id = 1 AND time >= '2024-01-01 00:00:00+00' AND time < '2024-01-01 06:00:00+00'
+GROUP BY hour
+ORDER BY hour;
+
+-- range from arguments, per sensor, return 12 rows (6 per sensor)
+SELECT time_bucket_gapfill('1 hour', time, '2024-01-01 00:00:00+00', '2024-01-01 06:00:00+00') AS hour,
+       sensor_id, avg(temperature)
+FROM sensor_data
+GROUP BY hour, sensor_id
+ORDER BY sensor_id, hour;
+
+-- finish included with <=, return 7 rows 00:00 .. 06:00
+SELECT count(*) FROM (
+    SELECT time_bucket_gapfill('1 hour', time) AS hour, count(*)
+    FROM sensor_data
+    WHERE time >= '2024-01-01 00:00:00+00' AND time <= '2024-01-01 06:00:00+00'
+    GROUP BY hour
+) s;
+
+-- ==========================================
+-- Test locf and interpolate
+-- ==========================================
+-- sensor 1
+-- locf: 10, 10, 10, 40, 40, 40
+-- interpolate: 10, 20, 30, 40, NULL, NULL
+SELECT time_bucket_gapfill('1 hour', time) AS hour,
+       avg(temperature), locf(avg(temperature)), interpolate(avg(temperature))
+FROM sensor_data
+WHERE sensor_id = 1 AND time >= '2024-01-01 00:00:00+00' AND time < '2024-01-01 06:00:00+00'
+GROUP BY hour
+ORDER BY hour;
+
+-- sensor 2 has nothing before 01:00: locf NULL at 00:00, 5 after
+SELECT time_bucket_gapfill('1 hour', time) AS hour, sensor_id, locf(avg(temperature))
+FROM sensor_data
+WHERE time >= '2024-01-01 00:00:00+00' AND time < '2024-01-01 04:00:00+00'
+GROUP BY hour, sensor_id
+ORDER BY sensor_id, hour;
+
+-- ==========================================
+-- Test plan
+-- ==========================================
+EXPLAIN (COSTS OFF)
+SELECT time_bucket_gapfill('1 hour', time) AS hour, sensor_id, avg(temperature)
+FROM sensor_data
+WHERE time >= '2024-01-01 00:00:00+00' AND time < '2024-01-02 00:00:00+00'
+GROUP BY hour, sensor_id;
+-- output must show Custom Scan (GapFill) over a Sort (or sorted aggregation) by sensor_id, hour
+
+-- no rows at all, return 24 rows with count NULL
+SELECT count(*) FROM (
+    SELECT time_bucket_gapfill('1 hour', time) AS hour, count(*)
+    FROM sensor_data
+    WHERE time >= '2024-02-01 00:00:00+00' AND time < '2024-02-02 00:00:00+00'
+    GROUP BY hour
+) s;
+
+-- outside GROUP BY it is time_bucket, return 2024-01-01 03:00:00+00
+SELECT time_bucket_gapfill('1 hour', '2024-01-01 03:30:00+00'::timestamptz);
+
+-- error: no start / finish
+SELECT time_bucket_gapfill('1 hour', time) AS hour, count(*) FROM sensor_data GROUP BY hour;
+
+-- Cleanup
+DROP TABLE sensor_data CASCADE;
@@ -0,0 +1,59 @@
+DROP TABLE IF EXISTS sensor_data CASCADE;
+CREATE TABLE sensor_data (
+    time TIMESTAMPTZ NOT NULL,
+    sensor_id INTEGER,
+    temperature DOUBLE PRECISION
+);
+
+\echo 'Plain table, cached as not a hypertable...'
+
+-- return 0
+SELECT COUNT(*) FROM sensor_data;
+
+SELECT create_hypertable('sensor_data', 'time', INTERVAL '1 day');
+
+INSERT INTO sensor_data
+SELECT '2024-01-01 00:00:00+00'::timestamptz + (i * INTERVAL '1 hour'), i % 10, 20.0
+FROM generate_series(0, 10 * 24 - 1) AS i;
+
+-- ==========================================
+-- Test create_hypertable invalidates the cached entry
+-- ==========================================
+EXPLAIN (COSTS OFF)
+SELECT * FROM sensor_data WHERE time >= '2024-01-10';
+-- output must scan sensor_data (parent) and 1 chunk
+
+\echo 'Transactions not changing hypertables keep the cache...'
+
+BEGIN;
+INSERT INTO sensor_data VALUES ('2024-01-10 12:30:00+00', 1, 21.0);
+COMMIT;
+
+-- return 25
+SELECT COUNT(*) FROM sensor_data WHERE time >= '2024-01-10';
+
+\echo 'Aborted create_hypertable leaves a plain table...'
+
+DROP TABLE IF EXISTS plain_data;
+CREATE TABLE plain_data (time TIMESTAMPTZ NOT NULL, value DOUBLE PRECISION);
+INSERT INTO plain_data VALUES ('2024-01-01 00:00:00+00', 1.0);
+
+BEGIN;
+SELECT create_hypertable('plain_data', 'time', INTERVAL '1 day');
+ROLLBACK;
+
+-- return 1
+SELECT COUNT(*) FROM plain_data WHERE time >= '2024-01-01';
+
+DROP TABLE plain_data;
+
+-- ==========================================
+-- Test drop_hypertable invalidates the cached entry
+-- ==========================================
+SELECT drop_hypertable('sensor_data');
+
+EXPLAIN (COSTS OFF)
+SELECT * FROM sensor_data WHERE time >= '2024-01-10';
+-- output must show a plain Seq Scan on sensor_data
+
+DROP TABLE sensor_data CASCADE;
@@ -0,0 +1,83 @@
+DROP TABLE IF EXISTS sensor_data CASCADE;
+
+CREATE TABLE sensor_data (
+    time      TIMESTAMPTZ NOT NULL,
+    sensor_id INTEGER,
+    value     DOUBLE PRECISION
+);
+
+SELECT create_hypertable('sensor_data', 'time', INTERVAL '1 day');
+
+-- =============================================
+-- Queue rows, writer (or flush) routes them into chunks
+-- =============================================
+
+-- counters are shared by the database, compare against the values before
+SELECT enqueued AS enqueued_before, written AS written_before, failed AS failed_before, dropped AS dropped_before
+FROM ingest_async_stats() \gset
+
+-- return true
+SELECT ingest_async('sensor_data', ROW('2024-01-01 10:00+00', 1, 10.0)::sensor_data);
+
+SELECT bool_and(ingest_async('sensor_data', ROW('2024-01-02 00:00+00'::timestamptz + i * INTERVAL '1 minute', i, i)::sensor_data))
+FROM generate_series(1, 5000) AS i; -- return true
+
+SELECT ingest_async_flush();
+
+-- return 5001
+SELECT count(*) FROM sensor_data;
+
+-- return 0 (nothing left in queue)
+SELECT queue_depth, queue_bytes FROM ingest_async_stats();
+
+-- return 5001 5001 0 0
+SELECT enqueued - :enqueued_before, written - :written_before, failed - :failed_before, dropped - :dropped_before
+FROM ingest_async_stats();
+
+-- =============================================
+-- Rows follow the transaction of the caller
+-- =============================================
+
+BEGIN;
+SELECT ingest_async('sensor_data', ROW('2024-01-05 10:00+00', 2, 20.0)::sensor_data);
+ROLLBACK;
+
+BEGIN;
+SELECT ingest_async('sensor_data', ROW('2024-01-05 11:00+00', 3, 30.0)::sensor_data);
+SAVEPOINT s1;
+SELECT ingest_async('sensor_data', ROW('2024-01-05 12:00+00', 4, 40.0)::sensor_data);
+ROLLBACK TO SAVEPOINT s1;
+COMMIT;
+
+SELECT ingest_async_flush();
+
+-- return 1 (row of sensor 3 only)
+SELECT count(*) FROM sensor_data WHERE time >= '2024-01-05';
+
+-- rows of the current transaction are written by flush
+BEGIN;
+SELECT ingest_async('sensor_data', ROW('2024-01-05 13:00+00', 5, 50.0)::sensor_data);
+SELECT ingest_async_flush();
+-- return 2
+SELECT count(*) FROM sensor_data WHERE time >= '2024-01-05';
+ROLLBACK;
+
+-- return 1
+SELECT count(*) FROM sensor_data WHERE time >= '2024-01-05';
+
+-- =============================================
+-- Errors
+-- =============================================
+
+-- record of another type
+SELECT ingest_async('sensor_data', ROW(NOW(), 1));
+
+-- not a hypertable
+CREATE TABLE plain_table (time TIMESTAMPTZ, value DOUBLE PRECISION);
+SELECT ingest_async('plain_table', ROW(NOW(), 1.0)::plain_table);
+DROP TABLE plain_table;
+
+-- row level security would be bypassed by the writer
+ALTER TABLE sensor_data ENABLE ROW LEVEL SECURITY;
+SELECT ingest_async('sensor_data', ROW('2024-01-01 11:00+00', 1, 11.0)::sensor_data);
+ALTER TABLE sensor_data DISABLE ROW LEVEL SECURITY;
@@ -0,0 +1,86 @@
+DROP TABLE IF EXISTS sensor_data CASCADE;
+CREATE TABLE sensor_data (
+    time TIMESTAMPTZ NOT NULL,
+    sensor_id INTEGER,
+    temperature DOUBLE PRECISION,
+    humidity DOUBLE PRECISION
+);
+
+SELECT create_hypertable('sensor_data', 'time', INTERVAL '1 day');
+
+\echo 'Column arrays spanning 3 days, out of order...'
+
+-- return 4
+SELECT ingest_columns('sensor_data',
+    ARRAY['2024-01-03 08:00:00+00', '2024-01-01 00:00:00+00',
+          '2024-01-02 10:00:00+00', '2024-01-01 12:00:00+00']::timestamptz[],
+    ARRAY[1, 1, 3, 2],
+    ARRAY[24.0, 25.5, 28.0, 27.5]::double precision[],
+    ARRAY[58.0, 60.0, NULL, 62.0]::double precision[]);
+
+-- parent table must return 0
+SELECT COUNT(*) FROM ONLY sensor_data;
+
+SELECT * FROM sensor_data ORDER BY time;
+
+-- 3 chunks created
+SELECT table_name FROM _timeseries_catalog.chunk ORDER BY start_time;
+
+
+\echo 'Bulk columnar ingest...'
+
+-- return 100000
+SELECT ingest_columns('sensor_data',
+    array_agg('2024-02-01 00:00:00+00'::timestamptz + (i * INTERVAL '1 minute')),
+    array_agg(i % 10),
+    array_agg(20.0::double precision),
+    array_agg(50.0::double precision))
+FROM generate_series(0, 99999) AS i;
+
+-- return 100000
+SELECT COUNT(*) FROM sensor_data WHERE time >= '2024-02-01';
+
+
+\echo 'Dropped column is skipped...'
+ALTER TABLE sensor_data DROP COLUMN humidity;
+
+SELECT ingest_columns('sensor_data',
+    ARRAY['2024-01-01 06:00:00+00']::timestamptz[],
+    ARRAY[5],
+    ARRAY[21.0]::double precision[]);
+
+SELECT * FROM sensor_data WHERE sensor_id = 5;
+
+
+\echo 'Length mismatch must fail...'
+SELECT ingest_columns('sensor_data',
+    ARRAY['2024-01-01 00:00:00+00', '2024-01-01 01:00:00+00']::timestamptz[],
+    ARRAY[1],
+    ARRAY[20.0, 21.0]::double precision[]);
+
+\echo 'Wrong element type must fail...'
+SELECT ingest_columns('sensor_data',
+    ARRAY['2024-01-01 00:00:00+00']::timestamptz[],
+    ARRAY[1],
+    ARRAY[20.0]::numeric[]);
+
+\echo 'Missing column array must fail...'
+SELECT ingest_columns('sensor_data',
+    ARRAY['2024-01-01 00:00:00+00']::timestamptz[],
+    ARRAY[1]);
+
+\echo 'NULL array must fail...'
+SELECT ingest_columns('sensor_data',
+    NULL::timestamptz[],
+    ARRAY[1],
+    ARRAY[20.0]::double precision[]);
+SELECT ingest_columns('sensor_data',
+    ARRAY['2024-01-01 00:00:00+00']::timestamptz[],
+    ARRAY[1],
+    NULL::double precision[]);
+
+\echo 'NULL time must fail...'
+SELECT ingest_columns('sensor_data',
+    ARRAY[NULL]::timestamptz[],
+    ARRAY[1],
+    ARRAY[20.0]::double precision[]);
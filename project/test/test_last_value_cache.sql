@@ -0,0 +1,116 @@
+DROP TABLE IF EXISTS sensor_data CASCADE;
+CREATE TABLE sensor_data (
+    time TIMESTAMPTZ NOT NULL,
+    sensor_id INTEGER,
+    location TEXT,
+    temperature DOUBLE PRECISION
+);
+
+SELECT create_hypertable('sensor_data', 'time', INTERVAL '1 day');
+
+\echo '10 days of rows every minute from 10 sensors, 10 chunks...'
+
+INSERT INTO sensor_data
+SELECT '2024-01-01 00:00:00+00'::timestamptz + (i * INTERVAL '1 minute'), i % 10, 'room_' || (i % 10), i % 40
+FROM generate_series(0, 10 * 1440 - 1) AS i;
+
+-- rows without sensor form their own series
+INSERT INTO sensor_data VALUES ('2024-01-05 12:00:00+00', NULL, 'hall', 1.0);
+
+-- ==========================================
+-- Test enable
+-- ==========================================
+-- error: cache not enabled yet
+SELECT * FROM last_values(NULL::sensor_data);
+
+-- error: column does not exist
+SELECT enable_last_value_cache('sensor_data', 'no_such_column');
+
+SELECT enable_last_value_cache('sensor_data', 'sensor_id');
+
+-- first call scans and fills the cache, 10 sensors and NULL: return 11
+SELECT count(*) FROM last_values(NULL::sensor_data);
+
+-- second call reads the cache, must match DISTINCT ON
+SELECT l.sensor_id, l.time, l.temperature
+FROM last_values(NULL::sensor_data) l
+EXCEPT
+SELECT DISTINCT ON (sensor_id) sensor_id, time, temperature
+FROM sensor_data ORDER BY sensor_id, time DESC;
+-- return 0 rows
+
+-- ==========================================
+-- Test insert
+-- ==========================================
+INSERT INTO sensor_data VALUES ('2024-01-11 00:00:00+00', 3, 'room_3', 99.0);
+
+-- newer row replaces the cached one, return 2024-01-11 00:00:00+00 | 99
+SELECT time, temperature FROM last_values(NULL::sensor_data) WHERE sensor_id = 3;
+
+-- older row keeps the cached one, return 2024-01-11 00:00:00+00 | 99
+INSERT INTO sensor_data VALUES ('2024-01-02 00:00:00+00', 3, 'room_3', -1.0);
+SELECT time, temperature FROM last_values(NULL::sensor_data) WHERE sensor_id = 3;
+
+-- new series, return 12
+INSERT INTO sensor_data VALUES ('2024-01-03 00:00:00+00', 42, 'roof', 7.0);
+SELECT count(*) FROM last_values(NULL::sensor_data);
+
+-- rolled back rows are not cached, return 2024-01-11 00:00:00+00 | 99
+BEGIN;
+INSERT INTO sensor_data VALUES ('2024-01-12 00:00:00+00', 3, 'room_3', 0.0);
+ROLLBACK;
+SELECT time, temperature FROM last_values(NULL::sensor_data) WHERE sensor_id = 3;
+
+-- rolled back savepoint, cache is scanned again, return 2024-01-11 00:00:00+00 | 99
+BEGIN;
+INSERT INTO sensor_data VALUES ('2024-01-11 00:00:00+00', 4, 'room_4', 50.0);
+SAVEPOINT s;
+INSERT INTO sensor_data VALUES ('2024-01-12 00:00:00+00', 3, 'room_3', 0.0);
+ROLLBACK TO SAVEPOINT s;
+COMMIT;
+SELECT time, temperature FROM last_values(NULL::sensor_data) WHERE sensor_id = 3;
+
+-- COPY, return 2024-01-13 00:00:00+00 | 5
+COPY sensor_data FROM STDIN WITH (FORMAT csv);
+2024-01-13 00:00:00+00,5,room_5,5.0
+\.
+SELECT time, temperature FROM last_values(NULL::sensor_data) WHERE sensor_id = 5;
+
+-- ==========================================
+-- Test invalidation
+-- ==========================================
+-- DELETE removes the newest row, return 2024-01-10 23:53:00+00
+DELETE FROM sensor_data WHERE sensor_id = 3 AND time = '2024-01-11 00:00:00+00';
+SELECT time FROM last_values(NULL::sensor_data) WHERE sensor_id = 3;
+
+-- UPDATE, return 100
+UPDATE sensor_data SET temperature = 100 WHERE sensor_id = 42;
+SELECT temperature FROM last_values(NULL::sensor_data) WHERE sensor_id = 42;
+
+-- ==========================================
+-- Test series column
+-- ==========================================
+-- text series, return 12 (room_0 .. room_9, hall, roof)
+SELECT enable_last_value_cache('sensor_data', 'location');
+SELECT count(*) FROM last_values(NULL::sensor_data);
+
+-- series value longer than 64 bytes, still returned (scan), return 13
+INSERT INTO sensor_data VALUES ('2024-01-04 00:00:00+00', 0, repeat('x', 100), 1.0);
+SELECT count(*) FROM last_values(NULL::sensor_data);
+
+-- ==========================================
+-- Test disable
+-- ==========================================
+SELECT disable_last_value_cache('sensor_data');
+
+-- error: cache not enabled
+SELECT * FROM last_values(NULL::sensor_data);
+
+-- return 0, trigger is dropped
+SELECT count(*) FROM pg_trigger WHERE tgname = 'last_value_cache_trigger';
+
+-- error: not a hypertable row
+SELECT * FROM last_values(NULL::pg_class);
+
+-- Cleanup
+DROP TABLE sensor_data CASCADE;
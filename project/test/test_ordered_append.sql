@@ -0,0 +1,71 @@
+DROP TABLE IF EXISTS sensor_data CASCADE;
+CREATE TABLE sensor_data (
+    time TIMESTAMPTZ NOT NULL,
+    sensor_id INTEGER,
+    temperature DOUBLE PRECISION,
+    humidity DOUBLE PRECISION
+);
+
+-- row left in the parent table, create_hypertable does not move existing rows
+INSERT INTO sensor_data VALUES ('2024-01-15 12:00:00.5+00', 99, 0.0, 0.0);
+
+SELECT create_hypertable('sensor_data', 'time', INTERVAL '1 day');
+
+\echo '30 days of rows every minute, 30 chunks...'
+
+INSERT INTO sensor_data
+SELECT '2024-01-01 00:00:00+00'::timestamptz + (i * INTERVAL '1 minute'), i % 10, i % 40, 50.0
+FROM generate_series(0, 30 * 1440 - 1) AS i;
+
+CREATE INDEX ON sensor_data (time DESC);
+ANALYZE sensor_data;
+
+-- ==========================================
+-- Test ORDER BY time DESC LIMIT
+-- ==========================================
+EXPLAIN (ANALYZE, COSTS OFF, TIMING OFF, SUMMARY OFF)
+SELECT * FROM sensor_data ORDER BY time DESC LIMIT 100;
+-- output must show Custom Scan (ChunkAppend) Ordered: true, only the latest chunk scan is executed
+
+-- return 2024-01-30 23:59:00+00, 2024-01-30 22:20:00+00
+SELECT max(time), min(time)
+FROM (SELECT time FROM sensor_data ORDER BY time DESC LIMIT 100) AS latest;
+
+-- ascending, return 2024-01-01 00:00:00+00, 2024-01-02 00:59:00+00
+SELECT min(time), max(time)
+FROM (SELECT time FROM sensor_data ORDER BY time LIMIT 1500) AS first_rows;
+
+\echo 'Sort over the chunks (no index on time)...'
+
+DROP INDEX sensor_data_time_idx;
+SELECT format('DROP INDEX %I.%I', schemaname, indexname)
+FROM pg_indexes
+WHERE tablename IN (SELECT table_name FROM _timeseries_catalog.chunk) \gexec
+
+EXPLAIN (ANALYZE, COSTS OFF, TIMING OFF, SUMMARY OFF)
+SELECT time, temperature FROM sensor_data ORDER BY time DESC, temperature LIMIT 10;
+-- output must show Merge Append over Custom Scan (ChunkAppend) with a Sort per chunk
+
+-- same rows as a plain sort, return true
+SELECT array_agg(t ORDER BY t DESC) = (
+    SELECT array_agg(time ORDER BY time DESC)
+    FROM (SELECT time FROM sensor_data ORDER BY time DESC OFFSET 0) AS s
+    WHERE time >= '2024-01-30 23:50:00+00'
+)
+FROM (SELECT time AS t FROM sensor_data ORDER BY time DESC LIMIT 10) AS latest;
+
+\echo 'Rows left in the parent before create_hypertable are merged in order...'
+
+-- return 99
+SELECT sensor_id FROM (
+    SELECT * FROM sensor_data WHERE time <= '2024-01-15 12:01:00+00' ORDER BY time DESC LIMIT 2
+) AS s
+ORDER BY time LIMIT 1;
+
+\echo 'Time order is not used for other sort keys...'
+
+EXPLAIN (COSTS OFF)
+SELECT * FROM sensor_data ORDER BY temperature LIMIT 10;
+-- output must show a plain Sort, no ChunkAppend
+
+DROP TABLE sensor_data CASCADE;
@@ -0,0 +1,111 @@
+DROP TABLE IF EXISTS sensor_data CASCADE;
+CREATE TABLE sensor_data (
+    time TIMESTAMPTZ NOT NULL,
+    sensor_id INTEGER,
+    temperature DOUBLE PRECISION,
+    humidity DOUBLE PRECISION
+);
+
+DROP TABLE IF EXISTS alerts CASCADE;
+CREATE TABLE alerts (
+    time TIMESTAMPTZ NOT NULL,
+    sensor_id INTEGER,
+    level INTEGER
+);
+
+SELECT create_hypertable('sensor_data', 'time', INTERVAL '1 day');
+SELECT create_hypertable('alerts', 'time', INTERVAL '1 day');
+
+\echo '30 days of hourly rows, alerts every 6 hours...'
+
+INSERT INTO sensor_data
+SELECT '2024-01-01 00:00:00+00'::timestamptz + (i * INTERVAL '1 hour'), i % 10, 20.0, 50.0
+FROM generate_series(0, 30 * 24 - 1) AS i;
+
+INSERT INTO alerts
+SELECT '2024-01-01 00:00:00+00'::timestamptz + (i * INTERVAL '6 hours'), i % 10, i % 3
+FROM generate_series(0, 30 * 4 - 1) AS i;
+
+DROP TABLE IF EXISTS sensors;
+CREATE TABLE sensors (id INTEGER, name TEXT);
+INSERT INTO sensors SELECT i, 'sensor ' || i FROM generate_series(0, 9) AS i;
+
+-- ==========================================
+-- Test hypertables below the top query level
+-- ==========================================
+EXPLAIN (COSTS OFF)
+SELECT d.time, a.level
+FROM sensor_data d
+JOIN alerts a ON a.time = d.time AND a.sensor_id = d.sensor_id
+WHERE d.time >= '2024-01-30' AND a.time >= '2024-01-30';
+-- output must scan 1 chunk of each hypertable
+
+-- return 2
+SELECT COUNT(*)
+FROM sensor_data d
+JOIN alerts a ON a.time = d.time AND a.sensor_id = d.sensor_id
+WHERE d.time >= '2024-01-30' AND a.time >= '2024-01-30';
+
+EXPLAIN (COSTS OFF)
+SELECT s.name, latest.temperature
+FROM sensors s,
+LATERAL (SELECT temperature FROM sensor_data d WHERE d.sensor_id = s.id AND d.time >= '2024-01-30' LIMIT 1) latest;
+-- subquery, output must scan 1 chunk
+
+EXPLAIN (COSTS OFF)
+WITH recent AS MATERIALIZED (
+    SELECT * FROM sensor_data WHERE time >= '2024-01-29'
+)
+SELECT sensor_id, COUNT(*) FROM recent GROUP BY sensor_id;
+-- CTE, output must scan 2 chunks
+
+-- return 48
+WITH recent AS MATERIALIZED (
+    SELECT * FROM sensor_data WHERE time >= '2024-01-29'
+)
+SELECT COUNT(*) FROM recent;
+
+EXPLAIN (COSTS OFF)
+SELECT * FROM sensors
+WHERE id IN (SELECT sensor_id FROM alerts WHERE time >= '2024-01-30' AND level = 2);
+-- sublink, output must scan 1 alerts chunk
+
+\echo 'UPDATE / DELETE / INSERT ... SELECT...'
+
+EXPLAIN (COSTS OFF)
+UPDATE sensors s SET name = name
+FROM sensor_data d
+WHERE d.sensor_id = s.id AND d.time >= '2024-01-30';
+-- hypertable in FROM, output must scan 1 chunk
+
+EXPLAIN (COSTS OFF)
+DELETE FROM alerts a
+USING sensor_data d
+WHERE a.time = d.time AND d.time >= '2024-01-30' AND a.time >= '2024-01-30';
+-- output must scan 1 chunk of sensor_data, alerts chunks by constraint exclusion
+
+DROP TABLE IF EXISTS daily;
+CREATE TABLE daily (day DATE, n BIGINT);
+
+EXPLAIN (COSTS OFF)
+INSERT INTO daily
+SELECT time::date, COUNT(*) FROM sensor_data WHERE time >= '2024-01-30' GROUP BY 1;
+-- output must scan 1 chunk
+
+EXPLAIN (ANALYZE, COSTS OFF, TIMING OFF, SUMMARY OFF)
+DELETE FROM alerts WHERE time >= now() - INTERVAL '1 hour';
+-- output must show Custom Scan (ChunkAppend) below Delete, all chunks excluded during startup
+
+-- return 24
+WITH deleted AS (
+    DELETE FROM sensor_data WHERE time >= '2024-01-30' RETURNING *
+)
+SELECT COUNT(*) FROM deleted;
+
+-- return 696
+SELECT COUNT(*) FROM sensor_data;
+
+DROP TABLE daily;
+DROP TABLE sensors;
+DROP TABLE alerts CASCADE;
+DROP TABLE sensor_data CASCADE;
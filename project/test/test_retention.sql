@@ -44,6 +44,9 @@ INSERT INTO sensor_data VALUES
     ('2024-01-09 12:00', 1, 18.0),
     ('2024-01-10 12:00', 3, 40.0);
 
+-- dropped chunks must be recreated, not served from the routing cache (return 10)
+SELECT count(*) AS recreated_chunks FROM _timeseries_catalog.chunk;
+
 -- set policy (drop partial chunks)
 SELECT set_retention_policy('sensor_data', INTERVAL '365 days'); 
 
@@ -0,0 +1,91 @@
+DROP TABLE IF EXISTS sensor_data CASCADE;
+CREATE TABLE sensor_data (
+    time TIMESTAMPTZ NOT NULL,
+    sensor_id INTEGER,
+    temperature DOUBLE PRECISION,
+    humidity DOUBLE PRECISION
+);
+
+SELECT create_hypertable('sensor_data', 'time', INTERVAL '1 day');
+
+\echo '10 days of rows every minute from 10 sensors, 10 chunks...'
+
+INSERT INTO sensor_data
+SELECT '2024-01-01 00:00:00+00'::timestamptz + (i * INTERVAL '1 minute'), i % 10, i % 40, 50.0
+FROM generate_series(0, 10 * 1440 - 1) AS i;
+
+-- rows without sensor form their own group
+INSERT INTO sensor_data VALUES ('2024-01-05 12:00:00.5+00', NULL, 1.0, 1.0);
+
+CREATE INDEX ON sensor_data (sensor_id, time DESC);
+ANALYZE sensor_data;
+
+-- the planner has to read the chunks through the index
+SET enable_sort = off;
+SET enable_hashagg = off;
+SET enable_seqscan = off;
+SET enable_bitmapscan = off;
+
+-- ==========================================
+-- Test latest row per sensor
+-- ==========================================
+EXPLAIN (ANALYZE, COSTS OFF, TIMING OFF, SUMMARY OFF)
+SELECT DISTINCT ON (sensor_id) sensor_id, time, temperature
+FROM sensor_data ORDER BY sensor_id, time DESC;
+-- output must show Custom Scan (SkipScan) per chunk, 11 rows at most from every chunk index scan
+
+-- 10 sensors and NULL, all at the last day, return 11, 11, 0
+SELECT count(*), count(*) FILTER (WHERE time >= '2024-01-10 23:50:00+00' OR sensor_id IS NULL),
+       count(*) FILTER (WHERE sensor_id IS NULL AND time <> '2024-01-05 12:00:00.5+00')
+FROM (
+    SELECT DISTINCT ON (sensor_id) sensor_id, time, temperature
+    FROM sensor_data ORDER BY sensor_id, time DESC
+) AS latest;
+
+-- same rows as reading every row, return 0
+SET simple_timeseries.enable_skip_scan = off;
+CREATE TEMP TABLE latest_all AS
+SELECT DISTINCT ON (sensor_id) sensor_id, time, temperature
+FROM sensor_data ORDER BY sensor_id, time DESC;
+RESET simple_timeseries.enable_skip_scan;
+
+SELECT count(*) FROM (
+    (SELECT DISTINCT ON (sensor_id) sensor_id, time, temperature
+     FROM sensor_data ORDER BY sensor_id, time DESC)
+    EXCEPT
+    (SELECT * FROM latest_all)
+) AS diff;
+
+\echo 'Other quals are kept...'
+
+-- temperature below 5 only on sensors 0 to 4, return 5
+SELECT count(*) FROM (
+    SELECT DISTINCT ON (sensor_id) sensor_id, time
+    FROM sensor_data WHERE temperature < 5 AND sensor_id IS NOT NULL
+    ORDER BY sensor_id, time DESC
+) AS latest;
+
+\echo 'Distinct values, descending...'
+
+EXPLAIN (COSTS OFF)
+SELECT DISTINCT sensor_id FROM sensor_data ORDER BY sensor_id DESC;
+-- output must show Custom Scan (SkipScan) over a backward index (only) scan per chunk
+
+-- NULL first in descending order, return NULL, 9, 8, ..., 0
+SELECT DISTINCT sensor_id FROM sensor_data ORDER BY sensor_id DESC;
+
+\echo 'Nested loop rescans...'
+
+-- return 0|1, 1|1, 2|1
+SELECT s.id, (SELECT count(*) FROM (
+    SELECT DISTINCT ON (sensor_id) sensor_id FROM sensor_data
+    WHERE sensor_id = s.id ORDER BY sensor_id, time DESC) AS d)
+FROM generate_series(0, 2) AS s(id);
+
+RESET enable_sort;
+RESET enable_hashagg;
+RESET enable_seqscan;
+RESET enable_bitmapscan;
+
+DROP TABLE latest_all;
+DROP TABLE sensor_data CASCADE;
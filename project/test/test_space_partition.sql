@@ -0,0 +1,87 @@
+DROP TABLE IF EXISTS sensor_data CASCADE;
+CREATE TABLE sensor_data (
+    time TIMESTAMPTZ NOT NULL,
+    sensor_id INTEGER,
+    temperature DOUBLE PRECISION,
+    humidity DOUBLE PRECISION
+);
+
+SELECT create_hypertable('sensor_data', 'time', INTERVAL '1 day');
+SELECT add_dimension('sensor_data', 'sensor_id', 4);
+
+SELECT column_name, interval_length, num_partitions
+FROM _timeseries_catalog.dimension
+ORDER BY id;
+
+\echo 'Rows of one day split by sensor bucket...'
+
+INSERT INTO sensor_data
+SELECT '2024-01-01 00:00:00+00'::timestamptz + (i * INTERVAL '1 minute'), i % 8, 20.0, 50.0
+FROM generate_series(0, 999) AS i;
+
+-- up to 4 chunks for 2024-01-01, one per bucket
+SELECT space_bucket, COUNT(*)
+FROM _timeseries_catalog.chunk
+GROUP BY space_bucket
+ORDER BY space_bucket;
+
+-- return 1000
+SELECT COUNT(*) FROM sensor_data;
+
+-- every sensor lives in exactly one chunk
+SELECT sensor_id, COUNT(DISTINCT tableoid) AS chunks
+FROM sensor_data
+GROUP BY sensor_id
+ORDER BY sensor_id;
+
+\echo 'COPY routes by bucket as well...'
+
+COPY sensor_data FROM STDIN WITH (FORMAT csv);
+2024-01-02 00:00:00+00,1,25.5,60.0
+2024-01-02 00:00:00+00,2,27.5,62.0
+2024-01-02 00:00:00+00,,28.0,63.0
+\.
+
+-- NULL sensor goes to bucket 0
+SELECT c.space_bucket
+FROM sensor_data s
+JOIN pg_class p ON p.oid = s.tableoid
+JOIN _timeseries_catalog.chunk c ON c.table_name = p.relname
+WHERE s.sensor_id IS NULL;
+
+-- ==========================================
+-- Test space pruning
+-- ==========================================
+EXPLAIN (COSTS OFF)
+SELECT * FROM sensor_data WHERE sensor_id = 3;
+-- output must scan one chunk per day
+
+EXPLAIN (COSTS OFF)
+SELECT * FROM sensor_data
+WHERE sensor_id = 3 AND time >= '2024-01-02';
+-- output must scan a single chunk
+
+-- pruned result equals full result, return 125
+SELECT COUNT(*) FROM sensor_data WHERE sensor_id = 3;
+
+\echo 'add_dimension errors...'
+
+-- chunks already exist
+SELECT add_dimension('sensor_data', 'humidity', 2);
+
+DROP TABLE IF EXISTS plain_table;
+CREATE TABLE plain_table (time TIMESTAMPTZ NOT NULL, device TEXT);
+-- not a hypertable
+SELECT add_dimension('plain_table', 'device', 2);
+
+SELECT create_hypertable('plain_table', 'time', INTERVAL '1 day');
+-- invalid partition count
+SELECT add_dimension('plain_table', 'device', 0);
+-- time column
+SELECT add_dimension('plain_table', 'time', 2);
+-- second space dimension
+SELECT add_dimension('plain_table', 'device', 2);
+SELECT add_dimension('plain_table', 'device', 3);
+
+SELECT drop_hypertable('plain_table');
+SELECT drop_hypertable('sensor_data');
@@ -0,0 +1,116 @@
+-- ==========================================
+-- Test time_bucket values
+-- ==========================================
+-- return 2024-01-05 14:00:00+00, 2024-01-05 00:00:00+00
+SELECT time_bucket('1 hour', '2024-01-05 14:35:22+00'::timestamptz),
+       time_bucket('1 day', '2024-01-05 14:35:22+00'::timestamptz);
+
+-- times before 2000-01-01 round down too, return 1999-12-31 00:00:00+00
+SELECT time_bucket('1 day', '1999-12-31 18:00:00+00'::timestamptz);
+
+-- origin and offset, return 2024-01-05 06:00:00+00, 2024-01-05 06:00:00+00
+SELECT time_bucket('1 day', '2024-01-05 14:35:22+00'::timestamptz, origin => '2024-01-01 06:00:00+00'::timestamptz),
+       time_bucket('1 day', '2024-01-05 14:35:22+00'::timestamptz, "offset" => INTERVAL '6 hours');
+
+-- timestamp without time zone, return 2024-01-05 14:30:00
+SELECT time_bucket('15 minutes', '2024-01-05 14:35:22'::timestamp);
+
+-- integer time, return 1200, -200, 1205, 10
+SELECT time_bucket(100, 1234), time_bucket(100, -123), time_bucket(100::bigint, 1234::bigint, 5::bigint),
+       time_bucket(5::smallint, 14::smallint);
+
+-- infinity stays infinity, return infinity
+SELECT time_bucket('1 day', 'infinity'::timestamptz);
+
+-- error: months
+SELECT time_bucket('1 month', now());
+
+-- error: width must be positive
+SELECT time_bucket(0, 10);
+
+-- constant folded at plan time (IMMUTABLE), output must show a constant, no function call
+EXPLAIN (VERBOSE, COSTS OFF) SELECT time_bucket('1 day', '2024-01-05 14:35:22+00'::timestamptz);
+
+-- ==========================================
+-- Hypertable
+-- ==========================================
+DROP TABLE IF EXISTS sensor_data CASCADE;
+CREATE TABLE sensor_data (
+    time TIMESTAMPTZ NOT NULL,
+    sensor_id INTEGER,
+    temperature DOUBLE PRECISION
+);
+
+SELECT create_hypertable('sensor_data', 'time', INTERVAL '1 day');
+
+\echo '10 days of rows every minute, 10 chunks...'
+
+INSERT INTO sensor_data
+SELECT '2024-01-01 00:00:00+00'::timestamptz + (i * INTERVAL '1 minute'), i % 10, i % 40
+FROM generate_series(0, 10 * 1440 - 1) AS i;
+
+CREATE INDEX ON sensor_data (time DESC);
+ANALYZE sensor_data;
+
+-- ==========================================
+-- Test bucket quals restrict time
+-- ==========================================
+EXPLAIN (COSTS OFF)
+SELECT count(*) FROM sensor_data WHERE time_bucket('1 day', time) >= '2024-01-08 00:00:00+00';
+-- output must show only the chunks of 2024-01-08 .. 2024-01-10, with time >= '2024-01-08 00:00:00+00' on them
+
+-- 3 days, return 4320
+SELECT count(*) FROM sensor_data WHERE time_bucket('1 day', time) >= '2024-01-08 00:00:00+00';
+
+-- constant inside a bucket: bucket 2024-01-07 is not > 2024-01-07 12:00, return 4320
+SELECT count(*) FROM sensor_data WHERE time_bucket('1 day', time) > '2024-01-07 12:00:00+00';
+
+-- bucket 2024-01-02 .. 2024-01-03 both ends, return 2880, 1440
+SELECT count(*) FROM sensor_data
+WHERE time_bucket('1 day', time) >= '2024-01-02 00:00:00+00' AND time_bucket('1 day', time) <= '2024-01-03 00:00:00+00';
+SELECT count(*) FROM sensor_data WHERE time_bucket('1 day', time) = '2024-01-05 00:00:00+00';
+
+-- constant on the left, return 1440
+SELECT count(*) FROM sensor_data WHERE '2024-01-02 00:00:00+00' > time_bucket('1 day', time);
+
+-- same result without the rewrite, return 0 rows
+SELECT time_bucket('1 hour', time) b, count(*) FROM sensor_data
+WHERE time_bucket('1 hour', time) < '2024-01-03 10:30:00+00' GROUP BY 1
+EXCEPT
+SELECT time_bucket('1 hour', time) b, count(*) FROM sensor_data
+WHERE time_bucket('1 hour', time) + INTERVAL '0' < '2024-01-03 10:30:00+00' GROUP BY 1;
+
+-- ==========================================
+-- Test bucket order from time index
+-- ==========================================
+SET enable_hashagg = off;
+SET enable_seqscan = off;
+SET max_parallel_workers_per_gather = 0;
+SET simple_timeseries.enable_chunkwise_aggregation = off;
+
+EXPLAIN (COSTS OFF)
+SELECT time_bucket('1 hour', time), avg(temperature) FROM sensor_data GROUP BY 1 ORDER BY 1;
+-- output must show GroupAggregate -> Merge Append -> Index Scan Backward per chunk, no Sort
+
+-- 240 hours of 60 rows, return 240, 60, 60
+SELECT count(*), min(n), max(n) FROM (
+    SELECT time_bucket('1 hour', time), count(*) AS n FROM sensor_data GROUP BY 1 ORDER BY 1
+) t;
+
+-- buckets come out in order, return 0
+SELECT count(*) FROM (
+    SELECT b, lag(b) OVER () AS prev FROM (
+        SELECT time_bucket('1 hour', time) b FROM sensor_data GROUP BY 1 ORDER BY 1
+    ) s
+) t WHERE prev >= b;
+
+RESET enable_hashagg;
+RESET enable_seqscan;
+RESET max_parallel_workers_per_gather;
+RESET simple_timeseries.enable_chunkwise_aggregation;
+
+-- expression index on the bucket (needs IMMUTABLE)
+CREATE INDEX ON sensor_data (time_bucket('1 hour', time));
+
+-- Cleanup
+DROP TABLE sensor_data CASCADE;
@@ -56,6 +56,8 @@ CREATE TABLE metrics (
     value DOUBLE PRECISION
 );
 
+CREATE INDEX metrics_time_idx ON metrics (time); -- copied to every chunk
+
 SELECT create_hypertable('metrics', 'time', INTERVAL '1 hour');
 
 \echo 'Inserting data spanning 3 hours...'
@@ -68,5 +70,88 @@ INSERT INTO metrics VALUES
 SELECT * FROM metrics ORDER BY time;
 
 
+\echo 'Rows inserted directly into chunk must be visible through chunk indexes...'
+
+SET enable_seqscan = off;
+SELECT COUNT(*) FROM _hyper_2_1_chunk WHERE time = '2024-01-01 00:30:00+00'; -- return 1
+RESET enable_seqscan;
+
+
+\echo 'Bulk INSERT ... SELECT is buffered per chunk...'
+
+SET simple_timeseries.insert_batch_size = 500;
+INSERT INTO metrics
+SELECT '2024-01-02 00:00:00+00'::timestamptz + (i * INTERVAL '1 second'), i
+FROM generate_series(0, 9999) AS i;
+RESET simple_timeseries.insert_batch_size;
+
+SELECT COUNT(*) FROM metrics WHERE time >= '2024-01-02'; -- return 10000
+
+\echo 'Chunk names are numbered per hypertable by a sequence...'
+SELECT c.table_name FROM _timeseries_catalog.chunk c
+JOIN _timeseries_catalog.hypertable h ON h.id = c.hypertable_id
+WHERE h.table_name = 'metrics'
+ORDER BY c.id; -- _hyper_2_1_chunk ... _hyper_2_6_chunk
+
+
+\echo 'Hypertable descriptor is reloaded after drop_hypertable / create_hypertable...'
+
+CREATE TABLE metrics_cache (
+    time TIMESTAMPTZ NOT NULL,
+    value DOUBLE PRECISION
+);
+SELECT create_hypertable('metrics_cache', 'time', INTERVAL '1 hour');
+INSERT INTO metrics_cache VALUES ('2024-01-01 00:30:00+00', 1.0);
+SELECT drop_hypertable('metrics_cache');
+SELECT create_hypertable('metrics_cache', 'time', INTERVAL '1 day');
+INSERT INTO metrics_cache VALUES ('2024-01-01 00:30:00+00', 2.0), ('2024-01-01 23:30:00+00', 3.0);
+SELECT COUNT(*) FROM _timeseries_catalog.chunk c
+JOIN _timeseries_catalog.hypertable h ON h.id = c.hypertable_id
+WHERE h.table_name = 'metrics_cache'; -- return 1 (one day chunk)
+DROP TABLE metrics_cache CASCADE;
+
+
+\echo 'Stored generated columns are computed for rows written into chunks...'
+
+CREATE TABLE metrics_generated (
+    time TIMESTAMPTZ NOT NULL,
+    celsius DOUBLE PRECISION,
+    fahrenheit DOUBLE PRECISION GENERATED ALWAYS AS (celsius * 9 / 5 + 32) STORED
+);
+SELECT create_hypertable('metrics_generated', 'time', INTERVAL '1 day');
+INSERT INTO metrics_generated (time, celsius) VALUES ('2024-01-01 00:00:00+00', 100.0), ('2024-01-02 00:00:00+00', 0.0);
+COPY metrics_generated (time, celsius) FROM STDIN WITH (FORMAT csv);
+2024-01-03 00:00:00+00,-40.0
+\.
+-- return 212, 32, -40
+SELECT fahrenheit FROM metrics_generated ORDER BY time;
+DROP TABLE metrics_generated CASCADE;
+
+
+\echo 'Rows buffered by a failed INSERT are rolled back with its subtransaction...'
+
+BEGIN;
+SAVEPOINT before_insert;
+INSERT INTO metrics VALUES ('2024-03-01 00:00:00+00', 1.0), ('2024-03-01 01:00:00+00', 2.0), (NULL, 3.0); -- error
+ROLLBACK TO SAVEPOINT before_insert;
+COMMIT;
+SELECT COUNT(*) FROM metrics WHERE time >= '2024-03-01'; -- return 0
+
+DO $$
+BEGIN
+    INSERT INTO metrics VALUES ('2024-03-02 00:00:00+00', 1.0), (NULL, 2.0);
+EXCEPTION WHEN others THEN
+    RAISE NOTICE 'insert failed';
+END $$;
+SELECT COUNT(*) FROM metrics WHERE time >= '2024-03-01'; -- return 0
+
+
+\echo 'New connection routes into existing chunks (shared chunk map)...'
+
+\c
+INSERT INTO metrics VALUES ('2024-01-01 00:45:00+00', 110.0);
+SELECT COUNT(*) FROM _hyper_2_1_chunk; -- return 2
+
+
 \echo 'Display all triggers:'
 SELECT * FROM display_all_triggers();
\ No newline at end of file
@@ -268,24 +268,6 @@ cagg_worker_main(Datum main_arg)
 }
 
 
-// round timestamp for place in the same bucket
-PG_FUNCTION_INFO_V1(time_bucket);
-Datum 
-time_bucket(PG_FUNCTION_ARGS)
-{
-    Interval *bucket_width = PG_GETARG_INTERVAL_P(0);
-    TimestampTz ts = PG_GETARG_TIMESTAMPTZ(1);
-
-    // convert to microsec
-    int64 bucket_microseconds = (int64) bucket_width->day  * MICROSECS_PER_DAY + (int64) bucket_width->time;
-    int64 ts_microseconds = (int64) ts;
-
-    int64 bucketed_microseconds = (ts_microseconds / bucket_microseconds) * bucket_microseconds;
-
-    PG_RETURN_TIMESTAMPTZ((TimestampTz) bucketed_microseconds);
-}
-
-
 PG_FUNCTION_INFO_V1(create_continuous_aggregate);
 Datum 
 create_continuous_aggregate(PG_FUNCTION_ARGS)
@@ -4,6 +4,7 @@
 #include <utils/builtins.h>
 #include <utils/timestamp.h>
 #include <utils/lsyscache.h>
+#include <utils/resowner.h>
 #include <catalog/namespace.h>
 #include <access/xact.h>
 #include <pgstat.h>
@@ -14,6 +15,8 @@
 #include <funcapi.h>
 
 #include "../../src/metadata.h"
+#include "../../src/last_value.h"
+#include "../../src/chunk_precreate.h"
 #include "retention.h"
 
 // postgresql use SIGTERM as the signal for background worker to stop
@@ -120,6 +123,11 @@ retention_drop_old_chunks(int hypertable_id, int64 cutoff_time)
         dropped++;
     }
 
+    // newest rows may have been in the dropped chunks
+    if (dropped > 0){
+        last_value_cache_invalidate(hypertable_id);
+    }
+
     return dropped;
 }
 
@@ -196,6 +204,44 @@ retention_apply_all_policies(void)
     return total;
 }
 
+// chunk pre-creation shares this worker, a failing policy is rolled back in its subtransaction and only warned
+static void
+retention_precreate_chunks(void)
+{
+    MemoryContext oldcontext = CurrentMemoryContext;
+    ResourceOwner oldowner = CurrentResourceOwner;
+
+    BeginInternalSubTransaction(NULL);
+    MemoryContextSwitchTo(oldcontext);
+
+    PG_TRY();
+    {
+        int created = chunk_precreate_apply_all_policies();
+        if (created > 0)
+            elog(LOG, "retention worker: total %d chunk(s) pre-created", created);
+
+        ReleaseCurrentSubTransaction();
+        MemoryContextSwitchTo(oldcontext);
+        CurrentResourceOwner = oldowner;
+    }
+    PG_CATCH();
+    {
+        ErrorData *edata;
+
+        MemoryContextSwitchTo(oldcontext);
+        edata = CopyErrorData();
+        FlushErrorState();
+
+        RollbackAndReleaseCurrentSubTransaction();
+        MemoryContextSwitchTo(oldcontext);
+        CurrentResourceOwner = oldowner;
+
+        ereport(WARNING, (errmsg("retention worker: chunk pre-creation failed: %s", edata->message)));
+        FreeErrorData(edata);
+    }
+    PG_END_TRY();
+}
+
 void 
 retention_worker_main(Datum main_arg)
 {
@@ -235,6 +281,8 @@ retention_worker_main(Datum main_arg)
             if (dropped > 0)
                 elog(LOG, "retention worker: total %d chunk(s) dropped", dropped);
 
+            retention_precreate_chunks();
+
             SPI_finish();
             PopActiveSnapshot();
             CommitTransactionCommand();